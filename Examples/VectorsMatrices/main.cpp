@@ -19,14 +19,13 @@ int main()
     Matrix3Df mat = Matrix3Df();
 	mat.Identity();
     mat.Translate(2,3,0);
-	float** data;
-	data = mat.getData(); //get the matrix data
-	cout<<"Matrix -- Column Major (so far...maybe row major in next push)\n";
+	const float* data = mat.Data(); //view of the matrix data (no copy)
+	cout<<"Matrix -- Row Major\n";
     for(int i=0;i<4;i++)
 	{
         for(int j=0;j<4;j++)
 		{
-			cout<<data[i][j]<<" ";
+			cout<<data[i*4+j]<<" ";
 		}
 		cout<<endl;
 	}
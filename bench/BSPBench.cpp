@@ -0,0 +1,99 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+#include <3DTools/BSP.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* BSP tree build vs loading its serialised blob (cold start, with and
+* without validation), and point classification throughput, on a closed
+* bumpy sphere mesh
+**/
+
+/**
+* Get a closed bumpy sphere triangle soup with 8*4^levels triangles
+**/
+template<class T>
+static std::vector<Vector3D<T> > BumpySphere(int levels)
+{
+    std::vector<Vector3D<T> > tris;
+    Vector3D<T> axis[6] = {Vector3D<T>(1,0,0), Vector3D<T>(0,1,0), Vector3D<T>(-1,0,0), Vector3D<T>(0,-1,0), Vector3D<T>(0,0,1), Vector3D<T>(0,0,-1)};
+    for(int i=0;i<4;i++)
+    {
+        Vector3D<T> a = axis[i], b = axis[(i+1)%4];
+        tris.push_back(a); tris.push_back(b); tris.push_back(axis[4]);
+        tris.push_back(b); tris.push_back(a); tris.push_back(axis[5]);
+    }
+    for(int level=0;level<levels;level++)
+    {
+        std::vector<Vector3D<T> > finer;
+        for(std::size_t t=0;t<tris.size();t+=3)
+        {
+            Vector3D<T> a = tris[t], b = tris[t+1], c = tris[t+2];
+            Vector3D<T> ab = a+b, bc = b+c, ca = c+a;
+            ab.Normalize(); bc.Normalize(); ca.Normalize();
+            Vector3D<T> sub[12] = {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca};
+            finer.insert(finer.end(), sub, sub+12);
+        }
+        tris.swap(finer);
+    }
+    for(std::size_t i=0;i<tris.size();i++)
+        tris[i] = tris[i]*(T(1)+T(0.2)*T(std::sin(7*tris[i].X())*std::cos(5*tris[i].Y())));
+    return tris;
+}
+
+template<class T>
+static void BM_BSPBuild(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > soup = BumpySphere<T>(int(state.range(0)));
+    BSPTree<T> tree;
+    for(auto _ : state)
+    {
+        tree.Build(soup, std::vector<std::uint32_t>());
+        benchmark::DoNotOptimize(tree.NodeCount());
+    }
+    state.SetItemsProcessed(state.iterations()*(soup.size()/3));
+    state.counters["fragments"] = double(tree.PolygonCount());
+}
+
+template<class T>
+static void BM_BSPLoad(benchmark::State& state)
+{
+    // range(1) - 1 validates every node and fragment
+    std::vector<Vector3D<T> > soup = BumpySphere<T>(int(state.range(0)));
+    BSPTree<T> tree(soup, std::vector<std::uint32_t>());
+    std::vector<unsigned char> blob;
+    tree.Serialize(blob);
+    BSPView<T> view;
+    for(auto _ : state)
+    {
+        view.Load(&blob[0], blob.size(), state.range(1) != 0);
+        benchmark::DoNotOptimize(view.NodeCount());
+    }
+    state.SetItemsProcessed(state.iterations()*(soup.size()/3));
+    state.SetBytesProcessed(state.iterations()*blob.size());
+}
+
+template<class T>
+static void BM_BSPClassify(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > soup = BumpySphere<T>(int(state.range(0)));
+    BSPTree<T> tree(soup, std::vector<std::uint32_t>());
+    std::vector<Vector3D<T> > points = RandomPoints<T>(1<<12);
+    for(std::size_t i=0;i<points.size();i++)
+        points[i] = points[i]*T(3)-Vector3D<T>(T(1.5),T(1.5),T(1.5));
+    BSPView<T> view = tree.View();
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            benchmark::DoNotOptimize(view.Classify(points[i]));
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+BENCHMARK_TEMPLATE(BM_BSPBuild, float)->Arg(4)->Arg(6)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BSPBuild, double)->Arg(6)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BSPLoad, float)->Args({4, 1})->Args({6, 0})->Args({6, 1})->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_BSPClassify, float)->Arg(4)->Arg(6);
@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+#include <3DTools/BVH.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* BVH build time (single thread vs all hardware threads) and ray throughput
+* (closest hit and any hit) on procedural height-field meshes of up to about
+* four million triangles
+**/
+
+/**
+* Get a wavy grid mesh with about n triangles in [0,1]x[0,1]
+**/
+template<class T>
+static void GridMesh(std::size_t n, std::vector<Vector3D<T> >& vertices, std::vector<std::uint32_t>& indices)
+{
+    std::size_t side = std::size_t(std::sqrt(double(n/2)));
+    vertices.clear();
+    indices.clear();
+    for(std::size_t i=0;i<=side;i++)
+    {
+        for(std::size_t j=0;j<=side;j++)
+        {
+            T x = T(i)/T(side), z = T(j)/T(side);
+            vertices.push_back(Vector3D<T>(x, T(0.05)*T(std::sin(40*x)*std::cos(30*z)), z));
+        }
+    }
+    for(std::size_t i=0;i<side;i++)
+    {
+        for(std::size_t j=0;j<side;j++)
+        {
+            std::uint32_t a = std::uint32_t(i*(side+1)+j), b = a+1;
+            std::uint32_t c = std::uint32_t(a+side+1), d = c+1;
+            indices.push_back(a); indices.push_back(c); indices.push_back(b);
+            indices.push_back(b); indices.push_back(c); indices.push_back(d);
+        }
+    }
+}
+
+/**
+* Get n rays from above the mesh pointing down at random angles (fixed seed)
+**/
+template<class T>
+static std::vector<Ray<T> > RandomRays(std::size_t n)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(2*n);
+    std::vector<Ray<T> > rays(n);
+    for(std::size_t i=0;i<n;i++)
+        rays[i] = Ray<T>(Vector3D<T>(p[2*i].X(), T(1), p[2*i].Z()),
+                         Vector3D<T>(p[2*i+1].X()-T(0.5), T(-1), p[2*i+1].Z()-T(0.5)));
+    return rays;
+}
+
+template<class T>
+static void BM_BVHBuild(benchmark::State& state)
+{
+    // range(1) - build threads (0 for all hardware threads)
+    std::vector<Vector3D<T> > vertices;
+    std::vector<std::uint32_t> indices;
+    GridMesh<T>(state.range(0), vertices, indices);
+    typename BVH<T>::Settings settings;
+    settings.threads = unsigned(state.range(1));
+    BVH<T> bvh;
+    for(auto _ : state)
+    {
+        bvh.Build(vertices, indices, settings);
+        benchmark::DoNotOptimize(bvh.Nodes().data());
+    }
+    state.SetItemsProcessed(state.iterations()*(indices.size()/3));
+}
+
+template<class T>
+static void BM_BVHIntersect(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > vertices;
+    std::vector<std::uint32_t> indices;
+    GridMesh<T>(state.range(0), vertices, indices);
+    BVH<T> bvh(vertices, indices);
+    std::vector<Ray<T> > rays = RandomRays<T>(1<<14);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<rays.size();i++)
+        {
+            RayHit<T> hit;
+            bvh.Intersect(rays[i], hit);
+            benchmark::DoNotOptimize(hit);
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*rays.size());
+}
+
+template<class T>
+static void BM_BVHOccluded(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > vertices;
+    std::vector<std::uint32_t> indices;
+    GridMesh<T>(state.range(0), vertices, indices);
+    BVH<T> bvh(vertices, indices);
+    std::vector<Ray<T> > rays = RandomRays<T>(1<<14);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<rays.size();i++)
+            benchmark::DoNotOptimize(bvh.Occluded(rays[i]));
+    }
+    state.SetItemsProcessed(state.iterations()*rays.size());
+}
+
+BENCHMARK_TEMPLATE(BM_BVHBuild, float)->Args({1<<16, 1})->Args({1<<16, 0})->Args({1<<20, 1})->Args({1<<20, 0})->Args({1<<22, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BVHBuild, double)->Args({1<<20, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_BVHIntersect, float)->Arg(1<<10)->Arg(1<<20)->Arg(1<<22);
+BENCHMARK_TEMPLATE(BM_BVHOccluded, float)->Arg(1<<10)->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_BVHIntersect, double)->Arg(1<<20);
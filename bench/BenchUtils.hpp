@@ -0,0 +1,77 @@
+#ifndef BENCH_UTILS_HPP
+#define BENCH_UTILS_HPP
+
+/**
+* Shared input generators for the benchmarks
+**/
+#include <cstdlib>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+
+namespace Tools3DBench {
+
+using namespace Tools3D;
+
+/**
+* Batch sizes used by the benchmarks: fits L1, fits L2/L3, streams from memory
+**/
+#define TOOLS3D_BENCH_SIZES Arg(1<<4)->Arg(1<<10)->Arg(1<<16)
+
+/**
+* Get a uniform random value in [lo,hi]
+**/
+template<class T>
+inline T RandomValue(T lo, T hi)
+{
+    return lo+(hi-lo)*T(rand())/T(RAND_MAX);
+}
+
+/**
+* Get n random points in the unit cube (fixed seed)
+**/
+template<class T>
+inline std::vector<Vector3D<T> > RandomPoints(std::size_t n)
+{
+    std::vector<Vector3D<T> > points(n);
+    srand(42);
+    for(std::size_t i=0;i<n;i++)
+        points[i] = Vector3D<T>(RandomValue<T>(0,1), RandomValue<T>(0,1), RandomValue<T>(0,1));
+    return points;
+}
+
+/**
+* Get a rotation + translation matrix
+**/
+template<class T>
+inline Matrix3D<T> SomeTransform()
+{
+    Matrix3D<T> mat;
+    mat.RotateX(T(0.3));
+    mat.RotateY(T(-1.1));
+    mat(3,0) = T(2); mat(3,1) = T(-3); mat(3,2) = T(0.5);
+    return mat;
+}
+
+/**
+* Get n random invertible affine matrices (fixed seed)
+**/
+template<class T>
+inline std::vector<Matrix3D<T> > RandomTransforms(std::size_t n)
+{
+    std::vector<Matrix3D<T> > mats(n);
+    srand(7);
+    for(std::size_t i=0;i<n;i++)
+    {
+        mats[i].RotateX(RandomValue<T>(-3,3));
+        mats[i].RotateZ(RandomValue<T>(-3,3));
+        mats[i](3,0) = RandomValue<T>(-10,10);
+        mats[i](3,1) = RandomValue<T>(-10,10);
+        mats[i](3,2) = RandomValue<T>(-10,10);
+    }
+    return mats;
+}
+
+}
+
+#endif
@@ -0,0 +1,108 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/AABB.hpp>
+#include <3DTools/BoundingSphere.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Bounding volumes over large point sets: AoS Expand loop vs SoA SIMD reduction,
+* Ritter sphere fit, and box transforms (Arvo vs transforming the 8 corners)
+**/
+
+template<class T>
+static void BM_AABBExpandLoop(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > points = RandomPoints<T>(state.range(0));
+    for(auto _ : state)
+    {
+        AABB<T> box = AABB<T>::FromPoints(points);
+        benchmark::DoNotOptimize(box);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_AABBFromPointArray(benchmark::State& state)
+{
+    PointArray3D<T> points(RandomPoints<T>(state.range(0)));
+    for(auto _ : state)
+    {
+        AABB<T> box = AABB<T>::FromPoints(points);
+        benchmark::DoNotOptimize(box);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_SphereRitter(benchmark::State& state)
+{
+    PointArray3D<T> points(RandomPoints<T>(state.range(0)));
+    for(auto _ : state)
+    {
+        BoundingSphere<T> sphere = BoundingSphere<T>::FromPoints(points);
+        benchmark::DoNotOptimize(sphere);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static std::vector<AABB<T> > RandomBoxes(std::size_t n)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(2*n);
+    std::vector<AABB<T> > boxes(n);
+    for(std::size_t i=0;i<n;i++)
+    {
+        boxes[i].Expand(p[2*i]);
+        boxes[i].Expand(p[2*i+1]);
+    }
+    return boxes;
+}
+
+template<class T>
+static void BM_AABBTransformCorners(benchmark::State& state)
+{
+    std::vector<AABB<T> > boxes = RandomBoxes<T>(state.range(0)), out(boxes.size());
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<boxes.size();i++)
+        {
+            AABB<T> res;
+            const Vector3D<T>& lo = boxes[i].Min();
+            const Vector3D<T>& hi = boxes[i].Max();
+            for(int k=0;k<8;k++)
+                res.Expand(Vector3D<T>((k&1)?hi.X():lo.X(), (k&2)?hi.Y():lo.Y(), (k&4)?hi.Z():lo.Z())*mat);
+            out[i] = res;
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_AABBTransformArvo(benchmark::State& state)
+{
+    std::vector<AABB<T> > boxes = RandomBoxes<T>(state.range(0)), out(boxes.size());
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+    {
+        Transform(&boxes[0], &out[0], boxes.size(), mat);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_AABBExpandLoop, float)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_AABBFromPointArray, float)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_AABBExpandLoop, double)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_AABBFromPointArray, double)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_SphereRitter, float)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_SphereRitter, double)->TOOLS3D_BENCH_SIZES->Arg(1<<24);
+BENCHMARK_TEMPLATE(BM_AABBTransformCorners, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_AABBTransformArvo, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_AABBTransformCorners, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_AABBTransformArvo, double)->TOOLS3D_BENCH_SIZES;
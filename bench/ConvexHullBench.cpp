@@ -0,0 +1,71 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/ConvexHull.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Convex hull throughput (input points per second) on a solid ball, where
+* almost every point is culled, and on a sphere shell, where many points are
+* vertices; single thread vs all hardware threads
+**/
+
+/**
+* Get n random points in the unit ball (shell - on the unit sphere)
+**/
+template<class T>
+static std::vector<Vector3D<T> > BallPoints(std::size_t n, bool shell)
+{
+    std::vector<Vector3D<T> > points = RandomPoints<T>(2*n);
+    std::vector<Vector3D<T> > ball;
+    ball.reserve(n);
+    for(std::size_t i=0;i<points.size() && ball.size()<n;i++)
+    {
+        Vector3D<T> p = points[i]*T(2)-Vector3D<T>(T(1),T(1),T(1));
+        T len = p.LengthSq();
+        if(len > T(1) || len < T(1e-6))
+            continue;
+        if(shell)
+            p.Normalize();
+        ball.push_back(p);
+    }
+    return ball;
+}
+
+template<class T>
+static void BM_ConvexHullBall(benchmark::State& state)
+{
+    // range(1) - threads (0 for all hardware threads)
+    std::vector<Vector3D<T> > points = BallPoints<T>(state.range(0), false);
+    typename ConvexHull3D<T>::Settings settings;
+    settings.threads = unsigned(state.range(1));
+    ConvexHull3D<T> hull;
+    for(auto _ : state)
+    {
+        hull.Build(points, settings);
+        benchmark::DoNotOptimize(hull.Indices().data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+    state.counters["vertices"] = double(hull.Vertices().size());
+}
+
+template<class T>
+static void BM_ConvexHullSphere(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > points = BallPoints<T>(state.range(0), true);
+    typename ConvexHull3D<T>::Settings settings;
+    settings.threads = unsigned(state.range(1));
+    ConvexHull3D<T> hull;
+    for(auto _ : state)
+    {
+        hull.Build(points, settings);
+        benchmark::DoNotOptimize(hull.Indices().data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+    state.counters["vertices"] = double(hull.Vertices().size());
+}
+
+BENCHMARK_TEMPLATE(BM_ConvexHullBall, float)->Args({1<<16, 1})->Args({1<<20, 1})->Args({1<<20, 0})->Args({1<<22, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ConvexHullBall, double)->Args({1<<20, 1})->Args({1<<20, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_ConvexHullSphere, double)->Args({1<<16, 1})->Args({1<<16, 0})->Unit(benchmark::kMillisecond);
@@ -0,0 +1,117 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Curves.hpp>
+#include <3DTools/Tessellator.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Batched curve and patch evaluation vs scalar de Casteljau, and a frame of
+* curve tessellations with and without the cache
+**/
+
+static std::vector<float> Parameters(std::size_t n)
+{
+    std::vector<float> t(n);
+    for(std::size_t i=0;i<n;i++)
+        t[i] = float(i)/float(n-1);
+    return t;
+}
+
+static void BM_BezierDeCasteljau(benchmark::State& state)
+{
+    std::vector<Vector3Df> control = RandomPoints<float>(4);
+    std::vector<float> t = Parameters(state.range(0));
+    std::vector<Vector3Df> out(t.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<t.size();i++)
+        {
+            Vector3Df p[4] = {control[0], control[1], control[2], control[3]};
+            for(int r=1;r<4;r++)
+                for(int k=0;k+r<4;k++)
+                    p[k] = p[k]*(1.0f-t[i])+p[k+1]*t[i];
+            out[i] = p[0];
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*t.size());
+}
+
+static void BM_BezierBatch(benchmark::State& state)
+{
+    BezierCurvef curve(RandomPoints<float>(4));
+    std::vector<float> t = Parameters(state.range(0));
+    PointArray3Df out;
+    for(auto _ : state)
+    {
+        curve.Evaluate(t, out);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*t.size());
+}
+
+static void BM_NURBSBatch(benchmark::State& state)
+{
+    std::vector<Vector3Df> control = RandomPoints<float>(32);
+    std::vector<float> weights(control.size());
+    for(std::size_t i=0;i<weights.size();i++)
+        weights[i] = 0.5f+control[i].X();
+    NURBSCurvef curve(3, control, std::vector<float>(), weights);
+    std::vector<float> t = Parameters(state.range(0));
+    PointArray3Df out;
+    for(auto _ : state)
+    {
+        curve.Evaluate(t, out);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*t.size());
+}
+
+static void BM_BezierPatchGrid(benchmark::State& state)
+{
+    BezierPatchf patch(3, 3, RandomPoints<float>(16));
+    std::vector<float> u = Parameters(state.range(0));
+    PointArray3Df out;
+    for(auto _ : state)
+    {
+        patch.Evaluate(u, u, out);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*u.size()*u.size());
+}
+
+/**
+* range(0) - 1: through the cache (every curve unchanged since the last frame)
+**/
+static void BM_TessellateFrame(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(1000*8);
+    std::vector<BSplineCurvef> curves;
+    for(std::size_t i=0;i<points.size();i+=8)
+        curves.push_back(BSplineCurvef(3, std::vector<Vector3Df>(points.begin()+i, points.begin()+i+8)));
+    Tessellatorf tessellator;
+    Tessellatorf::Tessellation scratch;
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<curves.size();i++)
+        {
+            if(state.range(0))
+                benchmark::DoNotOptimize(tessellator.Tessellate(curves[i]).points.X());
+            else
+            {
+                Tessellatorf::TessellateCurve(curves[i], tessellator.GetSettings(), scratch);
+                benchmark::DoNotOptimize(scratch.points.X());
+            }
+        }
+        tessellator.NextFrame();
+    }
+    state.SetItemsProcessed(state.iterations()*curves.size());
+}
+
+BENCHMARK(BM_BezierDeCasteljau)->Arg(1<<6)->Arg(1<<12);
+BENCHMARK(BM_BezierBatch)->Arg(1<<6)->Arg(1<<12);
+BENCHMARK(BM_NURBSBatch)->Arg(1<<6)->Arg(1<<12);
+BENCHMARK(BM_BezierPatchGrid)->Arg(16)->Arg(64);
+BENCHMARK(BM_TessellateFrame)->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
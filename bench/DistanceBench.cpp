@@ -0,0 +1,184 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <3DTools/Distances3D.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Point-to-primitive squared distances: the scalar functions in a loop vs the
+* SoA batches, distances to a whole mesh, and a margin check that stops at the
+* first point beyond it
+**/
+
+static const Vector3Df TriangleA(0.1f, 0.2f, 0.3f);
+static const Vector3Df TriangleB(0.9f, 0.3f, 0.5f);
+static const Vector3Df TriangleC(0.4f, 0.8f, 0.6f);
+
+static void BM_DistanceTriangleScalar(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    std::vector<float> out(points.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            out[i] = DistanceSqPointTriangle(points[i], TriangleA, TriangleB, TriangleC);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_DistanceTriangleBatch(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    std::vector<float> out(points.Size());
+    for(auto _ : state)
+    {
+        DistanceSqPointsTriangle(points, TriangleA, TriangleB, TriangleC, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+static void BM_DistanceSegmentScalar(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    std::vector<float> out(points.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            out[i] = DistanceSqPointSegment(points[i], TriangleA, TriangleB);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_DistanceSegmentBatch(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    std::vector<float> out(points.Size());
+    for(auto _ : state)
+    {
+        DistanceSqPointsSegment(points, TriangleA, TriangleB, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+static void BM_DistanceAABBScalar(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    AABBf box(TriangleA, TriangleC);
+    std::vector<float> out(points.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            out[i] = DistanceSqPointAABB(points[i], box);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_DistanceAABBBatch(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    AABBf box(TriangleA, TriangleC);
+    std::vector<float> out(points.Size());
+    for(auto _ : state)
+    {
+        DistanceSqPointsAABB(points, box, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+/**
+* Get a wavy side x side grid across the unit cube (2*side*side indexed triangles)
+**/
+static void WavyGrid(std::size_t side, std::vector<Vector3Df>& vertices, std::vector<std::uint32_t>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for(std::size_t i=0;i<=side;i++)
+        for(std::size_t j=0;j<=side;j++)
+        {
+            float x = float(i)/float(side), z = float(j)/float(side);
+            vertices.push_back(Vector3Df(x, 0.5f+0.1f*std::sin(9*x)*std::cos(7*z), z));
+        }
+    for(std::size_t i=0;i<side;i++)
+        for(std::size_t j=0;j<side;j++)
+        {
+            std::uint32_t a = std::uint32_t(i*(side+1)+j), b = a+1;
+            std::uint32_t c = std::uint32_t(a+side+1), d = c+1;
+            indices.push_back(a); indices.push_back(c); indices.push_back(b);
+            indices.push_back(b); indices.push_back(c); indices.push_back(d);
+        }
+}
+
+/**
+* range(1) - grid side (2*side*side triangles)
+**/
+static void BM_DistanceMeshScalar(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0)), vertices;
+    std::vector<std::uint32_t> indices;
+    WavyGrid(std::size_t(state.range(1)), vertices, indices);
+    std::vector<float> out(points.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+        {
+            float best = std::numeric_limits<float>::infinity();
+            for(std::size_t t=0;t<indices.size();t+=3)
+                best = std::min(best, DistanceSqPointTriangle(points[i], vertices[indices[t]], vertices[indices[t+1]], vertices[indices[t+2]]));
+            out[i] = best;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_DistanceMeshBatch(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    std::vector<Vector3Df> vertices;
+    std::vector<std::uint32_t> indices;
+    WavyGrid(std::size_t(state.range(1)), vertices, indices);
+    std::vector<float> out(points.Size());
+    for(auto _ : state)
+    {
+        DistanceSqPointsMesh(points, vertices, indices, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+/**
+* Are all points within a margin of the box? The points are inside except the
+* one at range(1)/1000 of the way, so the batch stops there
+**/
+static void BM_DistanceMarginCheck(benchmark::State& state)
+{
+    std::vector<Vector3Df> raw = RandomPoints<float>(state.range(0));
+    std::size_t outlier = std::size_t(state.range(0))*std::size_t(state.range(1))/1000;
+    if(outlier < raw.size())
+        raw[outlier] = Vector3Df(5, 5, 5);
+    PointArray3Df points(raw);
+    AABBf box(Vector3Df(0, 0, 0), Vector3Df(1, 1, 1));
+    std::vector<float> out(points.Size());
+    for(auto _ : state)
+        benchmark::DoNotOptimize(DistanceSqPointsAABB(points, box, &out[0], 0.01f));
+    state.SetItemsProcessed(state.iterations()*std::min(outlier+1, points.Size()));
+}
+
+BENCHMARK(BM_DistanceTriangleScalar)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceTriangleBatch)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceSegmentScalar)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceSegmentBatch)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceAABBScalar)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceAABBBatch)->TOOLS3D_BENCH_SIZES;
+BENCHMARK(BM_DistanceMeshScalar)->Args({1<<14, 8})->Args({1<<14, 32});
+BENCHMARK(BM_DistanceMeshBatch)->Args({1<<14, 8})->Args({1<<14, 32});
+BENCHMARK(BM_DistanceMarginCheck)->Args({1<<20, 10})->Args({1<<20, 1000});
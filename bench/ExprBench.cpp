@@ -0,0 +1,62 @@
+#define TOOLS3D_EXPRESSION_TEMPLATES
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Vector3D chains with the expression template operators
+* (compare with the *Operators benchmarks of VectorBench.cpp)
+**/
+
+template<class T>
+static void BM_IntegrateExpressions(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(state.range(0)), v = p, a = p, c(p.size());
+    T dt = T(0.01);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<p.size();i++)
+            c[i] = p[i] + v[i]*dt + a[i]*(T(0.5)*dt*dt);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorAddExpressions(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), b = a, c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i]+b[i];
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorDotExpressions(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), b = a;
+    for(auto _ : state)
+    {
+        T sum = 0;
+        for(std::size_t i=0;i<a.size();i++)
+            sum += a[i]*b[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_IntegrateExpressions, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_IntegrateExpressions, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorAddExpressions, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorAddExpressions, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorDotExpressions, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorDotExpressions, double)->TOOLS3D_BENCH_SIZES;
@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <vector>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/TransformHierarchy.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Per-frame world matrices of a range(0)-node hierarchy (four children per
+* node): recomputing every product, the dirty-flag Update with a few percent
+* of the nodes moved, and an Update that has to redo everything
+**/
+
+static std::size_t ParentOf(std::size_t i) {return (i-1)/4;}
+
+static void BM_HierarchyFullRecompute(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<Matrix3Dd> locals = RandomTransforms<double>(n), worlds(n);
+    for(auto _ : state)
+    {
+        worlds[0] = locals[0];
+        for(std::size_t i=1;i<n;i++)
+            worlds[i] = locals[i]*worlds[ParentOf(i)];
+        benchmark::DoNotOptimize(worlds.data());
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+template<int Percent>
+static void BM_HierarchyUpdate(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<Matrix3Dd> locals = RandomTransforms<double>(n);
+    TransformHierarchyd h;
+    h.AddNode(locals[0]);
+    for(std::size_t i=1;i<n;i++)
+        h.AddNode(locals[i], TransformHierarchyd::NodeId(ParentOf(i)));
+    h.Update();
+    // moved nodes are picked ahead of time so only SetLocal and Update are
+    // timed; 100 moves just the root, which dirties every node
+    std::vector<TransformHierarchyd::NodeId> moved((Percent < 100)?n*Percent/100:0);
+    srand(5);
+    for(std::size_t i=0;i<moved.size();i++)
+        moved[i] = TransformHierarchyd::NodeId(rand()%n);
+    std::size_t updated = 0;
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<moved.size();i++)
+            h.SetLocal(moved[i], locals[moved[i]]);
+        if(Percent == 100)
+            h.SetLocal(0, locals[0]);
+        updated = h.Update();
+        benchmark::DoNotOptimize(&h.World(0));
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+    state.counters["recomputed"] = double(updated);
+}
+
+BENCHMARK(BM_HierarchyFullRecompute)->Arg(1<<12)->Arg(1<<16);
+BENCHMARK_TEMPLATE(BM_HierarchyUpdate, 1)->Arg(1<<12)->Arg(1<<16);
+BENCHMARK_TEMPLATE(BM_HierarchyUpdate, 5)->Arg(1<<12)->Arg(1<<16);
+BENCHMARK_TEMPLATE(BM_HierarchyUpdate, 100)->Arg(1<<12)->Arg(1<<16);
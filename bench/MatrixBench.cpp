@@ -0,0 +1,262 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/TransformBuilder.hpp>
+#include <3DTools/Affine3x4.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Matrix3D hot paths over batches of matrices
+**/
+
+template<class T>
+static void BM_MatrixMultiply(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+        {
+            c[i] = a[i];
+            c[i] *= a[(i+1)%a.size()];
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_MatrixDet(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0));
+    for(auto _ : state)
+    {
+        T sum = 0;
+        for(std::size_t i=0;i<a.size();i++)
+            sum += a[i].Det();
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_MatrixInverse(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i].Inverse();
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_MatrixInverseAffine(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i].InverseAffine();
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_MatrixInverseRigid(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i].InverseRigid();
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+/**
+* Rotation around one axis (0 - x, 1 - y, 2 - z)
+**/
+template<class T, int Axis>
+static void BM_MatrixRotate(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0)), c(a.size());
+    std::vector<T> angles(a.size());
+    for(std::size_t i=0;i<angles.size();i++)
+        angles[i] = RandomValue<T>(-3,3);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+        {
+            c[i] = a[i];
+            if(Axis==0)
+                c[i].RotateX(angles[i]);
+            else if(Axis==1)
+                c[i].RotateY(angles[i]);
+            else
+                c[i].RotateZ(angles[i]);
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+/**
+* Model matrix (scale, rotate x/y/z, translate): chained Matrix3D calls vs TransformBuilder
+**/
+template<class T>
+static void BM_ModelMatrixChained(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > c(state.range(0));
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<c.size();i++)
+        {
+            Matrix3D<T> m;
+            m.Scale(T(2), T(2), T(2));
+            m.RotateX(T(0.1)*T(i));
+            m.RotateY(T(0.2));
+            m.RotateZ(T(0.3));
+            m.Translate(T(i), T(1), T(2));
+            c[i] = m;
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_ModelMatrixBuilder(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > c(state.range(0));
+    TransformBuilder<T> builder;
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<c.size();i++)
+        {
+            builder.Reset();
+            builder.Scale(T(2), T(2), T(2)).RotateX(T(0.1)*T(i)).RotateY(T(0.2)).RotateZ(T(0.3)).Translate(T(i), T(1), T(2));
+            c[i] = builder.Build();
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_AffineMultiply(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > m = RandomTransforms<T>(state.range(0));
+    std::vector<Affine3x4<T> > a(m.size()), c(m.size());
+    for(std::size_t i=0;i<m.size();i++)
+        a[i] = Affine3x4<T>(m[i]);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+        {
+            c[i] = a[i];
+            c[i] *= a[(i+1)%a.size()];
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+/**
+* Points through a 4x4 matrix vs through its packed 4x3 part
+**/
+template<class T, class M>
+static void BM_PointTransform(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > points = RandomPoints<T>(state.range(0)), out(points.size());
+    M mat(SomeTransform<T>());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            out[i] = points[i]*mat;
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+/**
+* Flattening matrices for upload: getData (allocates) vs CopyData (caller storage)
+**/
+template<class T>
+static void BM_MatrixGetData(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0));
+    std::vector<T> out(16*a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+        {
+            T** data = a[i].getData();
+            for(int r=0;r<4;r++)
+            {
+                for(int c=0;c<4;c++)
+                    out[16*i+4*r+c] = data[r][c];
+                delete[] data[r];
+            }
+            delete[] data;
+        }
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_MatrixCopyData(benchmark::State& state)
+{
+    std::vector<Matrix3D<T> > a = RandomTransforms<T>(state.range(0));
+    std::vector<T> out(16*a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            a[i].CopyData(&out[16*i]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_MatrixMultiply, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixMultiply, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixDet, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixDet, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverse, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverse, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverseAffine, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverseAffine, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverseRigid, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixInverseRigid, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, float, 0)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, double, 0)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, float, 1)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, double, 1)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, float, 2)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixRotate, double, 2)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_ModelMatrixChained, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_ModelMatrixChained, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_ModelMatrixBuilder, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_ModelMatrixBuilder, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_AffineMultiply, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_AffineMultiply, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_PointTransform, float, Matrix3Df)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_PointTransform, float, Affine3x4f)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixGetData, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_MatrixCopyData, float)->TOOLS3D_BENCH_SIZES;
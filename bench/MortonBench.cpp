@@ -0,0 +1,111 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <3DTools/Morton.hpp>
+#include <3DTools/KdTree.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Morton codes of range(0) points, the radix sort against std::sort of
+* (code, index) pairs, a full MortonSort, and nearest-neighbour queries
+* issued in random and in Morton order
+**/
+
+template<class Code>
+static void BM_MortonCodes(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    AABBf box = AABBf::FromPoints(points);
+    std::vector<Code> codes;
+    for(auto _ : state)
+    {
+        MortonCodes(points, box, codes);
+        benchmark::DoNotOptimize(codes.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+template<class Code>
+static void BM_MortonStdSort(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    std::vector<Code> codes;
+    MortonCodes(points, AABBf::FromPoints(points), codes);
+    std::vector<std::pair<Code,std::uint32_t> > pairs(codes.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<codes.size();i++)
+            pairs[i] = std::make_pair(codes[i], std::uint32_t(i));
+        std::sort(pairs.begin(), pairs.end());
+        benchmark::DoNotOptimize(pairs.data());
+    }
+    state.SetItemsProcessed(state.iterations()*codes.size());
+}
+
+template<class Code>
+static void BM_MortonRadixSort(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0)));
+    std::vector<Code> codes, sorted;
+    MortonCodes(points, AABBf::FromPoints(points), codes);
+    std::vector<std::uint32_t> order;
+    for(auto _ : state)
+    {
+        sorted = codes;
+        RadixSort(sorted, order);
+        benchmark::DoNotOptimize(order.data());
+    }
+    state.SetItemsProcessed(state.iterations()*codes.size());
+}
+
+static void BM_MortonSortPoints(benchmark::State& state)
+{
+    std::vector<Vector3Df> raw = RandomPoints<float>(state.range(0));
+    std::vector<std::uint32_t> codes, order;
+    for(auto _ : state)
+    {
+        state.PauseTiming();
+        PointArray3Df points(raw);
+        state.ResumeTiming();
+        MortonSort(points, codes, order);
+        benchmark::DoNotOptimize(points.X());
+    }
+    state.SetItemsProcessed(state.iterations()*raw.size());
+}
+
+template<bool Sorted>
+static void BM_MortonNearestQueries(benchmark::State& state)
+{
+    KdTreef tree(RandomPoints<float>(1<<20));
+    std::vector<Vector3Df> queries = RandomPoints<float>(state.range(0));
+    std::reverse(queries.begin(), queries.end());
+    if(Sorted)
+    {
+        PointArray3Df points(queries);
+        std::vector<std::uint32_t> codes, order;
+        MortonSort(points, codes, order);
+        for(std::size_t i=0;i<queries.size();i++)
+            queries[i] = points.Get(i);
+    }
+    NeighborLists<float> out;
+    for(auto _ : state)
+    {
+        tree.NearestBatch(queries, 1, out, 1);
+        benchmark::DoNotOptimize(&out);
+    }
+    state.SetItemsProcessed(state.iterations()*queries.size());
+}
+
+BENCHMARK_TEMPLATE(BM_MortonCodes, std::uint32_t)->TOOLS3D_BENCH_SIZES->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonCodes, std::uint64_t)->TOOLS3D_BENCH_SIZES->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonStdSort, std::uint32_t)->Arg(1<<16)->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonRadixSort, std::uint32_t)->Arg(1<<16)->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonStdSort, std::uint64_t)->Arg(1<<16)->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonRadixSort, std::uint64_t)->Arg(1<<16)->Arg(1<<20);
+BENCHMARK(BM_MortonSortPoints)->Arg(1<<16)->Arg(1<<20);
+BENCHMARK_TEMPLATE(BM_MortonNearestQueries, false)->Arg(1<<16);
+BENCHMARK_TEMPLATE(BM_MortonNearestQueries, true)->Arg(1<<16);
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <3DTools/KdTree.hpp>
+#include <3DTools/SpatialHash.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Build time and query throughput of the proximity structures vs a linear scan,
+* on n points in the unit cube (cell size and radius chosen for ~30 neighbours)
+**/
+
+static float QueryRadius(std::size_t n)
+{
+    // a sphere holding about 30 points on average
+    return float(std::cbrt(30.0/(4.18879*double(n))));
+}
+
+static std::vector<Vector3Df> Queries()
+{
+    std::vector<Vector3Df> queries = RandomPoints<float>(1<<12);
+    for(std::size_t i=0;i<queries.size();i++)
+        queries[i] = queries[i]*0.9f+Vector3Df(0.05f, 0.05f, 0.05f);
+    return queries;
+}
+
+static void BM_KdTreeBuild(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    KdTreef::Settings settings;
+    settings.threads = unsigned(state.range(1));
+    KdTreef tree;
+    for(auto _ : state)
+    {
+        tree.Build(points, settings);
+        benchmark::DoNotOptimize(tree.Size());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_SpatialHashBuild(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    SpatialHashf hash;
+    for(auto _ : state)
+    {
+        hash.Build(points, QueryRadius(points.size()));
+        benchmark::DoNotOptimize(hash.Size());
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+/**
+* range(1) - points moved per iteration with Update (the rest stay put)
+**/
+static void BM_SpatialHashUpdate(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    std::vector<Vector3Df> targets = RandomPoints<float>(std::size_t(state.range(1)));
+    SpatialHashf hash(points, QueryRadius(points.size()));
+    std::size_t next = 0;
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<targets.size();i++)
+        {
+            hash.Update(std::uint32_t(next), targets[i]);
+            next = (next+7919)%points.size();
+        }
+        benchmark::DoNotOptimize(hash.Size());
+    }
+    state.SetItemsProcessed(state.iterations()*targets.size());
+}
+
+/**
+* range(1) - k (0 - radius query)
+**/
+template<class Index>
+static void RunQueries(benchmark::State& state, const Index& index, std::size_t n)
+{
+    std::vector<Vector3Df> queries = Queries();
+    std::size_t k = std::size_t(state.range(1));
+    float radius = QueryRadius(n);
+    NeighborLists<float> lists;
+    for(auto _ : state)
+    {
+        if(k)
+            index.NearestBatch(queries, k, lists, 1);
+        else
+            index.RadiusBatch(queries, radius, lists, 1);
+        benchmark::DoNotOptimize(lists.neighbors.data());
+    }
+    state.SetItemsProcessed(state.iterations()*queries.size());
+}
+
+static void BM_KdTreeQuery(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    RunQueries(state, KdTreef(points), points.size());
+}
+
+static void BM_SpatialHashQuery(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    RunQueries(state, SpatialHashf(points, QueryRadius(points.size())), points.size());
+}
+
+static void BM_BruteForceQuery(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0));
+    std::vector<Vector3Df> queries = Queries();
+    queries.resize(64);
+    std::size_t k = std::size_t(state.range(1));
+    float r2 = QueryRadius(points.size());
+    r2 *= r2;
+    std::vector<Neighbor<float> > found;
+    for(auto _ : state)
+    {
+        for(std::size_t q=0;q<queries.size();q++)
+        {
+            detail::KnnHeap<float> heap(found, k?k:points.size());
+            for(std::size_t i=0;i<points.size();i++)
+            {
+                float d = queries[q].DistanceSq(points[i]);
+                if(k || d <= r2)
+                    heap.Push(std::uint32_t(i), d);
+            }
+            benchmark::DoNotOptimize(found.data());
+        }
+    }
+    state.SetItemsProcessed(state.iterations()*queries.size());
+}
+
+BENCHMARK(BM_KdTreeBuild)->Args({1<<16, 1})->Args({1<<20, 1})->Args({1<<20, 0})->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SpatialHashBuild)->Arg(1<<16)->Arg(1<<20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SpatialHashUpdate)->Args({1<<20, 1<<10})->Args({1<<20, 1<<14});
+BENCHMARK(BM_KdTreeQuery)->Args({1<<16, 1})->Args({1<<16, 16})->Args({1<<16, 0})->Args({1<<20, 16})->Args({1<<20, 0});
+BENCHMARK(BM_SpatialHashQuery)->Args({1<<16, 1})->Args({1<<16, 16})->Args({1<<16, 0})->Args({1<<20, 16})->Args({1<<20, 0});
+BENCHMARK(BM_BruteForceQuery)->Args({1<<16, 16})->Args({1<<16, 0});
@@ -0,0 +1,76 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Parallel.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Distances3D.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Batch routines on executors with range(0) threads, and the cost of an
+* executor Run that does no work
+**/
+
+/**
+* Install a WorkStealingExecutor with a number of threads for one benchmark
+**/
+class ScopedExecutor
+{
+private:
+    WorkStealingExecutor executor;
+
+    static WorkStealingExecutor::Settings Threads(unsigned threads)
+    {
+        WorkStealingExecutor::Settings settings;
+        settings.threads = threads;
+        return settings;
+    }
+
+public:
+    explicit ScopedExecutor(unsigned threads):executor(Threads(threads)) {SetDefaultExecutor(&executor);}
+    ~ScopedExecutor() {SetDefaultExecutor(0);}
+};
+
+static void BM_ExecutorRun(benchmark::State& state)
+{
+    ScopedExecutor scoped(unsigned(state.range(0)));
+    std::vector<int> out(64);
+    for(auto _ : state)
+    {
+        DefaultExecutor().Run(unsigned(state.range(0)), [&](unsigned i) {out[i]++;});
+        benchmark::DoNotOptimize(out.data());
+    }
+}
+
+static void BM_TransformThreads(benchmark::State& state)
+{
+    ScopedExecutor scoped(unsigned(state.range(0)));
+    PointArray3Df points(RandomPoints<float>(1<<20));
+    PointArray3Df out;
+    Matrix3Df mat = SomeTransform<float>();
+    for(auto _ : state)
+    {
+        Transform(points, out, mat);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+static void BM_DistanceTriangleThreads(benchmark::State& state)
+{
+    ScopedExecutor scoped(unsigned(state.range(0)));
+    PointArray3Df points(RandomPoints<float>(1<<20));
+    std::vector<float> out(points.Size());
+    Vector3Df a(0.1f, 0.2f, 0.3f), b(0.9f, 0.3f, 0.5f), c(0.4f, 0.8f, 0.6f);
+    for(auto _ : state)
+    {
+        DistanceSqPointsTriangle(points, a, b, c, &out[0]);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+BENCHMARK(BM_ExecutorRun)->Arg(1)->Arg(2)->Arg(4);
+BENCHMARK(BM_TransformThreads)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+BENCHMARK(BM_DistanceTriangleThreads)->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <3DTools/PointStream.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Streaming transform throughput in MB/s: from memory to memory (compute and
+* pipeline overhead only) and from file to file (disk bound)
+**/
+
+template<class T>
+static std::vector<T> Records(std::size_t n)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(n);
+    std::vector<T> records(3*n);
+    for(std::size_t i=0;i<n;i++)
+    {
+        records[3*i] = p[i].X();
+        records[3*i+1] = p[i].Y();
+        records[3*i+2] = p[i].Z();
+    }
+    return records;
+}
+
+template<class T>
+static void BM_StreamMemory(benchmark::State& state)
+{
+    // range(0) - points, range(1) - threads (0 for all hardware threads)
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<T> input = Records<T>(n), output(3*n);
+    typename PointCloudStream<T>::Settings settings;
+    settings.chunkPoints = 1<<18;
+    settings.threads = unsigned(state.range(1));
+    PointCloudStream<T> stream(settings);
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+    {
+        std::size_t readPos = 0, writePos = 0;
+        stream.Transform([&](T* buffer, std::size_t maxPoints, std::size_t& points) {
+            points = std::min(maxPoints, n-readPos);
+            std::copy(input.begin()+3*readPos, input.begin()+3*(readPos+points), buffer);
+            readPos += points;
+            return true;
+        }, [&](const T* buffer, std::size_t points) {
+            std::copy(buffer, buffer+3*points, output.begin()+3*writePos);
+            writePos += points;
+            return true;
+        }, mat);
+        benchmark::DoNotOptimize(output.data());
+    }
+    state.SetBytesProcessed(state.iterations()*n*3*sizeof(T));
+    state.counters["MB/s"] = stream.LastStats().MBPerSecond();
+}
+
+template<class T>
+static void BM_StreamFile(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<T> input = Records<T>(n);
+    std::string in = "3DTools_bench_in.xyz", out = "3DTools_bench_out.xyz";
+    std::FILE* f = std::fopen(in.c_str(), "wb");
+    std::fwrite(&input[0], sizeof(T), input.size(), f);
+    std::fclose(f);
+    PointCloudStream<T> stream;
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+        stream.Transform(in, out, mat);
+    state.SetBytesProcessed(state.iterations()*n*3*sizeof(T));
+    state.counters["MB/s"] = stream.LastStats().MBPerSecond();
+    std::remove(in.c_str());
+    std::remove(out.c_str());
+}
+
+BENCHMARK_TEMPLATE(BM_StreamMemory, float)->Args({1<<22, 1})->Args({1<<22, 0})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamMemory, double)->Args({1<<22, 0})->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamFile, float)->Arg(1<<22)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_StreamFile, double)->Arg(1<<22)->Unit(benchmark::kMillisecond)->UseRealTime();
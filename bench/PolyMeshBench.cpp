@@ -0,0 +1,139 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <3DTools/PolyMesh.hpp>
+#include <3DTools/MappedFile.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Half-edge build time (a grid, and a fan whose center touches every
+* triangle) and start-up cost of a mesh: mapping its binary blob (with and
+* without validation) vs parsing the same mesh from OBJ-like text
+**/
+
+/**
+* Get a grid mesh with about n triangles
+**/
+template<class T>
+static void Grid(std::size_t n, std::vector<Vector3D<T> >& vertices, std::vector<std::uint32_t>& indices)
+{
+    std::uint32_t side = std::uint32_t(std::sqrt(double(n/2)));
+    vertices.clear();
+    indices.clear();
+    for(std::uint32_t i=0;i<=side;i++)
+        for(std::uint32_t j=0;j<=side;j++)
+            vertices.push_back(Vector3D<T>(T(i), T(j), T((i*j)%7)));
+    for(std::uint32_t i=0;i<side;i++)
+    {
+        for(std::uint32_t j=0;j<side;j++)
+        {
+            std::uint32_t a = i*(side+1)+j, b = a+side+1;
+            std::uint32_t tri[6] = {a, b, a+1, a+1, b, b+1};
+            indices.insert(indices.end(), tri, tri+6);
+        }
+    }
+}
+
+static void BM_PolyMeshBuild(benchmark::State& state)
+{
+    std::vector<Vector3Df> vertices;
+    std::vector<std::uint32_t> indices;
+    Grid(state.range(0), vertices, indices);
+    PolyMeshf mesh;
+    for(auto _ : state)
+    {
+        mesh.Build(vertices, indices);
+        benchmark::DoNotOptimize(mesh.View().Twin(0));
+    }
+    state.SetItemsProcessed(state.iterations()*(indices.size()/3));
+}
+
+static void BM_PolyMeshBuildFan(benchmark::State& state)
+{
+    // one vertex of valence n: the build time must grow linearly with n
+    std::uint32_t n = std::uint32_t(state.range(0));
+    std::vector<Vector3Df> vertices(1, Vector3Df(0, 0, 0));
+    std::vector<std::uint32_t> indices;
+    for(std::uint32_t i=0;i<=n;i++)
+        vertices.push_back(Vector3Df(std::cos(float(i)), std::sin(float(i)), 0));
+    for(std::uint32_t i=1;i<=n;i++)
+    {
+        std::uint32_t tri[3] = {0, i, i+1};
+        indices.insert(indices.end(), tri, tri+3);
+    }
+    PolyMeshf mesh;
+    for(auto _ : state)
+    {
+        mesh.Build(vertices, indices);
+        benchmark::DoNotOptimize(mesh.View().Twin(0));
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+static void BM_PolyMeshMap(benchmark::State& state)
+{
+    // range(1) - 1 validates every index
+    std::vector<Vector3Df> vertices;
+    std::vector<std::uint32_t> indices;
+    Grid(state.range(0), vertices, indices);
+    PolyMeshf mesh(vertices, indices);
+    std::string path = "3DTools_bench_mesh.msh";
+    mesh.Save(path);
+    for(auto _ : state)
+    {
+        MappedFile file(path);
+        PolyMeshViewf view;
+        view.Load(file.Data(), file.Size(), state.range(1) != 0);
+        benchmark::DoNotOptimize(view.Twin(view.HalfEdgeCount()-1));
+    }
+    state.SetItemsProcessed(state.iterations()*(indices.size()/3));
+    std::remove(path.c_str());
+}
+
+static void BM_PolyMeshParseText(benchmark::State& state)
+{
+    std::vector<Vector3Df> vertices;
+    std::vector<std::uint32_t> indices;
+    Grid(state.range(0), vertices, indices);
+    std::ostringstream obj;
+    for(std::size_t v=0;v<vertices.size();v++)
+        obj << "v " << vertices[v].X() << ' ' << vertices[v].Y() << ' ' << vertices[v].Z() << '\n';
+    for(std::size_t f=0;f<indices.size();f+=3)
+        obj << "f " << indices[f]+1 << ' ' << indices[f+1]+1 << ' ' << indices[f+2]+1 << '\n';
+    std::string text = obj.str();
+    for(auto _ : state)
+    {
+        std::istringstream in(text);
+        std::vector<Vector3Df> v;
+        std::vector<std::uint32_t> idx;
+        std::string tag;
+        while(in >> tag)
+        {
+            if(tag == "v")
+            {
+                float x, y, z;
+                in >> x >> y >> z;
+                v.push_back(Vector3Df(x, y, z));
+            }
+            else
+            {
+                std::uint32_t a, b, c;
+                in >> a >> b >> c;
+                idx.push_back(a-1); idx.push_back(b-1); idx.push_back(c-1);
+            }
+        }
+        PolyMeshf mesh(v, idx);
+        benchmark::DoNotOptimize(mesh.View().Twin(0));
+    }
+    state.SetItemsProcessed(state.iterations()*(indices.size()/3));
+}
+
+BENCHMARK(BM_PolyMeshBuild)->Arg(1<<16)->Arg(1<<20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PolyMeshBuildFan)->Arg(1<<16)->Arg(1<<20)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_PolyMeshMap)->Args({1<<16, 0})->Args({1<<16, 1})->Args({1<<20, 0})->Args({1<<20, 1})->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_PolyMeshParseText)->Arg(1<<16)->Arg(1<<20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/QuantizedPoints.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Transforming vertex positions: plain Vector3D loop, SoA batch, and the
+* fused dequantise-and-transform of 16-bit and 10:10:10 quantised points
+* (bytes read per point: 12, 12, 6 and 4)
+**/
+
+static void BM_QuantizedBaselineVector3D(benchmark::State& state)
+{
+    std::vector<Vector3Df> points = RandomPoints<float>(state.range(0)), out(points.size());
+    Matrix3Df mat = SomeTransform<float>();
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            out[i] = points[i]*mat;
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*points.size());
+}
+
+static void BM_QuantizedBaselineSoA(benchmark::State& state)
+{
+    PointArray3Df points(RandomPoints<float>(state.range(0))), out;
+    Matrix3Df mat = SomeTransform<float>();
+    for(auto _ : state)
+    {
+        Transform(points, out, mat);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+}
+
+template<QuantizedFormat Format>
+static void BM_QuantizedTransform(benchmark::State& state)
+{
+    QuantizedPointArray3Df::Settings settings;
+    settings.format = Format;
+    QuantizedPointArray3Df points(PointArray3Df(RandomPoints<float>(state.range(0))), settings);
+    PointArray3Df out;
+    Matrix3Df mat = SomeTransform<float>();
+    for(auto _ : state)
+    {
+        Transform(points, out, mat);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*points.Size());
+    state.counters["bytes_per_point"] = double(points.Bytes())/double(points.Size());
+}
+
+BENCHMARK(BM_QuantizedBaselineVector3D)->TOOLS3D_BENCH_SIZES->Arg(1<<22);
+BENCHMARK(BM_QuantizedBaselineSoA)->TOOLS3D_BENCH_SIZES->Arg(1<<22);
+BENCHMARK_TEMPLATE(BM_QuantizedTransform, Quantized16)->TOOLS3D_BENCH_SIZES->Arg(1<<22);
+BENCHMARK_TEMPLATE(BM_QuantizedTransform, Quantized10)->TOOLS3D_BENCH_SIZES->Arg(1<<22);
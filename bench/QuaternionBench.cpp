@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <algorithm>
+#include <3DTools/Quaternion.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Quaternion composition vs Matrix3D products and batch keyframe interpolation
+**/
+
+template<class T>
+static std::vector<Quaternion<T> > RandomOrientations(std::size_t n)
+{
+    std::vector<Quaternion<T> > q(n);
+    srand(11);
+    for(std::size_t i=0;i<n;i++)
+        q[i] = Quaternion<T>::FromAxisAngle(Vector3D<T>(RandomValue<T>(-1,1), RandomValue<T>(-1,1), RandomValue<T>(0.1,1)), RandomValue<T>(-3,3));
+    return q;
+}
+
+template<class T>
+static void BM_QuaternionCompose(benchmark::State& state)
+{
+    std::vector<Quaternion<T> > a = RandomOrientations<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i]*a[(i+1)%a.size()];
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_QuaternionComposeAsMatrices(benchmark::State& state)
+{
+    std::vector<Quaternion<T> > q = RandomOrientations<T>(state.range(0));
+    std::vector<Matrix3D<T> > a(q.size()), c(q.size());
+    for(std::size_t i=0;i<q.size();i++)
+        a[i] = q[i].ToMatrix();
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i]*a[(i+1)%a.size()];
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_QuaternionSlerpBatch(benchmark::State& state)
+{
+    std::vector<Quaternion<T> > a = RandomOrientations<T>(state.range(0)), b = a, c;
+    std::rotate(b.begin(), b.begin()+1, b.end());
+    for(auto _ : state)
+    {
+        Slerp(a, b, T(0.3), c);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_QuaternionNlerpBatch(benchmark::State& state)
+{
+    std::vector<Quaternion<T> > a = RandomOrientations<T>(state.range(0)), b = a, c;
+    std::rotate(b.begin(), b.begin()+1, b.end());
+    for(auto _ : state)
+    {
+        Nlerp(a, b, T(0.3), c);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_QuaternionCompose, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionCompose, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionComposeAsMatrices, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionComposeAsMatrices, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionSlerpBatch, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionSlerpBatch, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionNlerpBatch, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_QuaternionNlerpBatch, double)->TOOLS3D_BENCH_SIZES;
@@ -0,0 +1,110 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/RayPacket.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Ray/triangle tests: scalar Moller-Trumbore loop vs the packet kernels
+* (one ray against many triangles, many rays against one triangle)
+**/
+
+template<class T>
+static std::vector<Vector3D<T> > RandomTriangles(std::size_t n)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(3*n);
+    for(std::size_t i=0;i<p.size();i++)
+        p[i].SetY(p[i].Y()*T(0.1));
+    return p;
+}
+
+template<class T>
+static std::vector<Ray<T> > DownRays(std::size_t n)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(n);
+    std::vector<Ray<T> > rays(n);
+    for(std::size_t i=0;i<n;i++)
+        rays[i] = Ray<T>(Vector3D<T>(p[i].X(), T(1), p[i].Z()), Vector3D<T>(p[i].Y()-T(0.5), T(-1), T(0.1)));
+    return rays;
+}
+
+template<class T>
+static void BM_RayTrianglesScalar(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > tris = RandomTriangles<T>(state.range(0));
+    Ray<T> ray = DownRays<T>(1)[0];
+    for(auto _ : state)
+    {
+        RayHit<T> hit;
+        for(std::size_t i=0;i<tris.size()/3;i++)
+        {
+            T t, u, v;
+            if(IntersectRayTriangle(ray, tris[3*i], tris[3*i+1], tris[3*i+2], t, u, v) && t < hit.t)
+            {
+                hit.t = t;
+                hit.triangle = i;
+            }
+        }
+        benchmark::DoNotOptimize(hit);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_RayTrianglesPacket(benchmark::State& state)
+{
+    TriangleArray3D<T> tris(RandomTriangles<T>(state.range(0)), std::vector<std::uint32_t>());
+    Ray<T> ray = DownRays<T>(1)[0];
+    for(auto _ : state)
+    {
+        RayHit<T> hit;
+        IntersectRayTriangles(ray, tris, hit);
+        benchmark::DoNotOptimize(hit);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_RaysTriangleScalar(benchmark::State& state)
+{
+    std::vector<Ray<T> > rays = DownRays<T>(state.range(0));
+    std::vector<RayHit<T> > hits(rays.size());
+    std::vector<Vector3D<T> > tri = RandomTriangles<T>(1);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<rays.size();i++)
+        {
+            T t, u, v;
+            if(IntersectRayTriangle(rays[i], tri[0], tri[1], tri[2], t, u, v) && t < hits[i].t)
+            {
+                hits[i].t = t;
+                hits[i].triangle = 0;
+            }
+        }
+        benchmark::DoNotOptimize(hits.data());
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_RaysTrianglePacket(benchmark::State& state)
+{
+    RayArray3D<T> rays(DownRays<T>(state.range(0)));
+    std::vector<Vector3D<T> > tri = RandomTriangles<T>(1);
+    for(auto _ : state)
+    {
+        IntersectRays(rays, tri[0], tri[1], tri[2], 0);
+        benchmark::DoNotOptimize(rays.Component(6));
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_RayTrianglesScalar, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RayTrianglesPacket, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RayTrianglesScalar, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RayTrianglesPacket, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RaysTriangleScalar, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RaysTrianglePacket, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RaysTriangleScalar, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RaysTrianglePacket, double)->TOOLS3D_BENCH_SIZES;
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/SinCos.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Batch rotation-matrix generation: per-matrix RotateY vs RotationMatrices (libm and polynomial sincos)
+**/
+
+template<class T>
+static std::vector<T> RandomAngles(std::size_t n)
+{
+    std::vector<T> angles(n);
+    srand(5);
+    for(std::size_t i=0;i<n;i++)
+        angles[i] = RandomValue<T>(-10,10);
+    return angles;
+}
+
+template<class T>
+static void BM_RotateYLoop(benchmark::State& state)
+{
+    std::vector<T> angles = RandomAngles<T>(state.range(0));
+    std::vector<Matrix3D<T> > out(angles.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<angles.size();i++)
+        {
+            out[i].Identity();
+            out[i].RotateY(angles[i]);
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T, SinCosMethod method>
+static void BM_RotationMatrices(benchmark::State& state)
+{
+    std::vector<T> angles = RandomAngles<T>(state.range(0));
+    std::vector<Matrix3D<T> > out(angles.size());
+    for(auto _ : state)
+    {
+        RotationMatrices(&angles[0], angles.size(), AxisY, &out[0], method);
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T, SinCosMethod method>
+static void BM_SinCos(benchmark::State& state)
+{
+    std::vector<T> angles = RandomAngles<T>(state.range(0)), s(angles.size()), c(angles.size());
+    for(auto _ : state)
+    {
+        SinCos(&angles[0], &s[0], &c[0], angles.size(), method);
+        benchmark::DoNotOptimize(s.data());
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_RotateYLoop, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RotateYLoop, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RotationMatrices, float, SinCosLibm)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RotationMatrices, float, SinCosPolynomial)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RotationMatrices, double, SinCosLibm)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_RotationMatrices, double, SinCosPolynomial)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_SinCos, float, SinCosLibm)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_SinCos, float, SinCosPolynomial)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_SinCos, double, SinCosLibm)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_SinCos, double, SinCosPolynomial)->TOOLS3D_BENCH_SIZES;
@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <vector>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/MatrixArray3D.hpp>
+#include <3DTools/Skinning.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Skinning palettes (inverse bind times bone world for range(0) bones, i.e.
+* many 128-bone characters in one array) as a Matrix3D loop and as SoA batch
+* products, and four-influence linear-blend skinning of range(0) vertices
+* with a Vector3D loop and with Skin
+**/
+
+static const std::size_t Bones = 128;
+
+static void BM_PaletteMatrix3D(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<Matrix3Df> bind = RandomTransforms<float>(n), world = RandomTransforms<float>(n), palette(n);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<n;i++)
+            Matrix3Df::Multiply(bind[i], world[i], palette[i]);
+        benchmark::DoNotOptimize(palette.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+static void BM_PaletteSoA(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    MatrixArray3Df bind(RandomTransforms<float>(n)), world(RandomTransforms<float>(n)), palette;
+    for(auto _ : state)
+    {
+        Multiply(bind, world, palette);
+        benchmark::DoNotOptimize(palette.Component(0));
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+/**
+* Four random bones per vertex with weights summing to 1
+**/
+static void RandomInfluences(std::size_t n, std::vector<std::uint16_t>& ids, std::vector<float>& w)
+{
+    ids.resize(4*n);
+    w.resize(4*n);
+    for(std::size_t i=0;i<4*n;i++)
+    {
+        ids[i] = std::uint16_t(rand()%Bones);
+        w[i] = 0.25f;
+    }
+}
+
+static void BM_SkinPerVertex(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    std::vector<Vector3Df> rest = RandomPoints<float>(n), out(n);
+    std::vector<Matrix3Df> palette = RandomTransforms<float>(Bones);
+    std::vector<std::uint16_t> ids;
+    std::vector<float> w;
+    RandomInfluences(n, ids, w);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            Vector3Df p = (rest[i]*palette[ids[4*i]])*w[4*i];
+            for(int j=1;j<4;j++)
+                p += (rest[i]*palette[ids[4*i+j]])*w[4*i+j];
+            out[i] = p;
+        }
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+static void BM_SkinSoA(benchmark::State& state)
+{
+    std::size_t n = std::size_t(state.range(0));
+    PointArray3Df rest(RandomPoints<float>(n)), out;
+    MatrixArray3Df palette(RandomTransforms<float>(Bones));
+    std::vector<std::uint16_t> ids;
+    std::vector<float> w;
+    RandomInfluences(n, ids, w);
+    SkinWeightsf weights(n);
+    for(std::size_t i=0;i<n;i++)
+        weights.Set(i, 4, &ids[4*i], &w[4*i]);
+    for(auto _ : state)
+    {
+        Skin(rest, weights, palette, out);
+        benchmark::DoNotOptimize(out.X());
+    }
+    state.SetItemsProcessed(state.iterations()*n);
+}
+
+BENCHMARK(BM_PaletteMatrix3D)->Arg(Bones)->Arg(Bones*256);
+BENCHMARK(BM_PaletteSoA)->Arg(Bones)->Arg(Bones*256);
+BENCHMARK(BM_SkinPerVertex)->Arg(1<<12)->Arg(1<<16);
+BENCHMARK(BM_SkinSoA)->Arg(1<<12)->Arg(1<<16);
@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Point-transform throughput: per-Vector3D loop (AoS) vs batch Transform (SoA)
+**/
+
+template<class T>
+static void BM_TransformVector3DLoop(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > points = RandomPoints<T>(state.range(0));
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            points[i] *= mat;
+        benchmark::DoNotOptimize(points.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_TransformPointArray(benchmark::State& state)
+{
+    PointArray3D<T> points(RandomPoints<T>(state.range(0)));
+    Matrix3D<T> mat = SomeTransform<T>();
+    for(auto _ : state)
+    {
+        Transform(points, mat);
+        benchmark::DoNotOptimize(points.X());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_TransformVector3DLoop, float)->RangeMultiplier(16)->Range(1<<8, 1<<20);
+BENCHMARK_TEMPLATE(BM_TransformPointArray, float)->RangeMultiplier(16)->Range(1<<8, 1<<20);
+BENCHMARK_TEMPLATE(BM_TransformVector3DLoop, double)->RangeMultiplier(16)->Range(1<<8, 1<<20);
+BENCHMARK_TEMPLATE(BM_TransformPointArray, double)->RangeMultiplier(16)->Range(1<<8, 1<<20);
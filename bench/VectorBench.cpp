@@ -0,0 +1,116 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include "BenchUtils.hpp"
+using namespace Tools3D;
+using namespace Tools3DBench;
+
+/**
+* Vector3D hot paths over batches of vectors
+**/
+
+template<class T>
+static void BM_VectorAdd(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), b = a, c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i]+b[i];
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorScale(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), c(a.size());
+    T s = T(1.5);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i]*s;
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorDot(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), b = a;
+    for(auto _ : state)
+    {
+        T sum = 0;
+        for(std::size_t i=0;i<a.size();i++)
+            sum += a[i]*b[i];
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorCross(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), b = a, c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+            c[i] = a[i].Cross(b[(i+1)%b.size()]);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+template<class T>
+static void BM_VectorNormalize(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > a = RandomPoints<T>(state.range(0)), c(a.size());
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<a.size();i++)
+        {
+            c[i] = a[i];
+            c[i].Normalize();
+        }
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+/**
+* Integrator step p + v*dt + a*(0.5*dt*dt) with the plain operators
+* (see ExprBench.cpp for the expression template version)
+**/
+template<class T>
+static void BM_IntegrateOperators(benchmark::State& state)
+{
+    std::vector<Vector3D<T> > p = RandomPoints<T>(state.range(0)), v = p, a = p, c(p.size());
+    T dt = T(0.01);
+    for(auto _ : state)
+    {
+        for(std::size_t i=0;i<p.size();i++)
+            c[i] = p[i] + v[i]*dt + a[i]*(T(0.5)*dt*dt);
+        benchmark::DoNotOptimize(c.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations()*state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_VectorAdd, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorAdd, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorScale, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorScale, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorDot, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorDot, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorCross, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorCross, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorNormalize, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_VectorNormalize, double)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_IntegrateOperators, float)->TOOLS3D_BENCH_SIZES;
+BENCHMARK_TEMPLATE(BM_IntegrateOperators, double)->TOOLS3D_BENCH_SIZES;
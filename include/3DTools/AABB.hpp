@@ -0,0 +1,404 @@
+#ifndef AABB_HPP
+#define AABB_HPP
+
+/**
+* Includes
+**/
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Min/max reduction over SoA components
+* lo and hi are updated in place, so several ranges can be accumulated.
+* Width is the register width, see SimdWidth (1 - scalar fallback)
+**/
+template<class T, int Width>
+struct BoundsKernel;
+
+template<class T>
+struct BoundsKernel<T,1>
+{
+    static void Run(const T* x, const T* y, const T* z, std::size_t n, T lo[3], T hi[3])
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            lo[0] = (x[i]<lo[0])?x[i]:lo[0]; hi[0] = (x[i]>hi[0])?x[i]:hi[0];
+            lo[1] = (y[i]<lo[1])?y[i]:lo[1]; hi[1] = (y[i]>hi[1])?y[i]:hi[1];
+            lo[2] = (z[i]<lo[2])?z[i]:lo[2]; hi[2] = (z[i]>hi[2])?z[i]:hi[2];
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* SIMD min/max reduction: two registers per bound and component, so the
+* loop is limited by load bandwidth rather than by min/max latency
+**/
+template<class T, int W>
+struct BoundsKernel
+{
+    static void Run(const T* x, const T* y, const T* z, std::size_t n, T lo[3], T hi[3])
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        std::size_t i = 0;
+        if(n >= std::size_t(2*W))
+        {
+            V lx0 = O::Set1(lo[0]), ly0 = O::Set1(lo[1]), lz0 = O::Set1(lo[2]);
+            V hx0 = O::Set1(hi[0]), hy0 = O::Set1(hi[1]), hz0 = O::Set1(hi[2]);
+            V lx1 = lx0, ly1 = ly0, lz1 = lz0, hx1 = hx0, hy1 = hy0, hz1 = hz0;
+            for(;i+2*W<=n;i+=2*W)
+            {
+                V px = O::Load(x+i), py = O::Load(y+i), pz = O::Load(z+i);
+                lx0 = O::Min(lx0,px); hx0 = O::Max(hx0,px);
+                ly0 = O::Min(ly0,py); hy0 = O::Max(hy0,py);
+                lz0 = O::Min(lz0,pz); hz0 = O::Max(hz0,pz);
+                px = O::Load(x+i+W); py = O::Load(y+i+W); pz = O::Load(z+i+W);
+                lx1 = O::Min(lx1,px); hx1 = O::Max(hx1,px);
+                ly1 = O::Min(ly1,py); hy1 = O::Max(hy1,py);
+                lz1 = O::Min(lz1,pz); hz1 = O::Max(hz1,pz);
+            }
+            T buf[6][W];
+            O::Store(buf[0],O::Min(lx0,lx1)); O::Store(buf[1],O::Min(ly0,ly1)); O::Store(buf[2],O::Min(lz0,lz1));
+            O::Store(buf[3],O::Max(hx0,hx1)); O::Store(buf[4],O::Max(hy0,hy1)); O::Store(buf[5],O::Max(hz0,hz1));
+            for(int k=0;k<W;k++)
+            {
+                for(int c=0;c<3;c++)
+                {
+                    lo[c] = (buf[c][k]<lo[c])?buf[c][k]:lo[c];
+                    hi[c] = (buf[3+c][k]>hi[c])?buf[3+c][k]:hi[c];
+                }
+            }
+        }
+        BoundsKernel<T,1>::Run(x+i, y+i, z+i, n-i, lo, hi);
+    }
+};
+#endif
+
+/**
+* BoundsKernel over chunks of the default executor, merged at the end
+**/
+template<class T>
+inline void ParallelBounds(const T* x, const T* y, const T* z, std::size_t n, T lo[3], T hi[3])
+{
+    typedef BoundsKernel<T,SimdWidth<T>::value> Kernel;
+    std::size_t grain = DefaultExecutor().Grain();
+    unsigned count = (n > grain)?unsigned(std::min<std::size_t>(ThreadCount(0), n/grain)):1u;
+    if(count <= 1)
+    {
+        Kernel::Run(x, y, z, n, lo, hi);
+        return;
+    }
+    std::vector<T> bounds(6*std::size_t(count));
+    ParallelChunks(0, n, count, [&](std::size_t b, std::size_t e, unsigned i) {
+        T* l = &bounds[6*std::size_t(i)];
+        T* h = l+3;
+        std::copy(lo, lo+3, l);
+        std::copy(hi, hi+3, h);
+        Kernel::Run(x+b, y+b, z+b, e-b, l, h);
+    });
+    for(unsigned i=0;i<count;i++)
+    {
+        for(int c=0;c<3;c++)
+        {
+            lo[c] = std::min(lo[c], bounds[6*std::size_t(i)+c]);
+            hi[c] = std::max(hi[c], bounds[6*std::size_t(i)+3+c]);
+        }
+    }
+}
+
+/**
+* Arvo's method for affine transforms of boxes: the transformed box has center
+* center*mat and half extents extents*|mat| (|mat| - absolute values of the 3x3 block)
+* @param mat - transformation matrix
+* @param m - output, m[r*3+c] = mat(r,c) for rows 0-3
+* @param a - output, a[r*3+c] = |mat(r,c)| for rows 0-2
+**/
+template<class T>
+inline void PackArvo(const Matrix3D<T>& mat, T m[12], T a[9])
+{
+    PackAffine(mat, m);
+    for(int i=0;i<9;i++)
+        a[i] = std::abs(m[i]);
+}
+
+}
+
+/**
+* Simple Axis-Aligned Bounding Box Class
+* An empty box has Min() > Max() (it contains nothing and expanding it by
+* a point gives the box of that point)
+**/
+template<class T>
+class AABB
+{
+private:
+    Vector3D<T> lo; // minimum corner
+    Vector3D<T> hi; // maximum corner
+public:
+    /**
+    * Default Constructor
+    * Initializes to the empty box
+    **/
+    AABB():lo(std::numeric_limits<T>::max(),std::numeric_limits<T>::max(),std::numeric_limits<T>::max()),
+           hi(std::numeric_limits<T>::lowest(),std::numeric_limits<T>::lowest(),std::numeric_limits<T>::lowest()){}
+
+    /**
+    * Constructor
+    * @param minCorner - minimum corner
+    * @param maxCorner - maximum corner
+    **/
+    AABB(const Vector3D<T>& minCorner, const Vector3D<T>& maxCorner):lo(minCorner),hi(maxCorner){}
+
+    /**
+    * Get the box of a set of points (SIMD min/max reduction over the SoA buffers)
+    * @param points - points to bound
+    * @return AABB - the smallest box containing all points (empty if there are none)
+    **/
+    static AABB FromPoints(const PointArray3D<T>& points)
+    {
+        return FromPoints(points.X(), points.Y(), points.Z(), points.Size());
+    }
+
+    /**
+    * Get the box of a set of points given as SoA component arrays
+    * @param x - x components
+    * @param y - y components
+    * @param z - z components
+    * @param n - number of points
+    * @return AABB - the smallest box containing all points (empty if there are none)
+    **/
+    static AABB FromPoints(const T* x, const T* y, const T* z, std::size_t n)
+    {
+        AABB box;
+        T l[3] = {box.lo.X(), box.lo.Y(), box.lo.Z()};
+        T h[3] = {box.hi.X(), box.hi.Y(), box.hi.Z()};
+        detail::ParallelBounds(x, y, z, n, l, h);
+        return AABB(Vector3D<T>(l[0],l[1],l[2]), Vector3D<T>(h[0],h[1],h[2]));
+    }
+
+    /**
+    * Get the box of a set of points (AoS)
+    * @param points - points to bound
+    * @return AABB - the smallest box containing all points (empty if there are none)
+    **/
+    static AABB FromPoints(const std::vector<Vector3D<T> >& points)
+    {
+        AABB box;
+        for(std::size_t i=0;i<points.size();i++)
+            box.Expand(points[i]);
+        return box;
+    }
+
+    /**
+    * Get corners
+    * @return Vector3D - the corner
+    **/
+    const Vector3D<T>& Min()const {return lo;}
+    const Vector3D<T>& Max()const {return hi;}
+
+    /**
+    * Test if box is empty?
+    * @return bool - true if the box contains no point
+    **/
+    bool Empty()const {return (lo.X()>hi.X())||(lo.Y()>hi.Y())||(lo.Z()>hi.Z());}
+
+    /**
+    * Get center of box
+    * @return Vector3D - the center
+    **/
+    Vector3D<T> Center()const {return Vector3D<T>((lo.X()+hi.X())*T(0.5), (lo.Y()+hi.Y())*T(0.5), (lo.Z()+hi.Z())*T(0.5));}
+
+    /**
+    * Get half extents of box
+    * @return Vector3D - half of the size in each axis
+    **/
+    Vector3D<T> Extents()const {return Vector3D<T>((hi.X()-lo.X())*T(0.5), (hi.Y()-lo.Y())*T(0.5), (hi.Z()-lo.Z())*T(0.5));}
+
+    /**
+    * Get size of box
+    * @return Vector3D - the size in each axis
+    **/
+    Vector3D<T> Size()const {return Vector3D<T>(hi.X()-lo.X(), hi.Y()-lo.Y(), hi.Z()-lo.Z());}
+
+    /**
+    * Get surface area of box
+    * @return T - the surface area (0 for an empty box)
+    **/
+    T SurfaceArea()const
+    {
+        if(Empty())
+            return T(0);
+        T dx = hi.X()-lo.X(), dy = hi.Y()-lo.Y(), dz = hi.Z()-lo.Z();
+        return T(2)*(dx*dy+dy*dz+dz*dx);
+    }
+
+    /**
+    * Get volume of box
+    * @return T - the volume (0 for an empty box)
+    **/
+    T Volume()const
+    {
+        if(Empty())
+            return T(0);
+        return (hi.X()-lo.X())*(hi.Y()-lo.Y())*(hi.Z()-lo.Z());
+    }
+
+    /**
+    * Grow box to contain a point
+    * @param p - point to include
+    **/
+    void Expand(const Vector3D<T>& p)
+    {
+        lo = Vector3D<T>((p.X()<lo.X())?p.X():lo.X(), (p.Y()<lo.Y())?p.Y():lo.Y(), (p.Z()<lo.Z())?p.Z():lo.Z());
+        hi = Vector3D<T>((p.X()>hi.X())?p.X():hi.X(), (p.Y()>hi.Y())?p.Y():hi.Y(), (p.Z()>hi.Z())?p.Z():hi.Z());
+    }
+
+    /**
+    * Grow box to contain another box
+    * @param other - box to include
+    **/
+    void Expand(const AABB& other)
+    {
+        if(other.Empty())
+            return;
+        Expand(other.lo);
+        Expand(other.hi);
+    }
+
+    /**
+    * Test if point is inside the box (boundary included)
+    * @param p - point to test
+    * @return bool - true if inside
+    **/
+    bool Contains(const Vector3D<T>& p)const
+    {
+        return (p.X()>=lo.X())&&(p.X()<=hi.X())&&(p.Y()>=lo.Y())&&(p.Y()<=hi.Y())&&(p.Z()>=lo.Z())&&(p.Z()<=hi.Z());
+    }
+
+    /**
+    * Test if other box is inside this box
+    * @param other - box to test
+    * @return bool - true if inside (an empty box is inside every box)
+    **/
+    bool Contains(const AABB& other)const
+    {
+        return other.Empty()||(Contains(other.lo)&&Contains(other.hi));
+    }
+
+    /**
+    * Test if this box overlaps another box (touching counts)
+    * @param other - box to test
+    * @return bool - true if they overlap
+    **/
+    bool Intersects(const AABB& other)const
+    {
+        return (lo.X()<=other.hi.X())&&(hi.X()>=other.lo.X())&&
+               (lo.Y()<=other.hi.Y())&&(hi.Y()>=other.lo.Y())&&
+               (lo.Z()<=other.hi.Z())&&(hi.Z()>=other.lo.Z());
+    }
+
+    /**
+    * Squared distance from a point to the box
+    * @param p - point
+    * @return T - the squared distance (0 if the point is inside)
+    **/
+    T DistanceSq(const Vector3D<T>& p)const
+    {
+        T d = T(0);
+        T v[3] = {p.X(), p.Y(), p.Z()}, l[3] = {lo.X(), lo.Y(), lo.Z()}, h[3] = {hi.X(), hi.Y(), hi.Z()};
+        for(int i=0;i<3;i++)
+        {
+            T e = (v[i]<l[i])?(l[i]-v[i]):((v[i]>h[i])?(v[i]-h[i]):T(0));
+            d += e*e;
+        }
+        return d;
+    }
+
+    /**
+    * Get the box of this box transformed by an affine matrix (Arvo's method)
+    * The corners are never transformed: the new center is center*mat and the
+    * new half extents are extents*|mat|. The result bounds all 8 transformed corners.
+    * @param mat - affine transformation matrix
+    * @return AABB - the transformed box (empty if this box is empty)
+    **/
+    AABB Transform(const Matrix3D<T>& mat)const
+    {
+        if(Empty())
+            return AABB();
+        T m[12], a[9];
+        detail::PackArvo(mat, m, a);
+        return TransformPacked(m, a);
+    }
+
+    /**
+    * Transform with packed matrices (see detail::PackArvo)
+    **/
+    AABB TransformPacked(const T m[12], const T a[9])const
+    {
+        T c[3] = {(lo.X()+hi.X())*T(0.5), (lo.Y()+hi.Y())*T(0.5), (lo.Z()+hi.Z())*T(0.5)};
+        T e[3] = {(hi.X()-lo.X())*T(0.5), (hi.Y()-lo.Y())*T(0.5), (hi.Z()-lo.Z())*T(0.5)};
+        T nc[3], ne[3];
+        for(int j=0;j<3;j++)
+        {
+            nc[j] = c[0]*m[j]+c[1]*m[3+j]+c[2]*m[6+j]+m[9+j];
+            ne[j] = e[0]*a[j]+e[1]*a[3+j]+e[2]*a[6+j];
+        }
+        return AABB(Vector3D<T>(nc[0]-ne[0], nc[1]-ne[1], nc[2]-ne[2]), Vector3D<T>(nc[0]+ne[0], nc[1]+ne[1], nc[2]+ne[2]));
+    }
+
+    /**
+    * Overload basic operators
+    * equality operators (==,!=)
+    **/
+    bool operator==(const AABB& other)const {return (lo==other.lo)&&(hi==other.hi);}
+    bool operator!=(const AABB& other)const {return !((*this)==other);}
+};
+
+/**
+* Transform an array of boxes by the same affine matrix (Arvo's method)
+* @param in - boxes to transform
+* @param out - transformed boxes (may be the same array as in)
+* @param n - number of boxes
+* @param mat - affine transformation matrix
+**/
+template<class T>
+void Transform(const AABB<T>* in, AABB<T>* out, std::size_t n, const Matrix3D<T>& mat)
+{
+    T m[12], a[9];
+    detail::PackArvo(mat, m, a);
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+            out[i] = in[i].Empty()?AABB<T>():in[i].TransformPacked(m, a);
+    });
+}
+
+/**
+* Transform a std::vector of boxes by the same affine matrix
+* @param boxes - boxes to transform in place
+* @param mat - affine transformation matrix
+**/
+template<class T>
+void Transform(std::vector<AABB<T> >& boxes, const Matrix3D<T>& mat)
+{
+    if(!boxes.empty())
+        Transform(&boxes[0], &boxes[0], boxes.size(), mat);
+}
+
+typedef AABB<double> AABBd;
+typedef AABB<float> AABBf;
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef AFFINE_3X4_HPP
+#define AFFINE_3X4_HPP
+
+/**
+* Includes
+**/
+#include <cmath>
+#include <limits>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Packed affine product kernel: out = a*b (scalar fallback)
+* Rows are a[i][0]*b[0] + a[i][1]*b[1] + a[i][2]*b[2], plus b[3] for the
+* translation row, summed left to right (the scalar Matrix3D product without
+* the terms of the constant column). out may alias a, but not b.
+**/
+template<class T>
+constexpr void AffineMultiplyScalar(const T a[4][3], const T b[4][3], T out[4][3])
+{
+    T r[4][3] = {};
+    for(int i=0;i<4;i++)
+    {
+        T a0 = a[i][0], a1 = a[i][1], a2 = a[i][2];
+        for(int j=0;j<3;j++)
+            r[i][j] = a0*b[0][j]+a1*b[1][j]+a2*b[2][j];
+    }
+    for(int j=0;j<3;j++)
+        r[3][j] += b[3][j];
+    for(int i=0;i<4;i++)
+        for(int j=0;j<3;j++)
+            out[i][j] = r[i][j];
+}
+
+template<class T>
+struct AffineMultiplyKernel
+{
+    static constexpr void Run(const T a[4][3], const T b[4][3], T out[4][3])
+    {
+        AffineMultiplyScalar(a, b, out);
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* One row per SSE register; the fourth lane spills into the next row and is
+* overwritten by the later stores (the last row is stored ending at out[3][2])
+**/
+template<>
+struct AffineMultiplyKernel<float>
+{
+    static void Run(const float a[4][3], const float b[4][3], float out[4][3])
+    {
+        __m128 b0 = _mm_loadu_ps(b[0]), b1 = _mm_loadu_ps(b[1]), b2 = _mm_loadu_ps(b[2]);
+        // b[2][2], b[3][0..2] shifted down one lane
+        __m128 b3 = _mm_loadu_ps(b[2]+2);
+        b3 = _mm_shuffle_ps(b3,b3,_MM_SHUFFLE(3,3,2,1));
+        __m128 r[4];
+        for(int i=0;i<4;i++)
+        {
+            r[i] = _mm_mul_ps(_mm_set1_ps(a[i][0]),b0);
+            r[i] = _mm_add_ps(r[i],_mm_mul_ps(_mm_set1_ps(a[i][1]),b1));
+            r[i] = _mm_add_ps(r[i],_mm_mul_ps(_mm_set1_ps(a[i][2]),b2));
+        }
+        r[3] = _mm_add_ps(r[3],b3);
+        _mm_storeu_ps(out[0],r[0]);
+        _mm_storeu_ps(out[1],r[1]);
+        _mm_storeu_ps(out[2],r[2]);
+        // (r2.z, r3.x, r3.y, r3.z) ending at out[3][2]
+        __m128 t = _mm_shuffle_ps(r[2],r[3],_MM_SHUFFLE(0,0,2,2));
+        _mm_storeu_ps(out[2]+2,_mm_shuffle_ps(t,r[3],_MM_SHUFFLE(2,1,2,0)));
+    }
+};
+
+#if defined(TOOLS3D_AVX)
+template<>
+struct AffineMultiplyKernel<double>
+{
+    static void Run(const double a[4][3], const double b[4][3], double out[4][3])
+    {
+        __m256d b0 = _mm256_loadu_pd(b[0]), b1 = _mm256_loadu_pd(b[1]), b2 = _mm256_loadu_pd(b[2]);
+        __m256d b3 = _mm256_set_pd(0, b[3][2], b[3][1], b[3][0]);
+        __m256d r[4];
+        for(int i=0;i<4;i++)
+        {
+            r[i] = _mm256_mul_pd(_mm256_set1_pd(a[i][0]),b0);
+            r[i] = _mm256_add_pd(r[i],_mm256_mul_pd(_mm256_set1_pd(a[i][1]),b1));
+            r[i] = _mm256_add_pd(r[i],_mm256_mul_pd(_mm256_set1_pd(a[i][2]),b2));
+        }
+        r[3] = _mm256_add_pd(r[3],b3);
+        _mm256_storeu_pd(out[0],r[0]);
+        _mm256_storeu_pd(out[1],r[1]);
+        _mm256_storeu_pd(out[2],r[2]);
+        double last[4];
+        _mm256_storeu_pd(last,r[3]);
+        out[3][0] = last[0];
+        out[3][1] = last[1];
+        out[3][2] = last[2];
+    }
+};
+#endif
+#endif
+
+}
+
+/**
+* Packed affine matrix
+* Holds the 4x3 part of a Matrix3D whose last column is (0,0,0,1): rows 0-2
+* are the linear part and row 3 the translation (points are row vectors,
+* vec*mat, as with Matrix3D). 12 values instead of 16, and a product needs
+* three multiply-adds per row instead of four (36 multiplications instead of 64).
+* The conversion to and from Matrix3D is exact.
+**/
+template<class T>
+class Affine3x4
+{
+private:
+    T data[4][3]; // rows 0-2 - linear part, row 3 - translation
+
+public:
+    /**
+    * Default Constructor
+    * Initializes to Identity
+    **/
+    constexpr Affine3x4():data{{1,0,0},{0,1,0},{0,0,1},{0,0,0}}{}
+
+    /**
+    * Constructor
+    * @param mat - affine matrix (its last column is ignored)
+    **/
+    explicit constexpr Affine3x4(const Matrix3D<T>& mat):data{}
+    {
+        for(int i=0;i<4;i++)
+            for(int j=0;j<3;j++)
+                data[i][j] = mat(i,j);
+    }
+
+    /**
+    * Make matrix Identity
+    **/
+    constexpr void Identity()
+    {
+        for(int i=0;i<4;i++)
+            for(int j=0;j<3;j++)
+                data[i][j] = (i==j)?T(1):T(0);
+    }
+
+    /**
+    * Get the full matrix
+    * @return Matrix3D - the matrix with last column (0,0,0,1)
+    **/
+    constexpr Matrix3D<T> Matrix()const
+    {
+        Matrix3D<T> temp;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<3;j++)
+                temp(i,j) = data[i][j];
+        return temp;
+    }
+
+    /**
+    * Get Matrix Data without copying
+    * @return T - the 12 elements row by row (the layout of detail::PackAffine)
+    **/
+    constexpr const T* Data()const {return &data[0][0];}
+    constexpr T* Data() {return &data[0][0];}
+
+    /**
+    * Copy Matrix Data into caller storage
+    * ColumnMajor gives the 3x4 matrix of the column-vector convention row by
+    * row (the usual layout of 3x4 shader constants).
+    * @param out - output, 12 elements
+    * @param order - element order of out
+    **/
+    constexpr void CopyData(T* out, MatrixOrder order = RowMajor)const
+    {
+        for(int i=0;i<4;i++)
+            for(int j=0;j<3;j++)
+                out[(order == RowMajor)?i*3+j:j*4+i] = data[i][j];
+    }
+
+    /**
+    * Get the translation
+    * @return Vector3D - row 3
+    **/
+    constexpr Vector3D<T> Translation()const {return Vector3D<T>(data[3][0], data[3][1], data[3][2]);}
+
+    /**
+    * Get Determinant of the linear part
+    * @return T - the determinant (also the one of Matrix())
+    **/
+    constexpr T Det()const
+    {
+        return data[0][0]*(data[1][1]*data[2][2]-data[1][2]*data[2][1])
+              +data[0][1]*(data[1][2]*data[2][0]-data[1][0]*data[2][2])
+              +data[0][2]*(data[1][0]*data[2][1]-data[1][1]*data[2][0]);
+    }
+
+    /**
+    * Get Inverse of the Matrix
+    * @return Affine3x4 - the inversed matrix (Identity if the linear part is singular),
+    * same as Matrix().InverseAffine()
+    **/
+    Affine3x4 Inverse()const
+    {
+        T c00 = data[1][1]*data[2][2]-data[1][2]*data[2][1];
+        T c01 = data[1][2]*data[2][0]-data[1][0]*data[2][2];
+        T c02 = data[1][0]*data[2][1]-data[1][1]*data[2][0];
+        T det = data[0][0]*c00+data[0][1]*c01+data[0][2]*c02;
+        if(std::fabs(det) <= std::numeric_limits<T>::epsilon())
+            return Affine3x4();
+        T inv = T(1)/det;
+        Affine3x4 temp;
+        temp.data[0][0] = c00*inv;
+        temp.data[0][1] = (data[0][2]*data[2][1]-data[0][1]*data[2][2])*inv;
+        temp.data[0][2] = (data[0][1]*data[1][2]-data[0][2]*data[1][1])*inv;
+        temp.data[1][0] = c01*inv;
+        temp.data[1][1] = (data[0][0]*data[2][2]-data[0][2]*data[2][0])*inv;
+        temp.data[1][2] = (data[0][2]*data[1][0]-data[0][0]*data[1][2])*inv;
+        temp.data[2][0] = c02*inv;
+        temp.data[2][1] = (data[0][1]*data[2][0]-data[0][0]*data[2][1])*inv;
+        temp.data[2][2] = (data[0][0]*data[1][1]-data[0][1]*data[1][0])*inv;
+        for(int j=0;j<3;j++)
+            temp.data[3][j] = -(data[3][0]*temp.data[0][j]+data[3][1]*temp.data[1][j]+data[3][2]*temp.data[2][j]);
+        return temp;
+    }
+
+    /**
+    * Matrix product written straight into the destination
+    * (SSE/AVX for float and double with AVX, scalar otherwise)
+    * @param a - left operand
+    * @param b - right operand
+    * @param out - result a*b (may be the same object as a or b)
+    **/
+    static constexpr void Multiply(const Affine3x4& a, const Affine3x4& b, Affine3x4& out)
+    {
+        if(&out == &b)
+        {
+            Affine3x4 copy(b);
+            Multiply(a, copy, out);
+        }
+        else if(TOOLS3D_IS_CONSTANT_EVALUATED())
+            detail::AffineMultiplyScalar(a.data, b.data, out.data);
+        else
+            detail::AffineMultiplyKernel<T>::Run(a.data, b.data, out.data);
+    }
+
+    /**
+    * Overload basic operators
+    **/
+    constexpr const Affine3x4& operator*=(const Affine3x4& other)
+    {
+        Multiply(*this, other, *this);
+        return *this;
+    }
+
+    /**
+    * Overloading () operator
+    * @params i - row index (0-3)
+    * @params j - column index (0-2)
+    * @return T - value of i,j-th element
+    **/
+    constexpr T& operator()(unsigned int i, unsigned int j)
+    {
+        return data[i][j];
+    }
+
+    constexpr const T& operator()(unsigned int i, unsigned int j)const
+    {
+        return data[i][j];
+    }
+};
+
+template<class T>
+constexpr Affine3x4<T> operator*(const Affine3x4<T>& a, const Affine3x4<T>& b)
+{
+    Affine3x4<T> temp;
+    Affine3x4<T>::Multiply(a, b, temp);
+    return temp;
+}
+
+template<class T>
+constexpr Vector3D<T> operator*(const Vector3D<T>& vec, const Affine3x4<T>& mat)
+{
+    return Vector3D<T>(vec.X()*mat(0,0)+vec.Y()*mat(1,0)+vec.Z()*mat(2,0)+mat(3,0),
+                       vec.X()*mat(0,1)+vec.Y()*mat(1,1)+vec.Z()*mat(2,1)+mat(3,1),
+                       vec.X()*mat(0,2)+vec.Y()*mat(1,2)+vec.Z()*mat(2,2)+mat(3,2));
+}
+
+/**
+* Transform all points by a packed matrix (no repacking, see Transform with Matrix3D)
+* @param points - points to transform in place
+* @param mat - transformation matrix
+**/
+template<class T>
+void Transform(PointArray3D<T>& points, const Affine3x4<T>& mat)
+{
+    const T* m = mat.Data();
+    T* x = points.X();
+    T* y = points.Y();
+    T* z = points.Z();
+    detail::ParallelBatch(points.Size(), [&](std::size_t b, std::size_t e) {
+        detail::TransformKernel<T>::Run(x+b, y+b, z+b, x+b, y+b, z+b, e-b, m);
+    });
+}
+
+/**
+* Transform all points by a packed matrix into another array
+* @param in - points to transform
+* @param out - transformed points (resized to match in)
+* @param mat - transformation matrix
+**/
+template<class T>
+void Transform(const PointArray3D<T>& in, PointArray3D<T>& out, const Affine3x4<T>& mat)
+{
+    const T* m = mat.Data();
+    out.Resize(in.Size());
+    const T* x = in.X();
+    const T* y = in.Y();
+    const T* z = in.Z();
+    T* ox = out.X();
+    T* oy = out.Y();
+    T* oz = out.Z();
+    detail::ParallelBatch(in.Size(), [&](std::size_t b, std::size_t e) {
+        detail::TransformKernel<T>::Run(x+b, y+b, z+b, ox+b, oy+b, oz+b, e-b, m);
+    });
+}
+
+typedef Affine3x4<double> Affine3x4d;
+typedef Affine3x4<float> Affine3x4f;
+
+}
+
+#endif
@@ -0,0 +1,810 @@
+#ifndef BSP_HPP
+#define BSP_HPP
+
+/**
+* Includes
+* Binary space partitioning tree over polygons
+* The tree lives in three flat arrays (nodes, polygon fragments, vertices) that
+* reference each other by index only, so it serialises to one pointer-free blob
+* that can be memory-mapped and queried in place by BSPView.
+* The per-polygon passes of a build run on the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Location of a point relative to the solid described by a BSP tree
+**/
+enum class BSPLocation
+{
+    Outside,
+    Inside,
+    Boundary // closer than the tolerance to a polygon plane that separates inside from outside
+};
+
+/**
+* Read-only BSP tree over flat arrays: the storage of a BSPTree or a serialised blob
+* Node children are node indices (always greater than the parent), or EmptyLeaf
+* (outside) / SolidLeaf (inside). A node owns the fragments coplanar with its
+* plane, and the fragments of a node are contiguous.
+**/
+template<class T>
+class BSPView
+{
+public:
+    /**
+    * Blob header (32 bytes), followed by the nodes, the polygons and 3 T per vertex
+    * The blob uses the byte order of the machine that wrote it.
+    **/
+    struct Header
+    {
+        char magic[4]; // "BSP3"
+        std::uint32_t version;
+        std::uint32_t scalarSize; // sizeof(T)
+        std::uint32_t nodeCount;
+        std::uint32_t polygonCount;
+        std::uint32_t vertexCount;
+        double tolerance;
+    };
+
+    /**
+    * Node: plane normal.Dot(p) = plane[3] and its two subtrees
+    **/
+    struct Node
+    {
+        T plane[4]; // unit normal and offset
+        std::int32_t front; // subtree on the normal side
+        std::int32_t back; // subtree on the other side
+        std::uint32_t firstPolygon; // fragments coplanar with the plane
+        std::uint32_t polygonCount;
+    };
+
+    /**
+    * Polygon fragment: a convex piece of an input polygon
+    **/
+    struct Polygon
+    {
+        std::uint32_t firstVertex;
+        std::uint32_t vertexCount;
+        std::uint32_t source; // index of the input polygon
+        std::uint32_t flipped; // 1 if the polygon faces against the plane of its node
+    };
+
+    static const std::int32_t EmptyLeaf = -1;
+    static const std::int32_t SolidLeaf = -2;
+    static const std::uint32_t Version = 1;
+
+private:
+    const Node* nodes;
+    const Polygon* polygons;
+    const T* coords;
+    std::uint32_t nodeCount;
+    std::uint32_t polygonCount;
+    std::uint32_t vertexCount;
+    T tolerance;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty view (every point is outside)
+    **/
+    BSPView():nodes(0),polygons(0),coords(0),nodeCount(0),polygonCount(0),vertexCount(0),tolerance(0){}
+
+    /**
+    * Constructor
+    * @param n - nodes (root first)
+    * @param nn - number of nodes
+    * @param p - polygon fragments
+    * @param np - number of fragments
+    * @param c - vertex coordinates (x,y,z per vertex)
+    * @param nv - number of vertices
+    * @param tol - plane thickness used by Classify
+    **/
+    BSPView(const Node* n, std::uint32_t nn, const Polygon* p, std::uint32_t np, const T* c, std::uint32_t nv, T tol)
+        :nodes(n),polygons(p),coords(c),nodeCount(nn),polygonCount(np),vertexCount(nv),tolerance(tol){}
+
+    /**
+    * View a serialised tree in place (no copy, the blob must outlive the view)
+    * The header and size are always checked, so a truncated or foreign file is
+    * rejected instead of being read out of bounds.
+    * @param data - the blob (aligned to at least alignof(T))
+    * @param size - size of the blob in bytes
+    * @param validate - check every child and range index (touches the whole blob);
+    * files this program wrote itself can skip it, which keeps the load O(1) and
+    * lets a mapped file be paged in lazily
+    * @return bool - false if the blob is not a valid tree for this T (the view is then empty)
+    **/
+    bool Load(const void* data, std::size_t size, bool validate = true)
+    {
+        *this = BSPView();
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        if(!data || size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data)%alignof(Node) != 0)
+            return false;
+        Header h;
+        std::memcpy(&h, bytes, sizeof(Header));
+        if(std::memcmp(h.magic, "BSP3", 4) != 0 || h.version != Version || h.scalarSize != sizeof(T))
+            return false;
+        std::size_t need = sizeof(Header)+std::size_t(h.nodeCount)*sizeof(Node)+std::size_t(h.polygonCount)*sizeof(Polygon)+std::size_t(h.vertexCount)*3*sizeof(T);
+        if(size < need)
+            return false;
+        const Node* n = reinterpret_cast<const Node*>(bytes+sizeof(Header));
+        const Polygon* p = reinterpret_cast<const Polygon*>(n+h.nodeCount);
+        const T* c = reinterpret_cast<const T*>(p+h.polygonCount);
+        if(validate)
+        {
+            for(std::uint32_t i=0;i<h.nodeCount;i++)
+            {
+                std::int32_t child[2] = {n[i].front, n[i].back};
+                for(int k=0;k<2;k++)
+                    if(child[k] != EmptyLeaf && child[k] != SolidLeaf && (child[k] <= std::int32_t(i) || std::uint32_t(child[k]) >= h.nodeCount))
+                        return false;
+                if(n[i].firstPolygon > h.polygonCount || n[i].polygonCount > h.polygonCount-n[i].firstPolygon)
+                    return false;
+            }
+            for(std::uint32_t i=0;i<h.polygonCount;i++)
+                if(p[i].firstVertex > h.vertexCount || p[i].vertexCount > h.vertexCount-p[i].firstVertex)
+                    return false;
+        }
+        *this = BSPView(n, h.nodeCount, p, h.polygonCount, c, h.vertexCount, T(h.tolerance));
+        return true;
+    }
+
+    /**
+    * Classify a point against the solid (back sides of the polygons are inside)
+    * @param p - the point
+    * @return BSPLocation - inside, outside or on the boundary
+    **/
+    BSPLocation Classify(const Vector3D<T>& p)const
+    {
+        if(nodeCount == 0)
+            return BSPLocation::Outside;
+        return ClassifyFrom(0, p);
+    }
+
+    /**
+    * Visit all polygon fragments in front-to-back order as seen from a point
+    * (a fragment never hides one visited before it)
+    * @param eye - the view point
+    * @param visit - callable taking the fragment index (std::uint32_t)
+    **/
+    template<class F>
+    void TraverseFrontToBack(const Vector3D<T>& eye, F visit)const
+    {
+        if(nodeCount == 0)
+            return;
+        // pending entries: subtree roots (>= 0) and nodes whose polygons are next (~node)
+        std::vector<std::int32_t> stack;
+        stack.reserve(64);
+        std::int32_t idx = 0;
+        while(true)
+        {
+            if(idx >= 0)
+            {
+                const Node& node = nodes[idx];
+                bool front = Distance(node, eye) >= T(0);
+                std::int32_t nearChild = front?node.front:node.back, farChild = front?node.back:node.front;
+                if(farChild >= 0)
+                    stack.push_back(farChild);
+                stack.push_back(~idx);
+                if(nearChild >= 0)
+                {
+                    idx = nearChild;
+                    continue;
+                }
+            }
+            else
+            {
+                const Node& node = nodes[~idx];
+                for(std::uint32_t i=node.firstPolygon;i<node.firstPolygon+node.polygonCount;i++)
+                    visit(i);
+            }
+            if(stack.empty())
+                break;
+            idx = stack.back();
+            stack.pop_back();
+        }
+    }
+
+    /**
+    * Test if tree is empty?
+    * @return bool - true if there are no nodes
+    **/
+    bool Empty()const {return nodeCount == 0;}
+
+    /**
+    * Get number of nodes
+    * @return std::size_t - the number of nodes
+    **/
+    std::size_t NodeCount()const {return nodeCount;}
+
+    /**
+    * Get number of polygon fragments
+    * @return std::size_t - the number of fragments
+    **/
+    std::size_t PolygonCount()const {return polygonCount;}
+
+    /**
+    * Get number of fragment vertices
+    * @return std::size_t - the number of vertices
+    **/
+    std::size_t VertexCount()const {return vertexCount;}
+
+    /**
+    * Get plane thickness used by Classify
+    * @return T - the tolerance
+    **/
+    T Tolerance()const {return tolerance;}
+
+    /**
+    * Get node
+    * @param i - node index (0 is the root)
+    * @return Node - the node
+    **/
+    const Node& GetNode(std::size_t i)const {return nodes[i];}
+
+    /**
+    * Get polygon fragment
+    * @param i - fragment index
+    * @return Polygon - the fragment
+    **/
+    const Polygon& GetPolygon(std::size_t i)const {return polygons[i];}
+
+    /**
+    * Get fragment vertex
+    * @param i - vertex index (Polygon::firstVertex + k)
+    * @return Vector3D - the vertex
+    **/
+    Vector3D<T> Vertex(std::size_t i)const {return Vector3D<T>(coords[3*i],coords[3*i+1],coords[3*i+2]);}
+
+private:
+    static T Distance(const Node& node, const Vector3D<T>& p)
+    {
+        return node.plane[0]*p.X()+node.plane[1]*p.Y()+node.plane[2]*p.Z()-node.plane[3];
+    }
+
+    BSPLocation ClassifyFrom(std::int32_t idx, const Vector3D<T>& p)const
+    {
+        while(idx >= 0)
+        {
+            const Node& node = nodes[idx];
+            T d = Distance(node, p);
+            if(d > tolerance)
+                idx = node.front;
+            else if(d < -tolerance)
+                idx = node.back;
+            else
+            {
+                // on the plane: the point is on the boundary unless both sides agree
+                BSPLocation front = ClassifyFrom(node.front, p);
+                if(front == BSPLocation::Boundary)
+                    return front;
+                BSPLocation back = ClassifyFrom(node.back, p);
+                return (front == back)?front:BSPLocation::Boundary;
+            }
+        }
+        return (idx == SolidLeaf)?BSPLocation::Inside:BSPLocation::Outside;
+    }
+};
+
+/**
+* Solid BSP tree built from polygons (autopartition: every split plane is the
+* plane of an input polygon)
+* Nodes, fragments and vertices are appended to flat arrays during the build,
+* so there is no allocation per node. For a closed mesh with outward-facing
+* polygons, the empty leaves are outside and the solid leaves inside.
+**/
+template<class T>
+class BSPTree
+{
+public:
+    typedef typename BSPView<T>::Header Header;
+    typedef typename BSPView<T>::Node Node;
+    typedef typename BSPView<T>::Polygon Polygon;
+
+    /**
+    * Build settings
+    * The split plane of a node is the cheapest of `candidates` polygon planes, each
+    * scored on `samples` polygons of the node: splitWeight*splits + |front - back|
+    **/
+    struct Settings
+    {
+        unsigned candidates; // split planes tried per node
+        unsigned samples; // polygons classified per candidate
+        T splitWeight; // cost of one split relative to one polygon of imbalance
+        unsigned threads; // threads for the input planes and the node classification (0 - DefaultExecutor().Concurrency())
+
+        Settings():candidates(8),samples(64),splitWeight(8),threads(0){}
+    };
+
+private:
+    /**
+    * Polygon fragment during the build (vertices in verts)
+    **/
+    struct Fragment
+    {
+        std::uint32_t first;
+        std::uint32_t count;
+        std::uint32_t source;
+        Vector3D<T> normal;
+        T offset;
+    };
+
+    /**
+    * Node waiting to be split: its fragments are list[begin..end of list)
+    **/
+    struct Task
+    {
+        std::uint32_t node;
+        std::size_t begin;
+    };
+
+    // side of a fragment relative to a plane (bit 0 - some vertex in front, bit 1 - some behind)
+    enum {Coplanar = 0, Front = 1, Back = 2, Spanning = 3};
+
+    std::vector<Node> nodes;
+    std::vector<Polygon> polygons;
+    std::vector<T> coords;
+    T tolerance;
+    Settings settings;
+
+    // build arenas
+    std::vector<Fragment> fragments;
+    std::vector<Vector3D<T> > verts;
+    std::vector<std::uint32_t> list;
+    std::vector<std::uint32_t> frontList;
+    std::vector<std::uint8_t> sides; // side of every fragment of the node being split
+    std::vector<Task> tasks;
+    std::vector<Vector3D<T> > frontPiece;
+    std::vector<Vector3D<T> > backPiece;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty tree
+    **/
+    BSPTree():tolerance(0){}
+
+    /**
+    * Constructor
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (empty - vertices is a triangle soup)
+    * @param s - build settings
+    **/
+    BSPTree(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, const Settings& s = Settings()):tolerance(0)
+    {
+        Build(vertices, indices, s);
+    }
+
+    /**
+    * Build the tree from a triangle mesh
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (empty - vertices is a triangle soup)
+    * @param s - build settings
+    **/
+    void Build(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, const Settings& s = Settings())
+    {
+        std::size_t n = (indices.empty()?vertices.size():indices.size())/3;
+        std::vector<std::uint32_t> offsets(n+1);
+        for(std::size_t i=0;i<=n;i++)
+            offsets[i] = std::uint32_t(3*i);
+        Build(vertices.empty()?0:&vertices[0], indices.empty()?0:&indices[0], &offsets[0], n, s);
+    }
+
+    /**
+    * Build the tree from polygons
+    * @param polygons - vertices of each polygon (planar, counter-clockwise seen from outside)
+    * @param s - build settings
+    **/
+    void Build(const std::vector<std::vector<Vector3D<T> > >& polygons, const Settings& s = Settings())
+    {
+        std::vector<Vector3D<T> > vertices;
+        std::vector<std::uint32_t> offsets(1, 0);
+        for(std::size_t i=0;i<polygons.size();i++)
+        {
+            vertices.insert(vertices.end(), polygons[i].begin(), polygons[i].end());
+            offsets.push_back(std::uint32_t(vertices.size()));
+        }
+        Build(vertices.empty()?0:&vertices[0], 0, &offsets[0], polygons.size(), s);
+    }
+
+    /**
+    * Build the tree from indexed polygons
+    * @param vertices - vertex positions
+    * @param indices - vertex indices of all polygons (null - use the vertices in order)
+    * @param offsets - polygon i uses indices offsets[i] .. offsets[i+1]-1 (polygonCount+1 values)
+    * @param polygonCount - number of polygons
+    * @param s - build settings
+    **/
+    void Build(const Vector3D<T>* vertices, const std::uint32_t* indices, const std::uint32_t* offsets, std::size_t polygonCount, const Settings& s = Settings())
+    {
+        settings = s;
+        settings.candidates = std::max(1u, settings.candidates);
+        settings.samples = std::max(1u, settings.samples);
+        settings.threads = detail::ThreadCount(settings.threads);
+        nodes.clear();
+        polygons.clear();
+        coords.clear();
+        fragments.clear();
+        verts.clear();
+        list.clear();
+        tolerance = T(0);
+        std::size_t grain = detail::BatchGrain();
+
+        // plane thickness relative to the coordinate magnitude
+        unsigned chunks = (polygonCount > grain)?unsigned(std::min<std::size_t>(settings.threads, polygonCount/grain)):1u;
+        std::vector<T> maxAbs(chunks, T(0));
+        detail::ParallelChunks(0, polygonCount, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            T m = T(0);
+            for(std::size_t i=b;i<e;i++)
+            {
+                for(std::uint32_t k=offsets[i];k<offsets[i+1];k++)
+                {
+                    const Vector3D<T>& v = vertices[indices?indices[k]:k];
+                    m = std::max(m, std::max(std::abs(v.X()), std::max(std::abs(v.Y()), std::abs(v.Z()))));
+                }
+            }
+            maxAbs[c] = m;
+        });
+        tolerance = T(64)*std::numeric_limits<T>::epsilon()*(*std::max_element(maxAbs.begin(), maxAbs.end()));
+
+        // input polygons with their (Newell) planes; degenerate ones are dropped
+        // (their vertices stay unused in the arena until the build ends)
+        std::uint32_t base = polygonCount?offsets[0]:0;
+        verts.resize(polygonCount?offsets[polygonCount]-base:0);
+        fragments.resize(polygonCount);
+        std::vector<std::uint8_t> valid(polygonCount);
+        detail::ParallelFor(0, polygonCount, grain, settings.threads, [&](std::size_t b, std::size_t e) {
+            for(std::size_t i=b;i<e;i++)
+            {
+                Fragment& f = fragments[i];
+                f.first = offsets[i]-base;
+                f.count = offsets[i+1]-offsets[i];
+                f.source = std::uint32_t(i);
+                for(std::uint32_t k=0;k<f.count;k++)
+                    verts[f.first+k] = vertices[indices?indices[offsets[i]+k]:offsets[i]+k];
+                valid[i] = (f.count >= 3 && Plane(f))?1u:0u;
+            }
+        });
+        for(std::size_t i=0;i<polygonCount;i++)
+            if(valid[i])
+                list.push_back(std::uint32_t(i));
+
+        if(!list.empty())
+        {
+            nodes.push_back(Node());
+            Task root = {0, 0};
+            tasks.push_back(root);
+        }
+        // depth-first with the fragments of the pending nodes stacked in list: the
+        // top task always owns the tail of list, so it can be rewritten in place
+        while(!tasks.empty())
+        {
+            Task task = tasks.back();
+            tasks.pop_back();
+            Split(task);
+        }
+
+        std::vector<Fragment>().swap(fragments);
+        std::vector<Vector3D<T> >().swap(verts);
+        std::vector<std::uint32_t>().swap(list);
+        std::vector<std::uint32_t>().swap(frontList);
+        std::vector<std::uint8_t>().swap(sides);
+    }
+
+    /**
+    * Get read-only view of the tree (valid until the next build)
+    * @return BSPView - the view
+    **/
+    BSPView<T> View()const
+    {
+        return BSPView<T>(nodes.empty()?0:&nodes[0], std::uint32_t(nodes.size()),
+                          polygons.empty()?0:&polygons[0], std::uint32_t(polygons.size()),
+                          coords.empty()?0:&coords[0], std::uint32_t(coords.size()/3), tolerance);
+    }
+
+    /**
+    * Classify a point against the solid (back sides of the polygons are inside)
+    * @param p - the point
+    * @return BSPLocation - inside, outside or on the boundary
+    **/
+    BSPLocation Classify(const Vector3D<T>& p)const {return View().Classify(p);}
+
+    /**
+    * Visit all polygon fragments in front-to-back order as seen from a point
+    * @param eye - the view point
+    * @param visit - callable taking the fragment index (std::uint32_t)
+    **/
+    template<class F>
+    void TraverseFrontToBack(const Vector3D<T>& eye, F visit)const {View().TraverseFrontToBack(eye, visit);}
+
+    /**
+    * Get size of the serialised tree
+    * @return std::size_t - the size in bytes
+    **/
+    std::size_t SerializedSize()const
+    {
+        return sizeof(Header)+nodes.size()*sizeof(Node)+polygons.size()*sizeof(Polygon)+coords.size()*sizeof(T);
+    }
+
+    /**
+    * Write the tree as a flat blob that BSPView::Load reads in place
+    * @param out - destination, SerializedSize() bytes
+    **/
+    void Serialize(void* out)const
+    {
+        Header h;
+        std::memcpy(h.magic, "BSP3", 4);
+        h.version = BSPView<T>::Version;
+        h.scalarSize = sizeof(T);
+        h.nodeCount = std::uint32_t(nodes.size());
+        h.polygonCount = std::uint32_t(polygons.size());
+        h.vertexCount = std::uint32_t(coords.size()/3);
+        h.tolerance = double(tolerance);
+        unsigned char* bytes = static_cast<unsigned char*>(out);
+        std::memcpy(bytes, &h, sizeof(Header));
+        bytes += sizeof(Header);
+        if(!nodes.empty())
+            std::memcpy(bytes, &nodes[0], nodes.size()*sizeof(Node));
+        bytes += nodes.size()*sizeof(Node);
+        if(!polygons.empty())
+            std::memcpy(bytes, &polygons[0], polygons.size()*sizeof(Polygon));
+        bytes += polygons.size()*sizeof(Polygon);
+        if(!coords.empty())
+            std::memcpy(bytes, &coords[0], coords.size()*sizeof(T));
+    }
+
+    /**
+    * Write the tree as a flat blob that BSPView::Load reads in place
+    * @param out - output, resized to SerializedSize()
+    **/
+    void Serialize(std::vector<unsigned char>& out)const
+    {
+        out.resize(SerializedSize());
+        Serialize(&out[0]);
+    }
+
+    /**
+    * Test if tree is empty?
+    * @return bool - true if there are no nodes
+    **/
+    bool Empty()const {return nodes.empty();}
+
+    /**
+    * Get number of nodes
+    * @return std::size_t - the number of nodes
+    **/
+    std::size_t NodeCount()const {return nodes.size();}
+
+    /**
+    * Get number of polygon fragments (input polygons plus the pieces made by splits)
+    * @return std::size_t - the number of fragments
+    **/
+    std::size_t PolygonCount()const {return polygons.size();}
+
+    /**
+    * Get plane thickness: points closer than this to a plane are on it
+    * @return T - the tolerance
+    **/
+    T Tolerance()const {return tolerance;}
+
+private:
+    /**
+    * Newell normal and offset of a fragment (false if it has no area)
+    **/
+    bool Plane(Fragment& f)const
+    {
+        T nx = T(0), ny = T(0), nz = T(0);
+        Vector3D<T> c;
+        for(std::uint32_t k=0;k<f.count;k++)
+        {
+            const Vector3D<T>& a = verts[f.first+k];
+            const Vector3D<T>& b = verts[f.first+(k+1)%f.count];
+            nx += (a.Y()-b.Y())*(a.Z()+b.Z());
+            ny += (a.Z()-b.Z())*(a.X()+b.X());
+            nz += (a.X()-b.X())*(a.Y()+b.Y());
+            c = c+a;
+        }
+        f.normal = Vector3D<T>(nx, ny, nz);
+        T len = f.normal.Length();
+        if(!(len > T(0)))
+            return false;
+        f.normal = f.normal/len;
+        f.offset = f.normal.Dot(c)/T(f.count);
+        return true;
+    }
+
+    int Side(const Fragment& f, const Vector3D<T>& n, T d)const
+    {
+        int side = Coplanar;
+        for(std::uint32_t k=0;k<f.count && side != Spanning;k++)
+        {
+            T dist = n.Dot(verts[f.first+k])-d;
+            if(dist > tolerance)
+                side |= Front;
+            else if(dist < -tolerance)
+                side |= Back;
+        }
+        return side;
+    }
+
+    /**
+    * Pick the split plane of count fragments at list[begin..]: the cheapest of
+    * evenly spaced candidates, each scored on evenly spaced samples
+    **/
+    std::uint32_t ChooseSplit(std::size_t begin, std::size_t count)const
+    {
+        std::size_t candidates = std::min<std::size_t>(settings.candidates, count);
+        std::size_t samples = std::min<std::size_t>(settings.samples, count);
+        std::uint32_t best = list[begin];
+        T bestCost = std::numeric_limits<T>::max();
+        for(std::size_t c=0;c<candidates;c++)
+        {
+            const Fragment& plane = fragments[list[begin+c*count/candidates]];
+            std::size_t front = 0, back = 0, splits = 0;
+            for(std::size_t s=0;s<samples;s++)
+            {
+                int side = Side(fragments[list[begin+s*count/samples]], plane.normal, plane.offset);
+                front += (side == Front);
+                back += (side == Back);
+                splits += (side == Spanning);
+            }
+            T cost = settings.splitWeight*T(splits)+T((front>back)?front-back:back-front);
+            if(cost < bestCost)
+            {
+                bestCost = cost;
+                best = list[begin+c*count/candidates];
+            }
+        }
+        return best;
+    }
+
+    /**
+    * Cut a fragment in two by a plane (vertices within the tolerance go to both pieces)
+    **/
+    void Cut(std::uint32_t f, const Vector3D<T>& n, T d, std::uint32_t& front, std::uint32_t& back)
+    {
+        frontPiece.clear();
+        backPiece.clear();
+        Fragment piece = fragments[f];
+        for(std::uint32_t k=0;k<piece.count;k++)
+        {
+            Vector3D<T> a = verts[piece.first+k], b = verts[piece.first+(k+1)%piece.count];
+            T da = n.Dot(a)-d, db = n.Dot(b)-d;
+            if(da >= -tolerance)
+                frontPiece.push_back(a);
+            if(da <= tolerance)
+                backPiece.push_back(a);
+            if((da > tolerance && db < -tolerance) || (da < -tolerance && db > tolerance))
+            {
+                Vector3D<T> p = a+(b-a)*(da/(da-db));
+                frontPiece.push_back(p);
+                backPiece.push_back(p);
+            }
+        }
+        front = AddPiece(piece, frontPiece);
+        back = AddPiece(piece, backPiece);
+    }
+
+    std::uint32_t AddPiece(Fragment piece, const std::vector<Vector3D<T> >& v)
+    {
+        if(v.size() < 3)
+            return std::numeric_limits<std::uint32_t>::max();
+        piece.first = std::uint32_t(verts.size());
+        piece.count = std::uint32_t(v.size());
+        verts.insert(verts.end(), v.begin(), v.end());
+        fragments.push_back(piece);
+        return std::uint32_t(fragments.size()-1);
+    }
+
+    /**
+    * Split the fragments of a node: coplanar ones stay in the node, the others
+    * (cut if needed) become the back and front tasks
+    **/
+    void Split(const Task& task)
+    {
+        std::size_t begin = task.begin, end = list.size(), count = end-begin;
+        std::uint32_t planeIndex = ChooseSplit(begin, count);
+        Vector3D<T> n = fragments[planeIndex].normal;
+        T d = fragments[planeIndex].offset;
+
+        Node node;
+        node.plane[0] = n.X();
+        node.plane[1] = n.Y();
+        node.plane[2] = n.Z();
+        node.plane[3] = d;
+        node.firstPolygon = std::uint32_t(polygons.size());
+
+        // classify first (split over the executor for big nodes), then cut in order
+        sides.resize(count);
+        detail::ParallelFor(begin, end, detail::BatchGrain(), settings.threads, [&](std::size_t b, std::size_t e) {
+            for(std::size_t i=b;i<e;i++)
+                sides[i-begin] = std::uint8_t(Side(fragments[list[i]], n, d));
+        });
+
+        // back fragments are appended first and front ones gathered after them
+        std::size_t frontBegin = frontList.size();
+        for(std::size_t i=begin;i<end;i++)
+        {
+            std::uint32_t f = list[i];
+            // the split fragment always stays here (even if it is not quite planar), so every node makes progress
+            int side = sides[i-begin];
+            if(side == Coplanar || f == planeIndex)
+            {
+                Emit(f, n);
+                continue;
+            }
+            if(side == Spanning)
+            {
+                std::uint32_t front, back;
+                Cut(f, n, d, front, back);
+                if(back != std::numeric_limits<std::uint32_t>::max())
+                    list.push_back(back);
+                if(front != std::numeric_limits<std::uint32_t>::max())
+                    frontList.push_back(front);
+                continue;
+            }
+            if(side == Back)
+                list.push_back(f);
+            else
+                frontList.push_back(f);
+        }
+        std::size_t backCount = list.size()-end, frontCount = frontList.size()-frontBegin;
+        list.insert(list.end(), frontList.begin()+frontBegin, frontList.end());
+        frontList.resize(frontBegin);
+        list.erase(list.begin()+begin, list.begin()+end);
+
+        node.polygonCount = std::uint32_t(polygons.size())-node.firstPolygon;
+        node.back = BSPView<T>::SolidLeaf;
+        node.front = BSPView<T>::EmptyLeaf;
+        if(backCount > 0)
+        {
+            node.back = std::int32_t(nodes.size());
+            Task t = {std::uint32_t(nodes.size()), begin};
+            tasks.push_back(t);
+            nodes.push_back(Node());
+        }
+        if(frontCount > 0)
+        {
+            node.front = std::int32_t(nodes.size());
+            Task t = {std::uint32_t(nodes.size()), begin+backCount};
+            tasks.push_back(t);
+            nodes.push_back(Node());
+        }
+        nodes[task.node] = node;
+    }
+
+    void Emit(std::uint32_t f, const Vector3D<T>& n)
+    {
+        const Fragment& frag = fragments[f];
+        Polygon p;
+        p.firstVertex = std::uint32_t(coords.size()/3);
+        p.vertexCount = frag.count;
+        p.source = frag.source;
+        p.flipped = (frag.normal.Dot(n) < T(0))?1u:0u;
+        for(std::uint32_t k=0;k<frag.count;k++)
+        {
+            const Vector3D<T>& v = verts[frag.first+k];
+            coords.push_back(v.X());
+            coords.push_back(v.Y());
+            coords.push_back(v.Z());
+        }
+        polygons.push_back(p);
+    }
+};
+
+typedef BSPTree<double> BSPTreed;
+typedef BSPTree<float> BSPTreef;
+typedef BSPView<double> BSPViewd;
+typedef BSPView<float> BSPViewf;
+
+}
+
+#endif
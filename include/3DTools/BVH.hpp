@@ -0,0 +1,609 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+/**
+* Includes
+* Bounding volume hierarchy over triangles
+* The build uses binned SAH (surface area heuristic) and runs large subtrees
+* and the binning of the first levels as executor tasks, so link with pthread.
+**/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Ray.hpp>
+#include <3DTools/AABB.hpp>
+#include <3DTools/Intersections3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Bounding Volume Hierarchy over a triangle mesh
+* Nodes are stored depth-first in one array: an interior node is followed by
+* its first child and stores the index of its second child, a leaf stores the
+* range of its triangles. Triangles are copied in leaf order as (v0, v1-v0, v2-v0)
+* so a leaf reads one contiguous block.
+**/
+template<class T>
+class BVH
+{
+public:
+    /**
+    * Flattened node (32 bytes for float)
+    * count == 0 - interior node: children are this+1 and offset, axis is the split axis
+    * count > 0 - leaf: triangles offset .. offset+count-1 (in BVH order)
+    **/
+    struct Node
+    {
+        T lo[3]; // minimum corner
+        T hi[3]; // maximum corner
+        std::uint32_t offset; // second child or first triangle
+        std::uint16_t count; // number of triangles (0 for interior nodes)
+        std::uint16_t axis; // split axis of interior nodes
+    };
+
+    /**
+    * Build settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // number of threads for the build (0 - DefaultExecutor().Concurrency())
+        unsigned maxLeafSize; // largest leaf (at most 255)
+        T traversalCost; // SAH cost of visiting a node relative to one triangle test
+
+        Settings():threads(0),maxLeafSize(8),traversalCost(1){}
+    };
+
+private:
+    /**
+    * Triangle reference used during the build
+    **/
+    struct PrimRef
+    {
+        T lo[3];
+        T hi[3];
+        std::uint32_t index;
+
+        T Centroid(int axis)const {return (lo[axis]+hi[axis])*T(0.5);}
+    };
+
+    /**
+    * Temporary tree node used during the build
+    **/
+    struct BuildNode
+    {
+        T lo[3];
+        T hi[3];
+        std::size_t first;
+        std::size_t count; // 0 for interior nodes
+        int axis;
+        std::unique_ptr<BuildNode> left;
+        std::unique_ptr<BuildNode> right;
+    };
+
+    /**
+    * SAH bin: bounds and number of triangles whose centroid falls in it
+    **/
+    struct Bin
+    {
+        T lo[3];
+        T hi[3];
+        std::size_t count;
+
+        Bin() {Reset();}
+        void Reset()
+        {
+            for(int i=0;i<3;i++)
+            {
+                lo[i] = std::numeric_limits<T>::max();
+                hi[i] = std::numeric_limits<T>::lowest();
+            }
+            count = 0;
+        }
+        void Add(const T l[3], const T h[3], std::size_t n)
+        {
+            for(int i=0;i<3;i++)
+            {
+                lo[i] = (l[i]<lo[i])?l[i]:lo[i];
+                hi[i] = (h[i]>hi[i])?h[i]:hi[i];
+            }
+            count += n;
+        }
+        T Area()const
+        {
+            if(count == 0)
+                return T(0);
+            T dx = hi[0]-lo[0], dy = hi[1]-lo[1], dz = hi[2]-lo[2];
+            return T(2)*(dx*dy+dy*dz+dz*dx);
+        }
+    };
+
+    static const int BinCount = 16;
+    // below this many triangles a subtree is built on the calling thread
+    static const std::size_t ParallelThreshold = 4096;
+    // below this many triangles a node is binned on the calling thread
+    static const std::size_t ParallelBinThreshold = 1<<16;
+    // below this depth nodes are split with SAH, deeper ones at the object median,
+    // which bounds the depth (and the traversal stack) by MaxSahDepth + 32
+    static const int MaxSahDepth = 64;
+    static const int StackSize = MaxSahDepth+40;
+
+    std::vector<Node> nodes; // depth-first flattened tree
+    std::vector<Vector3D<T> > tris; // v0, e1, e2 of every triangle in BVH order
+    std::vector<std::uint32_t> triIndex; // original index of every triangle in BVH order
+    Settings settings; // settings of the last build
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty hierarchy
+    **/
+    BVH(){}
+
+    /**
+    * Constructor
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (empty - vertices is a triangle soup)
+    * @param s - build settings
+    **/
+    BVH(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, const Settings& s = Settings())
+    {
+        Build(vertices, indices, s);
+    }
+
+    /**
+    * Build the hierarchy
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (empty - vertices is a triangle soup)
+    * @param s - build settings
+    * (no vertices gives an empty hierarchy, whatever the indices)
+    **/
+    void Build(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, const Settings& s = Settings())
+    {
+        if(vertices.empty())
+            Build(vertices.data(), 0, 0, s);
+        else if(indices.empty())
+            Build(vertices.data(), 0, vertices.size()/3, s);
+        else
+            Build(vertices.data(), indices.data(), indices.size()/3, s);
+    }
+
+    /**
+    * Build the hierarchy
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (null - vertices is a triangle soup)
+    * @param triangleCount - number of triangles
+    * @param s - build settings
+    **/
+    void Build(const Vector3D<T>* vertices, const std::uint32_t* indices, std::size_t triangleCount, const Settings& s = Settings())
+    {
+        settings = s;
+        settings.threads = detail::ThreadCount(settings.threads);
+        settings.maxLeafSize = std::max(1u, std::min(255u, settings.maxLeafSize));
+        nodes.clear();
+        tris.clear();
+        triIndex.clear();
+        if(triangleCount == 0)
+            return;
+
+        // triangle bounds
+        std::vector<PrimRef> refs(triangleCount);
+        unsigned chunks = (triangleCount >= ParallelBinThreshold)?settings.threads:1u;
+        detail::ParallelChunks(0, triangleCount, chunks, [&](std::size_t b, std::size_t e, unsigned) {
+            for(std::size_t i=b;i<e;i++)
+            {
+                const Vector3D<T>* v[3];
+                for(int k=0;k<3;k++)
+                    v[k] = &vertices[indices?indices[3*i+k]:3*i+k];
+                PrimRef& r = refs[i];
+                r.lo[0] = std::min(v[0]->X(), std::min(v[1]->X(), v[2]->X()));
+                r.lo[1] = std::min(v[0]->Y(), std::min(v[1]->Y(), v[2]->Y()));
+                r.lo[2] = std::min(v[0]->Z(), std::min(v[1]->Z(), v[2]->Z()));
+                r.hi[0] = std::max(v[0]->X(), std::max(v[1]->X(), v[2]->X()));
+                r.hi[1] = std::max(v[0]->Y(), std::max(v[1]->Y(), v[2]->Y()));
+                r.hi[2] = std::max(v[0]->Z(), std::max(v[1]->Z(), v[2]->Z()));
+                r.index = std::uint32_t(i);
+            }
+        });
+
+        std::atomic<std::size_t> nodeCount(0);
+        std::unique_ptr<BuildNode> root = BuildRecursive(refs, 0, triangleCount, settings.threads, 0, nodeCount);
+
+        // flatten depth-first and copy the triangles in leaf order
+        nodes.resize(nodeCount.load());
+        tris.resize(3*triangleCount);
+        triIndex.resize(triangleCount);
+        for(std::size_t i=0;i<triangleCount;i++)
+        {
+            std::uint32_t t = refs[i].index;
+            triIndex[i] = t;
+            const Vector3D<T>& v0 = vertices[indices?indices[3*t]:3*t];
+            const Vector3D<T>& v1 = vertices[indices?indices[3*t+1]:3*t+1];
+            const Vector3D<T>& v2 = vertices[indices?indices[3*t+2]:3*t+2];
+            tris[3*i] = v0;
+            tris[3*i+1] = v1-v0;
+            tris[3*i+2] = v2-v0;
+        }
+        std::size_t next = 0;
+        Flatten(root.get(), next);
+    }
+
+    /**
+    * Find the closest triangle hit by a ray
+    * @param ray - the ray
+    * @param hit - output, the closest hit (t, barycentrics and original triangle index)
+    * @param tMax - ignore hits farther than this
+    * @return bool - true if a triangle was hit
+    **/
+    bool Intersect(const Ray<T>& ray, RayHit<T>& hit, T tMax = std::numeric_limits<T>::infinity())const
+    {
+        hit = RayHit<T>();
+        hit.t = tMax;
+        std::size_t best = std::numeric_limits<std::size_t>::max();
+        if(nodes.empty())
+            return false;
+        T o[3], inv[3];
+        int neg[3];
+        Prepare(ray, o, inv, neg);
+        T tRoot;
+        if(!HitsNode(nodes[0], o, inv, neg, hit.t, tRoot))
+            return false;
+        // pending far children and their entry distances
+        std::uint32_t stack[StackSize];
+        T entry[StackSize];
+        int top = 0;
+        std::uint32_t idx = 0;
+        while(true)
+        {
+            const Node& node = nodes[idx];
+            if(node.count == 0)
+            {
+                // test both children and descend into the nearer one
+                std::uint32_t near = idx+1, far = node.offset;
+                T tNear, tFar;
+                bool hitNear = HitsNode(nodes[near], o, inv, neg, hit.t, tNear);
+                bool hitFar = HitsNode(nodes[far], o, inv, neg, hit.t, tFar);
+                if(hitNear && hitFar)
+                {
+                    if(tFar < tNear)
+                    {
+                        std::swap(near, far);
+                        std::swap(tNear, tFar);
+                    }
+                    stack[top] = far;
+                    entry[top++] = tFar;
+                    idx = near;
+                    continue;
+                }
+                if(hitNear || hitFar)
+                {
+                    idx = hitNear?near:far;
+                    continue;
+                }
+            }
+            else
+            {
+                for(std::uint32_t i=node.offset;i<node.offset+node.count;i++)
+                {
+                    T t, u, v;
+                    if(IntersectRayTriangleEdges(ray, tris[3*i], tris[3*i+1], tris[3*i+2], t, u, v) && t < hit.t)
+                    {
+                        hit.t = t;
+                        hit.u = u;
+                        hit.v = v;
+                        best = i;
+                    }
+                }
+            }
+            // skip pending subtrees that start beyond the closest hit so far
+            while(top > 0 && entry[top-1] > hit.t)
+                top--;
+            if(top == 0)
+                break;
+            idx = stack[--top];
+        }
+        if(best == std::numeric_limits<std::size_t>::max())
+        {
+            hit = RayHit<T>();
+            return false;
+        }
+        hit.triangle = triIndex[best];
+        return true;
+    }
+
+    /**
+    * Test if a ray hits any triangle (shadow/occlusion query, stops at the first hit)
+    * @param ray - the ray
+    * @param tMax - ignore hits farther than this
+    * @return bool - true if some triangle is hit at t <= tMax
+    **/
+    bool Occluded(const Ray<T>& ray, T tMax = std::numeric_limits<T>::infinity())const
+    {
+        if(nodes.empty())
+            return false;
+        T o[3], inv[3];
+        int neg[3];
+        Prepare(ray, o, inv, neg);
+        std::uint32_t stack[StackSize];
+        int top = 0;
+        std::uint32_t idx = 0;
+        while(true)
+        {
+            const Node& node = nodes[idx];
+            T tEntry;
+            if(HitsNode(node, o, inv, neg, tMax, tEntry))
+            {
+                if(node.count > 0)
+                {
+                    for(std::uint32_t i=node.offset;i<node.offset+node.count;i++)
+                    {
+                        T t, u, v;
+                        if(IntersectRayTriangleEdges(ray, tris[3*i], tris[3*i+1], tris[3*i+2], t, u, v) && t <= tMax)
+                            return true;
+                    }
+                }
+                else
+                {
+                    stack[top++] = node.offset;
+                    idx = idx+1;
+                    continue;
+                }
+            }
+            if(top == 0)
+                break;
+            idx = stack[--top];
+        }
+        return false;
+    }
+
+    /**
+    * Get bounds of all triangles
+    * @return AABB - the root box (empty if there are no triangles)
+    **/
+    AABB<T> Bounds()const
+    {
+        if(nodes.empty())
+            return AABB<T>();
+        return AABB<T>(Vector3D<T>(nodes[0].lo[0],nodes[0].lo[1],nodes[0].lo[2]), Vector3D<T>(nodes[0].hi[0],nodes[0].hi[1],nodes[0].hi[2]));
+    }
+
+    /**
+    * Test if hierarchy is empty?
+    * @return bool - true if there are no triangles
+    **/
+    bool Empty()const {return nodes.empty();}
+
+    /**
+    * Get number of triangles
+    * @return std::size_t - the number of triangles
+    **/
+    std::size_t TriangleCount()const {return triIndex.size();}
+
+    /**
+    * Get flattened nodes (depth-first, root first)
+    * @return std::vector - the nodes
+    **/
+    const std::vector<Node>& Nodes()const {return nodes;}
+
+    /**
+    * Get original index of the i-th triangle in BVH order
+    * @param i - index in BVH order (as in Node::offset)
+    * @return std::uint32_t - index in the input mesh
+    **/
+    std::uint32_t TriangleIndex(std::size_t i)const {return triIndex[i];}
+
+private:
+    static void Prepare(const Ray<T>& ray, T o[3], T inv[3], int neg[3])
+    {
+        o[0] = ray.Origin().X(); o[1] = ray.Origin().Y(); o[2] = ray.Origin().Z();
+        T d[3] = {ray.Direction().X(), ray.Direction().Y(), ray.Direction().Z()};
+        for(int i=0;i<3;i++)
+        {
+            // 1/0 = inf keeps the slab test valid for axis-parallel rays
+            inv[i] = T(1)/d[i];
+            neg[i] = d[i] < T(0);
+        }
+    }
+
+    /**
+    * Slab test against a node box, picking the near/far slab by the direction sign
+    * tEntry - output, the distance at which the ray enters the box (clamped to 0)
+    **/
+    static bool HitsNode(const Node& node, const T o[3], const T inv[3], const int neg[3], T tMax, T& tEntry)
+    {
+        T tNear = T(0), tFar = tMax;
+        for(int i=0;i<3;i++)
+        {
+            T t0 = ((neg[i]?node.hi[i]:node.lo[i])-o[i])*inv[i];
+            T t1 = ((neg[i]?node.lo[i]:node.hi[i])-o[i])*inv[i];
+            tNear = (t0>tNear)?t0:tNear;
+            tFar = (t1<tFar)?t1:tFar;
+        }
+        tEntry = tNear;
+        return tNear <= tFar;
+    }
+
+    /**
+    * Bounds of the triangles and of their centroids in [begin,end)
+    **/
+    void ComputeBounds(const std::vector<PrimRef>& refs, std::size_t begin, std::size_t end, unsigned threads, Bin& bounds, Bin& centroids)const
+    {
+        unsigned chunks = (end-begin >= ParallelBinThreshold)?threads:1u;
+        std::vector<Bin> b(chunks), c(chunks);
+        detail::ParallelChunks(begin, end, chunks, [&](std::size_t cb, std::size_t ce, unsigned k) {
+            for(std::size_t i=cb;i<ce;i++)
+            {
+                const PrimRef& r = refs[i];
+                T cen[3] = {r.Centroid(0), r.Centroid(1), r.Centroid(2)};
+                b[k].Add(r.lo, r.hi, 1);
+                c[k].Add(cen, cen, 1);
+            }
+        });
+        for(unsigned k=0;k<chunks;k++)
+        {
+            bounds.Add(b[k].lo, b[k].hi, b[k].count);
+            centroids.Add(c[k].lo, c[k].hi, c[k].count);
+        }
+    }
+
+    std::unique_ptr<BuildNode> BuildRecursive(std::vector<PrimRef>& refs, std::size_t begin, std::size_t end, unsigned threads, int depth, std::atomic<std::size_t>& nodeCount)const
+    {
+        std::unique_ptr<BuildNode> node(new BuildNode());
+        nodeCount++;
+        std::size_t count = end-begin;
+        Bin bounds, centroids;
+        ComputeBounds(refs, begin, end, threads, bounds, centroids);
+        for(int i=0;i<3;i++)
+        {
+            node->lo[i] = bounds.lo[i];
+            node->hi[i] = bounds.hi[i];
+        }
+        node->first = begin;
+        node->count = count;
+        node->axis = 0;
+        if(count == 1)
+            return node;
+
+        // bin the centroids along all three axes in one pass
+        T scale[3];
+        for(int a=0;a<3;a++)
+        {
+            T extent = centroids.hi[a]-centroids.lo[a];
+            scale[a] = (extent > T(0))?T(BinCount)*(T(1)-std::numeric_limits<T>::epsilon())/extent:T(0);
+        }
+        unsigned chunks = (count >= ParallelBinThreshold)?threads:1u;
+        if(depth >= MaxSahDepth)
+            chunks = 0;
+        std::vector<Bin> bins(chunks*3*BinCount);
+        if(chunks > 0)
+        {
+            detail::ParallelChunks(begin, end, chunks, [&](std::size_t cb, std::size_t ce, unsigned k) {
+                Bin* local = &bins[k*3*BinCount];
+                for(std::size_t i=cb;i<ce;i++)
+                {
+                    const PrimRef& r = refs[i];
+                    for(int a=0;a<3;a++)
+                    {
+                        int b = int((r.Centroid(a)-centroids.lo[a])*scale[a]);
+                        b = (b<0)?0:((b>=BinCount)?BinCount-1:b);
+                        local[a*BinCount+b].Add(r.lo, r.hi, 1);
+                    }
+                }
+            });
+        }
+        for(unsigned k=1;k<chunks;k++)
+            for(int b=0;b<3*BinCount;b++)
+                bins[b].Add(bins[k*3*BinCount+b].lo, bins[k*3*BinCount+b].hi, bins[k*3*BinCount+b].count);
+
+        // sweep the bin boundaries: cost = traversal + (A_left*N_left + A_right*N_right)/A
+        T bestCost = std::numeric_limits<T>::max();
+        int bestAxis = -1, bestSplit = 0;
+        for(int a=0;a<3 && chunks>0;a++)
+        {
+            if(scale[a] == T(0))
+                continue;
+            T rightArea[BinCount];
+            std::size_t rightCount[BinCount];
+            Bin acc;
+            for(int b=BinCount-1;b>0;b--)
+            {
+                const Bin& bin = bins[a*BinCount+b];
+                acc.Add(bin.lo, bin.hi, bin.count);
+                rightArea[b] = acc.Area();
+                rightCount[b] = acc.count;
+            }
+            acc.Reset();
+            for(int b=0;b<BinCount-1;b++)
+            {
+                const Bin& bin = bins[a*BinCount+b];
+                acc.Add(bin.lo, bin.hi, bin.count);
+                if(acc.count == 0 || rightCount[b+1] == 0)
+                    continue;
+                T cost = acc.Area()*T(acc.count)+rightArea[b+1]*T(rightCount[b+1]);
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = a;
+                    bestSplit = b+1;
+                }
+            }
+        }
+
+        Bin box;
+        box.Add(bounds.lo, bounds.hi, count);
+        T area = box.Area();
+        T leafCost = T(count);
+        std::size_t mid;
+        if(bestAxis >= 0)
+        {
+            T splitCost = settings.traversalCost+((area > T(0))?bestCost/area:T(count));
+            if(count <= settings.maxLeafSize && leafCost <= splitCost)
+                return node;
+            int a = bestAxis;
+            T lo = centroids.lo[a], s = scale[a];
+            int split = bestSplit;
+            mid = std::partition(refs.begin()+begin, refs.begin()+end, [&](const PrimRef& r) {
+                int b = int((r.Centroid(a)-lo)*s);
+                b = (b<0)?0:((b>=BinCount)?BinCount-1:b);
+                return b < split;
+            })-refs.begin();
+            node->axis = a;
+        }
+        else
+        {
+            // too deep, or all centroids coincide: split at the object median
+            // along the largest centroid extent if the leaf would be too big
+            if(count <= settings.maxLeafSize)
+                return node;
+            int a = 0;
+            for(int i=1;i<3;i++)
+                if(centroids.hi[i]-centroids.lo[i] > centroids.hi[a]-centroids.lo[a])
+                    a = i;
+            mid = begin+count/2;
+            std::nth_element(refs.begin()+begin, refs.begin()+mid, refs.begin()+end, [a](const PrimRef& l, const PrimRef& r) {
+                return l.Centroid(a) < r.Centroid(a);
+            });
+            node->axis = a;
+        }
+
+        node->count = 0;
+        bool parallel = threads > 1 && count >= ParallelThreshold;
+        unsigned leftThreads = parallel?threads/2:1, rightThreads = parallel?threads-leftThreads:1;
+        detail::ParallelInvoke([&]() {node->left = BuildRecursive(refs, begin, mid, leftThreads, depth+1, nodeCount);},
+                               [&]() {node->right = BuildRecursive(refs, mid, end, rightThreads, depth+1, nodeCount);}, parallel);
+        return node;
+    }
+
+    std::uint32_t Flatten(const BuildNode* node, std::size_t& next)
+    {
+        std::uint32_t idx = std::uint32_t(next++);
+        Node& out = nodes[idx];
+        for(int i=0;i<3;i++)
+        {
+            out.lo[i] = node->lo[i];
+            out.hi[i] = node->hi[i];
+        }
+        out.axis = std::uint16_t(node->axis);
+        if(node->count > 0)
+        {
+            out.offset = std::uint32_t(node->first);
+            out.count = std::uint16_t(node->count);
+            return idx;
+        }
+        out.count = 0;
+        Flatten(node->left.get(), next);
+        nodes[idx].offset = Flatten(node->right.get(), next);
+        return idx;
+    }
+};
+
+typedef BVH<double> BVHd;
+typedef BVH<float> BVHf;
+
+}
+
+#endif
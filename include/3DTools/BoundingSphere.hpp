@@ -0,0 +1,424 @@
+#ifndef BOUNDING_SPHERE_HPP
+#define BOUNDING_SPHERE_HPP
+
+/**
+* Includes
+**/
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/AABB.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Ritter sphere-fit passes over SoA components
+* Width is the register width, see SimdWidth (1 - scalar fallback)
+**/
+template<class T, int Width>
+struct SphereKernel;
+
+template<class T>
+struct SphereKernel<T,1>
+{
+    /**
+    * Index of the point farthest from c (first one on ties)
+    **/
+    static std::size_t Farthest(const T* x, const T* y, const T* z, std::size_t n, const T c[3])
+    {
+        std::size_t best = 0;
+        T bestD = T(-1);
+        for(std::size_t i=0;i<n;i++)
+        {
+            T dx = x[i]-c[0], dy = y[i]-c[1], dz = z[i]-c[2];
+            T d = dx*dx+dy*dy+dz*dz;
+            if(d > bestD)
+            {
+                bestD = d;
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    /**
+    * Grow the sphere (c,r) so it contains every point
+    **/
+    static void Grow(const T* x, const T* y, const T* z, std::size_t n, T c[3], T& r)
+    {
+        T r2 = r*r;
+        for(std::size_t i=0;i<n;i++)
+        {
+            T dx = x[i]-c[0], dy = y[i]-c[1], dz = z[i]-c[2];
+            T d2 = dx*dx+dy*dy+dz*dz;
+            if(d2 > r2)
+            {
+                // move the center towards the point so the old sphere and the point just fit
+                T d = std::sqrt(d2);
+                T nr = (r+d)*T(0.5);
+                T k = (nr-r)/d;
+                c[0] += dx*k;
+                c[1] += dy*k;
+                c[2] += dz*k;
+                r = nr;
+                r2 = r*r;
+            }
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* SIMD Ritter passes
+* Farthest: per-lane SIMD maximum of the squared distances together with
+* the index where it occurred, so the points are read only once.
+* Grow: the squared distances are tested a register at a time and only
+* registers with a point outside the sphere go through the scalar update.
+**/
+template<class T, int W>
+struct SphereKernel
+{
+    static std::size_t Farthest(const T* x, const T* y, const T* z, std::size_t n, const T c[3])
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        // lane indices are kept as T, exact up to 2^24 even for float
+        const std::size_t block = std::size_t(1)<<20;
+        V cx = O::Set1(c[0]), cy = O::Set1(c[1]), cz = O::Set1(c[2]);
+        T lane[W];
+        for(int k=0;k<W;k++)
+            lane[k] = T(k);
+        std::size_t best = 0;
+        T bestD = T(-1);
+        for(std::size_t start=0;start<n;start+=block)
+        {
+            std::size_t len = (n-start<block)?(n-start):block;
+            std::size_t end = start+len/W*W;
+            V m = O::Set1(T(-1)), mi = O::Set1(T(0)), cur = O::Load(lane), step = O::Set1(T(W));
+            for(std::size_t i=start;i<end;i+=W)
+            {
+                V dx = O::Sub(O::Load(x+i),cx), dy = O::Sub(O::Load(y+i),cy), dz = O::Sub(O::Load(z+i),cz);
+                V d = O::Add(O::Add(O::Mul(dx,dx),O::Mul(dy,dy)),O::Mul(dz,dz));
+                V gt = O::Gt(d,m);
+                m = O::Or(O::And(gt,d),O::AndNot(gt,m));
+                mi = O::Or(O::And(gt,cur),O::AndNot(gt,mi));
+                cur = O::Add(cur,step);
+            }
+            T bufD[W], bufI[W];
+            O::Store(bufD,m);
+            O::Store(bufI,mi);
+            for(int k=0;k<W;k++)
+            {
+                std::size_t i = start+std::size_t(bufI[k]);
+                if(bufD[k] > bestD || (bufD[k] == bestD && i < best))
+                {
+                    bestD = bufD[k];
+                    best = i;
+                }
+            }
+            for(std::size_t i=end;i<start+len;i++)
+            {
+                T dx = x[i]-c[0], dy = y[i]-c[1], dz = z[i]-c[2];
+                T d = dx*dx+dy*dy+dz*dz;
+                if(d > bestD)
+                {
+                    bestD = d;
+                    best = i;
+                }
+            }
+        }
+        return best;
+    }
+
+    static void Grow(const T* x, const T* y, const T* z, std::size_t n, T c[3], T& r)
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        V cx = O::Set1(c[0]), cy = O::Set1(c[1]), cz = O::Set1(c[2]), r2 = O::Set1(r*r);
+        std::size_t i = 0;
+        for(;i+W<=n;i+=W)
+        {
+            V dx = O::Sub(O::Load(x+i),cx), dy = O::Sub(O::Load(y+i),cy), dz = O::Sub(O::Load(z+i),cz);
+            V d2 = O::Add(O::Add(O::Mul(dx,dx),O::Mul(dy,dy)),O::Mul(dz,dz));
+            if(O::AnySet(O::Gt(d2,r2)))
+            {
+                SphereKernel<T,1>::Grow(x+i, y+i, z+i, W, c, r);
+                cx = O::Set1(c[0]); cy = O::Set1(c[1]); cz = O::Set1(c[2]); r2 = O::Set1(r*r);
+            }
+        }
+        SphereKernel<T,1>::Grow(x+i, y+i, z+i, n-i, c, r);
+    }
+};
+#endif
+
+/**
+* SphereKernel::Farthest over chunks of the default executor (first one on ties)
+**/
+template<class T>
+inline std::size_t ParallelFarthest(const T* x, const T* y, const T* z, std::size_t n, const T c[3])
+{
+    typedef SphereKernel<T,SimdWidth<T>::value> Kernel;
+    std::size_t grain = DefaultExecutor().Grain();
+    unsigned count = (n > grain)?unsigned(std::min<std::size_t>(ThreadCount(0), n/grain)):1u;
+    if(count <= 1)
+        return Kernel::Farthest(x, y, z, n, c);
+    std::vector<std::size_t> found(count);
+    ParallelChunks(0, n, count, [&](std::size_t b, std::size_t e, unsigned i) {
+        found[i] = b+Kernel::Farthest(x+b, y+b, z+b, e-b, c);
+    });
+    std::size_t best = 0;
+    T bestD = T(-1);
+    for(unsigned i=0;i<count;i++)
+    {
+        std::size_t k = found[i];
+        T dx = x[k]-c[0], dy = y[k]-c[1], dz = z[k]-c[2];
+        T d = dx*dx+dy*dy+dz*dz;
+        if(d > bestD)
+        {
+            bestD = d;
+            best = k;
+        }
+    }
+    return best;
+}
+
+}
+
+/**
+* Simple Bounding Sphere Class
+* A sphere with negative radius is empty (contains nothing)
+**/
+template<class T>
+class BoundingSphere
+{
+private:
+    Vector3D<T> center; // center of the sphere
+    T radius; // radius of the sphere
+public:
+    /**
+    * Default Constructor
+    * Initializes to the empty sphere
+    **/
+    BoundingSphere():center(),radius(-1){}
+
+    /**
+    * Constructor
+    * @param c - center
+    * @param r - radius
+    **/
+    BoundingSphere(const Vector3D<T>& c, const T& r):center(c),radius(r){}
+
+    /**
+    * Fit a sphere to a set of points with Ritter's method
+    * Three passes over the points: the farthest point a from the first point,
+    * the farthest point b from a, then growing the sphere with diameter ab
+    * until it contains every point. The result is not minimal (typically
+    * within 5-20% of the optimal radius) but costs only a few streaming passes.
+    * @param points - points to bound
+    * @return BoundingSphere - a sphere containing all points (empty if there are none)
+    **/
+    static BoundingSphere FromPoints(const PointArray3D<T>& points)
+    {
+        return FromPoints(points.X(), points.Y(), points.Z(), points.Size());
+    }
+
+    /**
+    * Fit a sphere to a set of points given as SoA component arrays (Ritter's method)
+    * @param x - x components
+    * @param y - y components
+    * @param z - z components
+    * @param n - number of points
+    * @return BoundingSphere - a sphere containing all points (empty if there are none)
+    **/
+    static BoundingSphere FromPoints(const T* x, const T* y, const T* z, std::size_t n)
+    {
+        typedef detail::SphereKernel<T,detail::SimdWidth<T>::value> Kernel;
+        if(n == 0)
+            return BoundingSphere();
+        T p0[3] = {x[0], y[0], z[0]};
+        std::size_t a = detail::ParallelFarthest(x, y, z, n, p0);
+        T pa[3] = {x[a], y[a], z[a]};
+        std::size_t b = detail::ParallelFarthest(x, y, z, n, pa);
+        T c[3] = {(x[a]+x[b])*T(0.5), (y[a]+y[b])*T(0.5), (z[a]+z[b])*T(0.5)};
+        T dx = x[b]-x[a], dy = y[b]-y[a], dz = z[b]-z[a];
+        T r = std::sqrt(dx*dx+dy*dy+dz*dz)*T(0.5);
+        Kernel::Grow(x, y, z, n, c, r);
+        return BoundingSphere(Vector3D<T>(c[0],c[1],c[2]), r);
+    }
+
+    /**
+    * Fit a sphere to a set of points (AoS, Ritter's method)
+    * @param points - points to bound
+    * @return BoundingSphere - a sphere containing all points (empty if there are none)
+    **/
+    static BoundingSphere FromPoints(const std::vector<Vector3D<T> >& points)
+    {
+        PointArray3D<T> soa(points);
+        return FromPoints(soa);
+    }
+
+    /**
+    * Get the sphere circumscribing a box
+    * @param box - box to bound
+    * @return BoundingSphere - the sphere (empty if the box is empty)
+    **/
+    static BoundingSphere FromAABB(const AABB<T>& box)
+    {
+        if(box.Empty())
+            return BoundingSphere();
+        return BoundingSphere(box.Center(), box.Extents().Length());
+    }
+
+    /**
+    * Get center
+    * @return Vector3D - the center
+    **/
+    const Vector3D<T>& Center()const {return center;}
+
+    /**
+    * Get radius
+    * @return T - the radius (negative if empty)
+    **/
+    T Radius()const {return radius;}
+
+    /**
+    * Test if sphere is empty?
+    * @return bool - true if the sphere contains no point
+    **/
+    bool Empty()const {return radius < T(0);}
+
+    /**
+    * Grow sphere to contain a point (Ritter's update)
+    * @param p - point to include
+    **/
+    void Expand(const Vector3D<T>& p)
+    {
+        if(Empty())
+        {
+            center = p;
+            radius = T(0);
+            return;
+        }
+        T c[3] = {center.X(), center.Y(), center.Z()};
+        T px = p.X(), py = p.Y(), pz = p.Z();
+        detail::SphereKernel<T,1>::Grow(&px, &py, &pz, 1, c, radius);
+        center = Vector3D<T>(c[0],c[1],c[2]);
+    }
+
+    /**
+    * Grow sphere to contain another sphere
+    * @param other - sphere to include
+    **/
+    void Expand(const BoundingSphere& other)
+    {
+        if(other.Empty())
+            return;
+        if(Empty())
+        {
+            *this = other;
+            return;
+        }
+        Vector3D<T> d = other.center-center;
+        T dist = d.Length();
+        if(dist+other.radius <= radius)
+            return;
+        if(dist+radius <= other.radius)
+        {
+            *this = other;
+            return;
+        }
+        T nr = (dist+radius+other.radius)*T(0.5);
+        center = center+d*((nr-radius)/dist);
+        radius = nr;
+    }
+
+    /**
+    * Test if point is inside the sphere (boundary included)
+    * @param p - point to test
+    * @return bool - true if inside
+    **/
+    bool Contains(const Vector3D<T>& p)const
+    {
+        return !Empty()&&(center.DistanceSq(p) <= radius*radius);
+    }
+
+    /**
+    * Test if this sphere overlaps another sphere (touching counts)
+    * @param other - sphere to test
+    * @return bool - true if they overlap
+    **/
+    bool Intersects(const BoundingSphere& other)const
+    {
+        if(Empty()||other.Empty())
+            return false;
+        T r = radius+other.radius;
+        return center.DistanceSq(other.center) <= r*r;
+    }
+
+    /**
+    * Test if this sphere overlaps a box (touching counts)
+    * @param box - box to test
+    * @return bool - true if they overlap
+    **/
+    bool Intersects(const AABB<T>& box)const
+    {
+        return !Empty()&&!box.Empty()&&(box.DistanceSq(center) <= radius*radius);
+    }
+
+    /**
+    * Get the sphere transformed by an affine matrix
+    * The center is transformed and the radius scaled by the largest singular
+    * value of the 3x3 block (the largest stretch of any direction), so the
+    * result is the tightest sphere around the transformed sphere for rotations
+    * and uniform scales and still bounds it for non-uniform scales and shears.
+    * @param mat - affine transformation matrix
+    * @return BoundingSphere - the transformed sphere
+    **/
+    BoundingSphere Transform(const Matrix3D<T>& mat)const
+    {
+        if(Empty())
+            return BoundingSphere();
+        return BoundingSphere(center*mat, radius*MaxScale(mat));
+    }
+
+    /**
+    * Largest singular value of the 3x3 block of a matrix
+    * (square root of the largest eigenvalue of A = M*M^T, closed form for symmetric 3x3 matrices)
+    * @param mat - matrix
+    * @return T - the largest factor by which mat stretches a vector
+    **/
+    static T MaxScale(const Matrix3D<T>& mat)
+    {
+        T a[3][3];
+        for(int i=0;i<3;i++)
+            for(int j=0;j<3;j++)
+                a[i][j] = mat(i,0)*mat(j,0)+mat(i,1)*mat(j,1)+mat(i,2)*mat(j,2);
+        T p1 = a[0][1]*a[0][1]+a[0][2]*a[0][2]+a[1][2]*a[1][2];
+        T q = (a[0][0]+a[1][1]+a[2][2])/T(3);
+        T d0 = a[0][0]-q, d1 = a[1][1]-q, d2 = a[2][2]-q;
+        T p = std::sqrt((d0*d0+d1*d1+d2*d2+T(2)*p1)/T(6));
+        if(p <= std::numeric_limits<T>::epsilon()*q)
+            return std::sqrt(q);
+        // B = (A - q*I)/p, its eigenvalues are 2*cos(phi + 2*k*Pi/3)
+        T detB = (d0*(d1*d2-a[1][2]*a[1][2])-a[0][1]*(a[0][1]*d2-a[1][2]*a[0][2])+a[0][2]*(a[0][1]*a[1][2]-d1*a[0][2]))/(p*p*p);
+        T h = detB*T(0.5);
+        h = (h<T(-1))?T(-1):((h>T(1))?T(1):h);
+        T phi = std::acos(h)/T(3);
+        return std::sqrt(q+T(2)*p*std::cos(phi));
+    }
+};
+
+typedef BoundingSphere<double> BoundingSphered;
+typedef BoundingSphere<float> BoundingSpheref;
+
+}
+
+#endif
@@ -0,0 +1,642 @@
+#ifndef CONVEX_HULL_HPP
+#define CONVEX_HULL_HPP
+
+/**
+* Includes
+* 3D convex hull (QuickHull) of point clouds
+* Interior culling and the point partitioning of large conflict sets run on
+* the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Point accessors, so that the hull reads AoS and SoA input without copying it
+**/
+template<class T>
+struct AoSPoints
+{
+    const Vector3D<T>* p;
+    Vector3D<T> operator[](std::size_t i)const {return p[i];}
+};
+
+template<class T>
+struct SoAPoints
+{
+    const T* x;
+    const T* y;
+    const T* z;
+    Vector3D<T> operator[](std::size_t i)const {return Vector3D<T>(x[i],y[i],z[i]);}
+};
+
+}
+
+/**
+* Convex Hull of a point cloud (QuickHull)
+* The hull is output as an indexed triangle list (indices into the input points,
+* counter-clockwise seen from outside). Points closer than Tolerance() to the hull
+* surface are treated as lying on it, so coplanar points never become vertices
+* and flat input yields a two-sided polygon.
+**/
+template<class T>
+class ConvexHull3D
+{
+public:
+    /**
+    * Build settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // number of threads (0 - DefaultExecutor().Concurrency())
+
+        Settings():threads(0){}
+    };
+
+private:
+    // face planes of float hulls are computed in double: the normals of thin float
+    // triangles are not accurate enough for the tolerance test
+    typedef typename std::conditional<std::is_same<T,float>::value, double, T>::type Real;
+
+    /**
+    * Hull triangle during the build
+    **/
+    struct Face
+    {
+        std::uint32_t v[3]; // vertices (counter-clockwise seen from outside)
+        std::uint32_t n[3]; // n[i] - face across the edge v[i] -> v[(i+1)%3]
+        Vector3D<Real> normal; // unit outward normal
+        Real offset; // normal.Dot(point on the face)
+        std::vector<std::uint32_t> outside; // points above this face (conflict list)
+        std::uint32_t farthest; // farthest point of the conflict list
+        Real farthestDist;
+        std::uint32_t visited; // stamp of the last horizon search that found it visible
+        bool alive;
+
+        Real Distance(const Vector3D<T>& p)const {return normal.Dot(Vector3D<Real>(p.X(),p.Y(),p.Z()))-offset;}
+    };
+
+    /**
+    * Edge a -> b of the horizon and the hidden face behind it
+    **/
+    struct HorizonEdge
+    {
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t face;
+    };
+
+    /**
+    * Horizon search stack frame: edges start..start+2 of face, next is the k-th
+    **/
+    struct Frame
+    {
+        std::uint32_t face;
+        int start;
+        int k;
+    };
+
+    // conflict sets smaller than this are partitioned on the calling thread
+    static const std::size_t ParallelThreshold = 1<<15;
+
+    std::vector<Face> faces; // all faces created (dead ones are kept until the build ends)
+    std::vector<std::uint32_t> indices; // 3 per hull triangle
+    std::vector<std::uint32_t> vertices; // hull vertices (sorted)
+    std::vector<HorizonEdge> horizon;
+    std::vector<Frame> stack;
+    std::vector<std::uint32_t> visible;
+    std::vector<std::uint32_t> orphans;
+    std::vector<std::uint32_t> corners;
+    int dimension;
+    T tolerance;
+    unsigned threads;
+    std::uint32_t stamp;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty hull
+    **/
+    ConvexHull3D():dimension(-1),tolerance(0),threads(1),stamp(0){}
+
+    /**
+    * Constructor
+    * @param points - the point cloud
+    * @param s - build settings
+    **/
+    explicit ConvexHull3D(const std::vector<Vector3D<T> >& points, const Settings& s = Settings()):dimension(-1),tolerance(0),threads(1),stamp(0)
+    {
+        Build(points, s);
+    }
+
+    /**
+    * Compute the hull
+    * @param points - the point cloud
+    * @param s - build settings
+    **/
+    void Build(const std::vector<Vector3D<T> >& points, const Settings& s = Settings())
+    {
+        Build(points.empty()?0:&points[0], points.size(), s);
+    }
+
+    /**
+    * Compute the hull of a range of points
+    * @param points - first point
+    * @param n - number of points
+    * @param s - build settings
+    **/
+    void Build(const Vector3D<T>* points, std::size_t n, const Settings& s = Settings())
+    {
+        detail::AoSPoints<T> p = {points};
+        BuildPoints(p, n, s);
+    }
+
+    /**
+    * Compute the hull of a Structure-of-Arrays point cloud
+    * @param points - the point cloud
+    * @param s - build settings
+    **/
+    void Build(const PointArray3D<T>& points, const Settings& s = Settings())
+    {
+        detail::SoAPoints<T> p = {points.X(), points.Y(), points.Z()};
+        BuildPoints(p, points.Size(), s);
+    }
+
+    /**
+    * Get hull triangles
+    * @return std::vector - 3 point indices per triangle (counter-clockwise seen from outside)
+    **/
+    const std::vector<std::uint32_t>& Indices()const {return indices;}
+
+    /**
+    * Get number of hull triangles
+    * @return std::size_t - the number of triangles
+    **/
+    std::size_t FaceCount()const {return indices.size()/3;}
+
+    /**
+    * Get hull vertices
+    * @return std::vector - sorted indices of the points on the hull corners
+    **/
+    const std::vector<std::uint32_t>& Vertices()const {return vertices;}
+
+    /**
+    * Get dimension of the input
+    * @return int - -1 no points, 0 all points coincide, 1 collinear,
+    * 2 coplanar (the hull is a two-sided polygon), 3 solid hull
+    **/
+    int Dimension()const {return dimension;}
+
+    /**
+    * Get distance tolerance used by the last build
+    * @return T - points within this distance of a face count as lying on it
+    **/
+    T Tolerance()const {return tolerance;}
+
+private:
+    template<class P>
+    void BuildPoints(const P& pts, std::size_t n, const Settings& s)
+    {
+        faces.clear();
+        indices.clear();
+        vertices.clear();
+        dimension = -1;
+        tolerance = T(0);
+        stamp = 0;
+        threads = detail::ThreadCount(s.threads);
+        if(n == 0)
+            return;
+
+        // extreme points along each axis and the tolerance (as qhull: 3*eps*(max|x|+max|y|+max|z|))
+        std::uint32_t ext[6];
+        Extremes(pts, n, ext);
+        T extent[3], maxAbs = T(0);
+        for(int a=0;a<3;a++)
+        {
+            T lo = Component(pts[ext[2*a]], a), hi = Component(pts[ext[2*a+1]], a);
+            extent[a] = hi-lo;
+            maxAbs += std::max(std::abs(lo), std::abs(hi));
+        }
+        tolerance = T(3)*std::numeric_limits<T>::epsilon()*maxAbs;
+
+        // initial simplex: widest axis pair, farthest from that line, farthest from that plane
+        int axis = (extent[0]>=extent[1])?((extent[0]>=extent[2])?0:2):((extent[1]>=extent[2])?1:2);
+        std::uint32_t i0 = ext[2*axis], i1 = ext[2*axis+1];
+        if(extent[axis] <= tolerance)
+        {
+            dimension = 0;
+            vertices.push_back(i0);
+            return;
+        }
+        Vector3D<T> p0 = pts[i0];
+        Vector3D<T> dir = pts[i1]-p0;
+        dir.Normalize();
+        T lineDist;
+        std::uint32_t i2 = ArgMax(pts, n, [&](const Vector3D<T>& p) {return (p-p0).Cross(dir).LengthSq();}, lineDist);
+        if(std::sqrt(lineDist) <= tolerance)
+        {
+            dimension = 1;
+            vertices.push_back(std::min(i0, i1));
+            vertices.push_back(std::max(i0, i1));
+            return;
+        }
+        Vector3D<T> normal = (pts[i1]-p0).Cross(pts[i2]-p0);
+        normal.Normalize();
+        T planeDist;
+        std::uint32_t i3 = ArgMax(pts, n, [&](const Vector3D<T>& p) {return std::abs(normal.Dot(p-p0));}, planeDist);
+        if(planeDist <= tolerance)
+        {
+            dimension = 2;
+            FlatHull(pts, n, p0, dir, normal);
+            return;
+        }
+        dimension = 3;
+        if(normal.Dot(pts[i3]-p0) > T(0))
+            std::swap(i1, i2);
+        AddFace(pts, i0, i1, i2);
+        AddFace(pts, i0, i2, i3);
+        AddFace(pts, i2, i1, i3);
+        AddFace(pts, i1, i0, i3);
+        for(std::uint32_t f=0;f<4;f++)
+            for(int e=0;e<3;e++)
+                for(std::uint32_t g=0;g<4;g++)
+                    if(g != f && EdgeIndex(g, faces[f].v[(e+1)%3], faces[f].v[e]) >= 0)
+                        faces[f].n[e] = g;
+
+        // cull the interior of the simplex and give each remaining point to a face it is above
+        Partition(pts, 0, n, 0, 4);
+
+        // the faces processed are always visible from their eye point, so they die
+        // and every face created after them is reached by this loop
+        for(std::size_t f=0;f<faces.size();f++)
+            while(faces[f].alive && !faces[f].outside.empty())
+                AddPoint(pts, std::uint32_t(f));
+
+        for(std::size_t f=0;f<faces.size();f++)
+        {
+            if(!faces[f].alive)
+                continue;
+            for(int k=0;k<3;k++)
+            {
+                indices.push_back(faces[f].v[k]);
+                vertices.push_back(faces[f].v[k]);
+            }
+        }
+        std::sort(vertices.begin(), vertices.end());
+        vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+        std::vector<Face>().swap(faces);
+    }
+
+    static T Component(const Vector3D<T>& p, int axis)
+    {
+        return (axis==0)?p.X():((axis==1)?p.Y():p.Z());
+    }
+
+    /**
+    * Indices of the points with minimum/maximum x, y and z
+    **/
+    template<class P>
+    void Extremes(const P& pts, std::size_t n, std::uint32_t ext[6])const
+    {
+        unsigned chunks = (n >= ParallelThreshold)?threads:1u;
+        std::vector<std::uint32_t> local(6*chunks);
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            std::uint32_t* r = &local[6*c];
+            for(int k=0;k<6;k++)
+                r[k] = std::uint32_t(b);
+            for(std::size_t i=b+1;i<e;i++)
+                UpdateExtremes(pts, r, std::uint32_t(i));
+        });
+        for(int k=0;k<6;k++)
+            ext[k] = local[k];
+        for(unsigned c=1;c<chunks;c++)
+            for(int k=0;k<6;k++)
+                UpdateExtremes(pts, ext, local[6*c+k]);
+    }
+
+    template<class P>
+    static void UpdateExtremes(const P& pts, std::uint32_t r[6], std::uint32_t i)
+    {
+        Vector3D<T> p = pts[i];
+        for(int a=0;a<3;a++)
+        {
+            T c = Component(p, a);
+            if(c < Component(pts[r[2*a]], a))
+                r[2*a] = i;
+            if(c > Component(pts[r[2*a+1]], a))
+                r[2*a+1] = i;
+        }
+    }
+
+    /**
+    * Index of the point maximizing f (first one on ties)
+    **/
+    template<class P, class F>
+    std::uint32_t ArgMax(const P& pts, std::size_t n, const F& f, T& best)const
+    {
+        unsigned chunks = (n >= ParallelThreshold)?threads:1u;
+        std::vector<std::uint32_t> arg(chunks, 0);
+        std::vector<T> value(chunks, std::numeric_limits<T>::lowest());
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            for(std::size_t i=b;i<e;i++)
+            {
+                T d = f(pts[i]);
+                if(d > value[c])
+                {
+                    value[c] = d;
+                    arg[c] = std::uint32_t(i);
+                }
+            }
+        });
+        unsigned c = 0;
+        for(unsigned k=1;k<chunks;k++)
+            if(value[k] > value[c])
+                c = k;
+        best = value[c];
+        return arg[c];
+    }
+
+    template<class P>
+    std::uint32_t AddFace(const P& pts, std::uint32_t a, std::uint32_t b, std::uint32_t c)
+    {
+        Face face;
+        face.v[0] = a;
+        face.v[1] = b;
+        face.v[2] = c;
+        face.n[0] = face.n[1] = face.n[2] = 0;
+        Vector3D<T> va = pts[a], vb = pts[b], vc = pts[c];
+        Vector3D<Real> pa(va.X(),va.Y(),va.Z()), pb(vb.X(),vb.Y(),vb.Z()), pc(vc.X(),vc.Y(),vc.Z());
+        face.normal = (pb-pa).Cross(pc-pa);
+        face.normal.Normalize();
+        face.offset = face.normal.Dot((pa+pb+pc)/Real(3));
+        face.farthest = 0;
+        face.farthestDist = Real(0);
+        face.visited = 0;
+        face.alive = true;
+        faces.push_back(face);
+        return std::uint32_t(faces.size()-1);
+    }
+
+    /**
+    * Index of the edge a -> b in face f (-1 if there is none)
+    **/
+    int EdgeIndex(std::uint32_t f, std::uint32_t a, std::uint32_t b)const
+    {
+        for(int k=0;k<3;k++)
+            if(faces[f].v[k] == a && faces[f].v[(k+1)%3] == b)
+                return k;
+        return -1;
+    }
+
+    /**
+    * Give points to the first face of [first,first+count) they are above (farther
+    * than the tolerance), dropping the rest; list == 0 partitions the points [0,n)
+    **/
+    template<class P>
+    void Partition(const P& pts, const std::uint32_t* list, std::size_t n, std::size_t first, std::size_t count)
+    {
+        unsigned chunks = (n >= ParallelThreshold)?threads:1u;
+        std::vector<std::vector<std::vector<std::uint32_t> > > local(chunks, std::vector<std::vector<std::uint32_t> >(count));
+        std::vector<std::vector<Real> > dist(chunks, std::vector<Real>(count, Real(0)));
+        std::vector<std::vector<std::uint32_t> > arg(chunks, std::vector<std::uint32_t>(count, 0));
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            for(std::size_t i=b;i<e;i++)
+            {
+                std::uint32_t idx = list?list[i]:std::uint32_t(i);
+                Vector3D<T> p = pts[idx];
+                for(std::size_t k=0;k<count;k++)
+                {
+                    Real d = faces[first+k].Distance(p);
+                    if(d > tolerance)
+                    {
+                        local[c][k].push_back(idx);
+                        if(d > dist[c][k])
+                        {
+                            dist[c][k] = d;
+                            arg[c][k] = idx;
+                        }
+                        break;
+                    }
+                }
+            }
+        });
+        for(std::size_t k=0;k<count;k++)
+        {
+            Face& face = faces[first+k];
+            for(unsigned c=0;c<chunks;c++)
+            {
+                if(local[c][k].empty())
+                    continue;
+                if(face.outside.empty())
+                    face.outside.swap(local[c][k]);
+                else
+                    face.outside.insert(face.outside.end(), local[c][k].begin(), local[c][k].end());
+                if(dist[c][k] > face.farthestDist)
+                {
+                    face.farthestDist = dist[c][k];
+                    face.farthest = arg[c][k];
+                }
+            }
+        }
+    }
+
+    /**
+    * Add the farthest point of face f to the hull: remove the faces it sees,
+    * connect it to their horizon and hand their points to the new faces
+    **/
+    template<class P>
+    void AddPoint(const P& pts, std::uint32_t f)
+    {
+        std::uint32_t eye = faces[f].farthest;
+        Vector3D<T> e = pts[eye];
+        stamp++;
+        horizon.clear();
+        orphans.clear();
+        corners.clear();
+        stack.clear();
+
+        // depth-first search over the visible faces; starting each face at the edge
+        // after the one it was entered through yields the horizon in order.
+        // Faces the eye lies on (within the tolerance) count as visible, so the new
+        // faces never have zero area or a concave seam with the faces they replace.
+        faces[f].visited = stamp;
+        Frame root = {f, 0, 0};
+        stack.push_back(root);
+        visible.assign(1, f);
+        while(!stack.empty())
+        {
+            Frame frame = stack.back();
+            if(frame.k == 3)
+            {
+                stack.pop_back();
+                continue;
+            }
+            stack.back().k++;
+            int i = (frame.start+frame.k)%3;
+            std::uint32_t g = faces[frame.face].n[i];
+            if(faces[g].visited == stamp)
+                continue;
+            std::uint32_t a = faces[frame.face].v[i], b = faces[frame.face].v[(i+1)%3];
+            if(faces[g].Distance(e) > -tolerance)
+            {
+                faces[g].visited = stamp;
+                visible.push_back(g);
+                int j = EdgeIndex(g, b, a);
+                Frame next = {g, (j+1)%3, 0};
+                stack.push_back(next);
+            }
+            else
+            {
+                HorizonEdge edge = {a, b, g};
+                horizon.push_back(edge);
+            }
+        }
+
+        // rounding can make the visible faces something else than a disc; skip the
+        // eye then (it is within a few tolerances of the faces it would replace)
+        for(std::size_t k=0;k<horizon.size();k++)
+        {
+            if(horizon[k].b != horizon[(k+1)%horizon.size()].a)
+            {
+                Face& face = faces[f];
+                face.outside.erase(std::find(face.outside.begin(), face.outside.end(), eye));
+                face.farthestDist = Real(0);
+                for(std::size_t i=0;i<face.outside.size();i++)
+                {
+                    Real d = face.Distance(pts[face.outside[i]]);
+                    if(d > face.farthestDist)
+                    {
+                        face.farthestDist = d;
+                        face.farthest = face.outside[i];
+                    }
+                }
+                return;
+            }
+        }
+
+        // points of the removed faces, and their corners which are not on the horizon
+        // (they are inside the new hull or within the tolerance of it, unless the eye
+        // was slightly below a removed face), go to the new faces
+        for(std::size_t k=0;k<visible.size();k++)
+        {
+            Face& face = faces[visible[k]];
+            for(std::size_t i=0;i<face.outside.size();i++)
+                if(face.outside[i] != eye)
+                    orphans.push_back(face.outside[i]);
+            std::vector<std::uint32_t>().swap(face.outside);
+            face.alive = false;
+            for(int i=0;i<3;i++)
+                corners.push_back(face.v[i]);
+        }
+        for(std::size_t k=0;k<horizon.size();k++)
+            corners.push_back(horizon[k].a);
+        std::sort(corners.begin(), corners.end());
+        for(std::size_t i=0;i<corners.size();)
+        {
+            std::size_t j = i;
+            while(j < corners.size() && corners[j] == corners[i])
+                j++;
+            // a horizon vertex is also a corner of some removed face, so it appears twice or more
+            bool onHorizon = false;
+            for(std::size_t k=0;k<horizon.size() && !onHorizon;k++)
+                onHorizon = (horizon[k].a == corners[i]);
+            if(!onHorizon)
+                orphans.push_back(corners[i]);
+            i = j;
+        }
+
+        // cone of new faces from the horizon to the eye
+        std::size_t first = faces.size(), count = horizon.size();
+        for(std::size_t k=0;k<count;k++)
+        {
+            const HorizonEdge& edge = horizon[k];
+            std::uint32_t nf = AddFace(pts, edge.a, edge.b, eye);
+            faces[nf].n[0] = edge.face;
+            faces[nf].n[1] = std::uint32_t(first+(k+1)%count);
+            faces[nf].n[2] = std::uint32_t(first+(k+count-1)%count);
+            faces[edge.face].n[EdgeIndex(edge.face, edge.b, edge.a)] = nf;
+        }
+        Partition(pts, orphans.empty()?0:&orphans[0], orphans.size(), first, count);
+    }
+
+    /**
+    * Hull of coplanar points: 2D monotone chain in the plane, output as a two-sided polygon
+    **/
+    template<class P>
+    void FlatHull(const P& pts, std::size_t n, const Vector3D<T>& origin, const Vector3D<T>& u, const Vector3D<T>& normal)
+    {
+        Vector3D<T> w = normal.Cross(u);
+        struct Planar
+        {
+            T x;
+            T y;
+            std::uint32_t index;
+            bool operator<(const Planar& o)const {return (x<o.x) || (x==o.x && y<o.y);}
+        };
+        std::vector<Planar> p(n);
+        for(std::size_t i=0;i<n;i++)
+        {
+            Vector3D<T> d = pts[i]-origin;
+            p[i].x = d.Dot(u);
+            p[i].y = d.Dot(w);
+            p[i].index = std::uint32_t(i);
+        }
+        std::sort(p.begin(), p.end());
+        // lower then upper chain; a middle point closer than the tolerance to the
+        // line through its neighbours is dropped
+        std::vector<Planar> chain(2*n);
+        std::size_t k = 0;
+        for(std::size_t i=0;i<n;i++)
+        {
+            while(k >= 2 && Turn(chain[k-2], chain[k-1], p[i]) <= tolerance*Length(chain[k-2], p[i]))
+                k--;
+            chain[k++] = p[i];
+        }
+        for(std::size_t i=n-1, lower=k+1;i>0;i--)
+        {
+            while(k >= lower && Turn(chain[k-2], chain[k-1], p[i-1]) <= tolerance*Length(chain[k-2], p[i-1]))
+                k--;
+            chain[k++] = p[i-1];
+        }
+        k--;
+        chain.resize(k);
+        for(std::size_t i=0;i<chain.size();i++)
+            vertices.push_back(chain[i].index);
+        std::sort(vertices.begin(), vertices.end());
+        for(std::size_t i=1;i+1<chain.size();i++)
+        {
+            std::uint32_t tri[6] = {chain[0].index, chain[i].index, chain[i+1].index,
+                                    chain[0].index, chain[i+1].index, chain[i].index};
+            indices.insert(indices.end(), tri, tri+6);
+        }
+    }
+
+    template<class Q>
+    static T Turn(const Q& a, const Q& b, const Q& c)
+    {
+        return (b.x-a.x)*(c.y-a.y)-(b.y-a.y)*(c.x-a.x);
+    }
+
+    template<class Q>
+    static T Length(const Q& a, const Q& b)
+    {
+        return std::sqrt((b.x-a.x)*(b.x-a.x)+(b.y-a.y)*(b.y-a.y));
+    }
+};
+
+typedef ConvexHull3D<double> ConvexHull3Dd;
+typedef ConvexHull3D<float> ConvexHull3Df;
+
+}
+
+#endif
@@ -0,0 +1,796 @@
+#ifndef CURVES_HPP
+#define CURVES_HPP
+
+/**
+* Includes
+* Bezier, B-spline and NURBS curves and Bezier patches with batched evaluation
+**/
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Horner evaluation of a polynomial in homogeneous coordinates at many parameters
+* c holds degree+1 coefficients (x,y,z,w) from the highest power down; when
+* rational the result is divided by w. s and x may be the same buffer.
+* Width is the register width, see SimdWidth (1 - scalar fallback)
+**/
+template<class T, int Width>
+struct CurveKernel;
+
+template<class T>
+struct CurveKernel<T,1>
+{
+    static void Run(const T* c, int degree, bool rational, const T* s, std::size_t n, T* x, T* y, T* z)
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            T t = s[i];
+            T px = c[0], py = c[1], pz = c[2], pw = c[3];
+            for(int j=1;j<=degree;j++)
+            {
+                const T* cj = c+4*j;
+                px = px*t+cj[0];
+                py = py*t+cj[1];
+                pz = pz*t+cj[2];
+                pw = pw*t+cj[3];
+            }
+            if(rational)
+            {
+                T inv = T(1)/pw;
+                px *= inv; py *= inv; pz *= inv;
+            }
+            x[i] = px;
+            y[i] = py;
+            z[i] = pz;
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* SIMD Horner evaluation: one parameter per lane
+**/
+template<class T, int W>
+struct CurveKernel
+{
+    static void Run(const T* c, int degree, bool rational, const T* s, std::size_t n, T* x, T* y, T* z)
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        std::size_t i = 0;
+        for(;i+W<=n;i+=W)
+        {
+            V t = O::Load(s+i);
+            V px = O::Set1(c[0]), py = O::Set1(c[1]), pz = O::Set1(c[2]), pw = O::Set1(c[3]);
+            for(int j=1;j<=degree;j++)
+            {
+                const T* cj = c+4*j;
+                px = O::Add(O::Mul(px,t),O::Set1(cj[0]));
+                py = O::Add(O::Mul(py,t),O::Set1(cj[1]));
+                pz = O::Add(O::Mul(pz,t),O::Set1(cj[2]));
+                if(rational)
+                    pw = O::Add(O::Mul(pw,t),O::Set1(cj[3]));
+            }
+            if(rational)
+            {
+                V inv = O::Div(O::Set1(T(1)),pw);
+                px = O::Mul(px,inv); py = O::Mul(py,inv); pz = O::Mul(pz,inv);
+            }
+            O::Store(x+i,px);
+            O::Store(y+i,py);
+            O::Store(z+i,pz);
+        }
+        CurveKernel<T,1>::Run(c, degree, rational, s+i, n-i, x+i, y+i, z+i);
+    }
+};
+#endif
+
+/**
+* Bernstein to power basis matrix of a degree
+* Row r gives the coefficient of s^(degree-r) as a combination of the control points
+* @param degree - polynomial degree
+* @param m - output, (degree+1)^2 values, row-major
+**/
+template<class T>
+inline void BernsteinToPower(int degree, std::vector<T>& m)
+{
+    std::vector<T> binomial(std::size_t(degree+1)*(degree+1), T(0));
+    for(int a=0;a<=degree;a++)
+    {
+        binomial[a*(degree+1)] = T(1);
+        for(int b=1;b<=a;b++)
+            binomial[a*(degree+1)+b] = binomial[(a-1)*(degree+1)+b-1]+((b<a)?binomial[(a-1)*(degree+1)+b]:T(0));
+    }
+    m.assign(binomial.size(), T(0));
+    for(int k=0;k<=degree;k++)
+        for(int i=0;i<=k;i++)
+            m[(degree-k)*(degree+1)+i] = binomial[degree*(degree+1)+k]*binomial[k*(degree+1)+i]*(((k-i)%2)?T(-1):T(1));
+}
+
+/**
+* Power-form coefficients of a Bezier polynomial
+* @param degree - polynomial degree
+* @param basis - BernsteinToPower matrix of the degree
+* @param control - degree+1 homogeneous control points (x,y,z,w)
+* @param c - output, 4*(degree+1) coefficients from the highest power down
+**/
+template<class T>
+inline void PowerCoefficients(int degree, const T* basis, const T* control, T* c)
+{
+    for(int r=0;r<=degree;r++)
+    {
+        T sum[4] = {T(0), T(0), T(0), T(0)};
+        for(int i=0;i<=degree;i++)
+        {
+            T b = basis[r*(degree+1)+i];
+            for(int d=0;d<4;d++)
+                sum[d] += b*control[4*i+d];
+        }
+        for(int d=0;d<4;d++)
+            c[4*r+d] = sum[d];
+    }
+}
+
+/**
+* Piecewise polynomial curve in power form
+* Segment k covers [breaks[k], breaks[k+1]] and is evaluated at the local
+* parameter s = (t-breaks[k])/(breaks[k+1]-breaks[k]) in [0,1].
+**/
+template<class T>
+struct PiecewisePolynomial
+{
+    int degree;
+    bool rational;
+    std::vector<T> breaks; // segment count + 1 increasing values
+    std::vector<T> inverseLengths; // 1/(breaks[k+1]-breaks[k])
+    std::vector<T> coefficients; // 4*(degree+1) per segment, highest power first
+
+    PiecewisePolynomial():degree(0),rational(false){}
+
+    std::size_t Segments()const {return inverseLengths.size();}
+
+    void Clear()
+    {
+        degree = 0;
+        rational = false;
+        breaks.clear();
+        inverseLengths.clear();
+        coefficients.clear();
+    }
+
+    // segment holding t (the end segments extend to infinity)
+    std::size_t Segment(T t)const
+    {
+        return std::size_t(std::upper_bound(breaks.begin()+1, breaks.end()-1, t)-(breaks.begin()+1));
+    }
+
+    T Local(std::size_t k, T t)const
+    {
+        return (std::min(std::max(t, breaks[k]), breaks[k+1])-breaks[k])*inverseLengths[k];
+    }
+
+    Vector3D<T> Evaluate(T t)const
+    {
+        if(inverseLengths.empty())
+            return Vector3D<T>();
+        std::size_t k = Segment(t);
+        T s = Local(k, t), x, y, z;
+        CurveKernel<T,1>::Run(&coefficients[4*(degree+1)*k], degree, rational, &s, 1, &x, &y, &z);
+        return Vector3D<T>(x, y, z);
+    }
+
+    /**
+    * Evaluate many parameters; consecutive parameters in the same segment
+    * (e.g. sorted input) go through the SIMD kernel together
+    **/
+    void Evaluate(const T* t, std::size_t n, T* x, T* y, T* z)const
+    {
+        if(inverseLengths.empty())
+        {
+            std::fill(x, x+n, T(0));
+            std::fill(y, y+n, T(0));
+            std::fill(z, z+n, T(0));
+            return;
+        }
+        std::size_t last = Segments()-1;
+        ParallelBatch(n, [&](std::size_t begin, std::size_t end) {
+            for(std::size_t i=begin;i<end;)
+            {
+                std::size_t k = Segment(t[i]), e = i;
+                T lo = breaks[k], hi = breaks[k+1];
+                // the local parameters go to x and are evaluated in place
+                x[e] = Local(k, t[e]);
+                for(e++;e<end && (t[e] >= lo || k == 0) && (t[e] < hi || k == last);e++)
+                    x[e] = Local(k, t[e]);
+                CurveKernel<T,SimdWidth<T>::value>::Run(&coefficients[4*(degree+1)*k], degree, rational, x+i, e-i, x+i, y+i, z+i);
+                i = e;
+            }
+        });
+    }
+};
+
+}
+
+/**
+* Bezier curve of any degree
+* The Bernstein form is converted once to power form, so evaluation is a
+* Horner scheme that runs on several parameters per SIMD register. The power
+* form loses precision at high degrees (beyond about 10 in double, 6 in float);
+* split such curves or use a B-spline.
+**/
+template<class T>
+class BezierCurve
+{
+private:
+    std::vector<Vector3D<T> > controlPoints;
+    detail::PiecewisePolynomial<T> poly;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty curve
+    **/
+    BezierCurve(){}
+
+    /**
+    * Constructor
+    * @param points - control points (degree+1)
+    **/
+    explicit BezierCurve(const std::vector<Vector3D<T> >& points)
+    {
+        Set(points);
+    }
+
+    /**
+    * Set the control points
+    * @param points - control points (degree+1)
+    * @return bool - false if there are no points
+    **/
+    bool Set(const std::vector<Vector3D<T> >& points)
+    {
+        controlPoints = points;
+        poly.Clear();
+        if(points.empty())
+            return false;
+        int degree = int(points.size())-1;
+        std::vector<T> basis, control(4*points.size());
+        detail::BernsteinToPower(degree, basis);
+        for(std::size_t i=0;i<points.size();i++)
+        {
+            control[4*i] = points[i].X();
+            control[4*i+1] = points[i].Y();
+            control[4*i+2] = points[i].Z();
+            control[4*i+3] = T(1);
+        }
+        poly.degree = degree;
+        poly.breaks.push_back(T(0));
+        poly.breaks.push_back(T(1));
+        poly.inverseLengths.push_back(T(1));
+        poly.coefficients.resize(control.size());
+        detail::PowerCoefficients(degree, &basis[0], &control[0], &poly.coefficients[0]);
+        return true;
+    }
+
+    /**
+    * Get curve degree
+    * @return int - the degree (-1 if empty)
+    **/
+    int Degree()const {return int(controlPoints.size())-1;}
+
+    /**
+    * Get control points
+    * @return std::vector - the control points
+    **/
+    const std::vector<Vector3D<T> >& ControlPoints()const {return controlPoints;}
+
+    /**
+    * Get polynomial segment boundaries in parameter space
+    * @return std::vector - {0, 1}
+    **/
+    const std::vector<T>& Breaks()const {return poly.breaks;}
+
+    /**
+    * Evaluate the curve
+    * @param t - parameter, clamped to [0,1]
+    * @return Vector3D - the point (origin if empty)
+    **/
+    Vector3D<T> Evaluate(T t)const {return poly.Evaluate(t);}
+
+    /**
+    * Evaluate the curve at many parameters
+    * @param t - parameters, clamped to [0,1]
+    * @param n - number of parameters
+    * @param out - output, resized to n points
+    **/
+    void Evaluate(const T* t, std::size_t n, PointArray3D<T>& out)const
+    {
+        out.Resize(n);
+        poly.Evaluate(t, n, out.X(), out.Y(), out.Z());
+    }
+
+    /**
+    * Evaluate the curve at many parameters
+    * @param t - parameters, clamped to [0,1]
+    * @param out - output, one point per parameter
+    **/
+    void Evaluate(const std::vector<T>& t, PointArray3D<T>& out)const
+    {
+        Evaluate(t.empty()?0:&t[0], t.size(), out);
+    }
+
+    /**
+    * Append the data defining the curve (for hashing and comparison)
+    * @param out - output, degree and control points are appended
+    **/
+    void Signature(std::vector<T>& out)const
+    {
+        out.push_back(T(Degree()));
+        for(std::size_t i=0;i<controlPoints.size();i++)
+        {
+            out.push_back(controlPoints[i].X());
+            out.push_back(controlPoints[i].Y());
+            out.push_back(controlPoints[i].Z());
+        }
+    }
+};
+
+/**
+* NURBS curve (non-uniform rational B-spline)
+* Every non-empty knot span is converted once to a power-form polynomial in
+* homogeneous coordinates (de Boor recursion carried out on polynomials), so
+* evaluation is a span lookup plus a Horner scheme that runs on several
+* parameters per SIMD register. Without weights the curve is a plain
+* (polynomial) B-spline and the division is skipped.
+**/
+template<class T>
+class NURBSCurve
+{
+private:
+    int degree;
+    std::vector<Vector3D<T> > controlPoints;
+    std::vector<T> knots;
+    std::vector<T> weights; // empty - all 1
+    detail::PiecewisePolynomial<T> poly;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty curve
+    **/
+    NURBSCurve():degree(0){}
+
+    /**
+    * Constructor
+    * @param degree - curve degree
+    * @param points - control points (at least degree+1)
+    * @param knots - knot vector (points+degree+1 non-decreasing values; empty - clamped uniform on [0,1])
+    * @param weights - one positive weight per control point (empty - all 1)
+    **/
+    NURBSCurve(int degree, const std::vector<Vector3D<T> >& points, const std::vector<T>& knots = std::vector<T>(), const std::vector<T>& weights = std::vector<T>()):degree(0)
+    {
+        Set(degree, points, knots, weights);
+    }
+
+    /**
+    * Get a clamped uniform knot vector on [0,1]
+    * @param count - number of control points
+    * @param degree - curve degree
+    * @return std::vector - count+degree+1 knots, the first and last degree+1 repeated
+    **/
+    static std::vector<T> ClampedKnots(std::size_t count, int degree)
+    {
+        std::vector<T> u(count+degree+1, T(0));
+        std::size_t spans = (count > std::size_t(degree))?count-degree:1;
+        for(std::size_t i=degree+1;i<u.size();i++)
+            u[i] = (i < count)?T(i-degree)/T(spans):T(1);
+        return u;
+    }
+
+    /**
+    * Set the curve
+    * @param d - curve degree
+    * @param points - control points (at least d+1)
+    * @param u - knot vector (points+d+1 non-decreasing values; empty - clamped uniform on [0,1])
+    * @param w - one positive weight per control point (empty - all 1)
+    * @return bool - false (and an empty curve) if the data is inconsistent
+    **/
+    bool Set(int d, const std::vector<Vector3D<T> >& points, const std::vector<T>& u = std::vector<T>(), const std::vector<T>& w = std::vector<T>())
+    {
+        degree = 0;
+        controlPoints.clear();
+        knots.clear();
+        weights.clear();
+        poly.Clear();
+        std::size_t count = points.size();
+        if(d < 0 || count < std::size_t(d)+1)
+            return false;
+        std::vector<T> k = u.empty()?ClampedKnots(count, d):u;
+        if(k.size() != count+d+1 || (!w.empty() && w.size() != count))
+            return false;
+        for(std::size_t i=1;i<k.size();i++)
+            if(!(k[i-1] <= k[i]))
+                return false;
+        for(std::size_t i=0;i<w.size();i++)
+            if(!(w[i] > T(0)))
+                return false;
+        if(!(k[d] < k[count]))
+            return false;
+        degree = d;
+        controlPoints = points;
+        knots.swap(k);
+        weights = w;
+        BuildSegments();
+        return true;
+    }
+
+    /**
+    * Test if curve is set?
+    * @return bool - false for an empty or rejected curve
+    **/
+    bool IsValid()const {return !controlPoints.empty();}
+
+    /**
+    * Get curve degree
+    * @return int - the degree
+    **/
+    int Degree()const {return degree;}
+
+    /**
+    * Test if curve is rational?
+    * @return bool - true if it has weights
+    **/
+    bool IsRational()const {return !weights.empty();}
+
+    /**
+    * Get control points
+    * @return std::vector - the control points
+    **/
+    const std::vector<Vector3D<T> >& ControlPoints()const {return controlPoints;}
+
+    /**
+    * Get knot vector
+    * @return std::vector - the knots
+    **/
+    const std::vector<T>& Knots()const {return knots;}
+
+    /**
+    * Get weights
+    * @return std::vector - the weights (empty - all 1)
+    **/
+    const std::vector<T>& Weights()const {return weights;}
+
+    /**
+    * Get parameter domain start
+    * @return T - knots[degree]
+    **/
+    T DomainStart()const {return poly.breaks.empty()?T(0):poly.breaks.front();}
+
+    /**
+    * Get parameter domain end
+    * @return T - knots[points]
+    **/
+    T DomainEnd()const {return poly.breaks.empty()?T(0):poly.breaks.back();}
+
+    /**
+    * Get polynomial segment boundaries in parameter space
+    * @return std::vector - the distinct knots of the domain
+    **/
+    const std::vector<T>& Breaks()const {return poly.breaks;}
+
+    /**
+    * Evaluate the curve
+    * @param t - parameter, clamped to the domain
+    * @return Vector3D - the point (origin if empty)
+    **/
+    Vector3D<T> Evaluate(T t)const {return poly.Evaluate(t);}
+
+    /**
+    * Evaluate the curve at many parameters (fastest when sorted)
+    * @param t - parameters, clamped to the domain
+    * @param n - number of parameters
+    * @param out - output, resized to n points
+    **/
+    void Evaluate(const T* t, std::size_t n, PointArray3D<T>& out)const
+    {
+        out.Resize(n);
+        poly.Evaluate(t, n, out.X(), out.Y(), out.Z());
+    }
+
+    /**
+    * Evaluate the curve at many parameters (fastest when sorted)
+    * @param t - parameters, clamped to the domain
+    * @param out - output, one point per parameter
+    **/
+    void Evaluate(const std::vector<T>& t, PointArray3D<T>& out)const
+    {
+        Evaluate(t.empty()?0:&t[0], t.size(), out);
+    }
+
+    /**
+    * Append the data defining the curve (for hashing and comparison)
+    * @param out - output, degree, knots, control points and weights are appended
+    **/
+    void Signature(std::vector<T>& out)const
+    {
+        out.push_back(T(degree));
+        out.push_back(T(controlPoints.size()));
+        out.insert(out.end(), knots.begin(), knots.end());
+        for(std::size_t i=0;i<controlPoints.size();i++)
+        {
+            out.push_back(controlPoints[i].X());
+            out.push_back(controlPoints[i].Y());
+            out.push_back(controlPoints[i].Z());
+        }
+        out.insert(out.end(), weights.begin(), weights.end());
+    }
+
+private:
+    void BuildSegments()
+    {
+        std::size_t count = controlPoints.size(), stride = 4*(degree+1);
+        poly.degree = degree;
+        poly.rational = !weights.empty();
+        std::vector<T> control(4*count);
+        for(std::size_t i=0;i<count;i++)
+        {
+            T w = weights.empty()?T(1):weights[i];
+            control[4*i] = controlPoints[i].X()*w;
+            control[4*i+1] = controlPoints[i].Y()*w;
+            control[4*i+2] = controlPoints[i].Z()*w;
+            control[4*i+3] = w;
+        }
+        // d[j] holds degree+1 polynomial coefficients (lowest power first) per component
+        std::vector<T> d(stride*(degree+1)), next(stride);
+        poly.breaks.push_back(knots[degree]);
+        for(std::size_t span=degree;span<count;span++)
+        {
+            T h = knots[span+1]-knots[span];
+            if(!(h > T(0)))
+                continue;
+            std::fill(d.begin(), d.end(), T(0));
+            for(int j=0;j<=degree;j++)
+                for(int c=0;c<4;c++)
+                    d[j*stride+c] = control[4*(span-degree+j)+c];
+            for(int r=1;r<=degree;r++)
+            {
+                for(int j=degree;j>=r;j--)
+                {
+                    // alpha(s) = a0+a1*s blends d[j-1] and d[j]
+                    std::size_t idx = span-degree+j;
+                    T den = knots[idx+degree+1-r]-knots[idx];
+                    T a0 = (knots[span]-knots[idx])/den, a1 = h/den;
+                    T* dj = &d[j*stride];
+                    const T* dp = &d[(j-1)*stride];
+                    for(int p=0;p<=degree;p++)
+                    {
+                        for(int c=0;c<4;c++)
+                        {
+                            T diff = dj[4*p+c]-dp[4*p+c];
+                            T below = (p > 0)?dj[4*(p-1)+c]-dp[4*(p-1)+c]:T(0);
+                            next[4*p+c] = dp[4*p+c]+a0*diff+a1*below;
+                        }
+                    }
+                    std::copy(next.begin(), next.end(), d.begin()+j*stride);
+                }
+            }
+            // store d[degree] highest power first
+            for(int p=0;p<=degree;p++)
+                for(int c=0;c<4;c++)
+                    poly.coefficients.push_back(d[degree*stride+4*(degree-p)+c]);
+            poly.breaks.push_back(knots[span+1]);
+            poly.inverseLengths.push_back(T(1)/h);
+        }
+    }
+};
+
+/**
+* B-spline curve: a NURBS curve with unit weights
+**/
+template<class T>
+class BSplineCurve : public NURBSCurve<T>
+{
+public:
+    /**
+    * Default Constructor
+    * Creates an empty curve
+    **/
+    BSplineCurve(){}
+
+    /**
+    * Constructor
+    * @param degree - curve degree
+    * @param points - control points (at least degree+1)
+    * @param knots - knot vector (points+degree+1 non-decreasing values; empty - clamped uniform on [0,1])
+    **/
+    BSplineCurve(int degree, const std::vector<Vector3D<T> >& points, const std::vector<T>& knots = std::vector<T>()):NURBSCurve<T>(degree, points, knots){}
+};
+
+/**
+* Tensor-product Bezier patch
+* Grid evaluation first evaluates every control row along v (one batched
+* curve evaluation per row), then converts each resulting column to power
+* form and evaluates it along u, so an nu x nv grid costs about
+* (uDegree+1)*nv + nu*nv Horner evaluations.
+**/
+template<class T>
+class BezierPatch
+{
+private:
+    int uDegree;
+    int vDegree;
+    std::vector<Vector3D<T> > controlPoints; // (uDegree+1) rows of vDegree+1 points
+    std::vector<T> uBasis; // BernsteinToPower matrix of uDegree
+    std::vector<T> rows; // power coefficients of every row along v
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty patch
+    **/
+    BezierPatch():uDegree(-1),vDegree(-1){}
+
+    /**
+    * Constructor
+    * @param uDegree - degree along u
+    * @param vDegree - degree along v
+    * @param points - (uDegree+1)*(vDegree+1) control points, point (i,j) at i*(vDegree+1)+j
+    **/
+    BezierPatch(int uDegree, int vDegree, const std::vector<Vector3D<T> >& points):BezierPatch()
+    {
+        Set(uDegree, vDegree, points);
+    }
+
+    /**
+    * Set the control net
+    * @param du - degree along u
+    * @param dv - degree along v
+    * @param points - (du+1)*(dv+1) control points, point (i,j) at i*(dv+1)+j
+    * @return bool - false (and an empty patch) if the sizes do not match
+    **/
+    bool Set(int du, int dv, const std::vector<Vector3D<T> >& points)
+    {
+        uDegree = vDegree = -1;
+        controlPoints.clear();
+        rows.clear();
+        if(du < 0 || dv < 0 || points.size() != std::size_t(du+1)*(dv+1))
+            return false;
+        uDegree = du;
+        vDegree = dv;
+        controlPoints = points;
+        detail::BernsteinToPower(uDegree, uBasis);
+        std::vector<T> vBasis, control(4*(vDegree+1));
+        detail::BernsteinToPower(vDegree, vBasis);
+        rows.resize(std::size_t(4)*(vDegree+1)*(uDegree+1));
+        for(int i=0;i<=uDegree;i++)
+        {
+            for(int j=0;j<=vDegree;j++)
+            {
+                const Vector3D<T>& p = controlPoints[i*(vDegree+1)+j];
+                control[4*j] = p.X();
+                control[4*j+1] = p.Y();
+                control[4*j+2] = p.Z();
+                control[4*j+3] = T(1);
+            }
+            detail::PowerCoefficients(vDegree, &vBasis[0], &control[0], &rows[std::size_t(4)*(vDegree+1)*i]);
+        }
+        return true;
+    }
+
+    /**
+    * Get degree along u
+    * @return int - the degree (-1 if empty)
+    **/
+    int UDegree()const {return uDegree;}
+
+    /**
+    * Get degree along v
+    * @return int - the degree (-1 if empty)
+    **/
+    int VDegree()const {return vDegree;}
+
+    /**
+    * Get control points
+    * @return std::vector - the control net, row by row
+    **/
+    const std::vector<Vector3D<T> >& ControlPoints()const {return controlPoints;}
+
+    /**
+    * Evaluate the patch
+    * @param u - parameter along u, clamped to [0,1]
+    * @param v - parameter along v, clamped to [0,1]
+    * @return Vector3D - the point (origin if empty)
+    **/
+    Vector3D<T> Evaluate(T u, T v)const
+    {
+        PointArray3D<T> out;
+        std::vector<T> us(1, u), vs(1, v);
+        Evaluate(us, vs, out);
+        return out.Empty()?Vector3D<T>():out.Get(0);
+    }
+
+    /**
+    * Evaluate the patch on a grid of parameters
+    * @param u - parameters along u, clamped to [0,1]
+    * @param v - parameters along v, clamped to [0,1]
+    * @param out - output, point (u[i], v[j]) at j*u.size()+i
+    **/
+    void Evaluate(const std::vector<T>& u, const std::vector<T>& v, PointArray3D<T>& out)const
+    {
+        std::size_t nu = u.size(), nv = v.size();
+        out.Resize(nu*nv);
+        if(uDegree < 0 || nu == 0 || nv == 0)
+        {
+            std::fill(out.X(), out.X()+nu*nv, T(0));
+            std::fill(out.Y(), out.Y()+nu*nv, T(0));
+            std::fill(out.Z(), out.Z()+nu*nv, T(0));
+            return;
+        }
+        // every row along v, evaluated in place over the clamped parameters
+        PointArray3D<T> columns(std::size_t(uDegree+1)*nv);
+        for(int i=0;i<=uDegree;i++)
+        {
+            T* x = columns.X()+i*nv;
+            for(std::size_t j=0;j<nv;j++)
+                x[j] = std::min(std::max(v[j], T(0)), T(1));
+            detail::CurveKernel<T,detail::SimdWidth<T>::value>::Run(&rows[std::size_t(4)*(vDegree+1)*i], vDegree, false, x, nv, x, columns.Y()+i*nv, columns.Z()+i*nv);
+        }
+        // then every column along u, a range of columns per task
+        std::size_t grain = std::max<std::size_t>(1, DefaultExecutor().Grain()/nu);
+        detail::ParallelFor(0, nv, grain, 0, [&](std::size_t begin, std::size_t end) {
+            std::vector<T> control(4*(uDegree+1)), c(4*(uDegree+1));
+            for(std::size_t j=begin;j<end;j++)
+            {
+                for(int i=0;i<=uDegree;i++)
+                {
+                    control[4*i] = columns.X()[i*nv+j];
+                    control[4*i+1] = columns.Y()[i*nv+j];
+                    control[4*i+2] = columns.Z()[i*nv+j];
+                    control[4*i+3] = T(1);
+                }
+                detail::PowerCoefficients(uDegree, &uBasis[0], &control[0], &c[0]);
+                T* x = out.X()+j*nu;
+                for(std::size_t i=0;i<nu;i++)
+                    x[i] = std::min(std::max(u[i], T(0)), T(1));
+                detail::CurveKernel<T,detail::SimdWidth<T>::value>::Run(&c[0], uDegree, false, x, nu, x, out.Y()+j*nu, out.Z()+j*nu);
+            }
+        });
+    }
+
+    /**
+    * Append the data defining the patch (for hashing and comparison)
+    * @param out - output, degrees and control points are appended
+    **/
+    void Signature(std::vector<T>& out)const
+    {
+        out.push_back(T(uDegree));
+        out.push_back(T(vDegree));
+        for(std::size_t i=0;i<controlPoints.size();i++)
+        {
+            out.push_back(controlPoints[i].X());
+            out.push_back(controlPoints[i].Y());
+            out.push_back(controlPoints[i].Z());
+        }
+    }
+};
+
+typedef BezierCurve<double> BezierCurved;
+typedef BezierCurve<float> BezierCurvef;
+typedef BSplineCurve<double> BSplineCurved;
+typedef BSplineCurve<float> BSplineCurvef;
+typedef NURBSCurve<double> NURBSCurved;
+typedef NURBSCurve<float> NURBSCurvef;
+typedef BezierPatch<double> BezierPatchd;
+typedef BezierPatch<float> BezierPatchf;
+
+}
+
+#endif
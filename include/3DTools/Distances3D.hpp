@@ -0,0 +1,600 @@
+#ifndef DISTANCES_3D_HPP
+#define DISTANCES_3D_HPP
+
+/**
+* Includes
+* Closest points and squared distances from points to segments, triangles
+* and boxes, one at a time or in SoA batches (also to triangle meshes)
+**/
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/AABB.hpp>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Closest point on a segment
+* @param p - the point
+* @param a - segment start
+* @param b - segment end
+* @param t - output, parameter of the closest point (0 at a, 1 at b)
+* @return Vector3D - the closest point
+**/
+template<class T>
+Vector3D<T> ClosestPointOnSegment(const Vector3D<T>& p, const Vector3D<T>& a, const Vector3D<T>& b, T& t)
+{
+    Vector3D<T> ab = b-a;
+    T lengthSq = ab.LengthSq();
+    t = (lengthSq > T(0))?(p-a).Dot(ab)/lengthSq:T(0);
+    t = std::min(std::max(t, T(0)), T(1));
+    return a+ab*t;
+}
+
+/**
+* Squared distance from a point to a segment
+* @param p - the point
+* @param a - segment start
+* @param b - segment end
+* @return T - the squared distance
+**/
+template<class T>
+T DistanceSqPointSegment(const Vector3D<T>& p, const Vector3D<T>& a, const Vector3D<T>& b)
+{
+    T t;
+    return p.DistanceSq(ClosestPointOnSegment(p, a, b, t));
+}
+
+/**
+* Closest point on a triangle (Voronoi regions of the vertices, edges and face)
+* @param p - the point
+* @param a - first vertex
+* @param b - second vertex
+* @param c - third vertex
+* @param u - output, barycentric coordinate of b
+* @param v - output, barycentric coordinate of c
+* @return Vector3D - the closest point, a+(b-a)*u+(c-a)*v
+**/
+template<class T>
+Vector3D<T> ClosestPointOnTriangle(const Vector3D<T>& p, const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c, T& u, T& v)
+{
+    Vector3D<T> ab = b-a, ac = c-a, ap = p-a;
+    T d1 = ab.Dot(ap), d2 = ac.Dot(ap);
+    u = v = T(0);
+    if(d1 <= T(0) && d2 <= T(0))
+        return a;
+    Vector3D<T> bp = p-b;
+    T d3 = ab.Dot(bp), d4 = ac.Dot(bp);
+    if(d3 >= T(0) && d4 <= d3)
+    {
+        u = T(1);
+        return b;
+    }
+    T vc = d1*d4-d3*d2;
+    if(vc <= T(0) && d1 >= T(0) && d3 <= T(0))
+    {
+        u = d1/(d1-d3);
+        return a+ab*u;
+    }
+    Vector3D<T> cp = p-c;
+    T d5 = ab.Dot(cp), d6 = ac.Dot(cp);
+    if(d6 >= T(0) && d5 <= d6)
+    {
+        v = T(1);
+        return c;
+    }
+    T vb = d5*d2-d1*d6;
+    if(vb <= T(0) && d2 >= T(0) && d6 <= T(0))
+    {
+        v = d2/(d2-d6);
+        return a+ac*v;
+    }
+    T va = d3*d6-d5*d4;
+    if(va <= T(0) && d4-d3 >= T(0) && d5-d6 >= T(0))
+    {
+        v = (d4-d3)/((d4-d3)+(d5-d6));
+        u = T(1)-v;
+        return b+(c-b)*v;
+    }
+    T sum = va+vb+vc;
+    if(sum == T(0))
+    {
+        // degenerate triangle: the closest of its edges
+        T tab, tbc, tca;
+        Vector3D<T> qab = ClosestPointOnSegment(p, a, b, tab), qbc = ClosestPointOnSegment(p, b, c, tbc), qca = ClosestPointOnSegment(p, c, a, tca);
+        T dab = p.DistanceSq(qab), dbc = p.DistanceSq(qbc), dca = p.DistanceSq(qca);
+        if(dab <= dbc && dab <= dca)
+        {
+            u = tab;
+            return qab;
+        }
+        if(dbc <= dca)
+        {
+            u = T(1)-tbc;
+            v = tbc;
+            return qbc;
+        }
+        v = T(1)-tca;
+        return qca;
+    }
+    T inv = T(1)/sum;
+    u = vb*inv;
+    v = vc*inv;
+    return a+ab*u+ac*v;
+}
+
+/**
+* Squared distance from a point to a triangle
+* @param p - the point
+* @param a - first vertex
+* @param b - second vertex
+* @param c - third vertex
+* @return T - the squared distance
+**/
+template<class T>
+T DistanceSqPointTriangle(const Vector3D<T>& p, const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c)
+{
+    T u, v;
+    return p.DistanceSq(ClosestPointOnTriangle(p, a, b, c, u, v));
+}
+
+/**
+* Closest point of a box
+* @param p - the point
+* @param box - the box (not empty)
+* @return Vector3D - p clamped to the box
+**/
+template<class T>
+Vector3D<T> ClosestPointOnAABB(const Vector3D<T>& p, const AABB<T>& box)
+{
+    return Vector3D<T>(std::min(std::max(p.X(), box.Min().X()), box.Max().X()),
+                       std::min(std::max(p.Y(), box.Min().Y()), box.Max().Y()),
+                       std::min(std::max(p.Z(), box.Min().Z()), box.Max().Z()));
+}
+
+/**
+* Squared distance from a point to a box
+* @param p - the point
+* @param box - the box
+* @return T - the squared distance (0 inside, infinite or huge for an empty box)
+**/
+template<class T>
+T DistanceSqPointAABB(const Vector3D<T>& p, const AABB<T>& box)
+{
+    T dx = std::max(std::max(box.Min().X()-p.X(), p.X()-box.Max().X()), T(0));
+    T dy = std::max(std::max(box.Min().Y()-p.Y(), p.Y()-box.Max().Y()), T(0));
+    T dz = std::max(std::max(box.Min().Z()-p.Z(), p.Z()-box.Max().Z()), T(0));
+    return dx*dx+dy*dy+dz*dz;
+}
+
+namespace detail {
+
+/**
+* Segment prepared for batch queries
+**/
+template<class T>
+struct SegmentDistance
+{
+    T a[3], d[3], invLengthSq;
+
+    SegmentDistance(const Vector3D<T>& start, const Vector3D<T>& end)
+    {
+        a[0] = start.X(); a[1] = start.Y(); a[2] = start.Z();
+        d[0] = end.X()-a[0]; d[1] = end.Y()-a[1]; d[2] = end.Z()-a[2];
+        T lengthSq = d[0]*d[0]+d[1]*d[1]+d[2]*d[2];
+        // a degenerate segment is its start point
+        invLengthSq = (lengthSq > T(0))?T(1)/lengthSq:T(0);
+    }
+
+    T Scalar(T x, T y, T z)const
+    {
+        T px = x-a[0], py = y-a[1], pz = z-a[2];
+        T t = (px*d[0]+py*d[1]+pz*d[2])*invLengthSq;
+        t = std::min(std::max(t, T(0)), T(1));
+        px -= d[0]*t; py -= d[1]*t; pz -= d[2]*t;
+        return px*px+py*py+pz*pz;
+    }
+
+#if defined(TOOLS3D_SSE2)
+    template<class O>
+    typename O::V Simd(typename O::V x, typename O::V y, typename O::V z)const
+    {
+        typedef typename O::V V;
+        V px = O::Sub(x,O::Set1(a[0])), py = O::Sub(y,O::Set1(a[1])), pz = O::Sub(z,O::Set1(a[2]));
+        V dx = O::Set1(d[0]), dy = O::Set1(d[1]), dz = O::Set1(d[2]);
+        V t = O::Mul(O::Add(O::Add(O::Mul(px,dx),O::Mul(py,dy)),O::Mul(pz,dz)),O::Set1(invLengthSq));
+        t = O::Min(O::Max(t,O::Set1(T(0))),O::Set1(T(1)));
+        px = O::Sub(px,O::Mul(dx,t)); py = O::Sub(py,O::Mul(dy,t)); pz = O::Sub(pz,O::Mul(dz,t));
+        return O::Add(O::Add(O::Mul(px,px),O::Mul(py,py)),O::Mul(pz,pz));
+    }
+#endif
+};
+
+/**
+* Triangle prepared for batch queries
+* The projection of p falls inside when it is on the inner side of the three
+* edge planes (containing an edge and the normal); then the distance is the
+* plane distance, otherwise the nearest of the three edges. This is branch-free,
+* so every SIMD lane does the same work.
+**/
+template<class T>
+struct TriangleDistance
+{
+    SegmentDistance<T> edges[3];
+    T normal[3], offset, invNormalSq; // plane normal, n.a, 1/|n|^2
+    T edgeNormals[3][3], edgeOffsets[3]; // inside iff edgeNormals[i].p >= edgeOffsets[i] for all i
+
+    TriangleDistance(const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c):edges{SegmentDistance<T>(a, b), SegmentDistance<T>(b, c), SegmentDistance<T>(c, a)}
+    {
+        Vector3D<T> n = (b-a).Cross(c-a);
+        normal[0] = n.X(); normal[1] = n.Y(); normal[2] = n.Z();
+        offset = n.Dot(a);
+        T normalSq = n.LengthSq();
+        invNormalSq = (normalSq > T(0))?T(1)/normalSq:T(0);
+        const Vector3D<T>* v[3] = {&a, &b, &c};
+        for(int i=0;i<3;i++)
+        {
+            Vector3D<T> m = n.Cross(*v[(i+1)%3]-*v[i]);
+            edgeNormals[i][0] = m.X(); edgeNormals[i][1] = m.Y(); edgeNormals[i][2] = m.Z();
+            edgeOffsets[i] = m.Dot(*v[i]);
+        }
+        // a degenerate triangle has no inside, only edges
+        if(!(normalSq > T(0)))
+            edgeOffsets[0] = std::numeric_limits<T>::infinity();
+    }
+
+    T Scalar(T x, T y, T z)const
+    {
+        bool inside = true;
+        for(int i=0;i<3;i++)
+            inside = inside && (edgeNormals[i][0]*x+edgeNormals[i][1]*y+edgeNormals[i][2]*z >= edgeOffsets[i]);
+        if(inside)
+        {
+            T plane = normal[0]*x+normal[1]*y+normal[2]*z-offset;
+            return plane*plane*invNormalSq;
+        }
+        return std::min(std::min(edges[0].Scalar(x, y, z), edges[1].Scalar(x, y, z)), edges[2].Scalar(x, y, z));
+    }
+
+#if defined(TOOLS3D_SSE2)
+    template<class O>
+    typename O::V Simd(typename O::V x, typename O::V y, typename O::V z)const
+    {
+        typedef typename O::V V;
+        V inside = O::Eq(x,x);
+        for(int i=0;i<3;i++)
+        {
+            V side = O::Add(O::Add(O::Mul(x,O::Set1(edgeNormals[i][0])),O::Mul(y,O::Set1(edgeNormals[i][1]))),O::Mul(z,O::Set1(edgeNormals[i][2])));
+            inside = O::And(inside,O::Le(O::Set1(edgeOffsets[i]),side));
+        }
+        V plane = O::Sub(O::Add(O::Add(O::Mul(x,O::Set1(normal[0])),O::Mul(y,O::Set1(normal[1]))),O::Mul(z,O::Set1(normal[2]))),O::Set1(offset));
+        plane = O::Mul(O::Mul(plane,plane),O::Set1(invNormalSq));
+        V edge = O::Min(O::Min(edges[0].template Simd<O>(x, y, z),edges[1].template Simd<O>(x, y, z)),edges[2].template Simd<O>(x, y, z));
+        return O::Select(inside,plane,edge);
+    }
+#endif
+};
+
+/**
+* Box prepared for batch queries
+**/
+template<class T>
+struct BoxDistance
+{
+    T lo[3], hi[3];
+
+    explicit BoxDistance(const AABB<T>& box)
+    {
+        lo[0] = box.Min().X(); lo[1] = box.Min().Y(); lo[2] = box.Min().Z();
+        hi[0] = box.Max().X(); hi[1] = box.Max().Y(); hi[2] = box.Max().Z();
+    }
+
+    T Scalar(T x, T y, T z)const
+    {
+        T dx = std::max(std::max(lo[0]-x, x-hi[0]), T(0));
+        T dy = std::max(std::max(lo[1]-y, y-hi[1]), T(0));
+        T dz = std::max(std::max(lo[2]-z, z-hi[2]), T(0));
+        return dx*dx+dy*dy+dz*dz;
+    }
+
+#if defined(TOOLS3D_SSE2)
+    template<class O>
+    typename O::V Simd(typename O::V x, typename O::V y, typename O::V z)const
+    {
+        typedef typename O::V V;
+        V zero = O::Set1(T(0));
+        V dx = O::Max(O::Max(O::Sub(O::Set1(lo[0]),x),O::Sub(x,O::Set1(hi[0]))),zero);
+        V dy = O::Max(O::Max(O::Sub(O::Set1(lo[1]),y),O::Sub(y,O::Set1(hi[1]))),zero);
+        V dz = O::Max(O::Max(O::Sub(O::Set1(lo[2]),z),O::Sub(z,O::Set1(hi[2]))),zero);
+        return O::Add(O::Add(O::Mul(dx,dx),O::Mul(dy,dy)),O::Mul(dz,dz));
+    }
+#endif
+};
+
+/**
+* Triangle mesh prepared for batch queries: the minimum over its triangles
+* A triangle is only evaluated when the distance to its bounding box (a lower
+* bound) is below the best distance so far, for at least one lane.
+**/
+template<class T>
+struct MeshDistance
+{
+    std::vector<BoxDistance<T> > boxes;
+    std::vector<TriangleDistance<T> > triangles;
+
+    MeshDistance(const Vector3D<T>* vertices, const std::uint32_t* indices, std::size_t triangleCount)
+    {
+        boxes.reserve(triangleCount);
+        triangles.reserve(triangleCount);
+        for(std::size_t i=0;i<triangleCount;i++)
+        {
+            const Vector3D<T>& a = vertices[indices?indices[3*i]:3*i];
+            const Vector3D<T>& b = vertices[indices?indices[3*i+1]:3*i+1];
+            const Vector3D<T>& c = vertices[indices?indices[3*i+2]:3*i+2];
+            AABB<T> box(a, a);
+            box.Expand(b);
+            box.Expand(c);
+            boxes.push_back(BoxDistance<T>(box));
+            triangles.push_back(TriangleDistance<T>(a, b, c));
+        }
+    }
+
+    T Scalar(T x, T y, T z)const
+    {
+        T best = std::numeric_limits<T>::infinity();
+        for(std::size_t i=0;i<triangles.size();i++)
+            if(boxes[i].Scalar(x, y, z) < best)
+                best = std::min(best, triangles[i].Scalar(x, y, z));
+        return best;
+    }
+
+#if defined(TOOLS3D_SSE2)
+    template<class O>
+    typename O::V Simd(typename O::V x, typename O::V y, typename O::V z)const
+    {
+        typedef typename O::V V;
+        V best = O::Set1(std::numeric_limits<T>::infinity());
+        for(std::size_t i=0;i<triangles.size();i++)
+            if(O::AnySet(O::Lt(boxes[i].template Simd<O>(x, y, z),best)))
+                best = O::Min(best,triangles[i].template Simd<O>(x, y, z));
+        return best;
+    }
+#endif
+};
+
+/**
+* Squared distances from SoA points to a prepared primitive, stopping at the
+* first point farther than a bound
+* Returns the index of that point (its distance is written) or n.
+* Width is the register width, see SimdWidth (1 - scalar fallback)
+**/
+template<class T, int Width>
+struct DistanceKernel;
+
+template<class T>
+struct DistanceKernel<T,1>
+{
+    template<class Primitive>
+    static std::size_t Run(const Primitive& prim, const T* x, const T* y, const T* z, std::size_t n, T* out, T maxDistanceSq)
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            out[i] = prim.Scalar(x[i], y[i], z[i]);
+            if(out[i] > maxDistanceSq)
+                return i;
+        }
+        return n;
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<class T, int W>
+struct DistanceKernel
+{
+    template<class Primitive>
+    static std::size_t Run(const Primitive& prim, const T* x, const T* y, const T* z, std::size_t n, T* out, T maxDistanceSq)
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        V bound = O::Set1(maxDistanceSq);
+        std::size_t i = 0;
+        for(;i+W<=n;i+=W)
+        {
+            V d = prim.template Simd<O>(O::Load(x+i), O::Load(y+i), O::Load(z+i));
+            O::Store(out+i,d);
+            // the test is one compare per block; the lane is found only when it fires
+            if(O::AnySet(O::Gt(d,bound)))
+            {
+                int lane = 0;
+                while(!(out[i+lane] > maxDistanceSq))
+                    lane++;
+                return i+lane;
+            }
+        }
+        std::size_t stop = DistanceKernel<T,1>::Run(prim, x+i, y+i, z+i, n-i, out+i, maxDistanceSq);
+        return i+stop;
+    }
+};
+#endif
+
+/**
+* DistanceKernel over chunks of the default executor
+* Chunks are handed out in order and skipped once they start past the first
+* point found beyond the bound, so the returned index is the same as for a
+* single pass. Chunks that were already running past it still write their
+* distances, so out may also be written after that index.
+**/
+template<class T, class Primitive>
+inline std::size_t DistanceBatch(const Primitive& prim, const T* x, const T* y, const T* z, std::size_t n, T* out, T maxDistanceSq)
+{
+    typedef DistanceKernel<T,SimdWidth<T>::value> Kernel;
+    std::size_t grain = BatchGrain();
+    if(n <= grain)
+        return Kernel::Run(prim, x, y, z, n, out, maxDistanceSq);
+    std::atomic<std::size_t> stop(n);
+    ParallelFor(0, n, grain, 0, [&](std::size_t b, std::size_t e) {
+        if(b >= stop.load())
+            return;
+        std::size_t i = b+Kernel::Run(prim, x+b, y+b, z+b, e-b, out+b, maxDistanceSq);
+        if(i == e)
+            return;
+        std::size_t current = stop.load();
+        while(i < current && !stop.compare_exchange_weak(current, i)) {}
+    });
+    return stop.load();
+}
+
+}
+
+/**
+* Squared distances from many points to a segment
+* @param x - x components
+* @param y - y components
+* @param z - z components
+* @param n - number of points
+* @param a - segment start
+* @param b - segment end
+* @param out - output, n squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), n if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsSegment(const T* x, const T* y, const T* z, std::size_t n, const Vector3D<T>& a, const Vector3D<T>& b, T* out,
+                                    T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return detail::DistanceBatch(detail::SegmentDistance<T>(a, b), x, y, z, n, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a segment
+* @param points - the points
+* @param a - segment start
+* @param b - segment end
+* @param out - output, points.Size() squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), points.Size() if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsSegment(const PointArray3D<T>& points, const Vector3D<T>& a, const Vector3D<T>& b, T* out,
+                                    T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return DistanceSqPointsSegment(points.X(), points.Y(), points.Z(), points.Size(), a, b, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a triangle
+* @param x - x components
+* @param y - y components
+* @param z - z components
+* @param n - number of points
+* @param a - first vertex
+* @param b - second vertex
+* @param c - third vertex
+* @param out - output, n squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), n if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsTriangle(const T* x, const T* y, const T* z, std::size_t n, const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c, T* out,
+                                     T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return detail::DistanceBatch(detail::TriangleDistance<T>(a, b, c), x, y, z, n, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a triangle
+* @param points - the points
+* @param a - first vertex
+* @param b - second vertex
+* @param c - third vertex
+* @param out - output, points.Size() squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), points.Size() if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsTriangle(const PointArray3D<T>& points, const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c, T* out,
+                                     T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return DistanceSqPointsTriangle(points.X(), points.Y(), points.Z(), points.Size(), a, b, c, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a box
+* @param x - x components
+* @param y - y components
+* @param z - z components
+* @param n - number of points
+* @param box - the box
+* @param out - output, n squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), n if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsAABB(const T* x, const T* y, const T* z, std::size_t n, const AABB<T>& box, T* out,
+                                 T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return detail::DistanceBatch(detail::BoxDistance<T>(box), x, y, z, n, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a box
+* @param points - the points
+* @param box - the box
+* @param out - output, points.Size() squared distances
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), points.Size() if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsAABB(const PointArray3D<T>& points, const AABB<T>& box, T* out,
+                                 T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return DistanceSqPointsAABB(points.X(), points.Y(), points.Z(), points.Size(), box, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a triangle mesh (the nearest triangle)
+* @param x - x components
+* @param y - y components
+* @param z - z components
+* @param n - number of points
+* @param vertices - vertex positions
+* @param indices - three vertex indices per triangle (null - vertices is a triangle soup)
+* @param triangleCount - number of triangles
+* @param out - output, n squared distances (infinite if there are no triangles)
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), n if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsMesh(const T* x, const T* y, const T* z, std::size_t n, const Vector3D<T>* vertices, const std::uint32_t* indices, std::size_t triangleCount, T* out,
+                                 T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    return detail::DistanceBatch(detail::MeshDistance<T>(vertices, indices, triangleCount), x, y, z, n, out, maxDistanceSq);
+}
+
+/**
+* Squared distances from many points to a triangle mesh (the nearest triangle)
+* @param points - the points
+* @param vertices - vertex positions
+* @param indices - three vertex indices per triangle (empty - vertices is a triangle soup)
+* @param out - output, points.Size() squared distances (infinite if there are no triangles)
+* @param maxDistanceSq - stop at the first point farther than this (squared)
+* @return std::size_t - index of that point (out is written up to it), points.Size() if there is none
+**/
+template<class T>
+std::size_t DistanceSqPointsMesh(const PointArray3D<T>& points, const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, T* out,
+                                 T maxDistanceSq = std::numeric_limits<T>::infinity())
+{
+    std::size_t triangleCount = vertices.empty()?0:(indices.empty()?vertices.size()/3:indices.size()/3);
+    return DistanceSqPointsMesh(points.X(), points.Y(), points.Z(), points.Size(), vertices.data(), indices.empty()?0:indices.data(), triangleCount, out, maxDistanceSq);
+}
+
+}
+
+#endif
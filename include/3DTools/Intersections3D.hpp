@@ -0,0 +1,103 @@
+#ifndef INTERSECTIONS_3D_HPP
+#define INTERSECTIONS_3D_HPP
+
+/**
+* Includes
+**/
+#include <limits>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Ray.hpp>
+#include <3DTools/AABB.hpp>
+
+namespace Tools3D {
+
+/**
+* Ray/triangle intersection with precomputed edges (e1 = v1-v0, e2 = v2-v0)
+* Same as IntersectRayTriangle below; acceleration structures store the edges to save the subtractions
+**/
+template<class T>
+bool IntersectRayTriangleEdges(const Ray<T>& ray, const Vector3D<T>& v0, const Vector3D<T>& e1, const Vector3D<T>& e2, T& t, T& u, T& v)
+{
+    Vector3D<T> p = ray.Direction().Cross(e2);
+    T det = e1.Dot(p);
+    // ray parallel to the triangle plane (or degenerate triangle)
+    if(det == T(0))
+        return false;
+    Vector3D<T> s = ray.Origin()-v0;
+    Vector3D<T> q = s.Cross(e1);
+    T uDet = s.Dot(p);
+    T vDet = ray.Direction().Dot(q);
+    T tDet = e2.Dot(q);
+    // flip to det > 0 so all rejections are done before the division
+    if(det < T(0))
+    {
+        det = -det;
+        uDet = -uDet;
+        vDet = -vDet;
+        tDet = -tDet;
+    }
+    if(uDet < T(0) || vDet < T(0) || uDet+vDet > det || tDet < T(0))
+        return false;
+    T invDet = T(1)/det;
+    t = tDet*invDet;
+    u = uDet*invDet;
+    v = vDet*invDet;
+    return true;
+}
+
+/**
+* Ray/triangle intersection (Moller-Trumbore, both sides of the triangle)
+* @param ray - the ray
+* @param v0 - first vertex
+* @param v1 - second vertex
+* @param v2 - third vertex
+* @param t - output, ray parameter of the hit
+* @param u - output, barycentric coordinate of v1
+* @param v - output, barycentric coordinate of v2
+* @return bool - true if the ray hits the triangle at some t >= 0
+**/
+template<class T>
+bool IntersectRayTriangle(const Ray<T>& ray, const Vector3D<T>& v0, const Vector3D<T>& v1, const Vector3D<T>& v2, T& t, T& u, T& v)
+{
+    Vector3D<T> e1 = v1-v0;
+    Vector3D<T> e2 = v2-v0;
+    return IntersectRayTriangleEdges(ray, v0, e1, e2, t, u, v);
+}
+
+/**
+* Ray/box intersection (slab test)
+* @param ray - the ray
+* @param box - the box
+* @param tNear - output, parameter where the ray enters the box (0 if the origin is inside)
+* @param tFar - output, parameter where the ray leaves the box
+* @return bool - true if the ray hits the box at some t >= 0
+**/
+template<class T>
+bool IntersectRayAABB(const Ray<T>& ray, const AABB<T>& box, T& tNear, T& tFar)
+{
+    T o[3] = {ray.Origin().X(), ray.Origin().Y(), ray.Origin().Z()};
+    T d[3] = {ray.Direction().X(), ray.Direction().Y(), ray.Direction().Z()};
+    T lo[3] = {box.Min().X(), box.Min().Y(), box.Min().Z()};
+    T hi[3] = {box.Max().X(), box.Max().Y(), box.Max().Z()};
+    tNear = T(0);
+    tFar = std::numeric_limits<T>::infinity();
+    for(int i=0;i<3;i++)
+    {
+        // 1/0 = inf keeps the slab test valid for axis-parallel rays
+        T inv = T(1)/d[i];
+        T t0 = (lo[i]-o[i])*inv, t1 = (hi[i]-o[i])*inv;
+        if(t0 > t1)
+        {
+            T tmp = t0;
+            t0 = t1;
+            t1 = tmp;
+        }
+        tNear = (t0>tNear)?t0:tNear;
+        tFar = (t1<tFar)?t1:tFar;
+    }
+    return tNear <= tFar;
+}
+
+}
+
+#endif
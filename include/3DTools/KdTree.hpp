@@ -0,0 +1,355 @@
+#ifndef KD_TREE_HPP
+#define KD_TREE_HPP
+
+/**
+* Includes
+* k-d tree over points for nearest-neighbour and radius queries
+* Large builds and batch queries run on the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Neighbors.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* k-d tree with an implicit layout
+* The points are reordered so that the node covering [begin,end) splits at its
+* median position begin+(end-begin)/2: the left subtree is [begin,median), the
+* right one (median,end), and ranges of at most leafSize points are leaves.
+* There are no node records, only the point array (each point stored next to
+* its original index) and the split axis at every median position.
+**/
+template<class T>
+class KdTree
+{
+public:
+    /**
+    * Build settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // build threads (0 - DefaultExecutor().Concurrency())
+        unsigned leafSize; // ranges of at most this many points are scanned linearly
+
+        Settings():threads(0),leafSize(8){}
+    };
+
+private:
+    /**
+    * Point in tree order and its index in the input
+    **/
+    struct Entry
+    {
+        Vector3D<T> p;
+        std::uint32_t index;
+    };
+
+    /**
+    * Subtree still to visit and the squared distance to its splitting plane
+    **/
+    struct Pending
+    {
+        std::size_t begin;
+        std::size_t end;
+        T distanceSq;
+    };
+
+    // subtrees smaller than this are built on the calling thread
+    static const std::size_t ParallelThreshold = 1<<14;
+    // queries per batch below which a batch runs on the calling thread
+    static const std::size_t ParallelBatchThreshold = 256;
+    // the tree is balanced, so its depth (and the query stack) is at most log2(2^32)+1
+    static const int StackSize = 64;
+
+    std::vector<Entry> entries;
+    std::vector<std::uint8_t> axes; // split axis at the median position of every interior node
+    Settings settings;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty tree
+    **/
+    KdTree(){}
+
+    /**
+    * Constructor
+    * @param points - the points to index
+    * @param s - build settings
+    **/
+    explicit KdTree(const std::vector<Vector3D<T> >& points, const Settings& s = Settings())
+    {
+        Build(points, s);
+    }
+
+    /**
+    * Build the tree
+    * @param points - the points to index
+    * @param s - build settings
+    **/
+    void Build(const std::vector<Vector3D<T> >& points, const Settings& s = Settings())
+    {
+        Build(points.empty()?0:&points[0], points.size(), s);
+    }
+
+    /**
+    * Build the tree over a range of points
+    * @param points - first point
+    * @param n - number of points
+    * @param s - build settings
+    **/
+    void Build(const Vector3D<T>* points, std::size_t n, const Settings& s = Settings())
+    {
+        entries.resize(n);
+        for(std::size_t i=0;i<n;i++)
+        {
+            entries[i].p = points[i];
+            entries[i].index = std::uint32_t(i);
+        }
+        BuildEntries(s);
+    }
+
+    /**
+    * Build the tree over a Structure-of-Arrays point cloud
+    * @param points - the points to index
+    * @param s - build settings
+    **/
+    void Build(const PointArray3D<T>& points, const Settings& s = Settings())
+    {
+        entries.resize(points.Size());
+        for(std::size_t i=0;i<points.Size();i++)
+        {
+            entries[i].p = points.Get(i);
+            entries[i].index = std::uint32_t(i);
+        }
+        BuildEntries(s);
+    }
+
+    /**
+    * Get number of indexed points
+    * @return std::size_t - the number of points
+    **/
+    std::size_t Size()const {return entries.size();}
+
+    /**
+    * Test if tree is empty?
+    * @return bool - true if there are no points
+    **/
+    bool Empty()const {return entries.empty();}
+
+    /**
+    * Find the k nearest points
+    * @param q - query point
+    * @param k - number of neighbours
+    * @param out - output, min(k, Size()) neighbours sorted by distance (ties by index)
+    **/
+    void Nearest(const Vector3D<T>& q, std::size_t k, std::vector<Neighbor<T> >& out)const
+    {
+        detail::KnnHeap<T> heap(out, std::min(k, entries.size()));
+        if(heap.k == 0)
+            return;
+        const T inf = std::numeric_limits<T>::infinity();
+        Traverse(q, [&]() {return heap.Bound(inf);}, [&](const Entry& e, T d) {heap.Push(e.index, d);});
+        heap.Finish();
+    }
+
+    /**
+    * Find the nearest point
+    * @param q - query point
+    * @param out - output, the nearest neighbour
+    * @return bool - false if the tree is empty
+    **/
+    bool Nearest(const Vector3D<T>& q, Neighbor<T>& out)const
+    {
+        if(entries.empty())
+            return false;
+        out.index = 0;
+        out.distanceSq = std::numeric_limits<T>::infinity();
+        Traverse(q, [&]() {return out.distanceSq;}, [&](const Entry& e, T d) {
+            if(d < out.distanceSq || (d == out.distanceSq && e.index < out.index))
+            {
+                out.distanceSq = d;
+                out.index = e.index;
+            }
+        });
+        return true;
+    }
+
+    /**
+    * Find all points within a distance
+    * @param q - query point
+    * @param radius - search radius (inclusive)
+    * @param out - output, the neighbours in no particular order
+    **/
+    void Radius(const Vector3D<T>& q, T radius, std::vector<Neighbor<T> >& out)const
+    {
+        out.clear();
+        if(entries.empty())
+            return;
+        T r2 = radius*radius;
+        Traverse(q, [r2]() {return r2;}, [&](const Entry& e, T d) {
+            if(d <= r2)
+            {
+                Neighbor<T> n = {e.index, d};
+                out.push_back(n);
+            }
+        });
+    }
+
+    /**
+    * Find the k nearest points of many query points
+    * @param queries - query points
+    * @param k - number of neighbours
+    * @param out - output, one sorted list of min(k, Size()) neighbours per query
+    * @param threads - number of threads (0 - DefaultExecutor().Concurrency())
+    **/
+    void NearestBatch(const std::vector<Vector3D<T> >& queries, std::size_t k, NeighborLists<T>& out, unsigned threads = 0)const
+    {
+        std::size_t n = queries.size(), kk = std::min(k, entries.size());
+        out.offsets.resize(n+1);
+        for(std::size_t i=0;i<=n;i++)
+            out.offsets[i] = i*kk;
+        out.neighbors.resize(n*kk);
+        unsigned chunks = (n >= ParallelBatchThreshold)?detail::ThreadCount(threads):1u;
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned) {
+            std::vector<Neighbor<T> > local;
+            for(std::size_t i=b;i<e;i++)
+            {
+                Nearest(queries[i], kk, local);
+                std::copy(local.begin(), local.end(), out.neighbors.begin()+i*kk);
+            }
+        });
+    }
+
+    /**
+    * Find all points within a distance of many query points
+    * @param queries - query points
+    * @param radius - search radius (inclusive)
+    * @param out - output, one unsorted list per query
+    * @param threads - number of threads (0 - DefaultExecutor().Concurrency())
+    **/
+    void RadiusBatch(const std::vector<Vector3D<T> >& queries, T radius, NeighborLists<T>& out, unsigned threads = 0)const
+    {
+        detail::BatchLists(queries.size(), out, (queries.size() >= ParallelBatchThreshold)?detail::ThreadCount(threads):1u,
+                           [&](std::size_t i, std::vector<Neighbor<T> >& list) {Radius(queries[i], radius, list);});
+    }
+
+private:
+    static T Component(const Vector3D<T>& p, int axis)
+    {
+        return (axis==0)?p.X():((axis==1)?p.Y():p.Z());
+    }
+
+    void BuildEntries(const Settings& s)
+    {
+        settings = s;
+        settings.leafSize = std::max(1u, settings.leafSize);
+        axes.assign(entries.size(), 0);
+        if(entries.empty())
+            return;
+        T lo[3], hi[3];
+        for(int a=0;a<3;a++)
+            lo[a] = hi[a] = Component(entries[0].p, a);
+        for(std::size_t i=1;i<entries.size();i++)
+        {
+            for(int a=0;a<3;a++)
+            {
+                T c = Component(entries[i].p, a);
+                lo[a] = std::min(lo[a], c);
+                hi[a] = std::max(hi[a], c);
+            }
+        }
+        BuildRange(0, entries.size(), lo, hi, detail::ThreadCount(settings.threads));
+    }
+
+    /**
+    * Split [begin,end) at its median along the widest side of its box (the
+    * parent box cut at the parent split, so no pass over the points is needed)
+    **/
+    void BuildRange(std::size_t begin, std::size_t end, const T lo[3], const T hi[3], unsigned threads)
+    {
+        if(end-begin <= settings.leafSize)
+            return;
+        int a = 0;
+        for(int i=1;i<3;i++)
+            if(hi[i]-lo[i] > hi[a]-lo[a])
+                a = i;
+        std::size_t mid = begin+(end-begin)/2;
+        std::nth_element(entries.begin()+begin, entries.begin()+mid, entries.begin()+end, [a](const Entry& l, const Entry& r) {
+            return Component(l.p, a) < Component(r.p, a);
+        });
+        axes[mid] = std::uint8_t(a);
+        T split = Component(entries[mid].p, a);
+        T leftHi[3] = {hi[0], hi[1], hi[2]}, rightLo[3] = {lo[0], lo[1], lo[2]};
+        leftHi[a] = split;
+        rightLo[a] = split;
+        bool parallel = threads > 1 && end-begin >= ParallelThreshold;
+        unsigned leftThreads = parallel?threads/2:1, rightThreads = parallel?threads-leftThreads:1;
+        detail::ParallelInvoke([&]() {BuildRange(begin, mid, lo, leftHi, leftThreads);},
+                               [&]() {BuildRange(mid+1, end, rightLo, hi, rightThreads);}, parallel);
+    }
+
+    /**
+    * Depth-first search, nearer side first; far subtrees whose splitting plane is
+    * farther than bound() are skipped
+    **/
+    template<class Bound, class Visit>
+    void Traverse(const Vector3D<T>& q, const Bound& bound, const Visit& visit)const
+    {
+        Pending stack[StackSize];
+        int top = 0;
+        std::size_t begin = 0, end = entries.size();
+        while(true)
+        {
+            if(end-begin <= settings.leafSize)
+            {
+                for(std::size_t i=begin;i<end;i++)
+                    visit(entries[i], q.DistanceSq(entries[i].p));
+            }
+            else
+            {
+                std::size_t mid = begin+(end-begin)/2;
+                int a = axes[mid];
+                T diff = Component(q, a)-Component(entries[mid].p, a);
+                visit(entries[mid], q.DistanceSq(entries[mid].p));
+                std::size_t nearBegin = begin, nearEnd = mid, farBegin = mid+1, farEnd = end;
+                if(diff >= T(0))
+                {
+                    std::swap(nearBegin, farBegin);
+                    std::swap(nearEnd, farEnd);
+                }
+                if(farBegin < farEnd)
+                {
+                    Pending p = {farBegin, farEnd, diff*diff};
+                    stack[top++] = p;
+                }
+                if(nearBegin < nearEnd)
+                {
+                    begin = nearBegin;
+                    end = nearEnd;
+                    continue;
+                }
+            }
+            while(top > 0 && stack[top-1].distanceSq > bound())
+                top--;
+            if(top == 0)
+                break;
+            top--;
+            begin = stack[top].begin;
+            end = stack[top].end;
+        }
+    }
+};
+
+typedef KdTree<double> KdTreed;
+typedef KdTree<float> KdTreef;
+
+}
+
+#endif
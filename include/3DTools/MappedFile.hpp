@@ -0,0 +1,157 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+/**
+* Includes
+* Read-only memory-mapped file (mmap on POSIX, file mapping on Windows)
+**/
+#include <cstddef>
+#include <string>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Tools3D {
+
+/**
+* Read-only view of a whole file in memory
+* The data is page-aligned and paged in lazily by the OS, so blobs written by
+* PolyMesh::Serialize or BSPTree::Serialize can be used in place.
+**/
+class MappedFile
+{
+private:
+    const void* data;
+    std::size_t size;
+#if defined(_WIN32)
+    HANDLE file;
+    HANDLE mapping;
+#endif
+
+public:
+    /**
+    * Default Constructor
+    * Nothing mapped
+    **/
+    MappedFile():data(0),size(0)
+#if defined(_WIN32)
+        ,file(INVALID_HANDLE_VALUE),mapping(0)
+#endif
+    {}
+
+    /**
+    * Constructor
+    * @param path - file to map (check IsOpen())
+    **/
+    explicit MappedFile(const std::string& path):MappedFile()
+    {
+        Open(path);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile()
+    {
+        Close();
+    }
+
+    /**
+    * Map a file, unmapping the previous one
+    * @param path - file to map
+    * @return bool - false if the file cannot be opened or is empty
+    **/
+    bool Open(const std::string& path)
+    {
+        Close();
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER length;
+        if(!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+        data = mapping?MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0):0;
+        if(!data)
+        {
+            Close();
+            return false;
+        }
+        size = std::size_t(length.QuadPart);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size == 0)
+        {
+            close(fd);
+            return false;
+        }
+        void* p = mmap(0, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping keeps the file alive
+        close(fd);
+        if(p == MAP_FAILED)
+            return false;
+        data = p;
+        size = std::size_t(st.st_size);
+#endif
+        return true;
+    }
+
+    /**
+    * Unmap the file
+    **/
+    void Close()
+    {
+#if defined(_WIN32)
+        if(data)
+            UnmapViewOfFile(data);
+        if(mapping)
+            CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = 0;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if(data)
+            munmap(const_cast<void*>(data), size);
+#endif
+        data = 0;
+        size = 0;
+    }
+
+    /**
+    * Test if a file is mapped?
+    * @return bool - true if Data() is valid
+    **/
+    bool IsOpen()const {return data != 0;}
+
+    /**
+    * Get file contents
+    * @return const void* - the first byte (page-aligned), null if nothing is mapped
+    **/
+    const void* Data()const {return data;}
+
+    /**
+    * Get file size
+    * @return std::size_t - the size in bytes
+    **/
+    std::size_t Size()const {return size;}
+};
+
+}
+
+#endif
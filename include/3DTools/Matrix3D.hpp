@@ -5,10 +5,109 @@
 * Includes
 **/
 #include <cstring>
+#include <3DTools/Helper.hpp>
+#include <3DTools/SIMD.hpp>
 #include <3DTools/Vector3D.hpp>
 
 namespace Tools3D {
 
+namespace detail {
+
+/**
+* 4x4 matrix product kernel: out = a*b (scalar fallback)
+* Every row of out is a[i][0]*b[0] + a[i][1]*b[1] + a[i][2]*b[2] + a[i][3]*b[3],
+* summed left to right. out may alias a, but not b.
+* The SIMD specializations below use the same operations in the same order
+* (separate multiplies and adds, no FMA), so they match this kernel bit for bit
+* unless the compiler contracts the scalar code into FMAs (e.g. -march=native
+* with -ffp-contract=fast); the difference is then at most a few ulp of
+* sum_k |a[i][k]*b[k][j]|.
+**/
+template<class T>
+constexpr void MultiplyScalar(const T a[4][4], const T b[4][4], T out[4][4])
+{
+    for(int i=0;i<4;i++)
+    {
+        T a0 = a[i][0], a1 = a[i][1], a2 = a[i][2], a3 = a[i][3];
+        for(int j=0;j<4;j++)
+            out[i][j] = a0*b[0][j]+a1*b[1][j]+a2*b[2][j]+a3*b[3][j];
+    }
+}
+
+template<class T>
+struct MultiplyKernel
+{
+    static constexpr void Run(const T a[4][4], const T b[4][4], T out[4][4])
+    {
+        MultiplyScalar(a, b, out);
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<>
+struct MultiplyKernel<float>
+{
+    static void Run(const float a[4][4], const float b[4][4], float out[4][4])
+    {
+        // one row of b per SSE register
+        __m128 b0 = _mm_loadu_ps(b[0]), b1 = _mm_loadu_ps(b[1]), b2 = _mm_loadu_ps(b[2]), b3 = _mm_loadu_ps(b[3]);
+        for(int i=0;i<4;i++)
+        {
+            __m128 r = _mm_mul_ps(_mm_set1_ps(a[i][0]),b0);
+            r = _mm_add_ps(r,_mm_mul_ps(_mm_set1_ps(a[i][1]),b1));
+            r = _mm_add_ps(r,_mm_mul_ps(_mm_set1_ps(a[i][2]),b2));
+            r = _mm_add_ps(r,_mm_mul_ps(_mm_set1_ps(a[i][3]),b3));
+            _mm_storeu_ps(out[i],r);
+        }
+    }
+};
+
+template<>
+struct MultiplyKernel<double>
+{
+    static void Run(const double a[4][4], const double b[4][4], double out[4][4])
+    {
+#if defined(TOOLS3D_AVX)
+        // one row of b per AVX register
+        __m256d b0 = _mm256_loadu_pd(b[0]), b1 = _mm256_loadu_pd(b[1]), b2 = _mm256_loadu_pd(b[2]), b3 = _mm256_loadu_pd(b[3]);
+        for(int i=0;i<4;i++)
+        {
+            __m256d r = _mm256_mul_pd(_mm256_set1_pd(a[i][0]),b0);
+            r = _mm256_add_pd(r,_mm256_mul_pd(_mm256_set1_pd(a[i][1]),b1));
+            r = _mm256_add_pd(r,_mm256_mul_pd(_mm256_set1_pd(a[i][2]),b2));
+            r = _mm256_add_pd(r,_mm256_mul_pd(_mm256_set1_pd(a[i][3]),b3));
+            _mm256_storeu_pd(out[i],r);
+        }
+#else
+        // one row of b per pair of SSE2 registers
+        __m128d b0l = _mm_loadu_pd(b[0]), b0h = _mm_loadu_pd(b[0]+2);
+        __m128d b1l = _mm_loadu_pd(b[1]), b1h = _mm_loadu_pd(b[1]+2);
+        __m128d b2l = _mm_loadu_pd(b[2]), b2h = _mm_loadu_pd(b[2]+2);
+        __m128d b3l = _mm_loadu_pd(b[3]), b3h = _mm_loadu_pd(b[3]+2);
+        for(int i=0;i<4;i++)
+        {
+            __m128d a0 = _mm_set1_pd(a[i][0]), a1 = _mm_set1_pd(a[i][1]), a2 = _mm_set1_pd(a[i][2]), a3 = _mm_set1_pd(a[i][3]);
+            __m128d rl = _mm_mul_pd(a0,b0l), rh = _mm_mul_pd(a0,b0h);
+            rl = _mm_add_pd(rl,_mm_mul_pd(a1,b1l)); rh = _mm_add_pd(rh,_mm_mul_pd(a1,b1h));
+            rl = _mm_add_pd(rl,_mm_mul_pd(a2,b2l)); rh = _mm_add_pd(rh,_mm_mul_pd(a2,b2h));
+            rl = _mm_add_pd(rl,_mm_mul_pd(a3,b3l)); rh = _mm_add_pd(rh,_mm_mul_pd(a3,b3h));
+            _mm_storeu_pd(out[i],rl);
+            _mm_storeu_pd(out[i]+2,rh);
+        }
+#endif
+    }
+};
+#endif
+
+}
+
+/**
+* Element order of flat matrix data
+* RowMajor - rows one after the other (the storage order of Matrix3D)
+* ColumnMajor - columns one after the other
+**/
+enum MatrixOrder { RowMajor, ColumnMajor };
+
 /**
 * Simple 3D Matrix Class (4x4 Matrix)
 **/
@@ -22,24 +121,40 @@ public:
     * Default Constructor
     * Initializes matrix to Identity
     **/
-    Matrix3D(){ Identity();}
+    constexpr Matrix3D():data{{1,0,0,0},{0,1,0,0},{0,0,1,0},{0,0,0,1}}{}
+
+    /**
+    * Tag for constructing a Matrix3D whose data is left uninitialized
+    **/
+    enum UninitializedTag { Uninitialized };
+
+    /**
+    * Constructor
+    * Leaves the data uninitialized (for results that are fully overwritten)
+    **/
+    explicit Matrix3D(UninitializedTag){}
 
     /**
     * Copy Constructor
     * @param other - Matrix3D to copy from
     **/
-    Matrix3D(const Matrix3D& other)
-    {
-        for(int i=0;i<4;i++)
-            for(int j=0;j<4;j++)
-                data[i][j] = other.data[i][j];
-    }
+    constexpr Matrix3D(const Matrix3D& other) = default;
+
+    /**
+    * Constructor
+    * @param mij - value of the element in row i and column j
+    **/
+    constexpr Matrix3D(const T& m00, const T& m01, const T& m02, const T& m03,
+                       const T& m10, const T& m11, const T& m12, const T& m13,
+                       const T& m20, const T& m21, const T& m22, const T& m23,
+                       const T& m30, const T& m31, const T& m32, const T& m33)
+        :data{{m00,m01,m02,m03},{m10,m11,m12,m13},{m20,m21,m22,m23},{m30,m31,m32,m33}}{}
 
     /**
     * Constructor
     * @param table - 2-dimensional table to copy data from
     **/
-    Matrix4D(T** table)
+    explicit Matrix3D(T** table)
     {
         for(int i=0;i<4;i++)
             for(int j=0;j<4;j++)
@@ -49,7 +164,7 @@ public:
     /**
     * Make matrix Identity
     **/
-    void Identity()
+    constexpr void Identity()
     {
         for(int i=0;i<4;i++)
         {
@@ -64,7 +179,8 @@ public:
     }
 
     /**
-    * Get Matrix Data
+    * Get Matrix Data as a table
+    * Allocates five arrays that the caller must delete[]; prefer Data() or CopyData()
     * @return T - the data
     **/
     T** getData()
@@ -79,49 +195,88 @@ public:
         return data;
     }
 
+    /**
+    * Get Matrix Data without copying
+    * Since points are row vectors (vec*mat) this is also the column-major
+    * data of the transposed (column-vector) matrix, i.e. what OpenGL expects.
+    * @return T - the 16 elements in row-major order (valid while the matrix lives)
+    **/
+    constexpr const T* Data()const {return &data[0][0];}
+    constexpr T* Data() {return &data[0][0];}
+
+    /**
+    * Copy Matrix Data into caller storage
+    * @param out - output, 16 elements
+    * @param order - element order of out
+    **/
+    constexpr void CopyData(T* out, MatrixOrder order = RowMajor)const
+    {
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                out[(order == RowMajor)?i*4+j:j*4+i] = data[i][j];
+    }
+
+    /**
+    * Build a matrix from flat data
+    * @param values - 16 elements
+    * @param order - element order of values
+    * @return Matrix3D - the matrix
+    **/
+    static constexpr Matrix3D FromData(const T* values, MatrixOrder order = RowMajor)
+    {
+        Matrix3D temp;
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                temp.data[i][j] = values[(order == RowMajor)?i*4+j:j*4+i];
+        return temp;
+    }
+
     /**
     * Translate this Matrix
+    * Same as multiplying by a translation matrix, but only adds
+    * column 3 times the offsets to columns 0-2
     * @param dx - translation offset in x-axis
     * @param dy - translation offset in y-axis
     * @param dz - translation offset in z-axis
     **/
-    void Translate(const T& dx, const T& dy, const T& dz)
+    constexpr void Translate(const T& dx, const T& dy, const T& dz)
     {
-        Matrix3D temp = Matrix3D();
-        temp.data[3][0] = dx;
-        temp.data[3][1] = dy;
-        (*this)*=temp;
+        for(int i=0;i<4;i++)
+        {
+            T w = data[i][3];
+            data[i][0] += w*dx;
+            data[i][1] += w*dy;
+            data[i][2] += w*dz;
+        }
     }
 
     /**
     * Scale this Matrix
+    * Same as multiplying by a scale matrix, but only scales columns 0-2
     * @param dx - scale offset in x-axis
     * @param dy - scale offset in y-axis
     * @param dz - scale offset in z-axis
     **/
-    void Scale(const T& dx, const T& dy, const T& dz)
+    constexpr void Scale(const T& dx, const T& dy, const T& dz)
     {
-        Matrix3D temp = Matrix3D();
-        temp.data[0][0] = dx;
-        temp.data[1][1] = dy;
-        temp.data[2][2] = dz;
-        (*this)*=temp;
+        for(int i=0;i<4;i++)
+        {
+            data[i][0] *= dx;
+            data[i][1] *= dy;
+            data[i][2] *= dz;
+        }
     }
 
     /**
     * Rotate this Matrix around x-axis
+    * Same as multiplying by a rotation matrix, but only mixes columns 1 and 2
     * @param angle - angle in radians
     **/
     void RotateX(T angle)
     {
-        double c = cos(angle);
-        double s = sin(angle);
-        Matrix3D temp = Matrix3D();
-        temp.data[1][1] = c;
-        temp.data[1][2] = s;
-        temp.data[2][1] = -s;
-        temp.data[2][2] = c;
-        (*this)*=temp;
+        T c = T(std::cos(angle));
+        T s = T(std::sin(angle));
+        RotateColumns(1, 2, c, s);
     }
 
     /**
@@ -136,18 +291,14 @@ public:
 
     /**
     * Rotate this Matrix around y-axis
+    * Same as multiplying by a rotation matrix, but only mixes columns 2 and 0
     * @param angle - angle in radians
     **/
     void RotateY(T angle)
     {
-        double c = cos(angle);
-        double s = sin(angle);
-        Matrix3D temp = Matrix3D();
-        temp.data[0][0] = c;
-        temp.data[2][0] = s;
-        temp.data[0][2] = -s;
-        temp.data[2][2] = c;
-        (*this)*=temp;
+        T c = T(std::cos(angle));
+        T s = T(std::sin(angle));
+        RotateColumns(2, 0, c, s);
     }
 
     /**
@@ -162,18 +313,14 @@ public:
 
     /**
     * Rotate this Matrix around z-axis
+    * Same as multiplying by a rotation matrix, but only mixes columns 0 and 1
     * @param angle - angle in radians
     **/
     void RotateZ(T angle)
     {
-        double c = cos(angle);
-        double s = sin(angle);
-        Matrix3D temp = Matrix3D();
-        temp.data[0][0] = c;
-        temp.data[0][1] = s;
-        temp.data[1][0] = -s;
-        temp.data[1][1] = c;
-        (*this)*=temp;
+        T c = T(std::cos(angle));
+        T s = T(std::sin(angle));
+        RotateColumns(0, 1, c, s);
     }
 
     /**
@@ -188,11 +335,11 @@ public:
 
     /**
     * Get Transpose of the Matrix
-    * @return Matrix2D - the transposed matrix
+    * @return Matrix3D - the transposed matrix
     **/
-    Matrix3D Transpose()
+    constexpr Matrix3D Transpose()const
     {
-        Matrix3D temp = Matrix3D();
+        Matrix3D temp;
         for(int i=0;i<4;i++)
         {
             for(int j=0;j<4;j++)
@@ -205,43 +352,128 @@ public:
     * Get the Determinant of the Matrix
     * @return T - the value of the Determinant
     **/
-    T Det()const
+    constexpr T Det()const
     {
-        return (data[0][0]*data[1][1]*data[2][2]*data[3][3]+data[0][0]*data[1][3]*data[2][1]*data[3][2]+data[0][0]*data[1][2]*data[2][3]*data[3][1]-data[0][0]*data[1][3]*data[2][2]*data[3][1]-data[0][0]*data[1][1]*data[2][3]*data[3][2]-data[0][0]*data[1][2]*data[2][1]*data[3][3]
-        		-data[0][1]*data[1][0]*data[2][2]*data[3][3]-data[0][1]*data[1][2]*data[2][3]*data[3][0]-data[0][1]*data[1][3]*data[2][0]*data[3][2]+data[0][1]*data[1][3]*data[2][2]*data[3][0]
-        		+data[0][1]*data[1][0]*data[2][3]*data[3][2]+data[0][1]*data[1][2]*data[2][0]*data[3][3]+data[0][2]*data[1][0]*data[2][1]*data[3][0]+data[0][2]*data[1][3]*data[2][0]*data[3][1]
-        		-data[0][2]*data[1][3]*data[2][1]*data[3][0]-data[0][2]*data[1][0]*data[2][3]*data[3][1]-data[0][2]*data[1][0]*data[2][3]*data[3][1]-data[0][2]*data[1][1]*data[2][0]*data[3][3]-data[0][3]*data[1][0]*data[2][1]*data[3][2]-data[0][3]*data[1][1]*data[2][2]*data[3][0]
-        		-data[0][3]*data[1][2]*data[2][0]+data[0][3]*data[1][2]*data[2][1]*data[3][0]+data[0][3]*data[1][0]*data[2][2]*data[3][1]+data[0][3]*data[1][1]*data[2][0]*data[3][2]);
+        // Laplace expansion over the 2x2 sub-determinants of the upper and lower row pairs
+        T s0 = data[0][0]*data[1][1]-data[1][0]*data[0][1];
+        T s1 = data[0][0]*data[1][2]-data[1][0]*data[0][2];
+        T s2 = data[0][0]*data[1][3]-data[1][0]*data[0][3];
+        T s3 = data[0][1]*data[1][2]-data[1][1]*data[0][2];
+        T s4 = data[0][1]*data[1][3]-data[1][1]*data[0][3];
+        T s5 = data[0][2]*data[1][3]-data[1][2]*data[0][3];
+        T c0 = data[2][0]*data[3][1]-data[3][0]*data[2][1];
+        T c1 = data[2][0]*data[3][2]-data[3][0]*data[2][2];
+        T c2 = data[2][0]*data[3][3]-data[3][0]*data[2][3];
+        T c3 = data[2][1]*data[3][2]-data[3][1]*data[2][2];
+        T c4 = data[2][1]*data[3][3]-data[3][1]*data[2][3];
+        T c5 = data[2][2]*data[3][3]-data[3][2]*data[2][3];
+        return s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0;
     }
 
     /**
     * Get Inverse of the Matrix
-    * @return Matrix2D - the inversed matrix
+    * @return Matrix3D - the inversed matrix (Identity if the matrix is singular)
     **/
-    Matrix3D Inverse()
+    Matrix3D Inverse()const
     {
-        T det = Det();
-        Matrix3D temp = Matrix3D();
-        if(det > std::numeric_limits<T>::epsilon())
-        {
-            temp.data[0][0] = data[1][2]*data[2][3]*data[3][1] - data[1][3]*data[2][2]*data[3][1] + data[1][3]*data[2][1]*data[3][2] - data[1][1]*data[2][3]*data[3][2] - data[1][2]*data[2][1]*data[3][3] + data[1][1]*data[2][2]*data[3][3];
-            temp.data[0][1] = data[0][3]*data[2][2]*data[3][1] - data[0][2]*data[2][3]*data[3][1] - data[0][3]*data[2][1]*data[3][2] + data[0][1]*data[2][3]*data[3][2] + data[0][2]*data[2][1]*data[3][3] - data[0][1]*data[2][2]*data[3][3];
-            temp.data[0][2] = data[0][2]*data[1][3]*data[3][1] - data[0][3]*data[1][2]*data[3][1] + data[0][3]*data[1][1]*data[3][2] - data[0][1]*data[1][3]*data[3][2] - data[0][2]*data[1][1]*data[3][3] + data[0][1]*data[1][2]*data[3][3];
-            temp.data[0][3] = data[0][3]*data[1][2]*data[2][1] - data[0][2]*data[1][3]*data[2][1] - data[0][3]*data[1][1]*data[2][2] + data[0][1]*data[1][3]*data[2][2] + data[0][2]*data[1][1]*data[2][3] - data[0][1]*data[1][2]*data[2][3];
-            temp.data[1][0] = data[1][3]*data[2][2]*data[3][0] - data[1][2]*data[2][3]*data[3][0] - data[1][3]*data[2][0]*data[3][2] + data[1][0]*data[2][3]*data[3][2] + data[1][2]*data[2][0]*data[3][3] - data[1][0]*data[2][2]*data[3][3];
-            temp.data[1][1] = data[0][2]*data[2][3]*data[3][0] - data[0][3]*data[2][2]*data[3][0] + data[0][3]*data[2][0]*data[3][2] - data[0][0]*data[2][3]*data[3][2] - data[0][2]*data[2][0]*data[3][3] + data[0][0]*data[2][2]*data[3][3];
-            temp.data[1][2] = data[0][3]*data[1][2]*data[3][0] - data[0][2]*data[1][3]*data[3][0] - data[0][3]*data[1][0]*data[3][2] + data[0][0]*data[1][3]*data[3][2] + data[0][2]*data[1][0]*data[3][3] - data[0][0]*data[1][2]*data[3][3];
-            temp.data[1][3] = data[0][2]*data[1][3]*data[2][0] - data[0][3]*data[1][2]*data[2][0] + data[0][3]*data[1][0]*data[2][2] - data[0][0]*data[1][3]*data[2][2] - data[0][2]*data[1][0]*data[2][3] + data[0][0]*data[1][2]*data[2][3];
-            temp.data[2][0] = data[1][1]*data[2][3]*data[3][0] - data[1][3]*data[2][1]*data[3][0] + data[1][3]*data[2][0]*data[3][1] - data[1][0]*data[2][3]*data[3][1] - data[1][1]*data[2][0]*data[3][3] + data[1][0]*data[2][1]*data[3][3];
-            temp.data[2][1] = data[0][3]*data[2][1]*data[3][0] - data[0][1]*data[2][3]*data[3][0] - data[0][3]*data[2][0]*data[3][1] + data[0][0]*data[2][3]*data[3][1] + data[0][1]*data[2][0]*data[3][3] - data[0][0]*data[2][1]*data[3][3];
-            temp.data[2][2] = data[0][1]*data[1][3]*data[3][0] - data[0][3]*data[1][1]*data[3][0] + data[0][3]*data[1][0]*data[3][1] - data[0][0]*data[1][3]*data[3][1] - data[0][1]*data[1][0]*data[3][3] + data[0][0]*data[1][1]*data[3][3];
-            temp.data[2][3] = data[0][3]*data[1][1]*data[2][0] - data[0][1]*data[1][3]*data[2][0] - data[0][3]*data[1][0]*data[2][1] + data[0][0]*data[1][3]*data[2][1] + data[0][1]*data[1][0]*data[2][3] - data[0][0]*data[1][1]*data[2][3];
-            temp.data[3][0] = data[1][2]*data[2][1]*data[3][0] - data[1][1]*data[2][2]*data[3][0] - data[1][2]*data[2][0]*data[3][1] + data[1][0]*data[2][2]*data[3][1] + data[1][1]*data[2][0]*data[3][2] - data[1][0]*data[2][1]*data[3][2];
-            temp.data[3][1] = data[0][1]*data[2][2]*data[3][0] - data[0][2]*data[2][1]*data[3][0] + data[0][2]*data[2][0]*data[3][1] - data[0][0]*data[2][2]*data[3][1] - data[0][1]*data[2][0]*data[3][2] + data[0][0]*data[2][1]*data[3][2];
-            temp.data[3][2] = data[0][2]*data[1][1]*data[3][0] - data[0][1]*data[1][2]*data[3][0] - data[0][2]*data[1][0]*data[3][1] + data[0][0]*data[1][2]*data[3][1] + data[0][1]*data[1][0]*data[3][2] - data[0][0]*data[1][1]*data[3][2];
-            temp.data[3][3] = data[0][1]*data[1][2]*data[2][0] - data[0][2]*data[1][1]*data[2][0] + data[0][2]*data[1][0]*data[2][1] - data[0][0]*data[1][2]*data[2][1] - data[0][1]*data[1][0]*data[2][2] + data[0][0]*data[1][1]*data[2][2];
-            temp /= det;
-        }
+        T det;
+        return Inverse(det);
+    }
+
+    /**
+    * Get Inverse of the Matrix and its Determinant
+    * The twelve 2x2 sub-determinants are computed once and shared
+    * between the determinant and all sixteen cofactors
+    * @param det - output, the determinant of the matrix
+    * @return Matrix3D - the inversed matrix (Identity if the matrix is singular)
+    **/
+    Matrix3D Inverse(T& det)const
+    {
+        T s0 = data[0][0]*data[1][1]-data[1][0]*data[0][1];
+        T s1 = data[0][0]*data[1][2]-data[1][0]*data[0][2];
+        T s2 = data[0][0]*data[1][3]-data[1][0]*data[0][3];
+        T s3 = data[0][1]*data[1][2]-data[1][1]*data[0][2];
+        T s4 = data[0][1]*data[1][3]-data[1][1]*data[0][3];
+        T s5 = data[0][2]*data[1][3]-data[1][2]*data[0][3];
+        T c0 = data[2][0]*data[3][1]-data[3][0]*data[2][1];
+        T c1 = data[2][0]*data[3][2]-data[3][0]*data[2][2];
+        T c2 = data[2][0]*data[3][3]-data[3][0]*data[2][3];
+        T c3 = data[2][1]*data[3][2]-data[3][1]*data[2][2];
+        T c4 = data[2][1]*data[3][3]-data[3][1]*data[2][3];
+        T c5 = data[2][2]*data[3][3]-data[3][2]*data[2][3];
+        det = s0*c5-s1*c4+s2*c3+s3*c2-s4*c1+s5*c0;
+        if(std::fabs(det) <= std::numeric_limits<T>::epsilon())
+            return Matrix3D();
+        T inv = T(1)/det;
+        Matrix3D temp(Uninitialized);
+        temp.data[0][0] = ( data[1][1]*c5-data[1][2]*c4+data[1][3]*c3)*inv;
+        temp.data[0][1] = (-data[0][1]*c5+data[0][2]*c4-data[0][3]*c3)*inv;
+        temp.data[0][2] = ( data[3][1]*s5-data[3][2]*s4+data[3][3]*s3)*inv;
+        temp.data[0][3] = (-data[2][1]*s5+data[2][2]*s4-data[2][3]*s3)*inv;
+        temp.data[1][0] = (-data[1][0]*c5+data[1][2]*c2-data[1][3]*c1)*inv;
+        temp.data[1][1] = ( data[0][0]*c5-data[0][2]*c2+data[0][3]*c1)*inv;
+        temp.data[1][2] = (-data[3][0]*s5+data[3][2]*s2-data[3][3]*s1)*inv;
+        temp.data[1][3] = ( data[2][0]*s5-data[2][2]*s2+data[2][3]*s1)*inv;
+        temp.data[2][0] = ( data[1][0]*c4-data[1][1]*c2+data[1][3]*c0)*inv;
+        temp.data[2][1] = (-data[0][0]*c4+data[0][1]*c2-data[0][3]*c0)*inv;
+        temp.data[2][2] = ( data[3][0]*s4-data[3][1]*s2+data[3][3]*s0)*inv;
+        temp.data[2][3] = (-data[2][0]*s4+data[2][1]*s2-data[2][3]*s0)*inv;
+        temp.data[3][0] = (-data[1][0]*c3+data[1][1]*c1-data[1][2]*c0)*inv;
+        temp.data[3][1] = ( data[0][0]*c3-data[0][1]*c1+data[0][2]*c0)*inv;
+        temp.data[3][2] = (-data[3][0]*s3+data[3][1]*s1-data[3][2]*s0)*inv;
+        temp.data[3][3] = ( data[2][0]*s3-data[2][1]*s1+data[2][2]*s0)*inv;
+        return temp;
+    }
+
+    /**
+    * Get Inverse of an affine Matrix
+    * Only valid when the last column is (0,0,0,1): the 3x3 block is
+    * inverted on its own and the translation row is mapped through it
+    * @return Matrix3D - the inversed matrix (Identity if the 3x3 block is singular)
+    **/
+    Matrix3D InverseAffine()const
+    {
+        // cofactors of the 3x3 block
+        T c00 = data[1][1]*data[2][2]-data[1][2]*data[2][1];
+        T c01 = data[1][2]*data[2][0]-data[1][0]*data[2][2];
+        T c02 = data[1][0]*data[2][1]-data[1][1]*data[2][0];
+        T det = data[0][0]*c00+data[0][1]*c01+data[0][2]*c02;
+        if(std::fabs(det) <= std::numeric_limits<T>::epsilon())
+            return Matrix3D();
+        T inv = T(1)/det;
+        Matrix3D temp(Uninitialized);
+        temp.data[0][0] = c00*inv;
+        temp.data[0][1] = (data[0][2]*data[2][1]-data[0][1]*data[2][2])*inv;
+        temp.data[0][2] = (data[0][1]*data[1][2]-data[0][2]*data[1][1])*inv;
+        temp.data[1][0] = c01*inv;
+        temp.data[1][1] = (data[0][0]*data[2][2]-data[0][2]*data[2][0])*inv;
+        temp.data[1][2] = (data[0][2]*data[1][0]-data[0][0]*data[1][2])*inv;
+        temp.data[2][0] = c02*inv;
+        temp.data[2][1] = (data[0][1]*data[2][0]-data[0][0]*data[2][1])*inv;
+        temp.data[2][2] = (data[0][0]*data[1][1]-data[0][1]*data[1][0])*inv;
+        temp.SetAffineInverseTranslation(data[3]);
+        return temp;
+    }
+
+    /**
+    * Get Inverse of a rigid Matrix (rotation and translation only)
+    * Only valid when the 3x3 block is orthonormal and the last column is (0,0,0,1):
+    * the inverse is the transposed 3x3 block with the translation mapped through it
+    * @return Matrix3D - the inversed matrix
+    **/
+    Matrix3D InverseRigid()const
+    {
+        Matrix3D temp(Uninitialized);
+        temp.data[0][0] = data[0][0]; temp.data[0][1] = data[1][0]; temp.data[0][2] = data[2][0];
+        temp.data[1][0] = data[0][1]; temp.data[1][1] = data[1][1]; temp.data[1][2] = data[2][1];
+        temp.data[2][0] = data[0][2]; temp.data[2][1] = data[1][2]; temp.data[2][2] = data[2][2];
+        // translation: -t*R^T, read straight from the rows of R
+        for(int j=0;j<3;j++)
+            temp.data[3][j] = -(data[3][0]*data[j][0]+data[3][1]*data[j][1]+data[3][2]*data[j][2]);
+        temp.data[0][3] = 0;
+        temp.data[1][3] = 0;
+        temp.data[2][3] = 0;
+        temp.data[3][3] = 1;
         return temp;
     }
 
@@ -249,7 +481,7 @@ public:
     * Overload basic operators
     * mathematic operators (*,/)
     **/
-    const Matrix3D& operator*=(const T& other)
+    constexpr const Matrix3D& operator*=(const T& other)
     {
         for(int i=0;i<4;i++)
         {
@@ -259,7 +491,7 @@ public:
         return *this;
     }
 
-    const Matrix3D& operator/=(const T& other)
+    constexpr const Matrix3D& operator/=(const T& other)
     {
         for(int i=0;i<4;i++)
         {
@@ -269,33 +501,33 @@ public:
         return *this;
     }
 
-    const Matrix3D& operator*=(const Matrix3D& other)
+    constexpr const Matrix3D& operator*=(const Matrix3D& other)
     {
-        Matrix3D temp = Matrix3D();
-        temp.data[0][0] = data[0][0]*other.data[0][0]+data[0][1]*other.data[1][0]+data[0][2]*other.data[2][0]+data[0][3]*other.data[3][0];
-        temp.data[0][1] = data[0][0]*other.data[0][1]+data[0][1]*other.data[1][1]+data[0][2]*other.data[2][1]+data[0][3]*other.data[3][1];
-        temp.data[0][2] = data[0][0]*other.data[0][2]+data[0][1]*other.data[1][2]+data[0][2]*other.data[2][2]+data[0][3]*other.data[3][2];
-        temp.data[0][3] = data[0][0]*other.data[0][3]+data[0][1]*other.data[1][3]+data[0][2]*other.data[2][3]+data[0][3]*other.data[3][3];
-
-        temp.data[1][0] = data[1][0]*other.data[0][0]+data[1][1]*other.data[1][0]+data[1][2]*other.data[2][0]+data[1][3]*other.data[3][0];
-        temp.data[1][1] = data[1][0]*other.data[0][1]+data[1][1]*other.data[1][1]+data[1][2]*other.data[2][1]+data[1][3]*other.data[3][1];
-        temp.data[1][2] = data[1][0]*other.data[0][2]+data[1][1]*other.data[1][2]+data[1][2]*other.data[2][2]+data[1][3]*other.data[3][2];
-        temp.data[1][3] = data[1][0]*other.data[0][3]+data[1][1]*other.data[1][3]+data[1][2]*other.data[2][3]+data[1][3]*other.data[3][3];
-
-        temp.data[2][0] = data[2][0]*other.data[0][0]+data[2][1]*other.data[1][0]+data[2][2]*other.data[2][0]+data[2][3]*other.data[3][0];
-        temp.data[2][1] = data[2][0]*other.data[0][1]+data[2][1]*other.data[1][1]+data[2][2]*other.data[2][1]+data[2][3]*other.data[3][1];
-        temp.data[2][2] = data[2][0]*other.data[0][2]+data[2][1]*other.data[1][2]+data[2][2]*other.data[2][2]+data[2][3]*other.data[3][2];
-        temp.data[2][3] = data[2][0]*other.data[0][3]+data[2][1]*other.data[1][3]+data[2][2]*other.data[2][3]+data[2][3]*other.data[3][3];
-
-        temp.data[3][0] = data[3][0]*other.data[0][0]+data[3][1]*other.data[1][0]+data[3][2]*other.data[2][0]+data[3][3]*other.data[3][0];
-        temp.data[3][1] = data[3][0]*other.data[0][1]+data[3][1]*other.data[1][1]+data[3][2]*other.data[2][1]+data[3][3]*other.data[3][1];
-        temp.data[3][2] = data[3][0]*other.data[0][2]+data[3][1]*other.data[1][2]+data[3][2]*other.data[2][2]+data[3][3]*other.data[3][2];
-        temp.data[3][3] = data[3][0]*other.data[0][3]+data[3][1]*other.data[1][3]+data[3][2]*other.data[2][3]+data[3][3]*other.data[3][3];
-
-        (*this) = temp;
+        Multiply(*this, other, *this);
         return *this;
     }
 
+    /**
+    * Matrix product written straight into the destination
+    * (SSE/AVX for float and double, scalar otherwise)
+    * @param a - left operand
+    * @param b - right operand
+    * @param out - result a*b (may be the same object as a or b)
+    **/
+    static constexpr void Multiply(const Matrix3D& a, const Matrix3D& b, Matrix3D& out)
+    {
+        if(&out == &b)
+        {
+            // the kernel reads all of b while writing out row by row
+            Matrix3D copy(b);
+            Multiply(a, copy, out);
+        }
+        else if(TOOLS3D_IS_CONSTANT_EVALUATED())
+            detail::MultiplyScalar(a.data, b.data, out.data);
+        else
+            detail::MultiplyKernel<T>::Run(a.data, b.data, out.data);
+    }
+
     /**
     * Overloading () operator
     * Access Matrix Matlab-like
@@ -303,14 +535,55 @@ public:
     * @params j - column index to return
     * @return T - value of i,j-th element
     **/
-    T& operator()(unsigned int i, unsigned int j)
+    constexpr T& operator()(unsigned int i, unsigned int j)
     {
         return data[i][j];
     }
 
+    constexpr const T& operator()(unsigned int i, unsigned int j)const
+    {
+        return data[i][j];
+    }
+
+protected:
+    /**
+    * Multiply by a plane rotation acting on two columns
+    * (column a becomes a*c - b*s, column b becomes a*s + b*c)
+    * @param a - first column index
+    * @param b - second column index
+    * @param c - cosine of the angle
+    * @param s - sine of the angle
+    **/
+    constexpr void RotateColumns(int a, int b, const T& c, const T& s)
+    {
+        for(int i=0;i<4;i++)
+        {
+            T va = data[i][a], vb = data[i][b];
+            data[i][a] = va*c-vb*s;
+            data[i][b] = va*s+vb*c;
+        }
+    }
+
+    /**
+    * Fill the last row and column of an affine inverse whose 3x3 block is already set
+    * @param t - translation row of the original matrix
+    **/
+    void SetAffineInverseTranslation(const T t[4])
+    {
+        for(int j=0;j<3;j++)
+            data[3][j] = -(t[0]*data[0][j]+t[1]*data[1][j]+t[2]*data[2][j]);
+        data[0][3] = 0;
+        data[1][3] = 0;
+        data[2][3] = 0;
+        data[3][3] = 1;
+    }
+
+public:
+    template<class U>
+    friend constexpr Vector3D<U> operator*(const Vector3D<U>& vec, const Matrix3D<U>& mat);
     template<class U>
-    friend Vector3D<U> operator*(Vector3D<U>& vec, const Matrix3D<U>& mat);
-    friend const Vector3D<T>& Vector3D<T>::operator *=(const Matrix3D& other);
+    friend constexpr Matrix3D<U> operator*(const Matrix3D<U>& mat1, const Matrix3D<U>& mat2);
+    friend constexpr const Vector3D<T>& Vector3D<T>::operator *=(const Matrix3D& other);
 };
 
 /**
@@ -321,7 +594,7 @@ public:
 **/
 
 template<class T>
-Matrix3D<T> operator*(const Matrix3D<T>& mat1, T val)
+constexpr Matrix3D<T> operator*(const Matrix3D<T>& mat1, T val)
 {
     Matrix3D<T> temp = Matrix3D<T>(mat1);
     temp *= val;
@@ -329,7 +602,7 @@ Matrix3D<T> operator*(const Matrix3D<T>& mat1, T val)
 }
 
 template<class T>
-Matrix3D<T> operator*(T val, const Matrix3D<T>& mat1)
+constexpr Matrix3D<T> operator*(T val, const Matrix3D<T>& mat1)
 {
     Matrix3D<T> temp = Matrix3D<T>(mat1);
     temp *= val;
@@ -337,7 +610,7 @@ Matrix3D<T> operator*(T val, const Matrix3D<T>& mat1)
 }
 
 template<class T>
-Matrix3D<T> operator/(const Matrix3D<T>& mat1, T val)
+constexpr Matrix3D<T> operator/(const Matrix3D<T>& mat1, T val)
 {
     Matrix3D<T> temp = Matrix3D<T>(mat1);
     temp /= val;
@@ -345,15 +618,22 @@ Matrix3D<T> operator/(const Matrix3D<T>& mat1, T val)
 }
 
 template<class T>
-Matrix3D<T> operator*(const Matrix3D<T>& mat1, const Matrix3D<T>& mat2)
+constexpr Matrix3D<T> operator*(const Matrix3D<T>& mat1, const Matrix3D<T>& mat2)
 {
-    Matrix3D<T> temp = Matrix3D<T>(mat1);
-    temp *= mat2;
+    if(TOOLS3D_IS_CONSTANT_EVALUATED())
+    {
+        Matrix3D<T> temp;
+        detail::MultiplyScalar(mat1.data, mat2.data, temp.data);
+        return temp;
+    }
+    // temp is a new object, so it never aliases an operand: no copy check
+    Matrix3D<T> temp(Matrix3D<T>::Uninitialized);
+    detail::MultiplyKernel<T>::Run(mat1.data, mat2.data, temp.data);
     return temp;
 }
 
 template<class T>
-Vector3D<T> operator*(Vector3D<T>& vec, const Matrix3D<T>& mat)
+constexpr Vector3D<T> operator*(const Vector3D<T>& vec, const Matrix3D<T>& mat)
 {
     Vector3D<T> temp = Vector3D<T>();
     temp.SetX(vec.X()*mat.data[0][0]+vec.Y()*mat.data[1][0]+vec.Z()*mat.data[2][0]+mat.data[3][0]);
@@ -363,7 +643,7 @@ Vector3D<T> operator*(Vector3D<T>& vec, const Matrix3D<T>& mat)
 }
 
 template<class T>
-Vector3D<T> operator*(const Matrix3D<T>& m, Vector3D<T>& vec)
+constexpr Vector3D<T> operator*(const Matrix3D<T>& m, const Vector3D<T>& vec)
 {
     Vector3D<T> temp = Vector3D<T>(vec);
     temp = temp*m;
@@ -371,7 +651,7 @@ Vector3D<T> operator*(const Matrix3D<T>& m, Vector3D<T>& vec)
 }
 
 template<class T>
-const Vector3D<T>& Vector3D<T>::operator *=(const Matrix3D<T>& other)
+constexpr const Vector3D<T>& Vector3D<T>::operator *=(const Matrix3D<T>& other)
 {
     Vector3D<T> temp;
     temp.x = x*other.data[0][0]+y*other.data[1][0]+z*other.data[2][0]+other.data[3][0];
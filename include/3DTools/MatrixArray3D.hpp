@@ -0,0 +1,227 @@
+#ifndef MATRIX_ARRAY_3D_HPP
+#define MATRIX_ARRAY_3D_HPP
+
+/**
+* Includes
+**/
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Structure-of-Arrays container of affine matrices
+* Each of the twelve affine components (m(r,c), r<4, c<3, stored as
+* component r*3+c like PackAffine) lives in its own SIMDAlignment-aligned
+* buffer, so batch products work on several matrices per instruction.
+* The last column is always (0,0,0,1) and is not stored.
+**/
+template<class T>
+class MatrixArray3D
+{
+public:
+    typedef std::vector<T, AlignedAllocator<T> > Buffer;
+    static const unsigned Components = 12;
+private:
+    Buffer m[Components];
+public:
+    /**
+    * Default Constructor
+    * Creates an empty array
+    **/
+    MatrixArray3D(){}
+
+    /**
+    * Constructor
+    * @param n - number of matrices (all identity)
+    **/
+    explicit MatrixArray3D(std::size_t n) {Resize(n);}
+
+    /**
+    * Constructor
+    * @param matrices - matrices to copy from (last columns are ignored)
+    **/
+    explicit MatrixArray3D(const std::vector<Matrix3D<T> >& matrices)
+    {
+        Resize(matrices.size());
+        for(std::size_t i=0;i<matrices.size();i++)
+            Set(i, matrices[i]);
+    }
+
+    /**
+    * Get number of matrices
+    * @return std::size_t - the number of matrices
+    **/
+    std::size_t Size()const {return m[0].size();}
+
+    /**
+    * Test if array is empty?
+    * @return bool - true if there are no matrices
+    **/
+    bool Empty()const {return m[0].empty();}
+
+    /**
+    * Resize the array (new matrices are identity)
+    * @param n - new number of matrices
+    **/
+    void Resize(std::size_t n)
+    {
+        for(unsigned k=0;k<Components;k++)
+            m[k].resize(n, (k == 0 || k == 4 || k == 8)?T(1):T(0));
+    }
+
+    /**
+    * Remove all matrices
+    **/
+    void Clear()
+    {
+        for(unsigned k=0;k<Components;k++)
+            m[k].clear();
+    }
+
+    /**
+    * Append a matrix
+    * @param mat - matrix to append (last column ignored)
+    **/
+    void PushBack(const Matrix3D<T>& mat)
+    {
+        for(unsigned k=0;k<Components;k++)
+            m[k].push_back(mat(k/3,k%3));
+    }
+
+    /**
+    * Set a matrix
+    * @param i - index of the matrix
+    * @param mat - new value (last column ignored)
+    **/
+    void Set(std::size_t i, const Matrix3D<T>& mat)
+    {
+        for(unsigned k=0;k<Components;k++)
+            m[k][i] = mat(k/3,k%3);
+    }
+
+    /**
+    * Get a matrix
+    * @param i - index of the matrix
+    * @return Matrix3D - the i-th matrix
+    **/
+    Matrix3D<T> Get(std::size_t i)const
+    {
+        Matrix3D<T> mat;
+        for(unsigned k=0;k<Components;k++)
+            mat(k/3,k%3) = m[k][i];
+        return mat;
+    }
+
+    /**
+    * Get raw component buffer
+    * @param k - component r*3+c of m(r,c)
+    * @return T* - pointer to Size() values (0 if empty)
+    **/
+    T* Component(unsigned k) {return m[k].empty()?0:&m[k][0];}
+    const T* Component(unsigned k)const {return m[k].empty()?0:&m[k][0];}
+};
+
+namespace detail {
+
+/**
+* Element-wise affine product kernel, out[i] = a[i]*b[i]
+* Every input component of a lane group is loaded before anything is
+* stored, so out may be the same buffers as a or b.
+* Width is the register width, see SimdWidth (1 - scalar fallback)
+**/
+template<class T, int Width>
+struct MatrixProductKernel;
+
+template<class T>
+struct MatrixProductKernel<T,1>
+{
+    static void Run(const T* const a[12], const T* const b[12], T* const out[12], std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i=begin;i<end;i++)
+        {
+            T ra[12], rb[12];
+            for(int k=0;k<12;k++)
+            {
+                ra[k] = a[k][i];
+                rb[k] = b[k][i];
+            }
+            for(int r=0;r<4;r++)
+                for(int c=0;c<3;c++)
+                {
+                    T v = ra[r*3]*rb[c]+ra[r*3+1]*rb[3+c]+ra[r*3+2]*rb[6+c];
+                    out[r*3+c][i] = (r == 3)?v+rb[9+c]:v;
+                }
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<class T, int W>
+struct MatrixProductKernel
+{
+    static void Run(const T* const a[12], const T* const b[12], T* const out[12], std::size_t begin, std::size_t end)
+    {
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        std::size_t i = begin;
+        for(;i+W<=end;i+=W)
+        {
+            V ra[12], rb[12];
+            for(int k=0;k<12;k++)
+            {
+                ra[k] = O::Load(a[k]+i);
+                rb[k] = O::Load(b[k]+i);
+            }
+            for(int r=0;r<4;r++)
+                for(int c=0;c<3;c++)
+                {
+                    V v = O::Add(O::Add(O::Mul(ra[r*3],rb[c]),O::Mul(ra[r*3+1],rb[3+c])),O::Mul(ra[r*3+2],rb[6+c]));
+                    O::Store(out[r*3+c]+i, (r == 3)?O::Add(v,rb[9+c]):v);
+                }
+        }
+        MatrixProductKernel<T,1>::Run(a, b, out, i, end);
+    }
+};
+#endif
+
+}
+
+/**
+* Element-wise product of two matrix arrays, out[i] = a[i]*b[i]
+* (e.g. a skinning palette from inverse bind matrices and bone world matrices)
+* @param a - left operands
+* @param b - right operands (same size as a)
+* @param out - products (resized to match; may be a or b)
+* @return bool - false if a and b differ in size
+**/
+template<class T>
+bool Multiply(const MatrixArray3D<T>& a, const MatrixArray3D<T>& b, MatrixArray3D<T>& out)
+{
+    if(a.Size() != b.Size())
+        return false;
+    out.Resize(a.Size());
+    const T* pa[12];
+    const T* pb[12];
+    T* po[12];
+    for(unsigned k=0;k<12;k++)
+    {
+        pa[k] = a.Component(k);
+        pb[k] = b.Component(k);
+        po[k] = out.Component(k);
+    }
+    detail::ParallelBatch(a.Size(), [&](std::size_t begin, std::size_t end) {
+        detail::MatrixProductKernel<T,detail::SimdWidth<T>::value>::Run(pa, pb, po, begin, end);
+    });
+    return true;
+}
+
+typedef MatrixArray3D<double> MatrixArray3Dd;
+typedef MatrixArray3D<float> MatrixArray3Df;
+
+}
+
+#endif
@@ -0,0 +1,378 @@
+#ifndef MORTON_HPP
+#define MORTON_HPP
+
+/**
+* Includes
+* Morton (Z-curve) codes of points in a box and a parallel radix sort by code
+* Sorting by code puts points that are close in space close in memory, which
+* helps every pass that walks them afterwards (tree builds, neighbour
+* queries, transforms); the sorted codes are also the input of linear BVH
+* construction (see MortonSplit).
+**/
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/AABB.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+namespace detail {
+
+/**
+* Bit spreading of one Morton axis: bit i of v moves to bit 3i
+* (pdep with TOOLS3D_BMI2, shifts and masks otherwise)
+**/
+template<class Code>
+struct MortonTraits;
+
+template<>
+struct MortonTraits<std::uint32_t>
+{
+    static const unsigned Bits = 10; // bits per axis
+
+    static std::uint32_t Spread(std::uint32_t v)
+    {
+#if defined(TOOLS3D_BMI2)
+        return _pdep_u32(v, 0x09249249u);
+#else
+        v &= 0x3FFu;
+        v = (v | (v << 16)) & 0x030000FFu;
+        v = (v | (v << 8)) & 0x0300F00Fu;
+        v = (v | (v << 4)) & 0x030C30C3u;
+        v = (v | (v << 2)) & 0x09249249u;
+        return v;
+#endif
+    }
+};
+
+template<>
+struct MortonTraits<std::uint64_t>
+{
+    static const unsigned Bits = 21; // bits per axis
+
+    static std::uint64_t Spread(std::uint64_t v)
+    {
+#if defined(TOOLS3D_BMI2)
+        return _pdep_u64(v, 0x1249249249249249ull);
+#else
+        v &= 0x1FFFFFull;
+        v = (v | (v << 32)) & 0x001F00000000FFFFull;
+        v = (v | (v << 16)) & 0x001F0000FF0000FFull;
+        v = (v | (v << 8)) & 0x100F00F00F00F00Full;
+        v = (v | (v << 4)) & 0x10C30C30C30C30C3ull;
+        v = (v | (v << 2)) & 0x1249249249249249ull;
+        return v;
+#endif
+    }
+};
+
+/**
+* Quantise points of a box to Morton cells and interleave the cell indices
+**/
+template<class T, class Code>
+struct MortonQuantizer
+{
+    T lo[3];
+    T scale[3]; // cells per unit (0 for a flat axis)
+    T top; // last cell
+
+    explicit MortonQuantizer(const AABB<T>& box)
+    {
+        T cells = T(std::uint64_t(1) << MortonTraits<Code>::Bits);
+        top = cells-T(1);
+        T l[3] = {box.Min().X(), box.Min().Y(), box.Min().Z()};
+        T h[3] = {box.Max().X(), box.Max().Y(), box.Max().Z()};
+        for(int a=0;a<3;a++)
+        {
+            lo[a] = l[a];
+            T extent = h[a]-l[a];
+            scale[a] = (extent > T(0))?cells/extent:T(0);
+        }
+    }
+
+    Code Cell(T v, int a)const
+    {
+        T c = (v-lo[a])*scale[a];
+        // written so that NaN lands in cell 0
+        if(!(c > T(0)))
+            return 0;
+        return Code(std::min(c, top));
+    }
+
+    Code operator()(T x, T y, T z)const
+    {
+        return MortonTraits<Code>::Spread(Cell(x, 0)) |
+               (MortonTraits<Code>::Spread(Cell(y, 1)) << 1) |
+               (MortonTraits<Code>::Spread(Cell(z, 2)) << 2);
+    }
+};
+
+/**
+* Number of chunks of a parallel radix-sort pass over n keys
+**/
+inline unsigned RadixChunks(std::size_t n)
+{
+    std::size_t grain = std::max<std::size_t>(DefaultExecutor().Grain(), 1);
+    return unsigned(std::max<std::size_t>(1, std::min<std::size_t>(ThreadCount(0), n/grain)));
+}
+
+}
+
+/**
+* Interleave 10-bit cell indices (bit i of x, y, z goes to bit 3i, 3i+1, 3i+2)
+* @param x - x cell (0..1023)
+* @param y - y cell
+* @param z - z cell
+* @return std::uint32_t - the 30-bit Morton code
+**/
+inline std::uint32_t Morton32(std::uint32_t x, std::uint32_t y, std::uint32_t z)
+{
+    typedef detail::MortonTraits<std::uint32_t> M;
+    return M::Spread(x) | (M::Spread(y) << 1) | (M::Spread(z) << 2);
+}
+
+/**
+* Interleave 21-bit cell indices (bit i of x, y, z goes to bit 3i, 3i+1, 3i+2)
+* @param x - x cell (0..2097151)
+* @param y - y cell
+* @param z - z cell
+* @return std::uint64_t - the 63-bit Morton code
+**/
+inline std::uint64_t Morton64(std::uint64_t x, std::uint64_t y, std::uint64_t z)
+{
+    typedef detail::MortonTraits<std::uint64_t> M;
+    return M::Spread(x) | (M::Spread(y) << 1) | (M::Spread(z) << 2);
+}
+
+/**
+* Get 30-bit Morton code of a point: the box is split in 1024 cells per axis,
+* points outside it are clamped to the border cells
+* @param p - the point
+* @param box - the box to quantise in
+* @return std::uint32_t - the Morton code
+**/
+template<class T>
+std::uint32_t MortonCode32(const Vector3D<T>& p, const AABB<T>& box)
+{
+    return detail::MortonQuantizer<T,std::uint32_t>(box)(p.X(), p.Y(), p.Z());
+}
+
+/**
+* Get 63-bit Morton code of a point (2^21 cells per axis, see MortonCode32)
+* @param p - the point
+* @param box - the box to quantise in
+* @return std::uint64_t - the Morton code
+**/
+template<class T>
+std::uint64_t MortonCode64(const Vector3D<T>& p, const AABB<T>& box)
+{
+    return detail::MortonQuantizer<T,std::uint64_t>(box)(p.X(), p.Y(), p.Z());
+}
+
+/**
+* Get Morton codes of all points on the default executor
+* @param points - the points
+* @param box - the box to quantise in (e.g. AABB::FromPoints(points))
+* @param codes - output codes (std::uint32_t or std::uint64_t, resized to match)
+**/
+template<class T, class Code>
+void MortonCodes(const PointArray3D<T>& points, const AABB<T>& box, std::vector<Code>& codes)
+{
+    detail::MortonQuantizer<T,Code> quantizer(box);
+    codes.resize(points.Size());
+    const T* x = points.X();
+    const T* y = points.Y();
+    const T* z = points.Z();
+    Code* out = codes.empty()?0:&codes[0];
+    detail::ParallelBatch(points.Size(), [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+            out[i] = quantizer(x[i], y[i], z[i]);
+    });
+}
+
+/**
+* Stable LSD radix sort of codes, 8 bits per pass
+* One read pass counts every digit; each pass then scatters (code, index)
+* pairs, one chunk per task (with several chunks each pass first counts its
+* digit per chunk). Passes over digits that are the same in every code are
+* skipped, so 30-bit codes take at most 4 passes and clustered 63-bit codes
+* fewer than 8.
+* @param codes - keys (std::uint32_t or std::uint64_t), sorted in place
+* @param order - output permutation: order[k] is the original index of the
+* k-th sorted code (fewer than 2^32 codes)
+**/
+template<class Code>
+void RadixSort(std::vector<Code>& codes, std::vector<std::uint32_t>& order)
+{
+    struct Item
+    {
+        Code code;
+        std::uint32_t index;
+    };
+    const unsigned Digits = sizeof(Code);
+    std::size_t n = codes.size();
+    order.resize(n);
+    unsigned chunks = detail::RadixChunks(n);
+    // one read pass counts every digit: totals[digit*256+value]
+    std::vector<std::size_t> counts(std::size_t(chunks)*Digits*256, 0), totals(Digits*256, 0);
+    const Code* keys = n?&codes[0]:0;
+    detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+        std::size_t* count = &counts[std::size_t(c)*Digits*256];
+        for(std::size_t i=b;i<e;i++)
+            for(unsigned d=0;d<Digits;d++)
+                count[d*256+((keys[i] >> (8*d)) & 0xFF)]++;
+    });
+    for(std::size_t k=0;k<counts.size();k++)
+        totals[k%(Digits*256)] += counts[k];
+    std::vector<Item> items(n), temp;
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+        {
+            items[i].code = keys[i];
+            items[i].index = std::uint32_t(i);
+        }
+    });
+    // offsets[chunk*256+value] of the current pass
+    std::vector<std::size_t> offsets(std::size_t(chunks)*256);
+    for(unsigned d=0;d<Digits;d++)
+    {
+        // a digit with a single value in all codes needs no pass
+        const std::size_t* total = &totals[d*256];
+        if(std::find(total, total+256, n) != total+256)
+            continue;
+        const Item* src = &items[0];
+        unsigned shift = 8*d;
+        // the chunks of the current order need their own counts (one chunk
+        // reuses the totals)
+        if(chunks == 1)
+            std::copy(total, total+256, offsets.begin());
+        else
+        {
+            std::fill(offsets.begin(), offsets.end(), std::size_t(0));
+            detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+                std::size_t* count = &offsets[std::size_t(c)*256];
+                for(std::size_t i=b;i<e;i++)
+                    count[(src[i].code >> shift) & 0xFF]++;
+            });
+        }
+        // value-major, chunk-minor prefix sums keep equal digits in input order
+        std::size_t sum = 0;
+        for(unsigned v=0;v<256;v++)
+            for(unsigned c=0;c<chunks;c++)
+            {
+                std::size_t count = offsets[std::size_t(c)*256+v];
+                offsets[std::size_t(c)*256+v] = sum;
+                sum += count;
+            }
+        temp.resize(n);
+        Item* dst = &temp[0];
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            std::size_t* next = &offsets[std::size_t(c)*256];
+            for(std::size_t i=b;i<e;i++)
+                dst[next[(src[i].code >> shift) & 0xFF]++] = src[i];
+        });
+        items.swap(temp);
+    }
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+        {
+            codes[i] = items[i].code;
+            order[i] = items[i].index;
+        }
+    });
+}
+
+/**
+* Reorder values by a permutation, values[k] = old values[order[k]]
+* @param order - permutation (e.g. from RadixSort)
+* @param values - values to reorder (any attribute array of the points)
+* @return bool - false if the sizes differ (values are unchanged)
+**/
+template<class V, class A>
+bool Reorder(const std::vector<std::uint32_t>& order, std::vector<V,A>& values)
+{
+    if(order.size() != values.size())
+        return false;
+    std::vector<V,A> temp(values.size());
+    detail::ParallelBatch(order.size(), [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+            temp[i] = values[order[i]];
+    });
+    values.swap(temp);
+    return true;
+}
+
+/**
+* Reorder points by a permutation, points[k] = old points[order[k]]
+* @param order - permutation (e.g. from RadixSort)
+* @param points - points to reorder
+* @return bool - false if the sizes differ (points are unchanged)
+**/
+template<class T>
+bool Reorder(const std::vector<std::uint32_t>& order, PointArray3D<T>& points)
+{
+    if(order.size() != points.Size())
+        return false;
+    PointArray3D<T> temp(points.Size());
+    const T* x = points.X();
+    const T* y = points.Y();
+    const T* z = points.Z();
+    T* ox = temp.X();
+    T* oy = temp.Y();
+    T* oz = temp.Z();
+    detail::ParallelBatch(order.size(), [&](std::size_t b, std::size_t e) {
+        for(std::size_t i=b;i<e;i++)
+        {
+            std::uint32_t k = order[i];
+            ox[i] = x[k];
+            oy[i] = y[k];
+            oz[i] = z[k];
+        }
+    });
+    std::swap(points, temp);
+    return true;
+}
+
+/**
+* Sort points along the Z-curve of their bounding box
+* Apply order with Reorder to every attribute array of the points.
+* @param points - points, reordered in place
+* @param codes - output sorted codes (std::uint32_t or std::uint64_t)
+* @param order - output permutation: order[k] is the original index of points[k]
+**/
+template<class T, class Code>
+void MortonSort(PointArray3D<T>& points, std::vector<Code>& codes, std::vector<std::uint32_t>& order)
+{
+    MortonCodes(points, AABB<T>::FromPoints(points), codes);
+    RadixSort(codes, order);
+    Reorder(order, points);
+}
+
+/**
+* Split a range of sorted codes at their highest differing bit (the node
+* split of a linear BVH / radix tree over Morton codes)
+* @param codes - sorted codes
+* @param begin - first code of the range
+* @param end - one past the last code (end-begin >= 2)
+* @return std::size_t - first index of the upper half, in (begin, end);
+* the middle if all codes of the range are equal
+**/
+template<class Code>
+std::size_t MortonSplit(const Code* codes, std::size_t begin, std::size_t end)
+{
+    Code diff = codes[begin]^codes[end-1];
+    if(diff == 0)
+        return (begin+end)/2;
+    Code bit = 1;
+    while(diff >>= 1)
+        bit <<= 1;
+    return std::size_t(std::partition_point(codes+begin, codes+end, [bit](Code c) {return (c & bit) == 0;})-codes);
+}
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef NEIGHBORS_HPP
+#define NEIGHBORS_HPP
+
+/**
+* Includes
+* Result types shared by the proximity structures (KdTree, SpatialHash)
+**/
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Point found by a proximity query
+**/
+template<class T>
+struct Neighbor
+{
+    std::uint32_t index; // index of the point in the indexed set
+    T distanceSq; // squared distance to the query point
+
+    bool operator<(const Neighbor& o)const {return (distanceSq<o.distanceSq) || (distanceSq==o.distanceSq && index<o.index);}
+};
+
+/**
+* Results of a batch query: the neighbours of query i are
+* neighbors[offsets[i]] .. neighbors[offsets[i+1]-1]
+**/
+template<class T>
+struct NeighborLists
+{
+    std::vector<std::size_t> offsets; // query count + 1
+    std::vector<Neighbor<T> > neighbors;
+
+    /**
+    * Get number of queries
+    * @return std::size_t - the number of lists
+    **/
+    std::size_t Size()const {return offsets.empty()?0:offsets.size()-1;}
+
+    /**
+    * Get number of neighbours of a query
+    * @param i - query index
+    * @return std::size_t - the list length
+    **/
+    std::size_t Count(std::size_t i)const {return offsets[i+1]-offsets[i];}
+
+    /**
+    * Get neighbours of a query
+    * @param i - query index
+    * @return const Neighbor* - first neighbour of the list
+    **/
+    const Neighbor<T>* Begin(std::size_t i)const {return neighbors.empty()?0:&neighbors[0]+offsets[i];}
+};
+
+namespace detail {
+
+/**
+* The k closest candidates so far (max-heap on distance while filling, sorted at the end)
+**/
+template<class T>
+struct KnnHeap
+{
+    std::vector<Neighbor<T> >& items;
+    std::size_t k;
+
+    KnnHeap(std::vector<Neighbor<T> >& out, std::size_t count):items(out),k(count) {items.clear();}
+
+    // squared distance a candidate must beat
+    T Bound(T infinity)const {return (items.size() < k)?infinity:items.front().distanceSq;}
+
+    void Push(std::uint32_t index, T distanceSq)
+    {
+        Neighbor<T> n = {index, distanceSq};
+        if(items.size() < k)
+        {
+            items.push_back(n);
+            std::push_heap(items.begin(), items.end());
+        }
+        else if(n < items.front())
+        {
+            std::pop_heap(items.begin(), items.end());
+            items.back() = n;
+            std::push_heap(items.begin(), items.end());
+        }
+    }
+
+    void Finish() {std::sort_heap(items.begin(), items.end());}
+};
+
+/**
+* Run query(i, list) for queries [0,n) on count threads and concatenate the lists
+**/
+template<class T, class Q>
+inline void BatchLists(std::size_t n, NeighborLists<T>& out, unsigned count, const Q& query)
+{
+    count = (n < count)?1u:std::max(count, 1u);
+    std::vector<std::vector<std::size_t> > sizes(count);
+    std::vector<std::vector<Neighbor<T> > > lists(count);
+    ParallelChunks(0, n, count, [&](std::size_t b, std::size_t e, unsigned c) {
+        std::vector<Neighbor<T> > list;
+        for(std::size_t i=b;i<e;i++)
+        {
+            query(i, list);
+            sizes[c].push_back(list.size());
+            lists[c].insert(lists[c].end(), list.begin(), list.end());
+        }
+    });
+    out.offsets.assign(1, 0);
+    out.neighbors.clear();
+    for(unsigned c=0;c<count;c++)
+    {
+        for(std::size_t i=0;i<sizes[c].size();i++)
+            out.offsets.push_back(out.offsets.back()+sizes[c][i]);
+        out.neighbors.insert(out.neighbors.end(), lists[c].begin(), lists[c].end());
+    }
+}
+
+}
+
+}
+
+#endif
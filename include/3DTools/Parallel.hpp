@@ -0,0 +1,558 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+/**
+* Includes
+* Task executor behind every batch routine (std::thread, so link with pthread)
+* Nothing here starts a thread until a batch is large enough to be split, so
+* code that only works on single points or small arrays never pays for it.
+**/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tools3D {
+
+/**
+* Executor interface
+* Implement Run (and optionally Grain) to plug another scheduler (a thread
+* pool, TBB, OpenMP...) under the library with SetDefaultExecutor().
+**/
+class Executor
+{
+public:
+    virtual ~Executor(){}
+
+    /**
+    * Get number of threads tasks may run on, including the caller
+    * @return unsigned - at least 1
+    **/
+    virtual unsigned Concurrency()const = 0;
+
+    /**
+    * Get number of items per task for cheap element-wise loops (transforms,
+    * distances, evaluations); batches up to this size stay on the caller
+    * @return std::size_t - the chunk size
+    **/
+    virtual std::size_t Grain()const {return std::size_t(1)<<14;}
+
+    /**
+    * Run task(0) .. task(count-1), possibly in parallel, and return when all are done
+    * Must allow Run to be called again from inside a task. If tasks throw, Run
+    * still waits for every started task and then rethrows one of the exceptions.
+    * @param count - number of tasks
+    * @param task - the task body, called with the task index
+    **/
+    virtual void Run(unsigned count, const std::function<void(unsigned)>& task) = 0;
+};
+
+namespace detail {
+
+/**
+* Block until pred() holds
+* Timed waits keep binaries loadable with a libstdc++ older than the compiler
+* (the untimed condition_variable::wait symbol was re-versioned in GCC 12).
+**/
+template<class P>
+inline void WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const P& pred)
+{
+    while(!cv.wait_for(lock, std::chrono::milliseconds(100), pred)) {}
+}
+
+}
+
+/**
+* Work-stealing executor
+* Every worker owns a deque: it pushes and pops its own tasks at the back and
+* steals from the front of the others when it runs dry; threads that are not
+* workers post to a shared queue. A thread waiting in Run keeps executing
+* queued tasks, so nested Run calls (e.g. parallel subtree builds that also
+* split their binning loops) cannot deadlock. The workers are started on the
+* first Run that has more than one task. An exception thrown by a task is kept
+* in its group, the group's tasks not yet started are skipped, and Run rethrows
+* it on the caller once no task refers to the group any more.
+**/
+class WorkStealingExecutor : public Executor
+{
+public:
+    /**
+    * Executor settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // threads including the caller (0 - std::thread::hardware_concurrency())
+        std::size_t grain; // see Executor::Grain
+
+        Settings():threads(0),grain(std::size_t(1)<<14){}
+    };
+
+private:
+    /**
+    * Tasks of one Run call still to finish
+    **/
+    struct Group
+    {
+        std::atomic<unsigned> pending;
+        const std::function<void(unsigned)>* task;
+        std::atomic<bool> failed;
+        std::mutex mutex;
+        std::exception_ptr error; // the first exception thrown by a task
+
+        void Fail(std::exception_ptr e)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(!error)
+                error = e;
+            failed = true;
+        }
+    };
+
+    struct Item
+    {
+        Group* group;
+        unsigned index;
+    };
+
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<Item> items;
+    };
+
+    /**
+    * Which executor and queue the current thread works for
+    **/
+    struct Worker
+    {
+        const WorkStealingExecutor* owner;
+        unsigned queue;
+    };
+
+    Settings settings;
+    std::vector<std::unique_ptr<Queue> > queues; // 0 - shared, 1.. - one per worker
+    std::vector<std::thread> workers;
+    std::once_flag started;
+    std::atomic<bool> running;
+    std::mutex sleep;
+    std::condition_variable wake;
+    std::atomic<std::size_t> queued;
+    bool stop;
+
+    static Worker& Current()
+    {
+        static thread_local Worker worker = {0, 0};
+        return worker;
+    }
+
+    unsigned OwnQueue()const
+    {
+        return (Current().owner == this)?Current().queue:0;
+    }
+
+    void Start()
+    {
+        std::call_once(started, [this]() {
+            for(unsigned i=1;i<settings.threads;i++)
+                workers.push_back(std::thread(&WorkStealingExecutor::Loop, this, i));
+            running = true;
+        });
+    }
+
+    bool TryGet(unsigned own, Item& item)
+    {
+        if(queued.load() == 0)
+            return false;
+        // own tasks newest first (still hot in cache), others oldest first (the biggest pieces)
+        for(std::size_t k=0;k<queues.size();k++)
+        {
+            Queue& q = *queues[(own+k)%queues.size()];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if(q.items.empty())
+                continue;
+            if(k == 0 && own != 0)
+            {
+                item = q.items.back();
+                q.items.pop_back();
+            }
+            else
+            {
+                item = q.items.front();
+                q.items.pop_front();
+            }
+            queued--;
+            return true;
+        }
+        return false;
+    }
+
+    static void Execute(const Item& item)
+    {
+        Group& group = *item.group;
+        if(!group.failed.load())
+        {
+            try
+            {
+                (*group.task)(item.index);
+            }
+            catch(...)
+            {
+                group.Fail(std::current_exception());
+            }
+        }
+        // the group may be gone once pending reaches 0
+        group.pending.fetch_sub(1);
+    }
+
+    void Loop(unsigned queue)
+    {
+        Current().owner = this;
+        Current().queue = queue;
+        while(true)
+        {
+            Item item;
+            if(TryGet(queue, item))
+            {
+                Execute(item);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep);
+            detail::WaitFor(wake, lock, [this]() {return stop || queued.load() > 0;});
+            if(stop)
+                return;
+        }
+    }
+
+public:
+    /**
+    * Constructor (no thread is started yet)
+    * @param s - executor settings
+    **/
+    explicit WorkStealingExecutor(const Settings& s = Settings()):settings(s),running(false),queued(0),stop(false)
+    {
+        if(settings.threads == 0)
+            settings.threads = std::max(1u, std::thread::hardware_concurrency());
+        settings.grain = std::max<std::size_t>(settings.grain, 1);
+        for(unsigned i=0;i<settings.threads;i++)
+            queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+
+    WorkStealingExecutor(const WorkStealingExecutor&) = delete;
+    WorkStealingExecutor& operator=(const WorkStealingExecutor&) = delete;
+
+    ~WorkStealingExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep);
+            stop = true;
+        }
+        wake.notify_all();
+        for(std::size_t i=0;i<workers.size();i++)
+            workers[i].join();
+    }
+
+    unsigned Concurrency()const {return settings.threads;}
+
+    std::size_t Grain()const {return settings.grain;}
+
+    /**
+    * Test if the worker threads were started?
+    * @return bool - true after the first Run with more than one task
+    **/
+    bool Started()const {return running.load();}
+
+    void Run(unsigned count, const std::function<void(unsigned)>& task)
+    {
+        if(count <= 1 || settings.threads <= 1)
+        {
+            for(unsigned i=0;i<count;i++)
+                task(i);
+            return;
+        }
+        Start();
+        Group group;
+        group.pending = count-1;
+        group.task = &task;
+        group.failed = false;
+        unsigned own = OwnQueue();
+        {
+            Queue& q = *queues[own];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            // pushed last to first, so the owner pops them in order
+            for(unsigned i=count-1;i>=1;i--)
+            {
+                Item item = {&group, i};
+                q.items.push_back(item);
+            }
+            queued += count-1;
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleep);
+        }
+        wake.notify_all();
+        try
+        {
+            task(0);
+        }
+        catch(...)
+        {
+            group.Fail(std::current_exception());
+        }
+        // queued items point at group and task: wait for all of them even after a failure
+        while(group.pending.load() > 0)
+        {
+            Item item;
+            if(TryGet(own, item))
+                Execute(item);
+            else
+                std::this_thread::yield();
+        }
+        if(group.error)
+            std::rethrow_exception(group.error);
+    }
+};
+
+namespace detail {
+
+inline std::atomic<Executor*>& InstalledExecutor()
+{
+    static std::atomic<Executor*> installed(0);
+    return installed;
+}
+
+}
+
+/**
+* Get the executor used by all batch routines
+* @return Executor - the installed one, or a WorkStealingExecutor with default settings
+**/
+inline Executor& DefaultExecutor()
+{
+    Executor* installed = detail::InstalledExecutor().load();
+    if(installed)
+        return *installed;
+    static WorkStealingExecutor builtIn;
+    return builtIn;
+}
+
+/**
+* Install the executor used by all batch routines
+* Not to be called while a batch routine is running.
+* @param executor - the executor (it must outlive its use; 0 - back to the built-in one)
+**/
+inline void SetDefaultExecutor(Executor* executor)
+{
+    detail::InstalledExecutor() = executor;
+}
+
+namespace detail {
+
+/**
+* Get number of threads to use
+* @param requested - requested number of threads (0 - DefaultExecutor().Concurrency())
+* @return unsigned - at least 1
+**/
+inline unsigned ThreadCount(unsigned requested)
+{
+    if(requested == 0)
+        requested = DefaultExecutor().Concurrency();
+    return std::max(1u, requested);
+}
+
+/**
+* Run func(chunkBegin, chunkEnd, chunk) over [begin,end) split in count chunks
+* as count tasks of the default executor
+**/
+template<class F>
+inline void ParallelChunks(std::size_t begin, std::size_t end, unsigned count, const F& func)
+{
+    if(count <= 1 || end-begin < count)
+    {
+        func(begin, end, 0u);
+        return;
+    }
+    std::size_t step = (end-begin)/count;
+    DefaultExecutor().Run(count, [&](unsigned i) {
+        func(begin+i*step, (i+1 == count)?end:begin+(i+1)*step, i);
+    });
+}
+
+/**
+* Run func(chunkBegin, chunkEnd) over [begin,end) in chunks of grain items,
+* handed out dynamically to at most threads tasks; ranges of at most grain
+* items run on the calling thread
+**/
+template<class F>
+inline void ParallelFor(std::size_t begin, std::size_t end, std::size_t grain, unsigned threads, const F& func)
+{
+    if(end <= begin)
+        return;
+    grain = std::max<std::size_t>(grain, 1);
+    std::size_t chunks = (end-begin-1)/grain+1;
+    unsigned lanes = unsigned(std::min<std::size_t>(chunks, ThreadCount(threads)));
+    if(lanes <= 1)
+    {
+        func(begin, end);
+        return;
+    }
+    std::atomic<std::size_t> next(begin);
+    DefaultExecutor().Run(lanes, [&](unsigned) {
+        for(std::size_t b=next.fetch_add(grain);b<end;b=next.fetch_add(grain))
+            func(b, std::min(end, b+grain));
+    });
+}
+
+/**
+* Get chunk size of element-wise batch loops: the executor's grain rounded up
+* to a multiple of 16, so every chunk starts on a SIMD register boundary and
+* each element goes through the same (vector or scalar tail) code as in a
+* single pass; results do not depend on the chunking
+**/
+inline std::size_t BatchGrain()
+{
+    return (std::max<std::size_t>(DefaultExecutor().Grain(), 1)+15)/16*16;
+}
+
+/**
+* Element-wise batch loop: ParallelFor over all threads in chunks of BatchGrain()
+**/
+template<class F>
+inline void ParallelBatch(std::size_t n, const F& func)
+{
+    std::size_t grain = BatchGrain();
+    if(n <= grain)
+    {
+        func(std::size_t(0), n);
+        return;
+    }
+    ParallelFor(0, n, grain, 0, func);
+}
+
+/**
+* Run a() and b(), as two tasks when parallel is set (fork-join)
+**/
+template<class A, class B>
+inline void ParallelInvoke(const A& a, const B& b, bool parallel)
+{
+    if(!parallel)
+    {
+        a();
+        b();
+        return;
+    }
+    DefaultExecutor().Run(2, [&](unsigned i) {
+        if(i == 0)
+            a();
+        else
+            b();
+    });
+}
+
+/**
+* One background thread running posted tasks in order (used to overlap I/O with compute)
+* The first exception thrown by a task is rethrown by the next Wait.
+**/
+class AsyncTask
+{
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::function<void()> task;
+    std::exception_ptr error;
+    bool pending;
+    bool stop;
+
+    void Loop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            WaitFor(changed, lock, [&]() {return stop || pending;});
+            if(pending)
+            {
+                lock.unlock();
+                std::exception_ptr e;
+                try
+                {
+                    task();
+                }
+                catch(...)
+                {
+                    e = std::current_exception();
+                }
+                lock.lock();
+                if(e && !error)
+                    error = e;
+                pending = false;
+                changed.notify_all();
+            }
+            else
+                return;
+        }
+    }
+
+public:
+    AsyncTask():pending(false),stop(false)
+    {
+        thread = std::thread(&AsyncTask::Loop, this);
+    }
+
+    AsyncTask(const AsyncTask&) = delete;
+    AsyncTask& operator=(const AsyncTask&) = delete;
+
+    ~AsyncTask()
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            WaitFor(changed, lock, [&]() {return !pending;});
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+
+    /**
+    * Start a task (waits for the previous one first)
+    **/
+    void Post(const std::function<void()>& f)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        WaitFor(changed, lock, [&]() {return !pending;});
+        task = f;
+        pending = true;
+        changed.notify_all();
+    }
+
+    /**
+    * Wait for the posted task to finish
+    * Rethrows the first exception thrown by a task posted since the last Wait.
+    **/
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        WaitFor(changed, lock, [&]() {return !pending;});
+        if(error)
+        {
+            std::exception_ptr e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+        }
+    }
+};
+
+}
+
+}
+
+#endif
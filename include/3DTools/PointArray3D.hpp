@@ -0,0 +1,330 @@
+#ifndef POINT_ARRAY_3D_HPP
+#define POINT_ARRAY_3D_HPP
+
+/**
+* Includes
+**/
+#include <algorithm>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Structure-of-Arrays container of 3D points
+* x, y and z components live in separate SIMDAlignment-aligned buffers
+* so that batch operations can process several points per instruction
+**/
+template<class T>
+class PointArray3D
+{
+public:
+    typedef std::vector<T, AlignedAllocator<T> > Buffer;
+private:
+    Buffer x; // x components
+    Buffer y; // y components
+    Buffer z; // z components
+public:
+    /**
+    * Default Constructor
+    * Creates an empty array
+    **/
+    PointArray3D(){}
+
+    /**
+    * Constructor
+    * @param n - number of points (all initialized to zero)
+    **/
+    explicit PointArray3D(std::size_t n):x(n),y(n),z(n){}
+
+    /**
+    * Constructor
+    * @param points - AoS points to copy from
+    **/
+    explicit PointArray3D(const std::vector<Vector3D<T> >& points):x(points.size()),y(points.size()),z(points.size())
+    {
+        for(std::size_t i=0;i<points.size();i++)
+            Set(i, points[i]);
+    }
+
+    /**
+    * Get number of points
+    * @return std::size_t - the number of points
+    **/
+    std::size_t Size()const {return x.size();}
+
+    /**
+    * Test if array is empty?
+    * @return bool - true if there are no points
+    **/
+    bool Empty()const {return x.empty();}
+
+    /**
+    * Resize the array (new points are zero)
+    * @param n - new number of points
+    **/
+    void Resize(std::size_t n) {x.resize(n);y.resize(n);z.resize(n);}
+
+    /**
+    * Reserve storage for points
+    * @param n - number of points to reserve
+    **/
+    void Reserve(std::size_t n) {x.reserve(n);y.reserve(n);z.reserve(n);}
+
+    /**
+    * Remove all points
+    **/
+    void Clear() {x.clear();y.clear();z.clear();}
+
+    /**
+    * Append a point
+    * @param p - point to append
+    **/
+    void PushBack(const Vector3D<T>& p)
+    {
+        x.push_back(p.X());
+        y.push_back(p.Y());
+        z.push_back(p.Z());
+    }
+
+    /**
+    * Get a point
+    * @param i - index of the point
+    * @return Vector3D - the i-th point
+    **/
+    Vector3D<T> Get(std::size_t i)const {return Vector3D<T>(x[i],y[i],z[i]);}
+
+    /**
+    * Set a point
+    * @param i - index of the point
+    * @param p - value to set
+    **/
+    void Set(std::size_t i, const Vector3D<T>& p) {x[i]=p.X();y[i]=p.Y();z[i]=p.Z();}
+
+    /**
+    * Get raw component buffers (aligned to SIMDAlignment)
+    * @return T* - pointer to the first component
+    **/
+    T* X() {return x.empty()?0:&x[0];}
+    T* Y() {return y.empty()?0:&y[0];}
+    T* Z() {return z.empty()?0:&z[0];}
+    const T* X()const {return x.empty()?0:&x[0];}
+    const T* Y()const {return y.empty()?0:&y[0];}
+    const T* Z()const {return z.empty()?0:&z[0];}
+};
+
+typedef PointArray3D<double> PointArray3Dd;
+typedef PointArray3D<float> PointArray3Df;
+
+namespace detail {
+
+/**
+* Pack the 4x3 affine part of a matrix (rows 0-3, columns 0-2)
+* @param mat - matrix to pack
+* @param m - output, m[r*3+c] = mat(r,c)
+**/
+template<class T>
+inline void PackAffine(const Matrix3D<T>& mat, T m[12])
+{
+    for(int r=0;r<4;r++)
+        for(int c=0;c<3;c++)
+            m[r*3+c] = mat(r,c);
+}
+
+/**
+* Batch point transform kernel (scalar fallback)
+* Same arithmetic order as operator*(Vector3D, Matrix3D);
+* input and output buffers may be the same
+**/
+template<class T>
+struct TransformKernel
+{
+    static void Run(const T* x, const T* y, const T* z, T* ox, T* oy, T* oz, std::size_t n, const T m[12])
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            T px = x[i], py = y[i], pz = z[i];
+            ox[i] = px*m[0]+py*m[3]+pz*m[6]+m[9];
+            oy[i] = px*m[1]+py*m[4]+pz*m[7]+m[10];
+            oz[i] = px*m[2]+py*m[5]+pz*m[8]+m[11];
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<>
+struct TransformKernel<float>
+{
+    static void Run(const float* x, const float* y, const float* z, float* ox, float* oy, float* oz, std::size_t n, const float m[12])
+    {
+        std::size_t i = 0;
+#if defined(TOOLS3D_AVX)
+        {
+            __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+            __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+            __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+            __m256 m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m11 = _mm256_set1_ps(m[11]);
+            for(;i+8<=n;i+=8)
+            {
+                __m256 px = _mm256_loadu_ps(x+i), py = _mm256_loadu_ps(y+i), pz = _mm256_loadu_ps(z+i);
+                __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m0),_mm256_mul_ps(py,m3)),_mm256_mul_ps(pz,m6)),m9);
+                __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m1),_mm256_mul_ps(py,m4)),_mm256_mul_ps(pz,m7)),m10);
+                __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m2),_mm256_mul_ps(py,m5)),_mm256_mul_ps(pz,m8)),m11);
+                _mm256_storeu_ps(ox+i,rx);
+                _mm256_storeu_ps(oy+i,ry);
+                _mm256_storeu_ps(oz+i,rz);
+            }
+        }
+#endif
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+        __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+        __m128 m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+        for(;i+4<=n;i+=4)
+        {
+            __m128 px = _mm_loadu_ps(x+i), py = _mm_loadu_ps(y+i), pz = _mm_loadu_ps(z+i);
+            __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m0),_mm_mul_ps(py,m3)),_mm_mul_ps(pz,m6)),m9);
+            __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m1),_mm_mul_ps(py,m4)),_mm_mul_ps(pz,m7)),m10);
+            __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m2),_mm_mul_ps(py,m5)),_mm_mul_ps(pz,m8)),m11);
+            _mm_storeu_ps(ox+i,rx);
+            _mm_storeu_ps(oy+i,ry);
+            _mm_storeu_ps(oz+i,rz);
+        }
+        for(;i<n;i++)
+        {
+            float px = x[i], py = y[i], pz = z[i];
+            ox[i] = px*m[0]+py*m[3]+pz*m[6]+m[9];
+            oy[i] = px*m[1]+py*m[4]+pz*m[7]+m[10];
+            oz[i] = px*m[2]+py*m[5]+pz*m[8]+m[11];
+        }
+    }
+};
+
+template<>
+struct TransformKernel<double>
+{
+    static void Run(const double* x, const double* y, const double* z, double* ox, double* oy, double* oz, std::size_t n, const double m[12])
+    {
+        std::size_t i = 0;
+#if defined(TOOLS3D_AVX)
+        {
+            __m256d m0 = _mm256_set1_pd(m[0]), m1 = _mm256_set1_pd(m[1]), m2 = _mm256_set1_pd(m[2]);
+            __m256d m3 = _mm256_set1_pd(m[3]), m4 = _mm256_set1_pd(m[4]), m5 = _mm256_set1_pd(m[5]);
+            __m256d m6 = _mm256_set1_pd(m[6]), m7 = _mm256_set1_pd(m[7]), m8 = _mm256_set1_pd(m[8]);
+            __m256d m9 = _mm256_set1_pd(m[9]), m10 = _mm256_set1_pd(m[10]), m11 = _mm256_set1_pd(m[11]);
+            for(;i+4<=n;i+=4)
+            {
+                __m256d px = _mm256_loadu_pd(x+i), py = _mm256_loadu_pd(y+i), pz = _mm256_loadu_pd(z+i);
+                __m256d rx = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px,m0),_mm256_mul_pd(py,m3)),_mm256_mul_pd(pz,m6)),m9);
+                __m256d ry = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px,m1),_mm256_mul_pd(py,m4)),_mm256_mul_pd(pz,m7)),m10);
+                __m256d rz = _mm256_add_pd(_mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(px,m2),_mm256_mul_pd(py,m5)),_mm256_mul_pd(pz,m8)),m11);
+                _mm256_storeu_pd(ox+i,rx);
+                _mm256_storeu_pd(oy+i,ry);
+                _mm256_storeu_pd(oz+i,rz);
+            }
+        }
+#endif
+        __m128d m0 = _mm_set1_pd(m[0]), m1 = _mm_set1_pd(m[1]), m2 = _mm_set1_pd(m[2]);
+        __m128d m3 = _mm_set1_pd(m[3]), m4 = _mm_set1_pd(m[4]), m5 = _mm_set1_pd(m[5]);
+        __m128d m6 = _mm_set1_pd(m[6]), m7 = _mm_set1_pd(m[7]), m8 = _mm_set1_pd(m[8]);
+        __m128d m9 = _mm_set1_pd(m[9]), m10 = _mm_set1_pd(m[10]), m11 = _mm_set1_pd(m[11]);
+        for(;i+2<=n;i+=2)
+        {
+            __m128d px = _mm_loadu_pd(x+i), py = _mm_loadu_pd(y+i), pz = _mm_loadu_pd(z+i);
+            __m128d rx = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(px,m0),_mm_mul_pd(py,m3)),_mm_mul_pd(pz,m6)),m9);
+            __m128d ry = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(px,m1),_mm_mul_pd(py,m4)),_mm_mul_pd(pz,m7)),m10);
+            __m128d rz = _mm_add_pd(_mm_add_pd(_mm_add_pd(_mm_mul_pd(px,m2),_mm_mul_pd(py,m5)),_mm_mul_pd(pz,m8)),m11);
+            _mm_storeu_pd(ox+i,rx);
+            _mm_storeu_pd(oy+i,ry);
+            _mm_storeu_pd(oz+i,rz);
+        }
+        for(;i<n;i++)
+        {
+            double px = x[i], py = y[i], pz = z[i];
+            ox[i] = px*m[0]+py*m[3]+pz*m[6]+m[9];
+            oy[i] = px*m[1]+py*m[4]+pz*m[7]+m[10];
+            oz[i] = px*m[2]+py*m[5]+pz*m[8]+m[11];
+        }
+    }
+};
+#endif
+
+/**
+* Transform interleaved x,y,z records: blocks are split into components on the
+* stack and run through TransformKernel; input and output may be the same
+**/
+template<class T>
+inline void TransformInterleaved(const T* in, T* out, std::size_t n, const T m[12])
+{
+    const std::size_t Block = 256;
+    T x[Block], y[Block], z[Block];
+    for(std::size_t b=0;b<n;b+=Block)
+    {
+        std::size_t count = std::min(Block, n-b);
+        const T* src = in+3*b;
+        for(std::size_t i=0;i<count;i++)
+        {
+            x[i] = src[3*i];
+            y[i] = src[3*i+1];
+            z[i] = src[3*i+2];
+        }
+        TransformKernel<T>::Run(x, y, z, x, y, z, count, m);
+        T* dst = out+3*b;
+        for(std::size_t i=0;i<count;i++)
+        {
+            dst[3*i] = x[i];
+            dst[3*i+1] = y[i];
+            dst[3*i+2] = z[i];
+        }
+    }
+}
+
+}
+
+/**
+* Transform all points by a matrix (same result as vec*mat for every point)
+* @param points - points to transform in place
+* @param mat - transformation matrix
+**/
+template<class T>
+void Transform(PointArray3D<T>& points, const Matrix3D<T>& mat)
+{
+    T m[12];
+    detail::PackAffine(mat, m);
+    T* x = points.X();
+    T* y = points.Y();
+    T* z = points.Z();
+    detail::ParallelBatch(points.Size(), [&](std::size_t b, std::size_t e) {
+        detail::TransformKernel<T>::Run(x+b, y+b, z+b, x+b, y+b, z+b, e-b, m);
+    });
+}
+
+/**
+* Transform all points by a matrix into another array
+* @param in - points to transform
+* @param out - transformed points (resized to match in)
+* @param mat - transformation matrix
+**/
+template<class T>
+void Transform(const PointArray3D<T>& in, PointArray3D<T>& out, const Matrix3D<T>& mat)
+{
+    T m[12];
+    detail::PackAffine(mat, m);
+    out.Resize(in.Size());
+    const T* x = in.X();
+    const T* y = in.Y();
+    const T* z = in.Z();
+    T* ox = out.X();
+    T* oy = out.Y();
+    T* oz = out.Z();
+    detail::ParallelBatch(in.Size(), [&](std::size_t b, std::size_t e) {
+        detail::TransformKernel<T>::Run(x+b, y+b, z+b, ox+b, oy+b, oz+b, e-b, m);
+    });
+}
+
+}
+
+#endif
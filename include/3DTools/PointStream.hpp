@@ -0,0 +1,185 @@
+#ifndef POINT_STREAM_HPP
+#define POINT_STREAM_HPP
+
+/**
+* Includes
+* Out-of-core transform of binary point clouds (interleaved x,y,z records)
+* Reading and writing overlap with the transform on two I/O threads and the
+* transform runs on the default executor, so link with pthread.
+**/
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Streaming point-cloud transform stage
+* The input is read in fixed-size chunks into three rotating buffers: while
+* chunk k is transformed on the executor, chunk k+1 is being read and chunk
+* k-1 written by two I/O threads, so memory stays at three chunks whatever the
+* input size and the slower of disk and compute sets the pace.
+**/
+template<class T>
+class PointCloudStream
+{
+public:
+    /**
+    * Pipeline settings
+    **/
+    struct Settings
+    {
+        std::size_t chunkPoints; // points per chunk (3 chunks are in memory)
+        unsigned threads; // transform threads (0 - DefaultExecutor().Concurrency())
+
+        Settings():chunkPoints(1<<20),threads(0){}
+    };
+
+    /**
+    * Statistics of the last run
+    **/
+    struct Stats
+    {
+        std::uint64_t points; // points transformed
+        std::uint64_t bytes; // input bytes (3*sizeof(T) per point)
+        double seconds; // wall time
+
+        Stats():points(0),bytes(0),seconds(0){}
+
+        /**
+        * Get throughput
+        * @return double - input megabytes (1e6 bytes) per second
+        **/
+        double MBPerSecond()const {return (seconds > 0)?double(bytes)/1e6/seconds:0.0;}
+    };
+
+private:
+    // points per task handed to the executor
+    static const std::size_t Grain = 1<<14;
+
+    Settings settings;
+    Stats stats;
+
+public:
+    /**
+    * Constructor
+    * @param s - pipeline settings
+    **/
+    explicit PointCloudStream(const Settings& s = Settings()):settings(s)
+    {
+        settings.chunkPoints = std::max<std::size_t>(settings.chunkPoints, 1);
+    }
+
+    /**
+    * Transform a stream of points (the same result as vec*mat for every point)
+    * @param read - callable bool(T* buffer, std::size_t maxPoints, std::size_t& points):
+    * fill the buffer with up to maxPoints records, 0 at the end; false on error
+    * @param write - callable bool(const T* buffer, std::size_t points); false on error
+    * @param mat - transformation matrix
+    * @return bool - false if read or write failed (the output is then incomplete);
+    * an exception thrown by read or write is rethrown here once both threads are idle
+    **/
+    template<class Read, class Write>
+    bool Transform(Read read, Write write, const Matrix3D<T>& mat)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        stats = Stats();
+        T m[12];
+        detail::PackAffine(mat, m);
+        std::vector<T> buffers[3];
+        std::size_t counts[3] = {0, 0, 0};
+        for(int b=0;b<3;b++)
+            buffers[b].resize(3*settings.chunkPoints);
+        bool readOk = true, writeOk = true;
+        auto fill = [&](int b) {
+            counts[b] = 0;
+            if(readOk && !read(&buffers[b][0], settings.chunkPoints, counts[b]))
+            {
+                readOk = false;
+                counts[b] = 0;
+            }
+        };
+
+        detail::AsyncTask reader, writer;
+        fill(0);
+        for(int k=0;counts[k%3] > 0;k++)
+        {
+            int current = k%3, next = (k+1)%3;
+            // the writer finished with buffer `next` (chunk k-2) before chunk k-1 was posted
+            reader.Post([&fill, next]() {fill(next);});
+            T* data = &buffers[current][0];
+            detail::ParallelFor(0, counts[current], Grain, settings.threads, [&](std::size_t b, std::size_t e) {
+                detail::TransformInterleaved(data+3*b, data+3*b, e-b, m);
+            });
+            stats.points += counts[current];
+            writer.Wait();
+            if(!writeOk)
+                break;
+            writer.Post([&, current]() {
+                if(writeOk && !write(&buffers[current][0], counts[current]))
+                    writeOk = false;
+            });
+            reader.Wait();
+        }
+        reader.Wait();
+        writer.Wait();
+        stats.bytes = stats.points*3*sizeof(T);
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count();
+        return readOk && writeOk;
+    }
+
+    /**
+    * Transform a binary file of x,y,z records into another file
+    * @param input - input file
+    * @param output - output file (overwritten)
+    * @param mat - transformation matrix
+    * @return bool - false on an I/O error or if the input is not a whole number of records
+    **/
+    bool Transform(const std::string& input, const std::string& output, const Matrix3D<T>& mat)
+    {
+        std::FILE* in = std::fopen(input.c_str(), "rb");
+        if(!in)
+            return false;
+        std::FILE* out = std::fopen(output.c_str(), "wb");
+        if(!out)
+        {
+            std::fclose(in);
+            return false;
+        }
+        const std::size_t record = 3*sizeof(T);
+        bool ok = Transform([&](T* buffer, std::size_t maxPoints, std::size_t& points) {
+            std::size_t bytes = std::fread(buffer, 1, maxPoints*record, in);
+            points = bytes/record;
+            return bytes%record == 0 && !std::ferror(in);
+        }, [&](const T* buffer, std::size_t points) {
+            return std::fwrite(buffer, record, points, out) == points;
+        }, mat);
+        std::fclose(in);
+        ok = (std::fclose(out) == 0) && ok;
+        return ok;
+    }
+
+    /**
+    * Get statistics of the last run
+    * @return Stats - points, bytes, time and throughput
+    **/
+    const Stats& LastStats()const {return stats;}
+
+    /**
+    * Get pipeline settings
+    * @return Settings - the settings
+    **/
+    const Settings& GetSettings()const {return settings;}
+};
+
+typedef PointCloudStream<double> PointCloudStreamd;
+typedef PointCloudStream<float> PointCloudStreamf;
+
+}
+
+#endif
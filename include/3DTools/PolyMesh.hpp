@@ -0,0 +1,581 @@
+#ifndef POLY_MESH_HPP
+#define POLY_MESH_HPP
+
+/**
+* Includes
+* Indexed polygon mesh with half-edge adjacency
+* The mesh is a set of flat arrays that reference each other by index only, so
+* it serialises to one blob that PolyMeshView uses in place (e.g. from a
+* MappedFile) without parsing or copying.
+* Adjacency builds run on the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Read-only polygon mesh over flat arrays: the storage of a PolyMesh or a serialised blob
+* Half-edge h is corner h of the face index list: it starts at vertex Origin(h)
+* and runs to the next corner of its face. Twin(h) is the opposite half-edge in
+* the neighbouring face, or Invalid on a boundary (and on non-manifold edges,
+* which are left unpaired).
+**/
+template<class T>
+class PolyMeshView
+{
+public:
+    /**
+    * Blob header (32 bytes), followed by 3 T per vertex, faceCount+1 face offsets,
+    * and per half-edge the origin, twin and face, then one half-edge per vertex
+    * The blob uses the byte order of the machine that wrote it.
+    **/
+    struct Header
+    {
+        char magic[4]; // "MSH3"
+        std::uint32_t version;
+        std::uint32_t scalarSize; // sizeof(T)
+        std::uint32_t vertexCount;
+        std::uint32_t faceCount;
+        std::uint32_t halfEdgeCount;
+        std::uint32_t nonManifoldCount; // half-edges left unpaired because their edge has more than two faces
+        std::uint32_t reserved;
+    };
+
+    static const std::uint32_t Invalid = 0xffffffffu;
+    static const std::uint32_t Version = 1;
+
+private:
+    const T* positions;
+    const std::uint32_t* offsets;
+    const std::uint32_t* indices;
+    const std::uint32_t* twins;
+    const std::uint32_t* faces;
+    const std::uint32_t* vertexEdges;
+    std::uint32_t vertexCount;
+    std::uint32_t faceCount;
+    std::uint32_t halfEdgeCount;
+    std::uint32_t nonManifoldCount;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty view
+    **/
+    PolyMeshView():positions(0),offsets(0),indices(0),twins(0),faces(0),vertexEdges(0),vertexCount(0),faceCount(0),halfEdgeCount(0),nonManifoldCount(0){}
+
+    /**
+    * Constructor
+    * @param p - vertex positions (x,y,z per vertex)
+    * @param o - face offsets (face f is half-edges o[f] .. o[f+1]-1)
+    * @param i - origin vertex of every half-edge
+    * @param tw - twin of every half-edge
+    * @param fc - face of every half-edge
+    * @param ve - one outgoing half-edge per vertex (a boundary one if there is any)
+    * @param nv - number of vertices
+    * @param nf - number of faces
+    * @param nonManifold - number of unpaired non-manifold half-edges
+    **/
+    PolyMeshView(const T* p, const std::uint32_t* o, const std::uint32_t* i, const std::uint32_t* tw, const std::uint32_t* fc, const std::uint32_t* ve, std::uint32_t nv, std::uint32_t nf, std::uint32_t nonManifold)
+        :positions(p),offsets(o),indices(i),twins(tw),faces(fc),vertexEdges(ve),vertexCount(nv),faceCount(nf),halfEdgeCount(o?o[nf]:0),nonManifoldCount(nonManifold){}
+
+    /**
+    * View a serialised mesh in place (no copy, the blob must outlive the view)
+    * @param data - the blob (aligned to at least alignof(T))
+    * @param size - size of the blob in bytes
+    * @param validate - check every index (touches the whole blob); files this
+    * program wrote itself can skip it, which keeps the load O(1) and lets a
+    * mapped file be paged in lazily
+    * @return bool - false if the blob is not a valid mesh for this T (the view is then empty)
+    **/
+    bool Load(const void* data, std::size_t size, bool validate = true)
+    {
+        *this = PolyMeshView();
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        if(!data || size < sizeof(Header) || reinterpret_cast<std::uintptr_t>(data)%alignof(T) != 0)
+            return false;
+        Header h;
+        std::memcpy(&h, bytes, sizeof(Header));
+        if(std::memcmp(h.magic, "MSH3", 4) != 0 || h.version != Version || h.scalarSize != sizeof(T))
+            return false;
+        std::size_t need = sizeof(Header)+std::size_t(h.vertexCount)*3*sizeof(T)
+                          +(std::size_t(h.faceCount)+1+3*std::size_t(h.halfEdgeCount)+h.vertexCount)*sizeof(std::uint32_t);
+        if(size < need)
+            return false;
+        const T* p = reinterpret_cast<const T*>(bytes+sizeof(Header));
+        const std::uint32_t* o = reinterpret_cast<const std::uint32_t*>(p+3*std::size_t(h.vertexCount));
+        const std::uint32_t* i = o+h.faceCount+1;
+        const std::uint32_t* tw = i+h.halfEdgeCount;
+        const std::uint32_t* fc = tw+h.halfEdgeCount;
+        const std::uint32_t* ve = fc+h.halfEdgeCount;
+        if(o[0] != 0 || o[h.faceCount] != h.halfEdgeCount)
+            return false;
+        if(validate)
+        {
+            for(std::uint32_t f=0;f<h.faceCount;f++)
+            {
+                if(o[f+1] < o[f]+3 || o[f+1] > h.halfEdgeCount)
+                    return false;
+                for(std::uint32_t e=o[f];e<o[f+1];e++)
+                    if(fc[e] != f)
+                        return false;
+            }
+            for(std::uint32_t e=0;e<h.halfEdgeCount;e++)
+                if(i[e] >= h.vertexCount || (tw[e] != Invalid && (tw[e] >= h.halfEdgeCount || tw[tw[e]] != e)))
+                    return false;
+            for(std::uint32_t v=0;v<h.vertexCount;v++)
+                if(ve[v] != Invalid && (ve[v] >= h.halfEdgeCount || i[ve[v]] != v))
+                    return false;
+        }
+        *this = PolyMeshView(p, o, i, tw, fc, ve, h.vertexCount, h.faceCount, h.nonManifoldCount);
+        return true;
+    }
+
+    /**
+    * Get number of vertices
+    * @return std::size_t - the number of vertices
+    **/
+    std::size_t VertexCount()const {return vertexCount;}
+
+    /**
+    * Get number of faces
+    * @return std::size_t - the number of faces
+    **/
+    std::size_t FaceCount()const {return faceCount;}
+
+    /**
+    * Get number of half-edges (face corners)
+    * @return std::size_t - the number of half-edges
+    **/
+    std::size_t HalfEdgeCount()const {return halfEdgeCount;}
+
+    /**
+    * Get number of half-edges left unpaired because more than two faces share their edge
+    * @return std::size_t - 0 for a manifold mesh
+    **/
+    std::size_t NonManifoldCount()const {return nonManifoldCount;}
+
+    /**
+    * Get vertex position
+    * @param v - vertex index
+    * @return Vector3D - the position
+    **/
+    Vector3D<T> Vertex(std::uint32_t v)const {return Vector3D<T>(positions[3*v],positions[3*v+1],positions[3*v+2]);}
+
+    /**
+    * Get vertex positions
+    * @return const T* - x,y,z of every vertex
+    **/
+    const T* Positions()const {return positions;}
+
+    /**
+    * Get first half-edge of a face (its corners are FaceBegin(f) .. FaceBegin(f)+FaceSize(f)-1)
+    * @param f - face index
+    * @return std::uint32_t - the half-edge
+    **/
+    std::uint32_t FaceBegin(std::uint32_t f)const {return offsets[f];}
+
+    /**
+    * Get number of corners of a face
+    * @param f - face index
+    * @return std::uint32_t - the number of corners
+    **/
+    std::uint32_t FaceSize(std::uint32_t f)const {return offsets[f+1]-offsets[f];}
+
+    /**
+    * Get face vertex indices
+    * @return const std::uint32_t* - origin vertex of every half-edge (face corners in order)
+    **/
+    const std::uint32_t* Indices()const {return indices;}
+
+    /**
+    * Get start vertex of a half-edge
+    * @param h - half-edge
+    * @return std::uint32_t - the vertex
+    **/
+    std::uint32_t Origin(std::uint32_t h)const {return indices[h];}
+
+    /**
+    * Get end vertex of a half-edge
+    * @param h - half-edge
+    * @return std::uint32_t - the vertex
+    **/
+    std::uint32_t Target(std::uint32_t h)const {return indices[Next(h)];}
+
+    /**
+    * Get face of a half-edge
+    * @param h - half-edge
+    * @return std::uint32_t - the face
+    **/
+    std::uint32_t Face(std::uint32_t h)const {return faces[h];}
+
+    /**
+    * Get next half-edge around the face
+    * @param h - half-edge
+    * @return std::uint32_t - the half-edge starting at Target(h)
+    **/
+    std::uint32_t Next(std::uint32_t h)const {return (h+1 == offsets[faces[h]+1])?offsets[faces[h]]:h+1;}
+
+    /**
+    * Get previous half-edge around the face
+    * @param h - half-edge
+    * @return std::uint32_t - the half-edge ending at Origin(h)
+    **/
+    std::uint32_t Prev(std::uint32_t h)const {return (h == offsets[faces[h]])?offsets[faces[h]+1]-1:h-1;}
+
+    /**
+    * Get opposite half-edge
+    * @param h - half-edge
+    * @return std::uint32_t - the half-edge in the neighbouring face, Invalid on a boundary
+    **/
+    std::uint32_t Twin(std::uint32_t h)const {return twins[h];}
+
+    /**
+    * Test if half-edge has no neighbouring face?
+    * @param h - half-edge
+    * @return bool - true on a boundary
+    **/
+    bool IsBoundary(std::uint32_t h)const {return twins[h] == Invalid;}
+
+    /**
+    * Get an outgoing half-edge of a vertex
+    * @param v - vertex index
+    * @return std::uint32_t - a boundary half-edge if the vertex has one, Invalid for unused vertices
+    **/
+    std::uint32_t VertexHalfEdge(std::uint32_t v)const {return vertexEdges[v];}
+
+    /**
+    * Get next outgoing half-edge around the origin vertex
+    * @param h - half-edge
+    * @return std::uint32_t - the outgoing half-edge of the next face, Invalid at a boundary
+    **/
+    std::uint32_t NextAroundVertex(std::uint32_t h)const {return twins[Prev(h)];}
+
+    /**
+    * Visit the outgoing half-edges of a vertex (from VertexHalfEdge until a boundary or all the way round)
+    * @param v - vertex index
+    * @param visit - callable taking the half-edge (std::uint32_t)
+    **/
+    template<class F>
+    void ForEachOutgoing(std::uint32_t v, F visit)const
+    {
+        std::uint32_t first = vertexEdges[v], h = first;
+        // the step count bounds the walk on vertices that are non-manifold (fans joined at the vertex)
+        for(std::uint32_t steps=0;h != Invalid && steps<halfEdgeCount;steps++)
+        {
+            visit(h);
+            h = NextAroundVertex(h);
+            if(h == first)
+                break;
+        }
+    }
+};
+
+/**
+* Indexed polygon mesh with half-edge adjacency
+* Faces are lists of vertex indices (counter-clockwise seen from outside, at
+* least 3 corners). The adjacency is built in time linear in the number of
+* corners and vertices, whatever the vertex valence.
+**/
+template<class T>
+class PolyMesh
+{
+public:
+    typedef typename PolyMeshView<T>::Header Header;
+    static const std::uint32_t Invalid = PolyMeshView<T>::Invalid;
+
+    /**
+    * Build settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // threads for the per-face and per-edge passes (0 - DefaultExecutor().Concurrency())
+
+        Settings():threads(0){}
+    };
+
+private:
+    std::vector<T> positions; // x,y,z per vertex
+    std::vector<std::uint32_t> offsets; // faceCount+1
+    std::vector<std::uint32_t> indices; // origin of every half-edge
+    std::vector<std::uint32_t> twins;
+    std::vector<std::uint32_t> faces;
+    std::vector<std::uint32_t> vertexEdges;
+    std::uint32_t nonManifoldCount;
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty mesh
+    **/
+    PolyMesh():offsets(1, 0),nonManifoldCount(0){}
+
+    /**
+    * Constructor
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle
+    * @param s - build settings
+    **/
+    PolyMesh(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices, const Settings& s = Settings()):offsets(1, 0),nonManifoldCount(0)
+    {
+        Build(vertices, indices, s);
+    }
+
+    /**
+    * Build a triangle mesh
+    * @param vertices - vertex positions
+    * @param triangles - three vertex indices per triangle
+    * @param s - build settings
+    **/
+    void Build(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& triangles, const Settings& s = Settings())
+    {
+        std::vector<std::uint32_t> faceOffsets(triangles.size()/3+1);
+        for(std::size_t f=0;f<faceOffsets.size();f++)
+            faceOffsets[f] = std::uint32_t(3*f);
+        Build(vertices, triangles, faceOffsets, s);
+    }
+
+    /**
+    * Build a polygon mesh
+    * @param vertices - vertex positions
+    * @param faceIndices - vertex indices of all faces
+    * @param faceOffsets - face f uses faceIndices[faceOffsets[f]] .. faceIndices[faceOffsets[f+1]-1]
+    * (faceCount+1 values, starting at 0)
+    * @param s - build settings
+    **/
+    void Build(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& faceIndices, const std::vector<std::uint32_t>& faceOffsets, const Settings& s = Settings())
+    {
+        unsigned threads = detail::ThreadCount(s.threads);
+        positions.resize(3*vertices.size());
+        detail::ParallelFor(0, vertices.size(), detail::BatchGrain(), threads, [&](std::size_t b, std::size_t e) {
+            for(std::size_t v=b;v<e;v++)
+            {
+                positions[3*v] = vertices[v].X();
+                positions[3*v+1] = vertices[v].Y();
+                positions[3*v+2] = vertices[v].Z();
+            }
+        });
+        offsets = faceOffsets.empty()?std::vector<std::uint32_t>(1, 0):faceOffsets;
+        indices.assign(faceIndices.begin(), faceIndices.begin()+offsets.back());
+        BuildAdjacency(threads);
+    }
+
+    /**
+    * Get read-only view of the mesh (valid until the mesh changes)
+    * @return PolyMeshView - the view
+    **/
+    PolyMeshView<T> View()const
+    {
+        return PolyMeshView<T>(positions.empty()?0:&positions[0], &offsets[0], indices.empty()?0:&indices[0],
+                               twins.empty()?0:&twins[0], faces.empty()?0:&faces[0], vertexEdges.empty()?0:&vertexEdges[0],
+                               std::uint32_t(vertexEdges.size()), std::uint32_t(offsets.size()-1), nonManifoldCount);
+    }
+
+    /**
+    * Get number of vertices
+    * @return std::size_t - the number of vertices
+    **/
+    std::size_t VertexCount()const {return vertexEdges.size();}
+
+    /**
+    * Get number of faces
+    * @return std::size_t - the number of faces
+    **/
+    std::size_t FaceCount()const {return offsets.size()-1;}
+
+    /**
+    * Get number of half-edges (face corners)
+    * @return std::size_t - the number of half-edges
+    **/
+    std::size_t HalfEdgeCount()const {return indices.size();}
+
+    /**
+    * Get number of half-edges left unpaired because more than two faces share their edge
+    * @return std::size_t - 0 for a manifold mesh
+    **/
+    std::size_t NonManifoldCount()const {return nonManifoldCount;}
+
+    /**
+    * Get size of the serialised mesh
+    * @return std::size_t - the size in bytes
+    **/
+    std::size_t SerializedSize()const
+    {
+        return sizeof(Header)+positions.size()*sizeof(T)+(offsets.size()+3*indices.size()+vertexEdges.size())*sizeof(std::uint32_t);
+    }
+
+    /**
+    * Write the mesh as a flat blob that PolyMeshView::Load reads in place
+    * @param out - destination, SerializedSize() bytes
+    **/
+    void Serialize(void* out)const
+    {
+        Header h;
+        std::memcpy(h.magic, "MSH3", 4);
+        h.version = PolyMeshView<T>::Version;
+        h.scalarSize = sizeof(T);
+        h.vertexCount = std::uint32_t(vertexEdges.size());
+        h.faceCount = std::uint32_t(offsets.size()-1);
+        h.halfEdgeCount = std::uint32_t(indices.size());
+        h.nonManifoldCount = nonManifoldCount;
+        h.reserved = 0;
+        unsigned char* bytes = static_cast<unsigned char*>(out);
+        std::memcpy(bytes, &h, sizeof(Header));
+        bytes += sizeof(Header);
+        bytes = Append(bytes, positions);
+        bytes = Append(bytes, offsets);
+        bytes = Append(bytes, indices);
+        bytes = Append(bytes, twins);
+        bytes = Append(bytes, faces);
+        Append(bytes, vertexEdges);
+    }
+
+    /**
+    * Write the mesh as a flat blob that PolyMeshView::Load reads in place
+    * @param out - output, resized to SerializedSize()
+    **/
+    void Serialize(std::vector<unsigned char>& out)const
+    {
+        out.resize(SerializedSize());
+        Serialize(&out[0]);
+    }
+
+    /**
+    * Write the serialised mesh to a file (map it back with MappedFile)
+    * @param path - output file
+    * @return bool - false if the file cannot be written
+    **/
+    bool Save(const std::string& path)const
+    {
+        std::vector<unsigned char> blob;
+        Serialize(blob);
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&blob[0]), std::streamsize(blob.size()));
+        return bool(file);
+    }
+
+private:
+    template<class U>
+    static unsigned char* Append(unsigned char* out, const std::vector<U>& v)
+    {
+        if(!v.empty())
+            std::memcpy(out, &v[0], v.size()*sizeof(U));
+        return out+v.size()*sizeof(U);
+    }
+
+    /**
+    * Pair every half-edge a -> b with the single b -> a: half-edges are bucketed
+    * by origin (counting sort), so each lookup scans the fan of one vertex.
+    * Every half-edge looks up its own twin, so the corners can be split over
+    * threads with no shared writes; only the counting sort is sequential.
+    **/
+    void BuildAdjacency(unsigned threads)
+    {
+        std::size_t vertexCount = positions.size()/3, faceCount = offsets.size()-1, halfEdgeCount = indices.size();
+        std::size_t grain = detail::BatchGrain();
+        faces.resize(halfEdgeCount);
+        twins.assign(halfEdgeCount, std::uint32_t(Invalid));
+        vertexEdges.assign(vertexCount, std::uint32_t(Invalid));
+        std::vector<std::uint32_t> target(halfEdgeCount);
+        detail::ParallelFor(0, faceCount, grain, threads, [&](std::size_t b, std::size_t e) {
+            for(std::uint32_t f=std::uint32_t(b);f<e;f++)
+            {
+                for(std::uint32_t h=offsets[f];h<offsets[f+1];h++)
+                {
+                    faces[h] = f;
+                    target[h] = indices[(h+1 == offsets[f+1])?offsets[f]:h+1];
+                }
+            }
+        });
+
+        // half-edges sorted by their undirected edge (low, high): two stable
+        // counting passes, by high then by low, put both directions of an
+        // edge in one run whatever the vertex valence
+        std::vector<std::uint32_t> low(halfEdgeCount), high(halfEdgeCount), byHigh(halfEdgeCount), edges(halfEdgeCount);
+        std::vector<std::uint32_t> lowStart(vertexCount+1, 0), highStart(vertexCount+1, 0);
+        for(std::uint32_t h=0;h<halfEdgeCount;h++)
+        {
+            low[h] = std::min(indices[h], target[h]);
+            high[h] = std::max(indices[h], target[h]);
+            lowStart[low[h]+1]++;
+            highStart[high[h]+1]++;
+        }
+        for(std::size_t v=0;v<vertexCount;v++)
+        {
+            lowStart[v+1] += lowStart[v];
+            highStart[v+1] += highStart[v];
+        }
+        for(std::uint32_t h=0;h<halfEdgeCount;h++)
+            byHigh[highStart[high[h]]++] = h;
+        for(std::size_t k=0;k<halfEdgeCount;k++)
+            edges[lowStart[low[byHigh[k]]]++] = byHigh[k];
+
+        // the edge is manifold if exactly one a -> b and one b -> a exist
+        std::atomic<std::uint32_t> nonManifold(0);
+        detail::ParallelFor(0, halfEdgeCount, grain, threads, [&](std::size_t begin, std::size_t end) {
+            std::uint32_t bad = 0;
+            // runs starting in [begin,end): the one crossing begin belongs to the previous chunk
+            std::size_t k = begin;
+            while(k > 0 && k < halfEdgeCount && low[edges[k]] == low[edges[k-1]] && high[edges[k]] == high[edges[k-1]])
+                k++;
+            while(k < end)
+            {
+                std::uint32_t a = low[edges[k]], b = high[edges[k]], forward = 0, backward = 0;
+                std::uint32_t first = Invalid, second = Invalid;
+                std::size_t run = k;
+                for(;run < halfEdgeCount && low[edges[run]] == a && high[edges[run]] == b;run++)
+                {
+                    std::uint32_t h = edges[run];
+                    if(indices[h] == a)
+                    {
+                        forward++;
+                        first = h;
+                    }
+                    else
+                    {
+                        backward++;
+                        second = h;
+                    }
+                }
+                if(a == b)
+                    backward = forward;
+                if(a != b && forward == 1 && backward == 1)
+                {
+                    twins[first] = second;
+                    twins[second] = first;
+                }
+                else if(forward > 1 || backward > 1)
+                    bad += std::uint32_t(run-k);
+                k = run;
+            }
+            nonManifold += bad;
+        });
+        nonManifoldCount = nonManifold.load();
+
+        // outgoing half-edge per vertex: the first boundary one of its fan (the
+        // fan is in half-edge order), so circulating from it reaches the whole
+        // fan, or else the first one
+        for(std::uint32_t h=0;h<halfEdgeCount;h++)
+        {
+            std::uint32_t& first = vertexEdges[indices[h]];
+            if(first == Invalid || (twins[h] == Invalid && twins[first] != Invalid))
+                first = h;
+        }
+    }
+};
+
+typedef PolyMesh<double> PolyMeshd;
+typedef PolyMesh<float> PolyMeshf;
+typedef PolyMeshView<double> PolyMeshViewd;
+typedef PolyMeshView<float> PolyMeshViewf;
+
+}
+
+#endif
@@ -0,0 +1,479 @@
+#ifndef QUANTIZED_POINTS_HPP
+#define QUANTIZED_POINTS_HPP
+
+/**
+* Includes
+* Compressed point storage: integer grid coordinates per block of points,
+* decoded and transformed in one pass
+**/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Component encoding of QuantizedPointArray3D
+* Quantized16 - three 16-bit integers per point (6 bytes)
+* Quantized10 - 10:10:10 packed in one 32-bit word per point (4 bytes)
+**/
+enum QuantizedFormat { Quantized16, Quantized10 };
+
+namespace detail {
+
+/**
+* Readers of the integer coordinates of the two formats
+* Get returns the coordinates of point i, Get4 (SSE2) those of points i..i+3
+* as 32-bit integer lanes.
+**/
+struct Quantized16Reader
+{
+    const std::uint16_t* x;
+    const std::uint16_t* y;
+    const std::uint16_t* z;
+
+    void Get(std::size_t i, std::uint32_t& a, std::uint32_t& b, std::uint32_t& c)const
+    {
+        a = x[i];
+        b = y[i];
+        c = z[i];
+    }
+
+#if defined(TOOLS3D_SSE2)
+    void Get4(std::size_t i, __m128i& a, __m128i& b, __m128i& c)const
+    {
+        __m128i zero = _mm_setzero_si128();
+        a = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(x+i)),zero);
+        b = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y+i)),zero);
+        c = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(z+i)),zero);
+    }
+#endif
+};
+
+struct Quantized10Reader
+{
+    const std::uint32_t* packed;
+
+    void Get(std::size_t i, std::uint32_t& a, std::uint32_t& b, std::uint32_t& c)const
+    {
+        std::uint32_t w = packed[i];
+        a = w&1023u;
+        b = (w>>10)&1023u;
+        c = (w>>20)&1023u;
+    }
+
+#if defined(TOOLS3D_SSE2)
+    void Get4(std::size_t i, __m128i& a, __m128i& b, __m128i& c)const
+    {
+        __m128i mask = _mm_set1_epi32(1023);
+        __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i*>(packed+i));
+        a = _mm_and_si128(w,mask);
+        b = _mm_and_si128(_mm_srli_epi32(w,10),mask);
+        c = _mm_and_si128(_mm_srli_epi32(w,20),mask);
+    }
+#endif
+};
+
+/**
+* Fused dequantise-and-transform kernel (scalar fallback)
+* m is the block matrix with the dequantisation folded in (see
+* QuantizedPointArray3D::BlockMatrix), so every point costs the integer
+* conversion plus the plain affine transform of TransformKernel.
+**/
+template<class T>
+struct DequantizeKernel
+{
+    template<class Reader>
+    static void Run(const Reader& q, std::size_t begin, std::size_t n, T* ox, T* oy, T* oz, const T m[12])
+    {
+        for(std::size_t i=0;i<n;i++)
+        {
+            std::uint32_t a, b, c;
+            q.Get(begin+i, a, b, c);
+            T px = T(a), py = T(b), pz = T(c);
+            ox[i] = px*m[0]+py*m[3]+pz*m[6]+m[9];
+            oy[i] = px*m[1]+py*m[4]+pz*m[7]+m[10];
+            oz[i] = px*m[2]+py*m[5]+pz*m[8]+m[11];
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* SIMD kernel for float: SSE2 widens the integers of four points at a time,
+* AVX converts and transforms two such groups per register
+**/
+template<>
+struct DequantizeKernel<float>
+{
+    template<class Reader>
+    static void Run(const Reader& q, std::size_t begin, std::size_t n, float* ox, float* oy, float* oz, const float m[12])
+    {
+        std::size_t i = 0;
+#if defined(TOOLS3D_AVX)
+        {
+            __m256 m0 = _mm256_set1_ps(m[0]), m1 = _mm256_set1_ps(m[1]), m2 = _mm256_set1_ps(m[2]);
+            __m256 m3 = _mm256_set1_ps(m[3]), m4 = _mm256_set1_ps(m[4]), m5 = _mm256_set1_ps(m[5]);
+            __m256 m6 = _mm256_set1_ps(m[6]), m7 = _mm256_set1_ps(m[7]), m8 = _mm256_set1_ps(m[8]);
+            __m256 m9 = _mm256_set1_ps(m[9]), m10 = _mm256_set1_ps(m[10]), m11 = _mm256_set1_ps(m[11]);
+            for(;i+8<=n;i+=8)
+            {
+                __m128i a0, b0, c0, a1, b1, c1;
+                q.Get4(begin+i, a0, b0, c0);
+                q.Get4(begin+i+4, a1, b1, c1);
+                __m256 px = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(a0),a1,1));
+                __m256 py = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(b0),b1,1));
+                __m256 pz = _mm256_cvtepi32_ps(_mm256_insertf128_si256(_mm256_castsi128_si256(c0),c1,1));
+                __m256 rx = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m0),_mm256_mul_ps(py,m3)),_mm256_mul_ps(pz,m6)),m9);
+                __m256 ry = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m1),_mm256_mul_ps(py,m4)),_mm256_mul_ps(pz,m7)),m10);
+                __m256 rz = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px,m2),_mm256_mul_ps(py,m5)),_mm256_mul_ps(pz,m8)),m11);
+                _mm256_storeu_ps(ox+i,rx);
+                _mm256_storeu_ps(oy+i,ry);
+                _mm256_storeu_ps(oz+i,rz);
+            }
+        }
+#endif
+        __m128 m0 = _mm_set1_ps(m[0]), m1 = _mm_set1_ps(m[1]), m2 = _mm_set1_ps(m[2]);
+        __m128 m3 = _mm_set1_ps(m[3]), m4 = _mm_set1_ps(m[4]), m5 = _mm_set1_ps(m[5]);
+        __m128 m6 = _mm_set1_ps(m[6]), m7 = _mm_set1_ps(m[7]), m8 = _mm_set1_ps(m[8]);
+        __m128 m9 = _mm_set1_ps(m[9]), m10 = _mm_set1_ps(m[10]), m11 = _mm_set1_ps(m[11]);
+        for(;i+4<=n;i+=4)
+        {
+            __m128i a, b, c;
+            q.Get4(begin+i, a, b, c);
+            __m128 px = _mm_cvtepi32_ps(a), py = _mm_cvtepi32_ps(b), pz = _mm_cvtepi32_ps(c);
+            __m128 rx = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m0),_mm_mul_ps(py,m3)),_mm_mul_ps(pz,m6)),m9);
+            __m128 ry = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m1),_mm_mul_ps(py,m4)),_mm_mul_ps(pz,m7)),m10);
+            __m128 rz = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(px,m2),_mm_mul_ps(py,m5)),_mm_mul_ps(pz,m8)),m11);
+            _mm_storeu_ps(ox+i,rx);
+            _mm_storeu_ps(oy+i,ry);
+            _mm_storeu_ps(oz+i,rz);
+        }
+        for(;i<n;i++)
+        {
+            std::uint32_t a, b, c;
+            q.Get(begin+i, a, b, c);
+            float px = float(a), py = float(b), pz = float(c);
+            ox[i] = px*m[0]+py*m[3]+pz*m[6]+m[9];
+            oy[i] = px*m[1]+py*m[4]+pz*m[7]+m[10];
+            oz[i] = px*m[2]+py*m[5]+pz*m[8]+m[11];
+        }
+    }
+};
+#endif
+
+}
+
+/**
+* Quantised Structure-of-Arrays point cloud
+* Points are split in blocks of a fixed number of points. Every block stores
+* its bounding box corner (offset) and grid step per axis, and every point
+* the integer grid coordinates q, so the decoded point is offset + q*step.
+* Rounding to the nearest grid point bounds the error per axis by half a step,
+* i.e. by (block extent)/(2*(2^bits-1)); MaxError() returns the bound over all
+* blocks. Decoding is fused with a transform: the block's offset and steps are
+* folded into the matrix, so Transform() costs no more than the plain
+* PointArray3D transform and full-precision copies are never made.
+**/
+template<class T>
+class QuantizedPointArray3D
+{
+public:
+    /**
+    * Quantisation settings
+    **/
+    struct Settings
+    {
+        QuantizedFormat format; // bits per component
+        std::size_t blockSize; // points per block (smaller blocks - smaller steps, more headers)
+
+        Settings():format(Quantized16),blockSize(1024){}
+    };
+
+private:
+    struct Block
+    {
+        T offset[3];
+        T step[3];
+    };
+
+    Settings settings;
+    std::size_t size;
+    std::vector<std::uint16_t> x, y, z; // Quantized16
+    std::vector<std::uint32_t> packed; // Quantized10
+    std::vector<Block> blocks;
+
+public:
+    /**
+    * Constructor
+    * Creates an empty array
+    * @param s - quantisation settings
+    **/
+    explicit QuantizedPointArray3D(const Settings& s = Settings()):settings(s),size(0)
+    {
+        settings.blockSize = std::max<std::size_t>(settings.blockSize, 1);
+    }
+
+    /**
+    * Constructor
+    * @param points - points to quantise
+    * @param s - quantisation settings
+    **/
+    QuantizedPointArray3D(const PointArray3D<T>& points, const Settings& s = Settings()):QuantizedPointArray3D(s)
+    {
+        Build(points);
+    }
+
+    /**
+    * Quantise a point cloud (replaces the contents)
+    * @param points - points to quantise
+    * @return bool - false (and an empty array) if a coordinate is not finite
+    **/
+    bool Build(const PointArray3D<T>& points)
+    {
+        Clear();
+        std::size_t n = points.Size();
+        const T* in[3] = {points.X(), points.Y(), points.Z()};
+        for(int c=0;c<3;c++)
+            for(std::size_t i=0;i<n;i++)
+                if(!std::isfinite(in[c][i]))
+                    return false;
+        size = n;
+        blocks.resize((n+settings.blockSize-1)/settings.blockSize);
+        if(settings.format == Quantized16)
+        {
+            x.resize(n);
+            y.resize(n);
+            z.resize(n);
+        }
+        else
+            packed.assign(n, 0);
+        std::uint16_t* out16[3] = {x.empty()?0:&x[0], y.empty()?0:&y[0], z.empty()?0:&z[0]};
+        const T levels = T(Levels());
+        detail::ParallelFor(0, blocks.size(), std::max<std::size_t>(1, detail::BatchGrain()/settings.blockSize), 0,
+                            [&](std::size_t first, std::size_t last) {
+            for(std::size_t k=first;k<last;k++)
+            {
+                std::size_t b = k*settings.blockSize, e = std::min(n, b+settings.blockSize);
+                Block& block = blocks[k];
+                for(int c=0;c<3;c++)
+                {
+                    T lo = *std::min_element(in[c]+b, in[c]+e), hi = *std::max_element(in[c]+b, in[c]+e);
+                    block.offset[c] = lo;
+                    block.step[c] = (hi-lo)/levels;
+                    // a flat block (or one too thin to resolve) stores only zeros
+                    T inverse = (block.step[c] > T(0))?T(1)/block.step[c]:T(0);
+                    for(std::size_t i=b;i<e;i++)
+                    {
+                        T v = std::floor((in[c][i]-lo)*inverse+T(0.5));
+                        std::uint32_t q = std::uint32_t(std::min(std::max(v, T(0)), levels));
+                        if(settings.format == Quantized16)
+                            out16[c][i] = std::uint16_t(q);
+                        else
+                            packed[i] |= q<<(10*c);
+                    }
+                }
+            }
+        });
+        return true;
+    }
+
+    /**
+    * Quantise a point cloud given as AoS points
+    * @param points - points to quantise
+    * @return bool - false (and an empty array) if a coordinate is not finite
+    **/
+    bool Build(const std::vector<Vector3D<T> >& points)
+    {
+        return Build(PointArray3D<T>(points));
+    }
+
+    /**
+    * Remove all points
+    **/
+    void Clear()
+    {
+        size = 0;
+        x.clear();
+        y.clear();
+        z.clear();
+        packed.clear();
+        blocks.clear();
+    }
+
+    /**
+    * Get number of points
+    * @return std::size_t - the number of points
+    **/
+    std::size_t Size()const {return size;}
+
+    /**
+    * Test if array is empty?
+    * @return bool - true if there are no points
+    **/
+    bool Empty()const {return size == 0;}
+
+    /**
+    * Get settings
+    * @return Settings - format and block size
+    **/
+    const Settings& GetSettings()const {return settings;}
+
+    /**
+    * Get number of blocks
+    * @return std::size_t - the number of blocks
+    **/
+    std::size_t BlockCount()const {return blocks.size();}
+
+    /**
+    * Get storage size
+    * @return std::size_t - bytes used by the coordinates and block headers
+    **/
+    std::size_t Bytes()const
+    {
+        return 3*x.size()*sizeof(std::uint16_t)+packed.size()*sizeof(std::uint32_t)+blocks.size()*sizeof(Block);
+    }
+
+    /**
+    * Get a decoded point
+    * @param i - point index
+    * @return Vector3D - offset + q*step of the point's block
+    **/
+    Vector3D<T> Get(std::size_t i)const
+    {
+        T m[12];
+        BlockMatrix(i/settings.blockSize, Matrix3D<T>(), m);
+        T p[3];
+        if(settings.format == Quantized16)
+            detail::DequantizeKernel<T>::Run(Reader16(), i, 1, p, p+1, p+2, m);
+        else
+            detail::DequantizeKernel<T>::Run(Reader10(), i, 1, p, p+1, p+2, m);
+        return Vector3D<T>(p[0], p[1], p[2]);
+    }
+
+    /**
+    * Get the quantisation error bound
+    * @return Vector3D - per axis, the largest half step over all blocks: every
+    * decoded coordinate is within this of the input (plus rounding of T)
+    **/
+    Vector3D<T> MaxError()const
+    {
+        T e[3] = {0, 0, 0};
+        for(std::size_t k=0;k<blocks.size();k++)
+            for(int c=0;c<3;c++)
+                e[c] = std::max(e[c], blocks[k].step[c]*T(0.5));
+        return Vector3D<T>(e[0], e[1], e[2]);
+    }
+
+    /**
+    * Get the quantisation error bound after a transform
+    * @param mat - affine transformation matrix
+    * @return Vector3D - per axis, MaxError() mapped through |mat|: every
+    * transformed decoded coordinate is within this of the transformed input
+    * (plus rounding of T)
+    **/
+    Vector3D<T> MaxError(const Matrix3D<T>& mat)const
+    {
+        Vector3D<T> e = MaxError();
+        T r[3];
+        for(int j=0;j<3;j++)
+            r[j] = e.X()*std::abs(mat(0,j))+e.Y()*std::abs(mat(1,j))+e.Z()*std::abs(mat(2,j));
+        return Vector3D<T>(r[0], r[1], r[2]);
+    }
+
+    /**
+    * Decode and transform all points in one pass (see detail::DequantizeKernel)
+    * @param out - output, transformed points (resized to Size())
+    * @param mat - affine transformation matrix
+    **/
+    void Transform(PointArray3D<T>& out, const Matrix3D<T>& mat)const
+    {
+        out.Resize(size);
+        T* ox = out.X();
+        T* oy = out.Y();
+        T* oz = out.Z();
+        std::size_t grain = std::max<std::size_t>(1, detail::BatchGrain()/settings.blockSize);
+        detail::ParallelFor(0, blocks.size(), grain, 0, [&](std::size_t first, std::size_t last) {
+            for(std::size_t k=first;k<last;k++)
+            {
+                std::size_t b = k*settings.blockSize, n = std::min(size, b+settings.blockSize)-b;
+                T m[12];
+                BlockMatrix(k, mat, m);
+                if(settings.format == Quantized16)
+                    detail::DequantizeKernel<T>::Run(Reader16(), b, n, ox+b, oy+b, oz+b, m);
+                else
+                    detail::DequantizeKernel<T>::Run(Reader10(), b, n, ox+b, oy+b, oz+b, m);
+            }
+        });
+    }
+
+    /**
+    * Decode all points
+    * @param out - output, decoded points (resized to Size())
+    **/
+    void Decode(PointArray3D<T>& out)const
+    {
+        Transform(out, Matrix3D<T>());
+    }
+
+private:
+    std::uint32_t Levels()const
+    {
+        return (settings.format == Quantized16)?65535u:1023u;
+    }
+
+    detail::Quantized16Reader Reader16()const
+    {
+        detail::Quantized16Reader r = {x.empty()?0:&x[0], y.empty()?0:&y[0], z.empty()?0:&z[0]};
+        return r;
+    }
+
+    detail::Quantized10Reader Reader10()const
+    {
+        detail::Quantized10Reader r = {packed.empty()?0:&packed[0]};
+        return r;
+    }
+
+    /**
+    * Fold a block's dequantisation into a transform
+    * (offset + q*step)*mat = q*(diag(step)*mat) + offset*mat
+    * @param k - block index
+    * @param mat - affine transformation matrix
+    * @param m - output, the packed 4x3 block matrix (layout of detail::PackAffine)
+    **/
+    void BlockMatrix(std::size_t k, const Matrix3D<T>& mat, T m[12])const
+    {
+        const Block& block = blocks[k];
+        for(int j=0;j<3;j++)
+        {
+            for(int r=0;r<3;r++)
+                m[r*3+j] = block.step[r]*mat(r,j);
+            m[9+j] = block.offset[0]*mat(0,j)+block.offset[1]*mat(1,j)+block.offset[2]*mat(2,j)+mat(3,j);
+        }
+    }
+};
+
+/**
+* Decode and transform a quantised point cloud
+* @param in - quantised points
+* @param out - output, transformed points (resized to in.Size())
+* @param mat - affine transformation matrix
+**/
+template<class T>
+void Transform(const QuantizedPointArray3D<T>& in, PointArray3D<T>& out, const Matrix3D<T>& mat)
+{
+    in.Transform(out, mat);
+}
+
+typedef QuantizedPointArray3D<double> QuantizedPointArray3Dd;
+typedef QuantizedPointArray3D<float> QuantizedPointArray3Df;
+
+}
+
+#endif
@@ -0,0 +1,357 @@
+#ifndef QUATERNION_HPP
+#define QUATERNION_HPP
+
+/**
+* Includes
+**/
+#include <cmath>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Simple Quaternion Class for handling Orientations
+* (w - scalar part, x,y,z - vector part)
+* Follows the row-vector convention of Matrix3D:
+* q1*q2 is the rotation q1 followed by q2, so (q1*q2).ToMatrix() == q1.ToMatrix()*q2.ToMatrix()
+* (this is the Hamilton product q2 q1)
+**/
+template<class T>
+class Quaternion
+{
+private:
+    T w; // scalar part
+    T x; // x component of vector part
+    T y; // y component of vector part
+    T z; // z component of vector part
+public:
+    /**
+    * Default Constructor
+    * Initializes to the Identity rotation (1,0,0,0)
+    **/
+    constexpr Quaternion():w(1),x(0),y(0),z(0){}
+
+    /**
+    * Constructor
+    * @param a - value to be assigned to w
+    * @param b - value to be assigned to x
+    * @param c - value to be assigned to y
+    * @param d - value to be assigned to z
+    **/
+    constexpr Quaternion(const T& a, const T& b, const T& c, const T& d):w(a),x(b),y(c),z(d){}
+
+    /**
+    * Get Quaternion rotating around an axis
+    * @param axis - rotation axis (does not need to be normalized)
+    * @param angle - angle in radians
+    * @return Quaternion - the rotation
+    **/
+    static Quaternion FromAxisAngle(const Vector3D<T>& axis, T angle)
+    {
+        Vector3D<T> n = axis;
+        n.Normalize();
+        T s = T(sin(angle*T(0.5)));
+        return Quaternion(T(cos(angle*T(0.5))), n.X()*s, n.Y()*s, n.Z()*s);
+    }
+
+    /**
+    * Get Quaternion of the rotation part of a Matrix
+    * The 3x3 block is assumed to be a rotation (orthonormal, determinant 1)
+    * @param mat - matrix to convert
+    * @return Quaternion - the rotation
+    **/
+    static Quaternion FromMatrix(const Matrix3D<T>& mat)
+    {
+        // Shepperd's method: pivot on the largest of w,x,y,z for stability
+        T trace = mat(0,0)+mat(1,1)+mat(2,2);
+        if(trace > 0)
+        {
+            T s = T(0.5)/T(sqrt(trace+T(1)));
+            return Quaternion(T(0.25)/s, (mat(1,2)-mat(2,1))*s, (mat(2,0)-mat(0,2))*s, (mat(0,1)-mat(1,0))*s);
+        }
+        if(mat(0,0) > mat(1,1) && mat(0,0) > mat(2,2))
+        {
+            T s = T(2)*T(sqrt(T(1)+mat(0,0)-mat(1,1)-mat(2,2)));
+            return Quaternion((mat(1,2)-mat(2,1))/s, T(0.25)*s, (mat(1,0)+mat(0,1))/s, (mat(2,0)+mat(0,2))/s);
+        }
+        if(mat(1,1) > mat(2,2))
+        {
+            T s = T(2)*T(sqrt(T(1)+mat(1,1)-mat(0,0)-mat(2,2)));
+            return Quaternion((mat(2,0)-mat(0,2))/s, (mat(1,0)+mat(0,1))/s, T(0.25)*s, (mat(2,1)+mat(1,2))/s);
+        }
+        T s = T(2)*T(sqrt(T(1)+mat(2,2)-mat(0,0)-mat(1,1)));
+        return Quaternion((mat(0,1)-mat(1,0))/s, (mat(2,0)+mat(0,2))/s, (mat(2,1)+mat(1,2))/s, T(0.25)*s);
+    }
+
+    /**
+    * Get components
+    * @return T - the component value
+    **/
+    constexpr T W()const {return w;}
+    constexpr T X()const {return x;}
+    constexpr T Y()const {return y;}
+    constexpr T Z()const {return z;}
+
+    /**
+    * Set components
+    * @param a - value to set
+    **/
+    constexpr void SetW(T a) {w=a;}
+    constexpr void SetX(T a) {x=a;}
+    constexpr void SetY(T a) {y=a;}
+    constexpr void SetZ(T a) {z=a;}
+
+    /**
+    * Get Vector part
+    * @return Vector3D - (x,y,z)
+    **/
+    constexpr Vector3D<T> Vector()const {return Vector3D<T>(x,y,z);}
+
+    /**
+    * Dot product with other quaternion
+    * @param other - quaternion to compute dot with
+    * @return T - the dot product
+    **/
+    constexpr T Dot(const Quaternion& other)const {return w*other.w+x*other.x+y*other.y+z*other.z;}
+
+    /**
+    * Get Length Squared of Quaternion
+    * @return T - the squared norm
+    **/
+    constexpr T LengthSq()const {return Dot(*this);}
+
+    /**
+    * Get Length of Quaternion
+    * @return T - the norm
+    **/
+    T Length()const {return T(sqrt(LengthSq()));}
+
+    /**
+    * Normalize quaternion (only if length not zero)
+    **/
+    void Normalize()
+    {
+        T length = Length();
+        if(length > std::numeric_limits<T>::epsilon())
+        {
+            w /= length;
+            x /= length;
+            y /= length;
+            z /= length;
+        }
+    }
+
+    /**
+    * Get Conjugate (w,-x,-y,-z) - the inverse rotation for unit quaternions
+    * @return Quaternion - the conjugate
+    **/
+    constexpr Quaternion Conjugate()const {return Quaternion(w,-x,-y,-z);}
+
+    /**
+    * Rotate a vector (the quaternion must be unit length)
+    * Same result as vec*ToMatrix(), using two cross products
+    * @param vec - vector to rotate
+    * @return Vector3D - the rotated vector
+    **/
+    constexpr Vector3D<T> Rotate(const Vector3D<T>& vec)const
+    {
+        // t = 2*cross(q,v); v' = v + w*t + cross(q,t)
+        T tx = T(2)*(y*vec.Z()-z*vec.Y());
+        T ty = T(2)*(z*vec.X()-x*vec.Z());
+        T tz = T(2)*(x*vec.Y()-y*vec.X());
+        return Vector3D<T>(vec.X()+w*tx+(y*tz-z*ty),
+                           vec.Y()+w*ty+(z*tx-x*tz),
+                           vec.Z()+w*tz+(x*ty-y*tx));
+    }
+
+    /**
+    * Get rotation Matrix (the quaternion must be unit length)
+    * @return Matrix3D - the rotation matrix
+    **/
+    constexpr Matrix3D<T> ToMatrix()const
+    {
+        T xx = x*x, yy = y*y, zz = z*z;
+        T xy = x*y, xz = x*z, yz = y*z;
+        T wx = w*x, wy = w*y, wz = w*z;
+        return Matrix3D<T>(1-2*(yy+zz),   2*(xy+wz),   2*(xz-wy), 0,
+                             2*(xy-wz), 1-2*(xx+zz),   2*(yz+wx), 0,
+                             2*(xz+wy),   2*(yz-wx), 1-2*(xx+yy), 0,
+                                     0,           0,           0, 1);
+    }
+
+    /**
+    * Overload basic operators
+    * mathematic operators (*)
+    * equality operators (==,!=)
+    **/
+
+    // Composition: this rotation followed by other
+    constexpr const Quaternion& operator*=(const Quaternion& other)
+    {
+        T nw = other.w*w-other.x*x-other.y*y-other.z*z;
+        T nx = other.w*x+other.x*w+other.y*z-other.z*y;
+        T ny = other.w*y-other.x*z+other.y*w+other.z*x;
+        T nz = other.w*z+other.x*y-other.y*x+other.z*w;
+        w = nw;
+        x = nx;
+        y = ny;
+        z = nz;
+        return *this;
+    }
+
+    constexpr const Quaternion& operator*=(const T& other)
+    {
+        w *= other;
+        x *= other;
+        y *= other;
+        z *= other;
+        return *this;
+    }
+
+    constexpr bool operator==(const Quaternion& other)const
+    {
+        return (w==other.w)&&(x==other.x)&&(y==other.y)&&(z==other.z);
+    }
+    constexpr bool operator!=(const Quaternion& other)const
+    {
+        return !((*this)==other);
+    }
+};
+
+/**
+* Functions Overloading basic operators
+* mathematic operators
+**/
+
+template<class T>
+constexpr Quaternion<T> operator*(const Quaternion<T>& q1, const Quaternion<T>& q2)
+{
+    Quaternion<T> res = q1;
+    res *= q2;
+    return res;
+}
+
+template<class T>
+constexpr Vector3D<T> operator*(const Vector3D<T>& vec, const Quaternion<T>& q)
+{
+    return q.Rotate(vec);
+}
+
+/**
+* Normalized linear interpolation (takes the shortest path)
+* @param a - start orientation (unit)
+* @param b - end orientation (unit)
+* @param t - interpolation parameter in [0,1]
+* @return Quaternion - the interpolated unit quaternion
+**/
+template<class T>
+Quaternion<T> Nlerp(const Quaternion<T>& a, const Quaternion<T>& b, T t)
+{
+    T sign = (a.Dot(b) < 0)?T(-1):T(1);
+    T wa = T(1)-t, wb = t*sign;
+    Quaternion<T> res(a.W()*wa+b.W()*wb, a.X()*wa+b.X()*wb, a.Y()*wa+b.Y()*wb, a.Z()*wa+b.Z()*wb);
+    res.Normalize();
+    return res;
+}
+
+/**
+* Spherical linear interpolation (takes the shortest path)
+* Falls back to Nlerp when the orientations are nearly equal
+* @param a - start orientation (unit)
+* @param b - end orientation (unit)
+* @param t - interpolation parameter in [0,1]
+* @return Quaternion - the interpolated unit quaternion
+**/
+template<class T>
+Quaternion<T> Slerp(const Quaternion<T>& a, const Quaternion<T>& b, T t)
+{
+    T cosTheta = a.Dot(b);
+    T sign = T(1);
+    if(cosTheta < 0)
+    {
+        cosTheta = -cosTheta;
+        sign = T(-1);
+    }
+    if(cosTheta > T(0.9995))
+        return Nlerp(a, b, t);
+    // sin(theta) from cos(theta) saves one of the three sin evaluations
+    T theta = std::acos(cosTheta);
+    T invSin = T(1)/std::sqrt(T(1)-cosTheta*cosTheta);
+    T wa = std::sin((T(1)-t)*theta)*invSin;
+    T wb = std::sin(t*theta)*invSin*sign;
+    return Quaternion<T>(a.W()*wa+b.W()*wb, a.X()*wa+b.X()*wb, a.Y()*wa+b.Y()*wb, a.Z()*wa+b.Z()*wb);
+}
+
+/**
+* Batch normalized linear interpolation between two keyframe poses
+* out[i] = Nlerp(a[i], b[i], t) for i in [0,n)
+* @param a - start keyframe orientations
+* @param b - end keyframe orientations
+* @param t - interpolation parameter in [0,1]
+* @param out - interpolated orientations (may be the same array as a or b)
+* @param n - number of orientations
+**/
+template<class T>
+void Nlerp(const Quaternion<T>* a, const Quaternion<T>* b, T t, Quaternion<T>* out, std::size_t n)
+{
+    detail::ParallelBatch(n, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i=begin;i<end;i++)
+            out[i] = Nlerp(a[i], b[i], t);
+    });
+}
+
+/**
+* Batch spherical linear interpolation between two keyframe poses
+* out[i] = Slerp(a[i], b[i], t) for i in [0,n)
+* @param a - start keyframe orientations
+* @param b - end keyframe orientations
+* @param t - interpolation parameter in [0,1]
+* @param out - interpolated orientations (may be the same array as a or b)
+* @param n - number of orientations
+**/
+template<class T>
+void Slerp(const Quaternion<T>* a, const Quaternion<T>* b, T t, Quaternion<T>* out, std::size_t n)
+{
+    detail::ParallelBatch(n, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i=begin;i<end;i++)
+            out[i] = Slerp(a[i], b[i], t);
+    });
+}
+
+/**
+* Batch interpolation of std::vector keyframe poses
+* @param a - start keyframe orientations
+* @param b - end keyframe orientations (same size as a)
+* @param t - interpolation parameter in [0,1]
+* @param out - interpolated orientations (resized to match a)
+* @return bool - false if a and b differ in size (out is left unchanged)
+**/
+template<class T>
+bool Nlerp(const std::vector<Quaternion<T> >& a, const std::vector<Quaternion<T> >& b, T t, std::vector<Quaternion<T> >& out)
+{
+    if(a.size() != b.size())
+        return false;
+    out.resize(a.size());
+    Nlerp(a.data(), b.data(), t, out.data(), a.size());
+    return true;
+}
+
+template<class T>
+bool Slerp(const std::vector<Quaternion<T> >& a, const std::vector<Quaternion<T> >& b, T t, std::vector<Quaternion<T> >& out)
+{
+    if(a.size() != b.size())
+        return false;
+    out.resize(a.size());
+    Slerp(a.data(), b.data(), t, out.data(), a.size());
+    return true;
+}
+
+typedef Quaternion<double> Quaterniond;
+typedef Quaternion<float> Quaternionf;
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef RAY_HPP
+#define RAY_HPP
+
+/**
+* Includes
+**/
+#include <limits>
+#include <3DTools/Vector3D.hpp>
+
+namespace Tools3D {
+
+/**
+* Simple Ray Class (half-line origin + t*direction, t >= 0)
+* The direction does not need to be normalized; t is measured in units of it
+**/
+template<class T>
+class Ray
+{
+private:
+    Vector3D<T> origin; // starting point
+    Vector3D<T> direction; // direction of the ray
+public:
+    /**
+    * Default Constructor
+    * Ray from the origin along the positive z-axis
+    **/
+    constexpr Ray():origin(),direction(0,0,1){}
+
+    /**
+    * Constructor
+    * @param o - starting point
+    * @param d - direction
+    **/
+    constexpr Ray(const Vector3D<T>& o, const Vector3D<T>& d):origin(o),direction(d){}
+
+    /**
+    * Get starting point
+    * @return Vector3D - the origin
+    **/
+    constexpr const Vector3D<T>& Origin()const {return origin;}
+
+    /**
+    * Get direction
+    * @return Vector3D - the direction
+    **/
+    constexpr const Vector3D<T>& Direction()const {return direction;}
+
+    /**
+    * Set starting point
+    * @param o - the origin
+    **/
+    constexpr void SetOrigin(const Vector3D<T>& o) {origin=o;}
+
+    /**
+    * Set direction
+    * @param d - the direction
+    **/
+    constexpr void SetDirection(const Vector3D<T>& d) {direction=d;}
+
+    /**
+    * Get point along the ray
+    * @param t - ray parameter
+    * @return Vector3D - origin + t*direction
+    **/
+    constexpr Vector3D<T> Point(T t)const
+    {
+        return Vector3D<T>(origin.X()+t*direction.X(), origin.Y()+t*direction.Y(), origin.Z()+t*direction.Z());
+    }
+};
+
+/**
+* Closest intersection of a ray with a set of triangles
+* t - ray parameter of the hit, (u,v) - barycentric coordinates of the hit
+* (point = (1-u-v)*v0 + u*v1 + v*v2), triangle - index of the triangle hit
+**/
+template<class T>
+struct RayHit
+{
+    T t;
+    T u;
+    T v;
+    std::size_t triangle;
+
+    /**
+    * Default Constructor
+    * No hit (t = infinity)
+    **/
+    constexpr RayHit():t(std::numeric_limits<T>::infinity()),u(0),v(0),triangle(std::numeric_limits<std::size_t>::max()){}
+
+    /**
+    * Test if something was hit?
+    * @return bool - true if there is a hit
+    **/
+    constexpr bool Hit()const {return triangle != std::numeric_limits<std::size_t>::max();}
+};
+
+typedef Ray<double> Rayd;
+typedef Ray<float> Rayf;
+
+}
+
+#endif
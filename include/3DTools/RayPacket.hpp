@@ -0,0 +1,481 @@
+#ifndef RAY_PACKET_HPP
+#define RAY_PACKET_HPP
+
+/**
+* Includes
+* Packet ray/triangle intersection: one ray against several triangles or
+* several rays against one triangle per instruction (SSE: 4 float/2 double
+* lanes, AVX: 8 float/4 double lanes)
+**/
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Ray.hpp>
+#include <3DTools/Intersections3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Structure-of-Arrays container of triangles
+* Stores v0, e1 = v1-v0 and e2 = v2-v0 per triangle in separate
+* SIMDAlignment-aligned buffers (the layout IntersectRayTriangleEdges uses)
+**/
+template<class T>
+class TriangleArray3D
+{
+public:
+    typedef std::vector<T, AlignedAllocator<T> > Buffer;
+private:
+    Buffer data[9]; // v0.x, v0.y, v0.z, e1.x, e1.y, e1.z, e2.x, e2.y, e2.z
+public:
+    /**
+    * Default Constructor
+    * Creates an empty array
+    **/
+    TriangleArray3D(){}
+
+    /**
+    * Constructor
+    * @param vertices - vertex positions
+    * @param indices - three vertex indices per triangle (empty - every three vertices form a triangle)
+    **/
+    TriangleArray3D(const std::vector<Vector3D<T> >& vertices, const std::vector<std::uint32_t>& indices)
+    {
+        std::size_t n = indices.empty()?vertices.size()/3:indices.size()/3;
+        Reserve(n);
+        for(std::size_t i=0;i<n;i++)
+        {
+            if(indices.empty())
+                PushBack(vertices[3*i], vertices[3*i+1], vertices[3*i+2]);
+            else
+                PushBack(vertices[indices[3*i]], vertices[indices[3*i+1]], vertices[indices[3*i+2]]);
+        }
+    }
+
+    /**
+    * Get number of triangles
+    * @return std::size_t - the number of triangles
+    **/
+    std::size_t Size()const {return data[0].size();}
+
+    /**
+    * Test if array is empty?
+    * @return bool - true if there are no triangles
+    **/
+    bool Empty()const {return data[0].empty();}
+
+    /**
+    * Reserve storage for triangles
+    * @param n - number of triangles to reserve
+    **/
+    void Reserve(std::size_t n) {for(int k=0;k<9;k++) data[k].reserve(n);}
+
+    /**
+    * Remove all triangles
+    **/
+    void Clear() {for(int k=0;k<9;k++) data[k].clear();}
+
+    /**
+    * Append a triangle
+    * @param v0 - first vertex
+    * @param v1 - second vertex
+    * @param v2 - third vertex
+    **/
+    void PushBack(const Vector3D<T>& v0, const Vector3D<T>& v1, const Vector3D<T>& v2)
+    {
+        Vector3D<T> e1 = v1-v0, e2 = v2-v0;
+        T values[9] = {v0.X(), v0.Y(), v0.Z(), e1.X(), e1.Y(), e1.Z(), e2.X(), e2.Y(), e2.Z()};
+        for(int k=0;k<9;k++)
+            data[k].push_back(values[k]);
+    }
+
+    /**
+    * Get first vertex and edges of a triangle
+    * @param i - index of the triangle
+    * @return Vector3D - v0, v1-v0 or v2-v0
+    **/
+    Vector3D<T> V0(std::size_t i)const {return Vector3D<T>(data[0][i],data[1][i],data[2][i]);}
+    Vector3D<T> E1(std::size_t i)const {return Vector3D<T>(data[3][i],data[4][i],data[5][i]);}
+    Vector3D<T> E2(std::size_t i)const {return Vector3D<T>(data[6][i],data[7][i],data[8][i]);}
+
+    /**
+    * Get raw component buffer (aligned to SIMDAlignment)
+    * @param k - component (0-2 v0, 3-5 e1, 6-8 e2; x,y,z in each)
+    * @return T* - pointer to the first value
+    **/
+    const T* Component(int k)const {return data[k].empty()?0:&data[k][0];}
+};
+
+/**
+* Structure-of-Arrays container of rays and their closest hits
+* Origins, directions and hit records live in separate aligned buffers;
+* hits start at t = infinity (or the tMax given) and are updated by IntersectRays
+**/
+template<class T>
+class RayArray3D
+{
+public:
+    typedef std::vector<T, AlignedAllocator<T> > Buffer;
+private:
+    Buffer data[9]; // origin x,y,z, direction x,y,z, hit t,u,v
+    std::vector<std::size_t> triangle; // triangle hit (SIZE_MAX - none)
+public:
+    /**
+    * Default Constructor
+    * Creates an empty array
+    **/
+    RayArray3D(){}
+
+    /**
+    * Constructor
+    * @param rays - AoS rays to copy from (no hits)
+    **/
+    explicit RayArray3D(const std::vector<Ray<T> >& rays)
+    {
+        Reserve(rays.size());
+        for(std::size_t i=0;i<rays.size();i++)
+            PushBack(rays[i]);
+    }
+
+    /**
+    * Get number of rays
+    * @return std::size_t - the number of rays
+    **/
+    std::size_t Size()const {return triangle.size();}
+
+    /**
+    * Test if array is empty?
+    * @return bool - true if there are no rays
+    **/
+    bool Empty()const {return triangle.empty();}
+
+    /**
+    * Reserve storage for rays
+    * @param n - number of rays to reserve
+    **/
+    void Reserve(std::size_t n)
+    {
+        for(int k=0;k<9;k++)
+            data[k].reserve(n);
+        triangle.reserve(n);
+    }
+
+    /**
+    * Remove all rays
+    **/
+    void Clear()
+    {
+        for(int k=0;k<9;k++)
+            data[k].clear();
+        triangle.clear();
+    }
+
+    /**
+    * Append a ray
+    * @param ray - ray to append
+    * @param tMax - ignore hits farther than this
+    **/
+    void PushBack(const Ray<T>& ray, T tMax = std::numeric_limits<T>::infinity())
+    {
+        T values[9] = {ray.Origin().X(), ray.Origin().Y(), ray.Origin().Z(),
+                       ray.Direction().X(), ray.Direction().Y(), ray.Direction().Z(), tMax, T(0), T(0)};
+        for(int k=0;k<9;k++)
+            data[k].push_back(values[k]);
+        triangle.push_back(std::numeric_limits<std::size_t>::max());
+    }
+
+    /**
+    * Forget all hits
+    * @param tMax - ignore hits farther than this
+    **/
+    void ResetHits(T tMax = std::numeric_limits<T>::infinity())
+    {
+        std::fill(data[6].begin(), data[6].end(), tMax);
+        std::fill(data[7].begin(), data[7].end(), T(0));
+        std::fill(data[8].begin(), data[8].end(), T(0));
+        std::fill(triangle.begin(), triangle.end(), std::numeric_limits<std::size_t>::max());
+    }
+
+    /**
+    * Get a ray
+    * @param i - index of the ray
+    * @return Ray - the i-th ray
+    **/
+    Ray<T> Get(std::size_t i)const
+    {
+        return Ray<T>(Vector3D<T>(data[0][i],data[1][i],data[2][i]), Vector3D<T>(data[3][i],data[4][i],data[5][i]));
+    }
+
+    /**
+    * Get closest hit of a ray
+    * @param i - index of the ray
+    * @return RayHit - the hit (Hit() is false if nothing was hit)
+    **/
+    RayHit<T> GetHit(std::size_t i)const
+    {
+        RayHit<T> hit;
+        if(triangle[i] != std::numeric_limits<std::size_t>::max())
+        {
+            hit.t = data[6][i];
+            hit.u = data[7][i];
+            hit.v = data[8][i];
+            hit.triangle = triangle[i];
+        }
+        return hit;
+    }
+
+    /**
+    * Get raw component buffer (aligned to SIMDAlignment)
+    * @param k - component (0-2 origin, 3-5 direction, 6-8 hit t,u,v)
+    * @return T* - pointer to the first value
+    **/
+    T* Component(int k) {return data[k].empty()?0:&data[k][0];}
+    const T* Component(int k)const {return data[k].empty()?0:&data[k][0];}
+
+    /**
+    * Get triangle hit buffer
+    * @return std::size_t* - pointer to the first triangle index
+    **/
+    std::size_t* Triangles() {return triangle.empty()?0:&triangle[0];}
+    const std::size_t* Triangles()const {return triangle.empty()?0:&triangle[0];}
+};
+
+typedef TriangleArray3D<double> TriangleArray3Dd;
+typedef TriangleArray3D<float> TriangleArray3Df;
+typedef RayArray3D<double> RayArray3Dd;
+typedef RayArray3D<float> RayArray3Df;
+
+namespace detail {
+
+/**
+* Packet Moller-Trumbore kernel
+* Width == 1 is the scalar reference (IntersectRayTriangleEdges, i.e. Vector3D::Cross/Dot);
+* the SIMD version evaluates the same expressions in the same order per lane
+**/
+template<class T, int Width>
+struct PacketKernel;
+
+template<class T>
+struct PacketKernel<T,1>
+{
+    static void RayTriangles(const Ray<T>& ray, const TriangleArray3D<T>& tris, std::size_t begin, std::size_t end, RayHit<T>& hit)
+    {
+        for(std::size_t i=begin;i<end;i++)
+        {
+            T t, u, v;
+            if(IntersectRayTriangleEdges(ray, tris.V0(i), tris.E1(i), tris.E2(i), t, u, v) && t < hit.t)
+            {
+                hit.t = t;
+                hit.u = u;
+                hit.v = v;
+                hit.triangle = i;
+            }
+        }
+    }
+
+    static void RaysTriangle(RayArray3D<T>& rays, std::size_t begin, std::size_t end, const Vector3D<T>& v0, const Vector3D<T>& e1, const Vector3D<T>& e2, std::size_t triangle)
+    {
+        T* th = rays.Component(6);
+        T* uh = rays.Component(7);
+        T* vh = rays.Component(8);
+        std::size_t* tri = rays.Triangles();
+        for(std::size_t i=begin;i<end;i++)
+        {
+            T t, u, v;
+            if(IntersectRayTriangleEdges(rays.Get(i), v0, e1, e2, t, u, v) && t < th[i])
+            {
+                th[i] = t;
+                uh[i] = u;
+                vh[i] = v;
+                tri[i] = triangle;
+            }
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<class T, int Width>
+struct PacketKernel
+{
+    typedef SimdOps<T,Width> Ops;
+    typedef typename Ops::V V;
+
+    static V Dot(V ax, V ay, V az, V bx, V by, V bz)
+    {
+        return Ops::Add(Ops::Add(Ops::Mul(ax,bx), Ops::Mul(ay,by)), Ops::Mul(az,bz));
+    }
+
+    /**
+    * Test Width ray/triangle pairs, returns the mask of lanes hit at 0 <= t < tMax
+    **/
+    static V Test(const V o[3], const V d[3], const V v0[3], const V e1[3], const V e2[3], V tMax, V& t, V& u, V& v)
+    {
+        V zero = Ops::Set1(T(0));
+        // p = d x e2, det = e1.p
+        V px = Ops::Sub(Ops::Mul(d[1],e2[2]), Ops::Mul(d[2],e2[1]));
+        V py = Ops::Sub(Ops::Mul(d[2],e2[0]), Ops::Mul(d[0],e2[2]));
+        V pz = Ops::Sub(Ops::Mul(d[0],e2[1]), Ops::Mul(d[1],e2[0]));
+        V det = Dot(e1[0], e1[1], e1[2], px, py, pz);
+        // s = o - v0, q = s x e1
+        V sx = Ops::Sub(o[0],v0[0]), sy = Ops::Sub(o[1],v0[1]), sz = Ops::Sub(o[2],v0[2]);
+        V qx = Ops::Sub(Ops::Mul(sy,e1[2]), Ops::Mul(sz,e1[1]));
+        V qy = Ops::Sub(Ops::Mul(sz,e1[0]), Ops::Mul(sx,e1[2]));
+        V qz = Ops::Sub(Ops::Mul(sx,e1[1]), Ops::Mul(sy,e1[0]));
+        V uDet = Dot(sx, sy, sz, px, py, pz);
+        V vDet = Dot(d[0], d[1], d[2], qx, qy, qz);
+        V tDet = Dot(e2[0], e2[1], e2[2], qx, qy, qz);
+        // flip to det > 0 (xor with the sign bit of det)
+        V sign = Ops::And(det, Ops::Set1(T(-0.0)));
+        det = Ops::Xor(det, sign);
+        uDet = Ops::Xor(uDet, sign);
+        vDet = Ops::Xor(vDet, sign);
+        tDet = Ops::Xor(tDet, sign);
+        V mask = Ops::And(Ops::Gt(det,zero), Ops::And(Ops::Le(zero,uDet), Ops::Le(zero,vDet)));
+        mask = Ops::And(mask, Ops::And(Ops::Le(Ops::Add(uDet,vDet),det), Ops::Le(zero,tDet)));
+        t = u = v = zero;
+        if(!Ops::AnySet(mask))
+            return mask;
+        V invDet = Ops::Div(Ops::Set1(T(1)), det);
+        t = Ops::Mul(tDet,invDet);
+        u = Ops::Mul(uDet,invDet);
+        v = Ops::Mul(vDet,invDet);
+        return Ops::And(mask, Ops::Lt(t,tMax));
+    }
+
+    static void RayTriangles(const Ray<T>& ray, const TriangleArray3D<T>& tris, std::size_t begin, std::size_t end, RayHit<T>& hit)
+    {
+        V o[3] = {Ops::Set1(ray.Origin().X()), Ops::Set1(ray.Origin().Y()), Ops::Set1(ray.Origin().Z())};
+        V d[3] = {Ops::Set1(ray.Direction().X()), Ops::Set1(ray.Direction().Y()), Ops::Set1(ray.Direction().Z())};
+        const T* c[9];
+        for(int k=0;k<9;k++)
+            c[k] = tris.Component(k);
+        V tMax = Ops::Set1(hit.t);
+        std::size_t i = begin;
+        for(;i+Width<=end;i+=Width)
+        {
+            V v0[3] = {Ops::Load(c[0]+i), Ops::Load(c[1]+i), Ops::Load(c[2]+i)};
+            V e1[3] = {Ops::Load(c[3]+i), Ops::Load(c[4]+i), Ops::Load(c[5]+i)};
+            V e2[3] = {Ops::Load(c[6]+i), Ops::Load(c[7]+i), Ops::Load(c[8]+i)};
+            V t, u, v;
+            int bits = Ops::MoveMask(Test(o, d, v0, e1, e2, tMax, t, u, v));
+            if(bits == 0)
+                continue;
+            T ts[Width], us[Width], vs[Width];
+            Ops::Store(ts, t);
+            Ops::Store(us, u);
+            Ops::Store(vs, v);
+            for(int k=0;k<Width;k++)
+            {
+                if(((bits>>k)&1) && ts[k] < hit.t)
+                {
+                    hit.t = ts[k];
+                    hit.u = us[k];
+                    hit.v = vs[k];
+                    hit.triangle = i+k;
+                }
+            }
+            tMax = Ops::Set1(hit.t);
+        }
+        PacketKernel<T,1>::RayTriangles(ray, tris, i, end, hit);
+    }
+
+    static void RaysTriangle(RayArray3D<T>& rays, std::size_t begin, std::size_t end, const Vector3D<T>& a, const Vector3D<T>& b, const Vector3D<T>& c, std::size_t triangle)
+    {
+        V v0[3] = {Ops::Set1(a.X()), Ops::Set1(a.Y()), Ops::Set1(a.Z())};
+        V e1[3] = {Ops::Set1(b.X()), Ops::Set1(b.Y()), Ops::Set1(b.Z())};
+        V e2[3] = {Ops::Set1(c.X()), Ops::Set1(c.Y()), Ops::Set1(c.Z())};
+        T* r[9];
+        for(int k=0;k<9;k++)
+            r[k] = rays.Component(k);
+        std::size_t* tri = rays.Triangles();
+        std::size_t i = begin;
+        for(;i+Width<=end;i+=Width)
+        {
+            V o[3] = {Ops::Load(r[0]+i), Ops::Load(r[1]+i), Ops::Load(r[2]+i)};
+            V d[3] = {Ops::Load(r[3]+i), Ops::Load(r[4]+i), Ops::Load(r[5]+i)};
+            V tOld = Ops::Load(r[6]+i);
+            V t, u, v;
+            V mask = Test(o, d, v0, e1, e2, tOld, t, u, v);
+            int bits = Ops::MoveMask(mask);
+            if(bits == 0)
+                continue;
+            Ops::Store(r[6]+i, Ops::Select(mask, t, tOld));
+            Ops::Store(r[7]+i, Ops::Select(mask, u, Ops::Load(r[7]+i)));
+            Ops::Store(r[8]+i, Ops::Select(mask, v, Ops::Load(r[8]+i)));
+            for(int k=0;k<Width;k++)
+                if((bits>>k)&1)
+                    tri[i+k] = triangle;
+        }
+        PacketKernel<T,1>::RaysTriangle(rays, i, end, a, b, c, triangle);
+    }
+};
+#endif
+
+}
+
+/**
+* Closest hit of one ray against an array of triangles (SIMD over triangles)
+* @param ray - the ray
+* @param tris - the triangles
+* @param hit - output, the closest hit (triangle is the index in tris)
+* @param tMax - ignore hits farther than this
+* @return bool - true if a triangle was hit
+**/
+template<class T>
+bool IntersectRayTriangles(const Ray<T>& ray, const TriangleArray3D<T>& tris, RayHit<T>& hit, T tMax = std::numeric_limits<T>::infinity())
+{
+    hit = RayHit<T>();
+    hit.t = tMax;
+    detail::PacketKernel<T, detail::SimdWidth<T>::value>::RayTriangles(ray, tris, 0, tris.Size(), hit);
+    if(!hit.Hit())
+    {
+        hit = RayHit<T>();
+        return false;
+    }
+    return true;
+}
+
+/**
+* Intersect an array of rays with one triangle (SIMD over rays)
+* The hits of rays that hit the triangle closer than their current hit are replaced
+* @param rays - the rays and their current closest hits
+* @param v0 - first vertex
+* @param v1 - second vertex
+* @param v2 - third vertex
+* @param triangle - index recorded in the hits
+**/
+template<class T>
+void IntersectRays(RayArray3D<T>& rays, const Vector3D<T>& v0, const Vector3D<T>& v1, const Vector3D<T>& v2, std::size_t triangle)
+{
+    Vector3D<T> e1 = v1-v0, e2 = v2-v0;
+    detail::ParallelBatch(rays.Size(), [&](std::size_t b, std::size_t e) {
+        detail::PacketKernel<T, detail::SimdWidth<T>::value>::RaysTriangle(rays, b, e, v0, e1, e2, triangle);
+    });
+}
+
+/**
+* Intersect an array of rays with an array of triangles (SIMD over rays)
+* Rays are processed in cache-sized blocks, each block against every triangle;
+* the blocks are spread over the default executor
+* @param rays - the rays and their current closest hits (triangle is the index in tris)
+* @param tris - the triangles
+**/
+template<class T>
+void IntersectRays(RayArray3D<T>& rays, const TriangleArray3D<T>& tris)
+{
+    const std::size_t block = 1024;
+    // small problems are not worth waking the workers for
+    unsigned threads = (double(rays.Size())*double(tris.Size()) > double(DefaultExecutor().Grain()))?0u:1u;
+    detail::ParallelFor(0, rays.Size(), block, threads, [&](std::size_t begin, std::size_t end) {
+        for(std::size_t i=0;i<tris.Size();i++)
+            detail::PacketKernel<T, detail::SimdWidth<T>::value>::RaysTriangle(rays, begin, end, tris.V0(i), tris.E1(i), tris.E2(i), i);
+    });
+}
+
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+/**
+* Includes
+* Compile-time SIMD selection: the widest instruction set enabled by the
+* compiler flags is used (e.g. -mavx, -march=native), otherwise the scalar
+* fallback. TOOLS3D_BMI2 (64-bit x86 with -mbmi2) enables the pdep/pext bit
+* scatter used for Morton codes. Define TOOLS3D_NO_SIMD to force the scalar paths.
+**/
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <limits>
+
+#if !defined(TOOLS3D_NO_SIMD)
+    #if defined(__AVX__)
+        #define TOOLS3D_AVX
+    #endif
+    #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #define TOOLS3D_SSE2
+    #endif
+    #if defined(__BMI2__) && (defined(__x86_64__) || defined(_M_X64))
+        #define TOOLS3D_BMI2
+    #endif
+#endif
+
+#if defined(TOOLS3D_AVX) || defined(TOOLS3D_SSE2) || defined(TOOLS3D_BMI2)
+    #include <immintrin.h>
+#endif
+
+/**
+* TOOLS3D_IS_CONSTANT_EVALUATED() is true while a constexpr function is being
+* evaluated at compile time, so SIMD kernels (which are never constexpr) can
+* fall back to their scalar version there. Without compiler support it is
+* always false, and products are then constexpr only with TOOLS3D_NO_SIMD.
+**/
+#if defined(__has_builtin)
+    #if __has_builtin(__builtin_is_constant_evaluated)
+        #define TOOLS3D_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+    #endif
+#endif
+#if !defined(TOOLS3D_IS_CONSTANT_EVALUATED)
+    #define TOOLS3D_IS_CONSTANT_EVALUATED() false
+#endif
+
+namespace Tools3D {
+
+/**
+* Alignment (in bytes) used for all SIMD buffers - enough for AVX registers
+**/
+const std::size_t SIMDAlignment = 32;
+
+/**
+* Allocate memory aligned to SIMDAlignment
+* @param bytes - number of bytes to allocate
+* @return void* - the aligned memory (must be released with AlignedFree)
+**/
+inline void* AlignedMalloc(std::size_t bytes)
+{
+    // Over-allocate and keep the original pointer right before the aligned block
+    void* raw = std::malloc(bytes+SIMDAlignment+sizeof(void*));
+    if(!raw)
+        throw std::bad_alloc();
+    std::size_t addr = reinterpret_cast<std::size_t>(raw)+sizeof(void*);
+    addr = (addr+SIMDAlignment-1)&~(SIMDAlignment-1);
+    void* aligned = reinterpret_cast<void*>(addr);
+    reinterpret_cast<void**>(aligned)[-1] = raw;
+    return aligned;
+}
+
+/**
+* Free memory allocated with AlignedMalloc
+* @param ptr - pointer returned by AlignedMalloc
+**/
+inline void AlignedFree(void* ptr)
+{
+    if(ptr)
+        std::free(reinterpret_cast<void**>(ptr)[-1]);
+}
+
+/**
+* Standard allocator returning SIMDAlignment-aligned storage
+* (for use with std::vector)
+**/
+template<class T>
+class AlignedAllocator
+{
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template<class U>
+    struct rebind { typedef AlignedAllocator<U> other; };
+
+    AlignedAllocator(){}
+
+    template<class U>
+    AlignedAllocator(const AlignedAllocator<U>&){}
+
+    T* allocate(std::size_t n)
+    {
+        if(n > std::numeric_limits<std::size_t>::max()/sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(AlignedMalloc(n*sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t)
+    {
+        AlignedFree(p);
+    }
+
+    template<class U>
+    bool operator==(const AlignedAllocator<U>&)const {return true;}
+    template<class U>
+    bool operator!=(const AlignedAllocator<U>&)const {return false;}
+};
+
+namespace detail {
+
+/**
+* Widest register width (in elements) available for T
+* (1 when there is no SIMD path for T, e.g. integers or TOOLS3D_NO_SIMD)
+**/
+template<class T>
+struct SimdWidth { static const int value = 1; };
+
+#if defined(TOOLS3D_AVX)
+template<>
+struct SimdWidth<float> { static const int value = 8; };
+template<>
+struct SimdWidth<double> { static const int value = 4; };
+#elif defined(TOOLS3D_SSE2)
+template<>
+struct SimdWidth<float> { static const int value = 4; };
+template<>
+struct SimdWidth<double> { static const int value = 2; };
+#endif
+
+#if defined(TOOLS3D_SSE2)
+/**
+* Thin wrappers over the SSE2/AVX intrinsics, so that kernels which only
+* need basic arithmetic can be written once for every register width
+* (one specialization per scalar type and register width)
+* Comparisons return lane masks; Select(mask,a,b) picks a where the mask is set
+**/
+template<class T, int Width>
+struct SimdOps;
+
+template<>
+struct SimdOps<float,4>
+{
+    typedef float T;
+    typedef __m128 V;
+    static __m128 Set1(T a) {return _mm_set1_ps(a);}
+    static __m128 Load(const T* p) {return _mm_loadu_ps(p);}
+    static void Store(T* p, __m128 a) {_mm_storeu_ps(p,a);}
+    static __m128 Add(__m128 a, __m128 b) {return _mm_add_ps(a,b);}
+    static __m128 Sub(__m128 a, __m128 b) {return _mm_sub_ps(a,b);}
+    static __m128 Mul(__m128 a, __m128 b) {return _mm_mul_ps(a,b);}
+    static __m128 Div(__m128 a, __m128 b) {return _mm_div_ps(a,b);}
+    static __m128 Min(__m128 a, __m128 b) {return _mm_min_ps(a,b);}
+    static __m128 Max(__m128 a, __m128 b) {return _mm_max_ps(a,b);}
+    static __m128 Sqrt(__m128 a) {return _mm_sqrt_ps(a);}
+    static __m128 Lt(__m128 a, __m128 b) {return _mm_cmplt_ps(a,b);}
+    static __m128 Gt(__m128 a, __m128 b) {return _mm_cmpgt_ps(a,b);}
+    static __m128 And(__m128 a, __m128 b) {return _mm_and_ps(a,b);}
+    static __m128 AndNot(__m128 a, __m128 b) {return _mm_andnot_ps(a,b);}
+    static __m128 Or(__m128 a, __m128 b) {return _mm_or_ps(a,b);}
+    static __m128 Xor(__m128 a, __m128 b) {return _mm_xor_ps(a,b);}
+    static __m128 Eq(__m128 a, __m128 b) {return _mm_cmpeq_ps(a,b);}
+    static __m128 Le(__m128 a, __m128 b) {return _mm_cmple_ps(a,b);}
+    static int AllSet(__m128 a) {return _mm_movemask_ps(a)==0xF;}
+    static int AnySet(__m128 a) {return _mm_movemask_ps(a)!=0;}
+    static int MoveMask(__m128 a) {return _mm_movemask_ps(a);}
+    static __m128 Select(__m128 mask, __m128 a, __m128 b) {return _mm_or_ps(_mm_and_ps(mask,a),_mm_andnot_ps(mask,b));}
+};
+
+template<>
+struct SimdOps<double,2>
+{
+    typedef double T;
+    typedef __m128d V;
+    static __m128d Set1(T a) {return _mm_set1_pd(a);}
+    static __m128d Load(const T* p) {return _mm_loadu_pd(p);}
+    static void Store(T* p, __m128d a) {_mm_storeu_pd(p,a);}
+    static __m128d Add(__m128d a, __m128d b) {return _mm_add_pd(a,b);}
+    static __m128d Sub(__m128d a, __m128d b) {return _mm_sub_pd(a,b);}
+    static __m128d Mul(__m128d a, __m128d b) {return _mm_mul_pd(a,b);}
+    static __m128d Div(__m128d a, __m128d b) {return _mm_div_pd(a,b);}
+    static __m128d Min(__m128d a, __m128d b) {return _mm_min_pd(a,b);}
+    static __m128d Max(__m128d a, __m128d b) {return _mm_max_pd(a,b);}
+    static __m128d Sqrt(__m128d a) {return _mm_sqrt_pd(a);}
+    static __m128d Lt(__m128d a, __m128d b) {return _mm_cmplt_pd(a,b);}
+    static __m128d Gt(__m128d a, __m128d b) {return _mm_cmpgt_pd(a,b);}
+    static __m128d And(__m128d a, __m128d b) {return _mm_and_pd(a,b);}
+    static __m128d AndNot(__m128d a, __m128d b) {return _mm_andnot_pd(a,b);}
+    static __m128d Or(__m128d a, __m128d b) {return _mm_or_pd(a,b);}
+    static __m128d Xor(__m128d a, __m128d b) {return _mm_xor_pd(a,b);}
+    static __m128d Eq(__m128d a, __m128d b) {return _mm_cmpeq_pd(a,b);}
+    static __m128d Le(__m128d a, __m128d b) {return _mm_cmple_pd(a,b);}
+    static int AllSet(__m128d a) {return _mm_movemask_pd(a)==0x3;}
+    static int AnySet(__m128d a) {return _mm_movemask_pd(a)!=0;}
+    static int MoveMask(__m128d a) {return _mm_movemask_pd(a);}
+    static __m128d Select(__m128d mask, __m128d a, __m128d b) {return _mm_or_pd(_mm_and_pd(mask,a),_mm_andnot_pd(mask,b));}
+};
+
+#if defined(TOOLS3D_AVX)
+template<>
+struct SimdOps<float,8>
+{
+    typedef float T;
+    typedef __m256 V;
+    static __m256 Set1(T a) {return _mm256_set1_ps(a);}
+    static __m256 Load(const T* p) {return _mm256_loadu_ps(p);}
+    static void Store(T* p, __m256 a) {_mm256_storeu_ps(p,a);}
+    static __m256 Add(__m256 a, __m256 b) {return _mm256_add_ps(a,b);}
+    static __m256 Sub(__m256 a, __m256 b) {return _mm256_sub_ps(a,b);}
+    static __m256 Mul(__m256 a, __m256 b) {return _mm256_mul_ps(a,b);}
+    static __m256 Div(__m256 a, __m256 b) {return _mm256_div_ps(a,b);}
+    static __m256 Min(__m256 a, __m256 b) {return _mm256_min_ps(a,b);}
+    static __m256 Max(__m256 a, __m256 b) {return _mm256_max_ps(a,b);}
+    static __m256 Sqrt(__m256 a) {return _mm256_sqrt_ps(a);}
+    static __m256 Lt(__m256 a, __m256 b) {return _mm256_cmp_ps(a,b,_CMP_LT_OQ);}
+    static __m256 Gt(__m256 a, __m256 b) {return _mm256_cmp_ps(a,b,_CMP_GT_OQ);}
+    static __m256 And(__m256 a, __m256 b) {return _mm256_and_ps(a,b);}
+    static __m256 AndNot(__m256 a, __m256 b) {return _mm256_andnot_ps(a,b);}
+    static __m256 Or(__m256 a, __m256 b) {return _mm256_or_ps(a,b);}
+    static __m256 Xor(__m256 a, __m256 b) {return _mm256_xor_ps(a,b);}
+    static __m256 Eq(__m256 a, __m256 b) {return _mm256_cmp_ps(a,b,_CMP_EQ_OQ);}
+    static __m256 Le(__m256 a, __m256 b) {return _mm256_cmp_ps(a,b,_CMP_LE_OQ);}
+    static int AllSet(__m256 a) {return _mm256_movemask_ps(a)==0xFF;}
+    static int AnySet(__m256 a) {return _mm256_movemask_ps(a)!=0;}
+    static int MoveMask(__m256 a) {return _mm256_movemask_ps(a);}
+    static __m256 Select(__m256 mask, __m256 a, __m256 b) {return _mm256_blendv_ps(b,a,mask);}
+};
+
+template<>
+struct SimdOps<double,4>
+{
+    typedef double T;
+    typedef __m256d V;
+    static __m256d Set1(T a) {return _mm256_set1_pd(a);}
+    static __m256d Load(const T* p) {return _mm256_loadu_pd(p);}
+    static void Store(T* p, __m256d a) {_mm256_storeu_pd(p,a);}
+    static __m256d Add(__m256d a, __m256d b) {return _mm256_add_pd(a,b);}
+    static __m256d Sub(__m256d a, __m256d b) {return _mm256_sub_pd(a,b);}
+    static __m256d Mul(__m256d a, __m256d b) {return _mm256_mul_pd(a,b);}
+    static __m256d Div(__m256d a, __m256d b) {return _mm256_div_pd(a,b);}
+    static __m256d Min(__m256d a, __m256d b) {return _mm256_min_pd(a,b);}
+    static __m256d Max(__m256d a, __m256d b) {return _mm256_max_pd(a,b);}
+    static __m256d Sqrt(__m256d a) {return _mm256_sqrt_pd(a);}
+    static __m256d Lt(__m256d a, __m256d b) {return _mm256_cmp_pd(a,b,_CMP_LT_OQ);}
+    static __m256d Gt(__m256d a, __m256d b) {return _mm256_cmp_pd(a,b,_CMP_GT_OQ);}
+    static __m256d And(__m256d a, __m256d b) {return _mm256_and_pd(a,b);}
+    static __m256d AndNot(__m256d a, __m256d b) {return _mm256_andnot_pd(a,b);}
+    static __m256d Or(__m256d a, __m256d b) {return _mm256_or_pd(a,b);}
+    static __m256d Xor(__m256d a, __m256d b) {return _mm256_xor_pd(a,b);}
+    static __m256d Eq(__m256d a, __m256d b) {return _mm256_cmp_pd(a,b,_CMP_EQ_OQ);}
+    static __m256d Le(__m256d a, __m256d b) {return _mm256_cmp_pd(a,b,_CMP_LE_OQ);}
+    static int AllSet(__m256d a) {return _mm256_movemask_pd(a)==0xF;}
+    static int AnySet(__m256d a) {return _mm256_movemask_pd(a)!=0;}
+    static int MoveMask(__m256d a) {return _mm256_movemask_pd(a);}
+    static __m256d Select(__m256d mask, __m256d a, __m256d b) {return _mm256_blendv_pd(b,a,mask);}
+};
+#endif
+#endif
+
+}
+
+}
+
+#endif
@@ -0,0 +1,387 @@
+#ifndef SIN_COS_HPP
+#define SIN_COS_HPP
+
+/**
+* Includes
+* Batch sine/cosine and batch rotation-matrix generation
+* The polynomial path reduces each angle to [-Pi/4,Pi/4] (three-part
+* Cody-Waite split of Pi/2) and evaluates the Cephes minimax polynomials
+* for sin and cos on SSE/AVX registers. Absolute error against the exact
+* values (measured over the whole valid range):
+*   float  - below 1e-7 (about 2 ulp) for |angle| <= SinCosLimit<float>::value (8192)
+*   double - below 2e-16 (about 2 ulp) for |angle| <= SinCosLimit<double>::value (2^20)
+* Angles outside the valid range (and NaN/Inf) are handed to libm, so the
+* result is always usable. Pass SinCosLibm to use std::sin/std::cos for
+* every angle (bit-identical to Matrix3D::RotateX/Y/Z).
+**/
+#include <cmath>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Parallel.hpp>
+#include <3DTools/Matrix3D.hpp>
+
+namespace Tools3D {
+
+/**
+* How the batch functions compute sine and cosine
+**/
+enum SinCosMethod
+{
+    SinCosPolynomial, // SIMD polynomial (see accuracy bound above)
+    SinCosLibm        // std::sin and std::cos
+};
+
+/**
+* Principal axes for batch rotation matrices
+**/
+enum RotationAxis
+{
+    AxisX,
+    AxisY,
+    AxisZ
+};
+
+/**
+* Largest |angle| handled by the polynomial path
+**/
+template<class T>
+struct SinCosLimit;
+
+template<>
+struct SinCosLimit<float> { static constexpr float value = 8192.0f; };
+
+template<>
+struct SinCosLimit<double> { static constexpr double value = 1048576.0; };
+
+namespace detail {
+
+/**
+* Constants of the polynomial sincos
+* (Pi/2 split in three parts so that k*DP1 and k*DP2 are exact for every k in range,
+* Round - adding and subtracting it rounds to the nearest integer,
+* S and C - polynomial coefficients of sin and cos, highest degree first)
+**/
+template<class T>
+struct SinCosConstants;
+
+template<>
+struct SinCosConstants<float>
+{
+    static constexpr float TwoOverPi = 0.636619772367581343f;
+    static constexpr float DP1 = 1.5703125f;
+    static constexpr float DP2 = 4.837512969970703125e-4f;
+    static constexpr float DP3 = 7.54978995489188216e-8f;
+    static constexpr float Round = 12582912.0f; // 1.5*2^23
+    static const int Terms = 3;
+    static constexpr float S(int i)
+    {
+        const float s[Terms] = {-1.9515295891e-4f, 8.3321608736e-3f, -1.6666654611e-1f};
+        return s[i];
+    }
+    static constexpr float C(int i)
+    {
+        const float c[Terms] = {2.443315711809948e-5f, -1.388731625493765e-3f, 4.166664568298827e-2f};
+        return c[i];
+    }
+};
+
+template<>
+struct SinCosConstants<double>
+{
+    static constexpr double TwoOverPi = 0.636619772367581343075535053490057448;
+    static constexpr double DP1 = 1.57079625129699707031;
+    static constexpr double DP2 = 7.54978941586159635336e-8;
+    static constexpr double DP3 = 5.39030285815811905290e-15;
+    static constexpr double Round = 6755399441055744.0; // 1.5*2^52
+    static const int Terms = 6;
+    static constexpr double S(int i)
+    {
+        const double s[Terms] = {1.58962301576546568060e-10, -2.50507477628578072866e-8, 2.75573136213857245213e-6,
+                                 -1.98412698295895385996e-4, 8.33333333332211858878e-3, -1.66666666666666307295e-1};
+        return s[i];
+    }
+    static constexpr double C(int i)
+    {
+        const double c[Terms] = {-1.13585365213876817300e-11, 2.08757008419747316778e-9, -2.75573141792967388112e-7,
+                                 2.48015872888517045348e-5, -1.38888888888730564116e-3, 4.16666666666665929218e-2};
+        return c[i];
+    }
+};
+
+/**
+* Scalar polynomial sincos of one angle (|x| <= SinCosLimit<T>::value)
+* Same operations in the same order as the SIMD blocks below
+**/
+template<class T>
+inline void SinCosScalar(T x, T& s, T& c)
+{
+    typedef SinCosConstants<T> K;
+    // quadrant q = k mod 4 and remainder r = x - k*Pi/2
+    // (k/4 - 0.375 rounds to floor(k/4) for every integer k)
+    T k = (x*K::TwoOverPi+K::Round)-K::Round;
+    T q = k-T(4)*(((k*T(0.25)-T(0.375))+K::Round)-K::Round);
+    T r = ((x-k*K::DP1)-k*K::DP2)-k*K::DP3;
+    T z = r*r;
+    T ps = K::S(0), pc = K::C(0);
+    for(int i=1;i<K::Terms;i++)
+    {
+        ps = ps*z+K::S(i);
+        pc = pc*z+K::C(i);
+    }
+    T sr = r+r*z*ps;
+    T cr = (T(1)-T(0.5)*z)+z*z*pc;
+    bool swap = (q==T(1))||(q==T(3));
+    s = swap?cr:sr;
+    c = swap?sr:cr;
+    if(q>=T(2))
+        s = -s;
+    if((q==T(1))||(q==T(2)))
+        c = -c;
+}
+
+/**
+* Polynomial sincos of n angles one at a time
+* (angles outside the valid range, and NaN/Inf, go to libm)
+**/
+template<class T>
+inline void SinCosRange(const T* angles, T* s, T* c, std::size_t n)
+{
+    for(std::size_t i=0;i<n;i++)
+    {
+        T x = angles[i];
+        if(std::abs(x) <= SinCosLimit<T>::value)
+            SinCosScalar(x, s[i], c[i]);
+        else
+        {
+            s[i] = std::sin(x);
+            c[i] = std::cos(x);
+        }
+    }
+}
+
+/**
+* Batch sincos kernel (scalar fallback)
+**/
+template<class T>
+struct SinCosKernel
+{
+    static void Run(const T* angles, T* s, T* c, std::size_t n)
+    {
+        SinCosRange(angles, s, c, n);
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+/**
+* SIMD sincos of Width angles starting at angles[0]
+* Uses only floating point operations (no integer SIMD), so the same
+* code serves SSE2 and AVX. Blocks with an angle outside the valid range
+* (or NaN) are computed with libm instead.
+**/
+template<class T, int Width>
+inline void SinCosBlock(const T* angles, T* s, T* c)
+{
+    typedef SimdOps<T,Width> O;
+    typedef typename O::V V;
+    typedef SinCosConstants<T> K;
+    V x = O::Load(angles);
+    V signMask = O::Set1(T(-0.0));
+    if(!O::AllSet(O::Le(O::AndNot(signMask,x),O::Set1(SinCosLimit<T>::value))))
+    {
+        for(int i=0;i<Width;i++)
+        {
+            s[i] = std::sin(angles[i]);
+            c[i] = std::cos(angles[i]);
+        }
+        return;
+    }
+    V round = O::Set1(K::Round);
+    V k = O::Sub(O::Add(O::Mul(x,O::Set1(K::TwoOverPi)),round),round);
+    V k4 = O::Sub(O::Add(O::Sub(O::Mul(k,O::Set1(T(0.25))),O::Set1(T(0.375))),round),round);
+    V q = O::Sub(k,O::Mul(O::Set1(T(4)),k4));
+    V r = O::Sub(O::Sub(O::Sub(x,O::Mul(k,O::Set1(K::DP1))),O::Mul(k,O::Set1(K::DP2))),O::Mul(k,O::Set1(K::DP3)));
+    V z = O::Mul(r,r);
+    V ps = O::Set1(K::S(0)), pc = O::Set1(K::C(0));
+    for(int i=1;i<K::Terms;i++)
+    {
+        ps = O::Add(O::Mul(ps,z),O::Set1(K::S(i)));
+        pc = O::Add(O::Mul(pc,z),O::Set1(K::C(i)));
+    }
+    V sr = O::Add(r,O::Mul(O::Mul(r,z),ps));
+    V cr = O::Add(O::Sub(O::Set1(T(1)),O::Mul(O::Set1(T(0.5)),z)),O::Mul(O::Mul(z,z),pc));
+    V q1 = O::Eq(q,O::Set1(T(1))), q2 = O::Eq(q,O::Set1(T(2))), q3 = O::Eq(q,O::Set1(T(3)));
+    V swap = O::Or(q1,q3);
+    V sinSign = O::And(O::Or(q2,q3),signMask);
+    V cosSign = O::And(O::Or(q1,q2),signMask);
+    O::Store(s,O::Xor(O::Or(O::And(swap,cr),O::AndNot(swap,sr)),sinSign));
+    O::Store(c,O::Xor(O::Or(O::And(swap,sr),O::AndNot(swap,cr)),cosSign));
+}
+
+template<>
+struct SinCosKernel<float>
+{
+    static void Run(const float* angles, float* s, float* c, std::size_t n)
+    {
+        std::size_t i = 0;
+#if defined(TOOLS3D_AVX)
+        for(;i+8<=n;i+=8)
+            SinCosBlock<float,8>(angles+i, s+i, c+i);
+#endif
+        for(;i+4<=n;i+=4)
+            SinCosBlock<float,4>(angles+i, s+i, c+i);
+        SinCosRange(angles+i, s+i, c+i, n-i);
+    }
+};
+
+template<>
+struct SinCosKernel<double>
+{
+    static void Run(const double* angles, double* s, double* c, std::size_t n)
+    {
+        std::size_t i = 0;
+#if defined(TOOLS3D_AVX)
+        for(;i+4<=n;i+=4)
+            SinCosBlock<double,4>(angles+i, s+i, c+i);
+#endif
+        for(;i+2<=n;i+=2)
+            SinCosBlock<double,2>(angles+i, s+i, c+i);
+        SinCosRange(angles+i, s+i, c+i, n-i);
+    }
+};
+#endif
+
+/**
+* Fill a rotation matrix around a principal axis from its sine and cosine
+* (same result as Matrix3D::RotateX/Y/Z applied to the Identity)
+**/
+template<class T>
+inline void SetAxisRotation(Matrix3D<T>& mat, RotationAxis axis, T s, T c)
+{
+    int a = (axis==AxisX)?1:((axis==AxisY)?2:0);
+    int b = (axis==AxisX)?2:((axis==AxisY)?0:1);
+    for(int i=0;i<4;i++)
+        for(int j=0;j<4;j++)
+            mat(i,j) = (i==j)?T(1):T(0);
+    mat(a,a) = c;
+    mat(a,b) = s;
+    mat(b,a) = -s;
+    mat(b,b) = c;
+}
+
+}
+
+/**
+* Batch sine and cosine
+* @param angles - angles in radians
+* @param s - output sines (may be the same array as angles)
+* @param c - output cosines
+* @param n - number of angles
+* @param method - polynomial (default) or libm
+**/
+template<class T>
+void SinCos(const T* angles, T* s, T* c, std::size_t n, SinCosMethod method = SinCosPolynomial)
+{
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        if(method == SinCosLibm)
+        {
+            for(std::size_t i=b;i<e;i++)
+            {
+                T x = angles[i];
+                s[i] = std::sin(x);
+                c[i] = std::cos(x);
+            }
+            return;
+        }
+        detail::SinCosKernel<T>::Run(angles+b, s+b, c+b, e-b);
+    });
+}
+
+/**
+* Batch rotation matrices around a principal axis
+* out[i] equals a Matrix3D m with m.RotateX(angles[i]) (or RotateY/RotateZ)
+* @param angles - angles in radians
+* @param n - number of angles
+* @param axis - rotation axis
+* @param out - output matrices (n of them)
+* @param method - polynomial (default) or libm
+**/
+template<class T>
+void RotationMatrices(const T* angles, std::size_t n, RotationAxis axis, Matrix3D<T>* out, SinCosMethod method = SinCosPolynomial)
+{
+    // sines and cosines are computed in blocks that stay in L1
+    const std::size_t block = 256;
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        T s[block], c[block];
+        for(std::size_t start=b;start<e;start+=block)
+        {
+            std::size_t count = (e-start<block)?(e-start):block;
+            SinCos(angles+start, s, c, count, method);
+            for(std::size_t i=0;i<count;i++)
+                detail::SetAxisRotation(out[start+i], axis, s[i], c[i]);
+        }
+    });
+}
+
+/**
+* Batch rotation matrices around an arbitrary axis
+* out[i] rotates by angles[i] around axis (the same sense as RotateX/Y/Z for the principal axes)
+* @param angles - angles in radians
+* @param n - number of angles
+* @param axis - rotation axis (does not need to be normalized)
+* @param out - output matrices (n of them)
+* @param method - polynomial (default) or libm
+**/
+template<class T>
+void RotationMatrices(const T* angles, std::size_t n, const Vector3D<T>& axis, Matrix3D<T>* out, SinCosMethod method = SinCosPolynomial)
+{
+    Vector3D<T> u = axis;
+    u.Normalize();
+    T x = u.X(), y = u.Y(), z = u.Z();
+    const std::size_t block = 256;
+    detail::ParallelBatch(n, [&](std::size_t b, std::size_t e) {
+        T s[block], c[block];
+        for(std::size_t start=b;start<e;start+=block)
+        {
+            std::size_t count = (e-start<block)?(e-start):block;
+            SinCos(angles+start, s, c, count, method);
+            for(std::size_t i=0;i<count;i++)
+            {
+                // Rodrigues' formula, transposed for the row-vector convention
+                T si = s[i], ci = c[i], t = T(1)-ci;
+                Matrix3D<T>& m = out[start+i];
+                m(0,0) = t*x*x+ci;   m(0,1) = t*x*y+si*z; m(0,2) = t*x*z-si*y; m(0,3) = 0;
+                m(1,0) = t*x*y-si*z; m(1,1) = t*y*y+ci;   m(1,2) = t*y*z+si*x; m(1,3) = 0;
+                m(2,0) = t*x*z+si*y; m(2,1) = t*y*z-si*x; m(2,2) = t*z*z+ci;   m(2,3) = 0;
+                m(3,0) = 0;          m(3,1) = 0;          m(3,2) = 0;          m(3,3) = 1;
+            }
+        }
+    });
+}
+
+/**
+* Batch rotation matrices from std::vector angles
+* @param angles - angles in radians
+* @param axis - rotation axis (RotationAxis or Vector3D)
+* @param out - output matrices (resized to match angles)
+* @param method - polynomial (default) or libm
+**/
+template<class T>
+void RotationMatrices(const std::vector<T>& angles, RotationAxis axis, std::vector<Matrix3D<T> >& out, SinCosMethod method = SinCosPolynomial)
+{
+    out.resize(angles.size());
+    if(!angles.empty())
+        RotationMatrices(&angles[0], angles.size(), axis, &out[0], method);
+}
+
+template<class T>
+void RotationMatrices(const std::vector<T>& angles, const Vector3D<T>& axis, std::vector<Matrix3D<T> >& out, SinCosMethod method = SinCosPolynomial)
+{
+    out.resize(angles.size());
+    if(!angles.empty())
+        RotationMatrices(&angles[0], angles.size(), axis, &out[0], method);
+}
+
+}
+
+#endif
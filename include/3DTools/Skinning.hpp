@@ -0,0 +1,289 @@
+#ifndef SKINNING_HPP
+#define SKINNING_HPP
+
+/**
+* Includes
+* Linear-blend skinning of SoA vertex arrays by a MatrixArray3D palette
+**/
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <3DTools/SIMD.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/MatrixArray3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Per-vertex bone influences, up to four per vertex
+* Slot j of all vertices is stored as one bone-index array and one weight
+* array, so only the first Influences() slots are ever read.
+* Unused slots have bone 0 and weight 0; slots past Influences() are skipped.
+**/
+template<class T>
+class SkinWeights
+{
+public:
+    typedef std::vector<T, AlignedAllocator<T> > Buffer;
+    static const unsigned MaxInfluences = 4;
+private:
+    std::vector<std::uint16_t> bones[MaxInfluences];
+    Buffer weights[MaxInfluences];
+    unsigned influences; // largest count passed to Set
+public:
+    /**
+    * Default Constructor
+    * Creates an empty set of weights
+    **/
+    SkinWeights():influences(0){}
+
+    /**
+    * Constructor
+    * @param n - number of vertices (no influences yet)
+    **/
+    explicit SkinWeights(std::size_t n):influences(0) {Resize(n);}
+
+    /**
+    * Get number of vertices
+    * @return std::size_t - the number of vertices
+    **/
+    std::size_t Size()const {return bones[0].size();}
+
+    /**
+    * Test if there are no vertices?
+    * @return bool - true if empty
+    **/
+    bool Empty()const {return bones[0].empty();}
+
+    /**
+    * Resize (new vertices have no influences)
+    * @param n - new number of vertices
+    **/
+    void Resize(std::size_t n)
+    {
+        for(unsigned j=0;j<MaxInfluences;j++)
+        {
+            bones[j].resize(n, 0);
+            weights[j].resize(n, T(0));
+        }
+    }
+
+    /**
+    * Remove all vertices
+    **/
+    void Clear()
+    {
+        for(unsigned j=0;j<MaxInfluences;j++)
+        {
+            bones[j].clear();
+            weights[j].clear();
+        }
+        influences = 0;
+    }
+
+    /**
+    * Set influences of a vertex (weights are used as given, normally they sum to 1)
+    * @param vertex - index of the vertex
+    * @param count - number of influences (at most MaxInfluences)
+    * @param boneIds - count bone indices into the palette
+    * @param boneWeights - count weights
+    * @return bool - false if count is too large (nothing is changed)
+    **/
+    bool Set(std::size_t vertex, unsigned count, const std::uint16_t* boneIds, const T* boneWeights)
+    {
+        if(count > MaxInfluences)
+            return false;
+        for(unsigned j=0;j<MaxInfluences;j++)
+        {
+            bones[j][vertex] = (j < count)?boneIds[j]:std::uint16_t(0);
+            weights[j][vertex] = (j < count)?boneWeights[j]:T(0);
+        }
+        influences = std::max(influences, count);
+        return true;
+    }
+
+    /**
+    * Get number of used influence slots
+    * @return unsigned - the largest count passed to Set
+    **/
+    unsigned Influences()const {return influences;}
+
+    /**
+    * Get largest bone index (scans the used slots, so overwritten influences do not count)
+    * @return std::uint16_t - the largest bone index in the first Influences() slots (0 if none)
+    **/
+    std::uint16_t MaxBone()const
+    {
+        std::size_t n = Size(), grain = detail::BatchGrain();
+        unsigned chunks = (n > grain)?unsigned(std::min<std::size_t>(detail::ThreadCount(0), n/grain)):1u;
+        std::vector<std::uint16_t> maxima(chunks, 0);
+        detail::ParallelChunks(0, n, chunks, [&](std::size_t b, std::size_t e, unsigned c) {
+            std::uint16_t m = 0;
+            for(unsigned j=0;j<influences;j++)
+                for(std::size_t i=b;i<e;i++)
+                    m = std::max(m, bones[j][i]);
+            maxima[c] = m;
+        });
+        return *std::max_element(maxima.begin(), maxima.end());
+    }
+
+    /**
+    * Get bone indices of an influence slot
+    * @param j - slot (0 to MaxInfluences-1)
+    * @return const std::uint16_t* - Size() bone indices
+    **/
+    const std::uint16_t* Bones(unsigned j)const {return bones[j].empty()?0:&bones[j][0];}
+
+    /**
+    * Get weights of an influence slot
+    * @param j - slot (0 to MaxInfluences-1)
+    * @return const T* - Size() weights
+    **/
+    const T* Weights(unsigned j)const {return weights[j].empty()?0:&weights[j][0];}
+};
+
+namespace detail {
+
+/**
+* Buffers of one skinning call
+* The palette is repacked as four padded rows per bone (rows[16*bone+4*r+c]
+* = m(r,c), c<3, and 0 for c=3), so one bone row is one 4-wide register.
+**/
+template<class T>
+struct SkinJob
+{
+    const T* x;
+    const T* y;
+    const T* z;
+    const std::uint16_t* bones[4];
+    const T* weights[4];
+    unsigned influences;
+    const T* rows;
+    T* ox;
+    T* oy;
+    T* oz;
+};
+
+/**
+* Register width of the skinning kernel: 4 when a 4-wide SimdOps exists for T
+* (SSE float, AVX double), otherwise the scalar fallback
+**/
+template<class T>
+struct SkinWidth { static const int value = (SimdWidth<T>::value >= 4)?4:1; };
+
+/**
+* Linear-blend skinning kernel: every vertex is transformed by each of its
+* bones and the results are blended by the weights. Each input of a vertex is
+* read before its output is written, so out may be the input array.
+* Width is 4 (one bone row per register) or 1 (scalar fallback)
+**/
+template<class T, int Width>
+struct SkinKernel;
+
+template<class T>
+struct SkinKernel<T,1>
+{
+    static void Run(const SkinJob<T>& job, std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i=begin;i<end;i++)
+        {
+            T px = job.x[i], py = job.y[i], pz = job.z[i];
+            T rx = 0, ry = 0, rz = 0;
+            for(unsigned j=0;j<job.influences;j++)
+            {
+                const T* m = job.rows+16*std::size_t(job.bones[j][i]);
+                T w = job.weights[j][i];
+                rx += w*(px*m[0]+py*m[4]+pz*m[8]+m[12]);
+                ry += w*(px*m[1]+py*m[5]+pz*m[9]+m[13]);
+                rz += w*(px*m[2]+py*m[6]+pz*m[10]+m[14]);
+            }
+            job.ox[i] = rx;
+            job.oy[i] = ry;
+            job.oz[i] = rz;
+        }
+    }
+};
+
+#if defined(TOOLS3D_SSE2)
+template<class T, int W>
+struct SkinKernel
+{
+    static void Run(const SkinJob<T>& job, std::size_t begin, std::size_t end)
+    {
+        // vertices are handled one at a time with x,y,z in the lanes: bone
+        // rows load directly, where spreading vertices over the lanes would
+        // need a gather of every matrix component (none below AVX2)
+        typedef SimdOps<T,W> O;
+        typedef typename O::V V;
+        T out[W];
+        for(std::size_t i=begin;i<end;i++)
+        {
+            V px = O::Set1(job.x[i]), py = O::Set1(job.y[i]), pz = O::Set1(job.z[i]);
+            V r = O::Set1(T(0));
+            for(unsigned j=0;j<job.influences;j++)
+            {
+                const T* m = job.rows+16*std::size_t(job.bones[j][i]);
+                V p = O::Add(O::Add(O::Add(O::Mul(px,O::Load(m)),O::Mul(py,O::Load(m+4))),O::Mul(pz,O::Load(m+8))),O::Load(m+12));
+                r = O::Add(r, O::Mul(O::Set1(job.weights[j][i]), p));
+            }
+            O::Store(out, r);
+            job.ox[i] = out[0];
+            job.oy[i] = out[1];
+            job.oz[i] = out[2];
+        }
+    }
+};
+#endif
+
+}
+
+/**
+* Linear-blend skinning: out[i] = sum_j(w_j*(rest[i]*palette[bone_j]))
+* @param rest - vertices in bind pose
+* @param weights - bone influences of every vertex (same size as rest)
+* @param palette - skinning matrices, e.g. inverse bind times bone world (see Multiply)
+* @param out - skinned vertices (resized to match; may be rest)
+* @return bool - false if the sizes differ or a bone index is outside the palette
+**/
+template<class T>
+bool Skin(const PointArray3D<T>& rest, const SkinWeights<T>& weights, const MatrixArray3D<T>& palette, PointArray3D<T>& out)
+{
+    if(rest.Size() != weights.Size())
+        return false;
+    if(weights.Influences() > 0 && weights.MaxBone() >= palette.Size())
+        return false;
+    out.Resize(rest.Size());
+    std::vector<T, AlignedAllocator<T> > rows(16*palette.Size(), T(0));
+    for(unsigned k=0;k<12;k++)
+    {
+        const T* c = palette.Component(k);
+        for(std::size_t b=0;b<palette.Size();b++)
+            rows[16*b+4*(k/3)+k%3] = c[b];
+    }
+    detail::SkinJob<T> job;
+    job.x = rest.X();
+    job.y = rest.Y();
+    job.z = rest.Z();
+    for(unsigned j=0;j<4;j++)
+    {
+        job.bones[j] = weights.Bones(j);
+        job.weights[j] = weights.Weights(j);
+    }
+    job.influences = weights.Influences();
+    job.rows = rows.empty()?0:&rows[0];
+    job.ox = out.X();
+    job.oy = out.Y();
+    job.oz = out.Z();
+    detail::ParallelBatch(rest.Size(), [&](std::size_t begin, std::size_t end) {
+        detail::SkinKernel<T,detail::SkinWidth<T>::value>::Run(job, begin, end);
+    });
+    return true;
+}
+
+typedef SkinWeights<double> SkinWeightsd;
+typedef SkinWeights<float> SkinWeightsf;
+
+}
+
+#endif
@@ -0,0 +1,530 @@
+#ifndef SPATIAL_HASH_HPP
+#define SPATIAL_HASH_HPP
+
+/**
+* Includes
+* Uniform-grid spatial hash for nearest-neighbour and radius queries
+* Batch queries run on the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Neighbors.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Spatial hash over a uniform grid
+* Every point goes to cell floor(p/cellSize), and cells are hashed into a
+* power-of-two bucket table (about two buckets per point). Buckets are stored
+* contiguously after a counting sort, so a query reads a few short runs of
+* points. Best for evenly spread points queried at radii close to cellSize;
+* for clustered data or large k prefer KdTree.
+* Points can also be inserted, moved and removed one at a time. A point that
+* moves to a full bucket is appended to an overflow chain of that bucket; the
+* runs are rebuilt once the overflow outgrows a quarter of the points. A move
+* costs about as much as indexing six points in Build, so when a large part of
+* the points moves every frame, calling Build again is cheaper.
+* Queries may run concurrently with each other, but not with changes.
+**/
+template<class T>
+class SpatialHash
+{
+public:
+    // index of a removed point, and the result of invalid requests
+    static const std::uint32_t None = 0xffffffffu;
+
+private:
+    // queries per batch below which a batch runs on the calling thread
+    static const std::size_t ParallelBatchThreshold = 256;
+    // overflow entries always allowed before the runs are rebuilt
+    static const std::size_t MinOverflow = 1024;
+    // Nearest radius doublings before falling back to a scan of all points
+    static const unsigned MaxDoublings = 32;
+    // cells a query can cover and still track its buckets on the stack
+    static const unsigned StackCells = 64;
+
+    /**
+    * Hash bucket: live points [begin,end), free space up to the next bucket's
+    * begin, then a chain of overflow entries
+    **/
+    struct Bucket
+    {
+        std::uint32_t begin;
+        std::uint32_t end;
+        std::uint32_t overflow; // first overflow entry (None - none)
+    };
+
+    T cellSize;
+    T inverseCell;
+    std::uint32_t mask; // bucket count - 1
+    std::vector<Bucket> buckets; // mask+2 entries, the last one only marks the end of the runs
+    std::vector<Vector3D<T> > points; // bucket runs, then overflow entries
+    std::vector<std::uint32_t> indices; // point index of every entry (None - unused)
+    std::vector<std::uint32_t> chain; // next overflow entry of the same bucket, per overflow entry
+    std::vector<std::uint32_t> entries; // entry of every point index (None - removed)
+    std::size_t live; // number of points
+    Vector3D<T> lo, hi; // bounds of the points (may be larger after moves and removals)
+
+public:
+    /**
+    * Default Constructor
+    * Creates an empty hash
+    **/
+    SpatialHash():cellSize(1),inverseCell(1),mask(0),live(0)
+    {
+        Store(std::vector<std::pair<Vector3D<T>, std::uint32_t> >());
+    }
+
+    /**
+    * Constructor
+    * @param points - the points to index
+    * @param cellSize - grid cell edge length (a typical query radius)
+    **/
+    SpatialHash(const std::vector<Vector3D<T> >& points, T cellSize):SpatialHash()
+    {
+        Build(points, cellSize);
+    }
+
+    /**
+    * Build the hash
+    * @param input - the points to index
+    * @param size - grid cell edge length (a typical query radius)
+    * @return bool - false if size is not positive and finite
+    **/
+    bool Build(const std::vector<Vector3D<T> >& input, T size)
+    {
+        return Build(input.data(), input.size(), size);
+    }
+
+    /**
+    * Build the hash over a Structure-of-Arrays point cloud
+    * @param input - the points to index
+    * @param size - grid cell edge length (a typical query radius)
+    * @return bool - false if size is not positive and finite
+    **/
+    bool Build(const PointArray3D<T>& input, T size)
+    {
+        std::vector<Vector3D<T> > copy(input.Size());
+        for(std::size_t i=0;i<copy.size();i++)
+            copy[i] = input.Get(i);
+        return Build(copy, size);
+    }
+
+    /**
+    * Build the hash over a range of points
+    * Point i gets index i; any earlier points are dropped.
+    * @param input - first point
+    * @param n - number of points
+    * @param size - grid cell edge length (a typical query radius)
+    * @return bool - false if size is not positive and finite
+    **/
+    bool Build(const Vector3D<T>* input, std::size_t n, T size)
+    {
+        if(!(size > T(0)) || !(size <= std::numeric_limits<T>::max()))
+            return false;
+        cellSize = size;
+        inverseCell = T(1)/size;
+        std::vector<std::pair<Vector3D<T>, std::uint32_t> > items(n);
+        for(std::size_t i=0;i<n;i++)
+            items[i] = std::make_pair(input[i], std::uint32_t(i));
+        entries.assign(n, None);
+        Store(items);
+        return true;
+    }
+
+    /**
+    * Add a point
+    * @param p - the point
+    * @return std::uint32_t - index of the new point (one past the largest index so far)
+    **/
+    std::uint32_t Insert(const Vector3D<T>& p)
+    {
+        std::uint32_t index = std::uint32_t(entries.size());
+        entries.push_back(None);
+        Place(index, p);
+        live++;
+        Grow(p);
+        if(OverflowFull())
+            Compact();
+        return index;
+    }
+
+    /**
+    * Move a point
+    * @param index - the point
+    * @param p - its new position
+    * @return bool - false if there is no such point
+    **/
+    bool Update(std::uint32_t index, const Vector3D<T>& p)
+    {
+        if(index >= entries.size() || entries[index] == None)
+            return false;
+        std::uint32_t e = entries[index];
+        if(BucketOf(points[e]) == BucketOf(p))
+            points[e] = p;
+        else
+        {
+            Unplace(e);
+            Place(index, p);
+            if(OverflowFull())
+                Compact();
+        }
+        Grow(p);
+        return true;
+    }
+
+    /**
+    * Remove a point (its index is not reused)
+    * @param index - the point
+    * @return bool - false if there is no such point
+    **/
+    bool Remove(std::uint32_t index)
+    {
+        if(index >= entries.size() || entries[index] == None)
+            return false;
+        Unplace(entries[index]);
+        entries[index] = None;
+        live--;
+        return true;
+    }
+
+    /**
+    * Test if a point index is in the hash?
+    * @param index - the point
+    * @return bool - true if it was built or inserted and not removed
+    **/
+    bool Contains(std::uint32_t index)const {return index < entries.size() && entries[index] != None;}
+
+    /**
+    * Get position of a point
+    * @param index - the point (must be in the hash)
+    * @return Vector3D - its position
+    **/
+    const Vector3D<T>& Point(std::uint32_t index)const {return points[entries[index]];}
+
+    /**
+    * Get number of indexed points
+    * @return std::size_t - the number of points
+    **/
+    std::size_t Size()const {return live;}
+
+    /**
+    * Test if hash is empty?
+    * @return bool - true if there are no points
+    **/
+    bool Empty()const {return live == 0;}
+
+    /**
+    * Get grid cell size
+    * @return T - cell edge length
+    **/
+    T CellSize()const {return cellSize;}
+
+    /**
+    * Find all points within a distance
+    * @param q - query point
+    * @param radius - search radius (inclusive)
+    * @param out - output, the neighbours in no particular order
+    **/
+    void Radius(const Vector3D<T>& q, T radius, std::vector<Neighbor<T> >& out)const
+    {
+        out.clear();
+        T r2 = radius*radius;
+        ForEachCandidate(q, radius, [&](std::size_t i) {
+            T d = q.DistanceSq(points[i]);
+            if(d <= r2)
+            {
+                Neighbor<T> n = {indices[i], d};
+                out.push_back(n);
+            }
+        });
+    }
+
+    /**
+    * Find the k nearest points
+    * The search radius starts at one cell and doubles until the k-th candidate
+    * lies inside it, so queries far from the data are slow.
+    * @param q - query point
+    * @param k - number of neighbours
+    * @param out - output, min(k, Size()) neighbours sorted by distance (ties
+    * by index); empty if q is not finite
+    **/
+    void Nearest(const Vector3D<T>& q, std::size_t k, std::vector<Neighbor<T> >& out)const
+    {
+        detail::KnnHeap<T> heap(out, std::min(k, live));
+        if(heap.k == 0 || !Finite(q))
+            return;
+        const T inf = std::numeric_limits<T>::infinity();
+        // a radius reaching every corner of the box covers all points
+        T reach = std::sqrt(std::max(q.DistanceSq(lo), q.DistanceSq(hi)) + (hi-lo).LengthSq());
+        T radius = cellSize;
+        for(unsigned step=0;;step++)
+        {
+            // past the last doubling, or once the radius overflows, visit everything
+            if(step == MaxDoublings)
+                radius = inf;
+            out.clear();
+            ForEachCandidate(q, radius, [&](std::size_t i) {heap.Push(indices[i], q.DistanceSq(points[i]));});
+            if((out.size() == heap.k && heap.Bound(inf) <= radius*radius) || radius >= reach)
+                break;
+            radius *= 2;
+        }
+        heap.Finish();
+    }
+
+    /**
+    * Find the k nearest points of many query points
+    * @param queries - query points
+    * @param k - number of neighbours
+    * @param out - output, one sorted list of min(k, Size()) neighbours per query
+    * @param threads - number of threads (0 - DefaultExecutor().Concurrency())
+    **/
+    void NearestBatch(const std::vector<Vector3D<T> >& queries, std::size_t k, NeighborLists<T>& out, unsigned threads = 0)const
+    {
+        detail::BatchLists(queries.size(), out, (queries.size() >= ParallelBatchThreshold)?detail::ThreadCount(threads):1u,
+                           [&](std::size_t i, std::vector<Neighbor<T> >& list) {Nearest(queries[i], k, list);});
+    }
+
+    /**
+    * Find all points within a distance of many query points
+    * @param queries - query points
+    * @param radius - search radius (inclusive)
+    * @param out - output, one unsorted list per query
+    * @param threads - number of threads (0 - DefaultExecutor().Concurrency())
+    **/
+    void RadiusBatch(const std::vector<Vector3D<T> >& queries, T radius, NeighborLists<T>& out, unsigned threads = 0)const
+    {
+        detail::BatchLists(queries.size(), out, (queries.size() >= ParallelBatchThreshold)?detail::ThreadCount(threads):1u,
+                           [&](std::size_t i, std::vector<Neighbor<T> >& list) {Radius(queries[i], radius, list);});
+    }
+
+private:
+    static bool Finite(const Vector3D<T>& p)
+    {
+        return std::isfinite(p.X()) && std::isfinite(p.Y()) && std::isfinite(p.Z());
+    }
+
+    std::int64_t Cell(T v)const
+    {
+        // clamp so far-away coordinates cannot overflow the cell index
+        const T limit = T(std::int64_t(1)<<40);
+        T c = std::floor(v*inverseCell);
+        return std::int64_t(std::max(-limit, std::min(limit, c)));
+    }
+
+    std::uint32_t Hash(std::int64_t x, std::int64_t y, std::int64_t z)const
+    {
+        return std::uint32_t((std::uint64_t(x)*73856093u ^ std::uint64_t(y)*19349663u ^ std::uint64_t(z)*83492791u) & mask);
+    }
+
+    std::uint32_t BucketOf(const Vector3D<T>& p)const
+    {
+        return Hash(Cell(p.X()), Cell(p.Y()), Cell(p.Z()));
+    }
+
+    bool InCell(const Vector3D<T>& p, std::int64_t x, std::int64_t y, std::int64_t z)const
+    {
+        return Cell(p.X()) == x && Cell(p.Y()) == y && Cell(p.Z()) == z;
+    }
+
+    void Grow(const Vector3D<T>& p)
+    {
+        if(live == 1)
+            lo = hi = p;
+        lo = Vector3D<T>(std::min(lo.X(), p.X()), std::min(lo.Y(), p.Y()), std::min(lo.Z(), p.Z()));
+        hi = Vector3D<T>(std::max(hi.X(), p.X()), std::max(hi.Y(), p.Y()), std::max(hi.Z(), p.Z()));
+    }
+
+    /**
+    * Lay out points with their indices as contiguous bucket runs (no free space)
+    **/
+    void Store(const std::vector<std::pair<Vector3D<T>, std::uint32_t> >& items)
+    {
+        std::size_t n = items.size();
+        std::uint32_t count = 16;
+        while(count < 2*n && count < (1u<<31))
+            count <<= 1;
+        mask = count-1;
+
+        std::vector<std::uint32_t> keys(n);
+        std::vector<std::uint32_t> starts(std::size_t(count)+1, 0);
+        for(std::size_t i=0;i<n;i++)
+        {
+            keys[i] = BucketOf(items[i].first);
+            starts[keys[i]+1]++;
+        }
+        for(std::size_t b=0;b<count;b++)
+            starts[b+1] += starts[b];
+        buckets.resize(std::size_t(count)+1);
+        for(std::size_t b=0;b<=count;b++)
+        {
+            buckets[b].begin = buckets[b].end = starts[b];
+            buckets[b].overflow = None;
+        }
+        points.resize(n);
+        indices.resize(n);
+        chain.clear();
+        for(std::size_t i=0;i<n;i++)
+        {
+            std::uint32_t slot = buckets[keys[i]].end++;
+            points[slot] = items[i].first;
+            indices[slot] = items[i].second;
+            entries[items[i].second] = slot;
+        }
+
+        live = n;
+        lo = hi = n?items[0].first:Vector3D<T>();
+        for(std::size_t i=1;i<n;i++)
+            Grow(items[i].first);
+    }
+
+    bool OverflowFull()const
+    {
+        std::size_t overflow = points.size()-buckets.back().begin;
+        return overflow > MinOverflow && overflow > live/4;
+    }
+
+    /**
+    * Rebuild the bucket runs from the points in place now
+    **/
+    void Compact()
+    {
+        std::vector<std::pair<Vector3D<T>, std::uint32_t> > items;
+        items.reserve(live);
+        for(std::size_t e=0;e<points.size();e++)
+            if(indices[e] != None)
+                items.push_back(std::make_pair(points[e], indices[e]));
+        Store(items);
+    }
+
+    /**
+    * Put a point in the free space of its bucket, or else in its overflow chain
+    **/
+    void Place(std::uint32_t index, const Vector3D<T>& p)
+    {
+        std::uint32_t b = BucketOf(p);
+        std::uint32_t e;
+        if(buckets[b].end < buckets[b+1].begin)
+        {
+            e = buckets[b].end++;
+            points[e] = p;
+            indices[e] = index;
+        }
+        else
+        {
+            e = std::uint32_t(points.size());
+            points.push_back(p);
+            indices.push_back(index);
+            chain.push_back(buckets[b].overflow);
+            buckets[b].overflow = e;
+        }
+        entries[index] = e;
+    }
+
+    /**
+    * Take the point of entry e out of its bucket
+    **/
+    void Unplace(std::uint32_t e)
+    {
+        std::uint32_t b = BucketOf(points[e]);
+        std::uint32_t runs = buckets.back().begin;
+        if(e < runs)
+        {
+            // the last point of the run fills the gap
+            std::uint32_t last = --buckets[b].end;
+            points[e] = points[last];
+            indices[e] = indices[last];
+            entries[indices[e]] = e;
+            indices[last] = None;
+            return;
+        }
+        std::uint32_t* link = &buckets[b].overflow;
+        while(*link != e)
+            link = &chain[*link-runs];
+        *link = chain[e-runs];
+        indices[e] = None;
+    }
+
+    /**
+    * Call visit(entry) for every point in the cells overlapping the query
+    * sphere, each point once (may include points outside the sphere)
+    **/
+    template<class Visit>
+    void ForEachCandidate(const Vector3D<T>& q, T radius, const Visit& visit)const
+    {
+        if(live == 0 || !(radius >= T(0)) || !Finite(q))
+            return;
+        std::int64_t x0 = Cell(q.X()-radius), x1 = Cell(q.X()+radius);
+        std::int64_t y0 = Cell(q.Y()-radius), y1 = Cell(q.Y()+radius);
+        std::int64_t z0 = Cell(q.Z()-radius), z1 = Cell(q.Z()+radius);
+        // also clip to the cells of the bounding box
+        x0 = std::max(x0, Cell(lo.X())); x1 = std::min(x1, Cell(hi.X()));
+        y0 = std::max(y0, Cell(lo.Y())); y1 = std::min(y1, Cell(hi.Y()));
+        z0 = std::max(z0, Cell(lo.Z())); z1 = std::min(z1, Cell(hi.Z()));
+        if(x0 > x1 || y0 > y1 || z0 > z1)
+            return;
+        std::uint32_t runs = buckets.back().begin;
+        double cells = double(x1-x0+1)*double(y1-y0+1)*double(z1-z0+1);
+        if(cells >= double(mask)+1)
+        {
+            for(std::uint32_t b=0;b<=mask;b++)
+                for(std::uint32_t i=buckets[b].begin;i<buckets[b].end;i++)
+                    visit(i);
+            for(std::size_t i=runs;i<points.size();i++)
+                if(indices[i] != None)
+                    visit(i);
+            return;
+        }
+        if(cells <= StackCells)
+        {
+            // distinct cells can share a bucket: skip buckets already visited
+            std::uint32_t seen[StackCells];
+            unsigned count = 0;
+            for(std::int64_t z=z0;z<=z1;z++)
+                for(std::int64_t y=y0;y<=y1;y++)
+                    for(std::int64_t x=x0;x<=x1;x++)
+                    {
+                        std::uint32_t h = Hash(x, y, z);
+                        if(std::find(seen, seen+count, h) != seen+count)
+                            continue;
+                        seen[count++] = h;
+                        const Bucket& b = buckets[h];
+                        for(std::uint32_t i=b.begin;i<b.end;i++)
+                            visit(i);
+                        for(std::uint32_t i=b.overflow;i!=None;i=chain[i-runs])
+                            visit(i);
+                    }
+            return;
+        }
+        // too many cells to remember the buckets: every cell only takes its own points
+        for(std::int64_t z=z0;z<=z1;z++)
+            for(std::int64_t y=y0;y<=y1;y++)
+                for(std::int64_t x=x0;x<=x1;x++)
+                {
+                    const Bucket& b = buckets[Hash(x, y, z)];
+                    for(std::uint32_t i=b.begin;i<b.end;i++)
+                        if(InCell(points[i], x, y, z))
+                            visit(i);
+                    for(std::uint32_t i=b.overflow;i!=None;i=chain[i-runs])
+                        if(InCell(points[i], x, y, z))
+                            visit(i);
+                }
+    }
+};
+
+template<class T>
+const std::uint32_t SpatialHash<T>::None;
+
+typedef SpatialHash<double> SpatialHashd;
+typedef SpatialHash<float> SpatialHashf;
+
+}
+
+#endif
@@ -0,0 +1,333 @@
+#ifndef TESSELLATOR_HPP
+#define TESSELLATOR_HPP
+
+/**
+* Includes
+* Adaptive tessellation of curves and patches with a per-frame cache
+**/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/Curves.hpp>
+
+namespace Tools3D {
+
+/**
+* Tessellator with a cache keyed by the shape data
+* Results are stored under a hash of the shape's signature (degree, knots,
+* control points, weights) and the settings; the full signature is kept and
+* compared on lookup, so a hash collision costs a rebuild, never a wrong
+* result. Shapes that did not change since the last frame are returned
+* straight from the cache, and NextFrame() drops entries that were not used
+* for Settings::maxAge frames. Not thread-safe.
+**/
+template<class T>
+class Tessellator
+{
+public:
+    /**
+    * Tessellation settings
+    **/
+    struct Settings
+    {
+        T tolerance; // maximum distance between the shape and its tessellation
+        unsigned maxDepth; // at most 2^maxDepth pieces per curve segment or patch side
+        unsigned maxAge; // frames an unused cache entry survives
+
+        Settings():tolerance(T(1e-3)),maxDepth(10),maxAge(1){}
+    };
+
+    /**
+    * Tessellated curve or patch
+    * A curve gives a polyline (points and their parameters, vCount = 1); a patch
+    * a grid of uCount x vCount points, point (i,j) at j*uCount+i, with the u
+    * parameters followed by the v parameters.
+    **/
+    struct Tessellation
+    {
+        PointArray3D<T> points;
+        std::vector<T> parameters;
+        std::size_t uCount;
+        std::size_t vCount;
+
+        Tessellation():uCount(0),vCount(0){}
+    };
+
+private:
+    /**
+    * Cached result and the signature it was built from
+    **/
+    struct Entry
+    {
+        std::vector<T> signature;
+        Tessellation result;
+        std::uint64_t frame; // last frame the entry was used
+    };
+
+    Settings settings;
+    std::unordered_map<std::uint64_t, Entry> cache;
+    std::uint64_t frame;
+    std::uint64_t hits;
+    std::uint64_t misses;
+    std::vector<T> key; // scratch signature
+
+public:
+    /**
+    * Constructor
+    * @param s - tessellation settings
+    **/
+    explicit Tessellator(const Settings& s = Settings()):settings(s),frame(0),hits(0),misses(0){}
+
+    /**
+    * Tessellate a Bezier curve (cached)
+    * @param curve - the curve
+    * @return Tessellation - the polyline, valid until NextFrame() or Clear()
+    **/
+    const Tessellation& Tessellate(const BezierCurve<T>& curve) {return Lookup(curve, 0);}
+
+    /**
+    * Tessellate a B-spline or NURBS curve (cached)
+    * @param curve - the curve
+    * @return Tessellation - the polyline, valid until NextFrame() or Clear()
+    **/
+    const Tessellation& Tessellate(const NURBSCurve<T>& curve) {return Lookup(curve, 1);}
+
+    /**
+    * Tessellate a Bezier patch (cached)
+    * @param patch - the patch
+    * @return Tessellation - the grid, valid until NextFrame() or Clear()
+    **/
+    const Tessellation& Tessellate(const BezierPatch<T>& patch) {return Lookup(patch, 2);}
+
+    /**
+    * Tessellate a curve without the cache
+    * Every polynomial segment starts as degree uniform pieces; pieces whose
+    * midpoint is farther than the tolerance from their chord are halved, one
+    * level at a time so each level is one batched evaluation.
+    * @param curve - a BezierCurve or NURBSCurve
+    * @param s - tessellation settings
+    * @param out - output, the polyline
+    **/
+    template<class Curve>
+    static void TessellateCurve(const Curve& curve, const Settings& s, Tessellation& out)
+    {
+        const std::vector<T>& breaks = curve.Breaks();
+        out.parameters.clear();
+        out.points.Clear();
+        out.uCount = out.vCount = 0;
+        if(breaks.size() < 2)
+            return;
+        int pieces = std::max(1, curve.Degree());
+        std::vector<T> t;
+        for(std::size_t k=0;k+1<breaks.size();k++)
+            for(int p=0;p<pieces;p++)
+                t.push_back(breaks[k]+(breaks[k+1]-breaks[k])*T(p)/T(pieces));
+        t.push_back(breaks.back());
+        PointArray3D<T> evaluated;
+        curve.Evaluate(t, evaluated);
+        std::vector<Vector3D<T> > points(t.size());
+        for(std::size_t i=0;i<t.size();i++)
+            points[i] = evaluated.Get(i);
+
+        std::vector<unsigned char> flat(t.size()-1, 0), nextFlat;
+        std::vector<T> mids, nextT;
+        std::vector<Vector3D<T> > nextPoints;
+        T tolSq = s.tolerance*s.tolerance;
+        for(unsigned depth=0;depth<s.maxDepth;depth++)
+        {
+            mids.clear();
+            for(std::size_t i=0;i+1<t.size();i++)
+                if(!flat[i])
+                    mids.push_back((t[i]+t[i+1])*T(0.5));
+            if(mids.empty())
+                break;
+            curve.Evaluate(mids, evaluated);
+            nextT.clear();
+            nextPoints.clear();
+            nextFlat.clear();
+            std::size_t m = 0;
+            for(std::size_t i=0;i+1<t.size();i++)
+            {
+                nextT.push_back(t[i]);
+                nextPoints.push_back(points[i]);
+                if(flat[i])
+                {
+                    nextFlat.push_back(1);
+                    continue;
+                }
+                Vector3D<T> mid = evaluated.Get(m);
+                if(ChordDistanceSq(mid, points[i], points[i+1]) > tolSq)
+                {
+                    nextT.push_back(mids[m]);
+                    nextPoints.push_back(mid);
+                    nextFlat.push_back(0);
+                    nextFlat.push_back(0);
+                }
+                else
+                    nextFlat.push_back(1);
+                m++;
+            }
+            nextT.push_back(t.back());
+            nextPoints.push_back(points.back());
+            t.swap(nextT);
+            points.swap(nextPoints);
+            flat.swap(nextFlat);
+        }
+        out.parameters.swap(t);
+        out.points = PointArray3D<T>(points);
+        out.uCount = points.size();
+        out.vCount = 1;
+    }
+
+    /**
+    * Tessellate a patch without the cache
+    * The grid density along each direction follows the flatness bound of a
+    * degree n Bezier curve sampled at N uniform pieces,
+    * n(n-1)/(8N^2)*max|P[i+2]-2P[i+1]+P[i]| <= tolerance/2, over the rows
+    * (or columns) of the control net.
+    * @param patch - the patch
+    * @param s - tessellation settings
+    * @param out - output, the grid
+    **/
+    static void TessellatePatch(const BezierPatch<T>& patch, const Settings& s, Tessellation& out)
+    {
+        out.parameters.clear();
+        out.points.Clear();
+        out.uCount = out.vCount = 0;
+        int du = patch.UDegree(), dv = patch.VDegree();
+        if(du < 0)
+            return;
+        const std::vector<Vector3D<T> >& net = patch.ControlPoints();
+        T secondU = T(0), secondV = T(0);
+        for(int i=0;i<=du;i++)
+        {
+            for(int j=0;j<=dv;j++)
+            {
+                const Vector3D<T>& p = net[i*(dv+1)+j];
+                if(i+2 <= du)
+                    secondU = std::max(secondU, (net[(i+2)*(dv+1)+j]-net[(i+1)*(dv+1)+j]*T(2)+p).Length());
+                if(j+2 <= dv)
+                    secondV = std::max(secondV, (net[i*(dv+1)+j+2]-net[i*(dv+1)+j+1]*T(2)+p).Length());
+            }
+        }
+        out.uCount = Pieces(du, secondU, s)+1;
+        out.vCount = Pieces(dv, secondV, s)+1;
+        std::vector<T> u(out.uCount), v(out.vCount);
+        for(std::size_t i=0;i<out.uCount;i++)
+            u[i] = T(i)/T(out.uCount-1);
+        for(std::size_t j=0;j<out.vCount;j++)
+            v[j] = T(j)/T(out.vCount-1);
+        patch.Evaluate(u, v, out.points);
+        out.parameters = u;
+        out.parameters.insert(out.parameters.end(), v.begin(), v.end());
+    }
+
+    /**
+    * Start a new frame, dropping cache entries unused for more than maxAge frames
+    **/
+    void NextFrame()
+    {
+        frame++;
+        for(typename std::unordered_map<std::uint64_t, Entry>::iterator it=cache.begin();it!=cache.end();)
+        {
+            if(frame-it->second.frame > settings.maxAge)
+                it = cache.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    /**
+    * Drop all cached results
+    **/
+    void Clear() {cache.clear();}
+
+    /**
+    * Get number of cached results
+    * @return std::size_t - the number of entries
+    **/
+    std::size_t CacheSize()const {return cache.size();}
+
+    /**
+    * Get number of lookups answered from the cache
+    * @return std::uint64_t - the hit count
+    **/
+    std::uint64_t Hits()const {return hits;}
+
+    /**
+    * Get number of lookups that had to tessellate
+    * @return std::uint64_t - the miss count
+    **/
+    std::uint64_t Misses()const {return misses;}
+
+    /**
+    * Get tessellation settings
+    * @return Settings - the settings
+    **/
+    const Settings& GetSettings()const {return settings;}
+
+private:
+    static T ChordDistanceSq(const Vector3D<T>& p, const Vector3D<T>& a, const Vector3D<T>& b)
+    {
+        Vector3D<T> ab = b-a, ap = p-a;
+        T len = ab.LengthSq();
+        T t = (len > T(0))?std::min(std::max(ap.Dot(ab)/len, T(0)), T(1)):T(0);
+        return (ap-ab*t).LengthSq();
+    }
+
+    static std::size_t Pieces(int degree, T second, const Settings& s)
+    {
+        std::size_t limit = std::size_t(1)<<std::min(s.maxDepth, 30u);
+        if(degree < 2 || !(second > T(0)))
+            return 1;
+        double n = std::ceil(std::sqrt(double(degree)*(degree-1)*double(second)/(4.0*double(s.tolerance))));
+        return (n >= double(limit) || !(n == n))?limit:std::max<std::size_t>(1, std::size_t(n));
+    }
+
+    static std::uint64_t Hash(const std::vector<T>& data)
+    {
+        // FNV-1a over the bytes
+        std::uint64_t h = 14695981039346656037ull;
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&data[0]);
+        for(std::size_t i=0;i<data.size()*sizeof(T);i++)
+            h = (h^bytes[i])*1099511628211ull;
+        return h;
+    }
+
+    static void Build(const BezierCurve<T>& curve, const Settings& s, Tessellation& out) {TessellateCurve(curve, s, out);}
+    static void Build(const NURBSCurve<T>& curve, const Settings& s, Tessellation& out) {TessellateCurve(curve, s, out);}
+    static void Build(const BezierPatch<T>& patch, const Settings& s, Tessellation& out) {TessellatePatch(patch, s, out);}
+
+    template<class Shape>
+    const Tessellation& Lookup(const Shape& shape, int kind)
+    {
+        key.clear();
+        key.push_back(T(kind));
+        key.push_back(settings.tolerance);
+        key.push_back(T(settings.maxDepth));
+        shape.Signature(key);
+        Entry& entry = cache[Hash(key)];
+        entry.frame = frame;
+        if(entry.signature.size() == key.size() && std::memcmp(&entry.signature[0], &key[0], key.size()*sizeof(T)) == 0)
+        {
+            hits++;
+            return entry.result;
+        }
+        misses++;
+        entry.signature = key;
+        Build(shape, settings, entry.result);
+        return entry.result;
+    }
+};
+
+typedef Tessellator<double> Tessellatord;
+typedef Tessellator<float> Tessellatorf;
+
+}
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef TRANSFORM_HIERARCHY_HPP
+#define TRANSFORM_HIERARCHY_HPP
+
+/**
+* Includes
+* Scene-graph transform hierarchy with incremental world-matrix updates
+* Levels are updated on the default executor, so link with pthread.
+**/
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <3DTools/Matrix3D.hpp>
+#include <3DTools/Parallel.hpp>
+
+namespace Tools3D {
+
+/**
+* Transform hierarchy
+* Every node has a local matrix and an optional parent; its world matrix is
+* local*parentWorld (points are row vectors, vec*mat, so the local transform
+* is applied first). Nodes are kept in flat arrays sorted breadth-first, so a
+* parent always comes before its children and every depth is one contiguous
+* range. SetLocal only flags a node; Update walks the levels in order,
+* recomputes the flagged nodes and everything below them, and leaves the
+* rest untouched, each level split over the default executor. Inverse world
+* matrices are computed on first request after a change.
+* Node ids returned by AddNode stay valid; positions in the arrays do not.
+**/
+template<class T>
+class TransformHierarchy
+{
+public:
+    typedef std::uint32_t NodeId;
+
+    // parent of a root node, and the id returned for invalid requests
+    static const NodeId None = 0xffffffffu;
+
+    /**
+    * Hierarchy settings
+    **/
+    struct Settings
+    {
+        unsigned threads; // threads per level (0 - DefaultExecutor().Concurrency())
+        std::size_t grain; // nodes per task; levels up to this size run on the caller
+
+        Settings():threads(0),grain(1024){}
+    };
+
+private:
+    Settings settings;
+    // by position (breadth-first once sorted)
+    std::vector<NodeId> parents; // parent position (None for roots)
+    std::vector<NodeId> ids; // node id of every position
+    std::vector<std::uint32_t> depths;
+    std::vector<Matrix3D<T> > locals;
+    std::vector<Matrix3D<T> > worlds;
+    std::vector<std::uint8_t> dirty; // local changed since the last Update
+    mutable std::vector<Matrix3D<T> > inverses;
+    mutable std::vector<std::uint8_t> inverseValid;
+    std::vector<std::size_t> levels; // depth d holds positions [levels[d], levels[d+1])
+    // by node id
+    std::vector<NodeId> positions;
+    bool sorted;
+    bool changed; // any dirty flag set
+
+public:
+    /**
+    * Constructor
+    * Creates an empty hierarchy
+    * @param s - hierarchy settings
+    **/
+    explicit TransformHierarchy(const Settings& s = Settings()):settings(s),sorted(true),changed(false)
+    {
+        settings.grain = std::max<std::size_t>(settings.grain, 1);
+    }
+
+    /**
+    * Add a node
+    * @param local - local matrix
+    * @param parent - parent node (None - a root)
+    * @return NodeId - the new node (None if parent is not a node)
+    **/
+    NodeId AddNode(const Matrix3D<T>& local, NodeId parent = None)
+    {
+        if(parent != None && parent >= positions.size())
+            return None;
+        NodeId id = NodeId(positions.size());
+        NodeId position = NodeId(ids.size());
+        NodeId parentPosition = (parent == None)?None:positions[parent];
+        std::uint32_t depth = (parent == None)?0:depths[parentPosition]+1;
+        // appending keeps the order breadth-first only if no level follows this one
+        if(!depths.empty() && depths.back() > depth)
+            sorted = false;
+        positions.push_back(position);
+        ids.push_back(id);
+        parents.push_back(parentPosition);
+        depths.push_back(depth);
+        locals.push_back(local);
+        worlds.push_back(local);
+        dirty.push_back(1);
+        inverses.push_back(Matrix3D<T>());
+        inverseValid.push_back(0);
+        changed = true;
+        return id;
+    }
+
+    /**
+    * Remove all nodes
+    **/
+    void Clear()
+    {
+        parents.clear();
+        ids.clear();
+        depths.clear();
+        locals.clear();
+        worlds.clear();
+        dirty.clear();
+        inverses.clear();
+        inverseValid.clear();
+        levels.clear();
+        positions.clear();
+        sorted = true;
+        changed = false;
+    }
+
+    /**
+    * Get number of nodes
+    * @return std::size_t - the number of nodes
+    **/
+    std::size_t Size()const {return positions.size();}
+
+    /**
+    * Get parent of a node
+    * @param id - the node
+    * @return NodeId - its parent (None for roots)
+    **/
+    NodeId Parent(NodeId id)const
+    {
+        NodeId p = parents[positions[id]];
+        return (p == None)?None:ids[p];
+    }
+
+    /**
+    * Get depth of a node
+    * @param id - the node
+    * @return std::uint32_t - 0 for roots
+    **/
+    std::uint32_t Depth(NodeId id)const {return depths[positions[id]];}
+
+    /**
+    * Set local matrix of a node (takes effect on the next Update)
+    * @param id - the node
+    * @param local - new local matrix
+    **/
+    void SetLocal(NodeId id, const Matrix3D<T>& local)
+    {
+        NodeId p = positions[id];
+        locals[p] = local;
+        dirty[p] = 1;
+        changed = true;
+    }
+
+    /**
+    * Get local matrix of a node
+    * @param id - the node
+    * @return Matrix3D - the local matrix
+    **/
+    const Matrix3D<T>& Local(NodeId id)const {return locals[positions[id]];}
+
+    /**
+    * Get world matrix of a node
+    * @param id - the node
+    * @return Matrix3D - the world matrix as of the last Update
+    **/
+    const Matrix3D<T>& World(NodeId id)const {return worlds[positions[id]];}
+
+    /**
+    * Get inverse world matrix of a node
+    * Computed on the first call after the world matrix changed (the world
+    * matrix is assumed affine). Not safe to call from several threads at once.
+    * @param id - the node
+    * @return Matrix3D - the inverse of World(id)
+    **/
+    const Matrix3D<T>& InverseWorld(NodeId id)const
+    {
+        NodeId p = positions[id];
+        if(!inverseValid[p])
+        {
+            inverses[p] = worlds[p].InverseAffine();
+            inverseValid[p] = 1;
+        }
+        return inverses[p];
+    }
+
+    /**
+    * Recompute the world matrices of changed nodes and their descendants
+    * @return std::size_t - number of world matrices recomputed
+    **/
+    std::size_t Update()
+    {
+        if(!sorted)
+            Sort();
+        if(!changed)
+            return 0;
+        if(levels.empty() || levels.back() != ids.size())
+            BuildLevels();
+        std::size_t total = 0;
+        for(std::size_t d=0;d+1<levels.size();d++)
+        {
+            std::size_t begin = levels[d], end = levels[d+1];
+            unsigned threads = (end-begin > settings.grain)?settings.threads:1u;
+            std::atomic<std::size_t> updated(0);
+            detail::ParallelFor(begin, end, settings.grain, threads, [&](std::size_t b, std::size_t e) {
+                const NodeId* parent = parents.data();
+                const Matrix3D<T>* local = locals.data();
+                Matrix3D<T>* world = worlds.data();
+                std::uint8_t* flags = dirty.data();
+                std::uint8_t* valid = inverseValid.data();
+                // flags first: dirty parents were handled on the previous level
+                // and pass their flag down. Keeping the byte stores out of the
+                // matrix loop lets the products run back to back
+                std::size_t count = 0;
+                for(std::size_t i=b;i<e;i++)
+                {
+                    if(parent[i] != None)
+                        flags[i] |= flags[parent[i]];
+                    valid[i] &= std::uint8_t(flags[i]^1);
+                    count += flags[i];
+                }
+                if(count == 0)
+                    return;
+                for(std::size_t i=b;i<e;i++)
+                {
+                    if(!flags[i])
+                        continue;
+                    NodeId p = parent[i];
+                    if(p == None)
+                        world[i] = local[i];
+                    else
+                        Matrix3D<T>::Multiply(local[i], world[p], world[i]);
+                }
+                updated += count;
+            });
+            total += updated.load();
+        }
+        std::fill(dirty.begin(), dirty.end(), std::uint8_t(0));
+        changed = false;
+        return total;
+    }
+
+private:
+    /**
+    * Put the nodes back in breadth-first order (stable, so siblings keep their order)
+    **/
+    void Sort()
+    {
+        std::size_t n = ids.size();
+        std::vector<NodeId> order(n);
+        for(std::size_t i=0;i<n;i++)
+            order[i] = NodeId(i);
+        std::stable_sort(order.begin(), order.end(), [&](NodeId a, NodeId b) {return depths[a] < depths[b];});
+        std::vector<NodeId> moved(n); // old position -> new position
+        for(std::size_t i=0;i<n;i++)
+            moved[order[i]] = NodeId(i);
+        Permute(order, ids);
+        Permute(order, depths);
+        Permute(order, locals);
+        Permute(order, worlds);
+        Permute(order, dirty);
+        Permute(order, inverses);
+        Permute(order, inverseValid);
+        Permute(order, parents);
+        for(std::size_t i=0;i<n;i++)
+        {
+            if(parents[i] != None)
+                parents[i] = moved[parents[i]];
+            positions[ids[i]] = NodeId(i);
+        }
+        BuildLevels();
+        sorted = true;
+    }
+
+    template<class V>
+    static void Permute(const std::vector<NodeId>& order, V& values)
+    {
+        V temp(values.size());
+        for(std::size_t i=0;i<order.size();i++)
+            temp[i] = values[order[i]];
+        values.swap(temp);
+    }
+
+    void BuildLevels()
+    {
+        levels.assign(1, 0);
+        for(std::size_t i=0;i<depths.size();i++)
+            while(depths[i] >= levels.size())
+                levels.push_back(i);
+        levels.push_back(depths.size());
+    }
+};
+
+typedef TransformHierarchy<double> TransformHierarchyd;
+typedef TransformHierarchy<float> TransformHierarchyf;
+
+}
+
+#endif
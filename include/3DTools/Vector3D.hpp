@@ -6,6 +6,7 @@
 **/
 #include <cmath>
 #include <limits>
+#include <3DTools/VectorExpr.hpp>
 
 namespace Tools3D {
 
@@ -17,8 +18,10 @@ class Matrix3D;
 * Simple 3D Vector Class
 **/
 template<class T>
-class Vector3D
+class Vector3D : public VectorExpr<Vector3D<T> >
 {
+public:
+    typedef T value_type;
 private:
     T x; // x component
     T y; // y component
@@ -28,7 +31,7 @@ public:
     * Default Constructor
     * Initializes x, y and z to zero
     **/
-    Vector3D():x(0.0),y(0.0),z(0.0){}
+    constexpr Vector3D():x(0.0),y(0.0),z(0.0){}
 
     /**
     * Constructor
@@ -36,65 +39,68 @@ public:
     * @param b - value to be assigned to y
     * @param c - value to be assigned to z
     **/
-    Vector3D(const T& a, const T& b, const T& c):x(a),y(b),z(c){}
+    constexpr Vector3D(const T& a, const T& b, const T& c):x(a),y(b),z(c){}
 
     /**
     * Copy Constructor
-    * @param other - Vector2D to copy from
+    * @param other - Vector3D to copy from
     **/
-    Vector3D(const Vector3D& other)
-    {
-        this->x = other.x;
-        this->y = other.y;
-        this->z = other.z;
-    }
+    constexpr Vector3D(const Vector3D& other) = default;
+
+    /**
+    * Constructor
+    * Evaluates a vector expression (see VectorExpr.hpp) in one pass
+    * @param e - expression to evaluate
+    **/
+    template<class E>
+    constexpr Vector3D(const VectorExpr<E>& e):x(e.Self().X()),y(e.Self().Y()),z(e.Self().Z()){}
 
     /**
     * Get X component
     * @return T - the X value
     **/
-    T X() {return x;}
+    constexpr T X()const {return x;}
 
     /**
     * Get Y component
     * @return T - the Y value
     **/
-    T Y() {return y;}
+    constexpr T Y()const {return y;}
 
     /**
     * Get Z component
     * @return T - the Z value
     **/
-    T Z() {return z;}
+    constexpr T Z()const {return z;}
 
     /**
     * Set X component
     * @param a - value to set
     **/
-    void SetX(T a) {x=a;}
+    constexpr void SetX(T a) {x=a;}
 
     /**
     * Set Y component
     * @param b - value to set
     **/
-    void SetY(T b) {y=b;}
+    constexpr void SetY(T b) {y=b;}
 
     /**
     * Set Z component
     * @param c - value to set
     **/
-    void SetZ(T c) {z=c;}
+    constexpr void SetZ(T c) {z=c;}
 
     /**
     * Make vector zero (x=y=z=0)
     **/
-    void Zero() {x=0.0;y=0.0;z=0.0;}
+    constexpr void Zero() {x=0.0;y=0.0;z=0.0;}
 
     /**
     * Test if vector is zero?
     * @return bool - true if vector is zero
     **/
-    bool IsZero()const {return (x*x+y*y+z*z)<std::numeric_limits<T>::epsilon();}
+    constexpr bool IsZero()const {return (x*x+y*y+z*z)<std::numeric_limits<T>::epsilon();}
 
     /**
     * Normalize vector
@@ -115,13 +121,13 @@ public:
     * Get Cross Product of Vectors
     * @return Vector3D - the cross product of the vectors
     **/
-    Vector3D Cross(const Vector3D& other) {return Vector3D(y*other.z-z*other.y, z*other.x-x*other.z, x*other.y-y*other.x);}
+    constexpr Vector3D Cross(const Vector3D& other)const {return Vector3D(y*other.z-z*other.y, z*other.x-x*other.z, x*other.y-y*other.x);}
 
     /**
     * Get Reverse Vector (-x,-y,-z)
     * @return Vector3D - the reversed vector
     **/
-    Vector3D Reverse(){return Vector3D(-x,-y,-z);}
+    constexpr Vector3D Reverse()const{return Vector3D(-x,-y,-z);}
 
     /**
     * Get Length of Vector
@@ -135,14 +141,14 @@ public:
     * @return T - length squared of the vector
     *  @see Length()
     **/
-    T LengthSq()const {return (x*x+y*y+z*z);}
+    constexpr T LengthSq()const {return (x*x+y*y+z*z);}
 
     /**
     * Dot product with other vector
     * @param other - vector to compute dot with
     * @return - the dot product
     **/
-    T Dot(const Vector3D& other)const
+    constexpr T Dot(const Vector3D& other)const
     {
         return (x*other.x+y*other.y+z*other.z);
     }
@@ -167,7 +173,7 @@ public:
     * @return T - distance squared to other vector
     * @see Distance()
     **/
-    T DistanceSq(const Vector3D& other)const
+    constexpr T DistanceSq(const Vector3D& other)const
     {
         T xSep = other.x-x;
         T ySep = other.y-y;
@@ -192,21 +198,50 @@ public:
     * mathematic operators (*,/,+,-)
     * equality operators (==,!=)
     **/
-    const Vector3D& operator-=(const Vector3D& other)
+    constexpr const Vector3D& operator-=(const Vector3D& other)
     {
         x -= other.x;
         y -= other.y;
         z -= other.z;
         return *this;
     }
-    const Vector3D& operator+=(const Vector3D& other)
+    constexpr const Vector3D& operator+=(const Vector3D& other)
     {
         x += other.x;
         y += other.y;
         z += other.z;
         return *this;
     }
-    const Vector3D& operator*=(const T& other)
+    // Used for vector expressions (component-wise, so the expression may contain this vector)
+    template<class E>
+    constexpr const Vector3D& operator=(const VectorExpr<E>& other)
+    {
+        const E& e = other.Self();
+        x = e.X();
+        y = e.Y();
+        z = e.Z();
+        return *this;
+    }
+    template<class E>
+    constexpr const Vector3D& operator+=(const VectorExpr<E>& other)
+    {
+        const E& e = other.Self();
+        x += e.X();
+        y += e.Y();
+        z += e.Z();
+        return *this;
+    }
+    template<class E>
+    constexpr const Vector3D& operator-=(const VectorExpr<E>& other)
+    {
+        const E& e = other.Self();
+        x -= e.X();
+        y -= e.Y();
+        z -= e.Z();
+        return *this;
+    }
+
+    constexpr const Vector3D& operator*=(const T& other)
     {
         x *= other;
         y *= other;
@@ -215,9 +250,9 @@ public:
     }
 
     // Used for Matrix-Vector multiplications
-    inline const Vector3D& operator*=(const Matrix3D<T>& other);
+    constexpr const Vector3D& operator*=(const Matrix3D<T>& other);
 
-    const Vector3D& operator/=(const T& other)
+    constexpr const Vector3D& operator/=(const T& other)
     {
         // Divide only if other is not zero
         if(other > std::numeric_limits<T>::epsilon())
@@ -229,11 +264,11 @@ public:
         return *this;
     }
 
-    bool operator==(const Vector3D& other)const
+    constexpr bool operator==(const Vector3D& other)const
     {
         return (x==other.x)&&(y==other.y)&&(z==other.z);
     }
-    bool operator!=(const Vector3D& other)const
+    constexpr bool operator!=(const Vector3D& other)const
     {
         return(x!=other.x)||(y!=other.y)||(z!=other.z);
     }
@@ -244,17 +279,21 @@ public:
 * mathematic operators
 * equality operators
 * dot products
+* (replaced by the expression operators of VectorExpr.hpp
+*  when TOOLS3D_EXPRESSION_TEMPLATES is defined)
 **/
 
+#if !defined(TOOLS3D_EXPRESSION_TEMPLATES)
+
 template<class T>
-T operator*(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
+constexpr T operator*(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
 {
     Vector3D<T> res = vec1;
     return res.Dot(vec2);
 }
 
 template<class T>
-Vector3D<T> operator*(const Vector3D<T>& vec, T val)
+constexpr Vector3D<T> operator*(const Vector3D<T>& vec, T val)
 {
     Vector3D<T> res = vec;
     res *= val;
@@ -262,7 +301,7 @@ Vector3D<T> operator*(const Vector3D<T>& vec, T val)
 }
 
 template<class T>
-Vector3D<T> operator*(T val, const Vector3D<T>& vec)
+constexpr Vector3D<T> operator*(T val, const Vector3D<T>& vec)
 {
     Vector3D<T> res = vec;
     res *= val;
@@ -270,7 +309,7 @@ Vector3D<T> operator*(T val, const Vector3D<T>& vec)
 }
 
 template<class T>
-Vector3D<T> operator+(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
+constexpr Vector3D<T> operator+(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
 {
     Vector3D<T> res = vec1;
     res += vec2;
@@ -278,7 +317,7 @@ Vector3D<T> operator+(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
 }
 
 template<class T>
-Vector3D<T> operator-(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
+constexpr Vector3D<T> operator-(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
 {
     Vector3D<T> res = vec1;
     res -= vec2;
@@ -286,13 +325,15 @@ Vector3D<T> operator-(const Vector3D<T>& vec1, const Vector3D<T>& vec2)
 }
 
 template<class T>
-Vector3D<T> operator/(const Vector3D<T>& vec, T val)
+constexpr Vector3D<T> operator/(const Vector3D<T>& vec, T val)
 {
     Vector3D<T> res = vec;
     res /= val;
     return res;
 }
 
+#endif
+
 typedef Vector3D<double> Vector3Dd;
 typedef Vector3D<float> Vector3Df;
 
@@ -0,0 +1,172 @@
+#ifndef VECTOR_EXPR_HPP
+#define VECTOR_EXPR_HPP
+
+/**
+* Includes
+* Expression templates for Vector3D arithmetic
+* Opt-in: define TOOLS3D_EXPRESSION_TEMPLATES before including Vector3D.hpp.
+* Then +, -, *, / build lightweight expression objects instead of Vector3D
+* temporaries, and a whole chain such as p + v*dt + a*(0.5*dt*dt) is
+* evaluated component by component in one pass when assigned to a Vector3D.
+* Note: expressions keep references to the Vector3D operands, so do not
+* store them (e.g. with auto) beyond the lifetime of those operands.
+**/
+#include <limits>
+
+namespace Tools3D {
+
+template<class T>
+class Vector3D;
+
+/**
+* Base of all vector expressions (CRTP)
+* Every expression E provides value_type and X(), Y(), Z()
+**/
+template<class E>
+class VectorExpr
+{
+public:
+    /**
+    * Get the actual expression
+    * @return E - the derived expression
+    **/
+    constexpr const E& Self()const {return static_cast<const E&>(*this);}
+};
+
+namespace detail {
+
+/**
+* How expressions hold their operands:
+* vectors by reference, intermediate expressions by value
+**/
+template<class E>
+struct ExprOperand { typedef const E type; };
+
+template<class T>
+struct ExprOperand<Vector3D<T> > { typedef const Vector3D<T>& type; };
+
+}
+
+/**
+* Expression for the sum of two vector expressions
+**/
+template<class L, class R>
+class VectorSum : public VectorExpr<VectorSum<L,R> >
+{
+private:
+    typename detail::ExprOperand<L>::type l; // left operand
+    typename detail::ExprOperand<R>::type r; // right operand
+public:
+    typedef typename L::value_type value_type;
+    constexpr VectorSum(const L& a, const R& b):l(a),r(b){}
+    constexpr value_type X()const {return l.X()+r.X();}
+    constexpr value_type Y()const {return l.Y()+r.Y();}
+    constexpr value_type Z()const {return l.Z()+r.Z();}
+};
+
+/**
+* Expression for the difference of two vector expressions
+**/
+template<class L, class R>
+class VectorDifference : public VectorExpr<VectorDifference<L,R> >
+{
+private:
+    typename detail::ExprOperand<L>::type l; // left operand
+    typename detail::ExprOperand<R>::type r; // right operand
+public:
+    typedef typename L::value_type value_type;
+    constexpr VectorDifference(const L& a, const R& b):l(a),r(b){}
+    constexpr value_type X()const {return l.X()-r.X();}
+    constexpr value_type Y()const {return l.Y()-r.Y();}
+    constexpr value_type Z()const {return l.Z()-r.Z();}
+};
+
+/**
+* Expression for a vector expression multiplied by a scalar
+**/
+template<class E>
+class VectorScaled : public VectorExpr<VectorScaled<E> >
+{
+public:
+    typedef typename E::value_type value_type;
+private:
+    typename detail::ExprOperand<E>::type e; // vector operand
+    value_type s; // scalar operand
+public:
+    constexpr VectorScaled(const E& a, const value_type& b):e(a),s(b){}
+    constexpr value_type X()const {return e.X()*s;}
+    constexpr value_type Y()const {return e.Y()*s;}
+    constexpr value_type Z()const {return e.Z()*s;}
+};
+
+/**
+* Expression for a vector expression divided by a scalar
+* Same rule as Vector3D::operator/=: divide only if the scalar is larger than epsilon
+**/
+template<class E>
+class VectorQuotient : public VectorExpr<VectorQuotient<E> >
+{
+public:
+    typedef typename E::value_type value_type;
+private:
+    typename detail::ExprOperand<E>::type e; // vector operand
+    value_type s; // scalar operand
+    bool divide; // whether the division takes place
+public:
+    constexpr VectorQuotient(const E& a, const value_type& b):e(a),s(b),divide(b > std::numeric_limits<value_type>::epsilon()){}
+    constexpr value_type X()const {return divide?e.X()/s:e.X();}
+    constexpr value_type Y()const {return divide?e.Y()/s:e.Y();}
+    constexpr value_type Z()const {return divide?e.Z()/s:e.Z();}
+};
+
+#if defined(TOOLS3D_EXPRESSION_TEMPLATES)
+
+/**
+* Functions Overloading basic operators for vector expressions
+* mathematic operators
+* dot products
+**/
+
+template<class L, class R>
+constexpr VectorSum<L,R> operator+(const VectorExpr<L>& a, const VectorExpr<R>& b)
+{
+    return VectorSum<L,R>(a.Self(), b.Self());
+}
+
+template<class L, class R>
+constexpr VectorDifference<L,R> operator-(const VectorExpr<L>& a, const VectorExpr<R>& b)
+{
+    return VectorDifference<L,R>(a.Self(), b.Self());
+}
+
+template<class E>
+constexpr VectorScaled<E> operator*(const VectorExpr<E>& a, typename E::value_type val)
+{
+    return VectorScaled<E>(a.Self(), val);
+}
+
+template<class E>
+constexpr VectorScaled<E> operator*(typename E::value_type val, const VectorExpr<E>& a)
+{
+    return VectorScaled<E>(a.Self(), val);
+}
+
+template<class E>
+constexpr VectorQuotient<E> operator/(const VectorExpr<E>& a, typename E::value_type val)
+{
+    return VectorQuotient<E>(a.Self(), val);
+}
+
+template<class L, class R>
+constexpr typename L::value_type operator*(const VectorExpr<L>& a, const VectorExpr<R>& b)
+{
+    const L& l = a.Self();
+    const R& r = b.Self();
+    return l.X()*r.X()+l.Y()*r.Y()+l.Z()*r.Z();
+}
+
+#endif
+
+}
+
+#endif
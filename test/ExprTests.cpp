@@ -0,0 +1,57 @@
+#define TOOLS3D_EXPRESSION_TEMPLATES
+#include <gtest/gtest.h>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+using namespace Tools3D;
+
+/**
+* Vector3D arithmetic with the expression template operators enabled
+**/
+
+ TEST(VectorExprTest, Arithmetic) {
+     Vector3Dd a(1.0, 2.0, 3.0);
+     Vector3Dd b(-4.0, 0.5, 2.0);
+     Vector3Dd c = a+b;
+     EXPECT_TRUE(c == Vector3Dd(-3.0, 2.5, 5.0));
+     c = a-b;
+     EXPECT_TRUE(c == Vector3Dd(5.0, 1.5, 1.0));
+     c = a*2.0;
+     EXPECT_TRUE(c == Vector3Dd(2.0, 4.0, 6.0));
+     c = 2.0*a;
+     EXPECT_TRUE(c == Vector3Dd(2.0, 4.0, 6.0));
+     c = a/2.0;
+     EXPECT_TRUE(c == Vector3Dd(0.5, 1.0, 1.5));
+     // same rule as operator/=: no division by (near) zero
+     c = a/0.0;
+     EXPECT_TRUE(c == a);
+     EXPECT_EQ(a*b, -4.0+1.0+6.0);
+ }
+
+ TEST(VectorExprTest, Chain) {
+     Vector3Dd p(1.0, 2.0, 3.0), v(0.5, -1.0, 2.0), acc(0.0, -9.81, 0.0);
+     double dt = 0.1;
+     Vector3Dd r = p + v*dt + acc*(0.5*dt*dt);
+     EXPECT_NEAR(r.X(), 1.0+0.05, 1e-12);
+     EXPECT_NEAR(r.Y(), 2.0-0.1-9.81*0.005, 1e-12);
+     EXPECT_NEAR(r.Z(), 3.0+0.2, 1e-12);
+     EXPECT_NEAR((p-v)*(p+v), p.LengthSq()-v.LengthSq(), 1e-12);
+ }
+
+ TEST(VectorExprTest, Aliasing) {
+     Vector3Df p(1.0f, 2.0f, 3.0f), v(1.0f, 1.0f, 1.0f);
+     p = p*2.0f + v;
+     EXPECT_TRUE(p == Vector3Df(3.0f, 5.0f, 7.0f));
+     p += p - v*3.0f;
+     EXPECT_TRUE(p == Vector3Df(3.0f, 7.0f, 11.0f));
+     p -= v/0.5f;
+     EXPECT_TRUE(p == Vector3Df(1.0f, 5.0f, 9.0f));
+ }
+
+ TEST(VectorExprTest, MatrixProducts) {
+     Matrix3Dd m;
+     m.Translate(1.0, 2.0, 3.0);
+     Vector3Dd a(1.0, 1.0, 1.0), b(1.0, 0.0, 0.0);
+     Vector3Dd c = a+b;
+     Vector3Dd r = c*m;
+     EXPECT_TRUE(r == Vector3Dd(3.0, 3.0, 4.0));
+ }
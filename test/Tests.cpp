@@ -1,6 +1,31 @@
 #include <gtest/gtest.h>
 #include <3DTools/Vector3D.hpp>
 #include <3DTools/Matrix3D.hpp>
+#include <3DTools/PointArray3D.hpp>
+#include <3DTools/QuantizedPoints.hpp>
+#include <3DTools/TransformBuilder.hpp>
+#include <3DTools/Affine3x4.hpp>
+#include <3DTools/TransformHierarchy.hpp>
+#include <3DTools/MatrixArray3D.hpp>
+#include <3DTools/Skinning.hpp>
+#include <3DTools/Morton.hpp>
+#include <3DTools/Quaternion.hpp>
+#include <3DTools/SinCos.hpp>
+#include <3DTools/AABB.hpp>
+#include <3DTools/BoundingSphere.hpp>
+#include <3DTools/Intersections3D.hpp>
+#include <3DTools/BVH.hpp>
+#include <3DTools/RayPacket.hpp>
+#include <3DTools/ConvexHull.hpp>
+#include <3DTools/BSP.hpp>
+#include <3DTools/PolyMesh.hpp>
+#include <3DTools/MappedFile.hpp>
+#include <3DTools/PointStream.hpp>
+#include <3DTools/KdTree.hpp>
+#include <3DTools/SpatialHash.hpp>
+#include <3DTools/Curves.hpp>
+#include <3DTools/Tessellator.hpp>
+#include <3DTools/Distances3D.hpp>
 using namespace Tools3D;
 
  TEST(Vector3DTest, DefaultConstructor) {
@@ -90,6 +115,2289 @@ using namespace Tools3D;
      EXPECT_EQ(t(2,2), 1);
  }
 
+ TEST(PointArray3DTest, Construction) {
+     std::vector<Vector3Dd> pts;
+     pts.push_back(Vector3Dd(1.0, 2.0, 3.0));
+     pts.push_back(Vector3Dd(-4.0, 5.0, -6.0));
+     PointArray3Dd arr(pts);
+     EXPECT_EQ(arr.Size(), 2u);
+     EXPECT_TRUE(arr.Get(0) == pts[0]);
+     EXPECT_TRUE(arr.Get(1) == pts[1]);
+     EXPECT_EQ(reinterpret_cast<std::size_t>(arr.X())%SIMDAlignment, 0u);
+ }
+
+ template<class T>
+ void CheckBatchTransform() {
+     Matrix3D<T> mat;
+     mat.RotateX(T(0.7));
+     mat.RotateZ(T(-0.2));
+     mat(3,0) = T(1.5); mat(3,1) = T(-2); mat(3,2) = T(3);
+     // odd size so both the vector and the scalar tail are exercised
+     PointArray3D<T> arr;
+     std::vector<Vector3D<T> > ref;
+     for(int i=0;i<37;i++) {
+         Vector3D<T> p(T(i), T(i*0.5-3), T(10-i));
+         arr.PushBack(p);
+         ref.push_back(p*mat);
+     }
+     Transform(arr, mat);
+     for(int i=0;i<37;i++) {
+         EXPECT_NEAR(arr.Get(i).X(), ref[i].X(), 1e-5*(1+std::fabs(ref[i].X())));
+         EXPECT_NEAR(arr.Get(i).Y(), ref[i].Y(), 1e-5*(1+std::fabs(ref[i].Y())));
+         EXPECT_NEAR(arr.Get(i).Z(), ref[i].Z(), 1e-5*(1+std::fabs(ref[i].Z())));
+     }
+ }
+
+ TEST(PointArray3DTest, TransformFloat) {
+     CheckBatchTransform<float>();
+ }
+
+ TEST(PointArray3DTest, TransformDouble) {
+     CheckBatchTransform<double>();
+ }
+
+ template<class T>
+ Matrix3D<T> SampleMatrix(int seed) {
+     Matrix3D<T> m;
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             m(i,j) = T(((i*7+j*3+seed*5)%11)-5)/T(3);
+     return m;
+ }
+
+ template<class T>
+ void CheckMultiply() {
+     Matrix3D<T> a = SampleMatrix<T>(1), b = SampleMatrix<T>(2);
+     Matrix3D<T> ab = a*b;
+     Matrix3D<T> aa = a;
+     aa *= aa;
+     for(int i=0;i<4;i++) {
+         for(int j=0;j<4;j++) {
+             T ref = 0, refSq = 0, mag = 0, magSq = 0;
+             for(int k=0;k<4;k++) {
+                 ref += a(i,k)*b(k,j);
+                 mag += std::fabs(a(i,k)*b(k,j));
+                 refSq += a(i,k)*a(k,j);
+                 magSq += std::fabs(a(i,k)*a(k,j));
+             }
+             // stated tolerance: a few ulp of sum_k |a_ik*b_kj|
+             EXPECT_NEAR(ab(i,j), ref, 4*std::numeric_limits<T>::epsilon()*mag);
+             EXPECT_NEAR(aa(i,j), refSq, 4*std::numeric_limits<T>::epsilon()*magSq);
+         }
+     }
+ }
+
+ TEST(Matrix3DTest, MultiplyFloat) {
+     CheckMultiply<float>();
+ }
+
+ TEST(Matrix3DTest, MultiplyDouble) {
+     CheckMultiply<double>();
+ }
+
+ template<class T>
+ void ExpectIdentity(const Matrix3D<T>& m, T tol) {
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             EXPECT_NEAR(m(i,j), (i==j)?T(1):T(0), tol);
+ }
+
+ TEST(Matrix3DTest, Det) {
+     Matrix3Dd m = SampleMatrix<double>(1);
+     m(0,0) = 0.5;
+     EXPECT_NEAR(m.Det(), 44.0/81.0, 1e-12);
+     Matrix3Dd r;
+     r.RotateX(0.5);
+     r(3,0) = 2;
+     EXPECT_NEAR(r.Det(), 1.0, 1e-12);
+ }
+
+ TEST(Matrix3DTest, Inverse) {
+     Matrix3Dd m = SampleMatrix<double>(1);
+     m(0,0) = 0.5;
+     double det = 0;
+     Matrix3Dd inv = m.Inverse(det);
+     EXPECT_NEAR(det, m.Det(), 1e-12);
+     ExpectIdentity(m*inv, 1e-12);
+     ExpectIdentity(inv*m, 1e-12);
+     // negative determinant (reflection)
+     Matrix3Dd refl;
+     refl(0,0) = -2;
+     refl(3,1) = 4;
+     EXPECT_NEAR(refl.Det(), -2.0, 1e-12);
+     ExpectIdentity(refl*refl.Inverse(), 1e-12);
+ }
+
+ TEST(Matrix3DTest, InverseAffine) {
+     Matrix3Dd m;
+     m.RotateX(0.3);
+     m.RotateZ(-1.2);
+     m(0,1) += 0.5; // shear
+     m(1,1) *= 2;   // non-uniform scale
+     m(3,0) = 1; m(3,1) = -2; m(3,2) = 3;
+     Matrix3Dd inv = m.InverseAffine();
+     Matrix3Dd ref = m.Inverse();
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             EXPECT_NEAR(inv(i,j), ref(i,j), 1e-12);
+     ExpectIdentity(m*inv, 1e-12);
+ }
+
+ TEST(Matrix3DTest, InverseRigid) {
+     Matrix3Df m;
+     m.RotateY(0.8f);
+     m.RotateX(-0.4f);
+     m(3,0) = 5; m(3,1) = 1; m(3,2) = -7;
+     Matrix3Df inv = m.InverseRigid();
+     Matrix3Df ref = m.Inverse();
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             EXPECT_NEAR(inv(i,j), ref(i,j), 1e-5f);
+     ExpectIdentity(m*inv, 1e-5f);
+ }
+
+ template<class T>
+ void ExpectMatrixNear(const Matrix3D<T>& a, const Matrix3D<T>& b, T tol) {
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             EXPECT_NEAR(a(i,j), b(i,j), tol);
+ }
+
+ TEST(Matrix3DTest, InPlaceTransforms) {
+     Matrix3Dd base = SampleMatrix<double>(2);
+     double c = cos(0.6), s = sin(0.6);
+     Matrix3Dd t, sc, rx, ry, rz;
+     t(3,0) = 1; t(3,1) = -2; t(3,2) = 3;
+     sc(0,0) = 2; sc(1,1) = 0.5; sc(2,2) = -1;
+     rx(1,1) = c; rx(1,2) = s; rx(2,1) = -s; rx(2,2) = c;
+     ry(0,0) = c; ry(2,0) = s; ry(0,2) = -s; ry(2,2) = c;
+     rz(0,0) = c; rz(0,1) = s; rz(1,0) = -s; rz(1,1) = c;
+     Matrix3Dd m = base;
+     m.Translate(1, -2, 3);
+     ExpectMatrixNear(m, base*t, 1e-12);
+     m = base;
+     m.Scale(2, 0.5, -1);
+     ExpectMatrixNear(m, base*sc, 1e-12);
+     m = base;
+     m.RotateX(0.6);
+     ExpectMatrixNear(m, base*rx, 1e-12);
+     m = base;
+     m.RotateY(0.6);
+     ExpectMatrixNear(m, base*ry, 1e-12);
+     m = base;
+     m.RotateZ(0.6);
+     ExpectMatrixNear(m, base*rz, 1e-12);
+ }
+
+ TEST(Matrix3DTest, TranslateZ) {
+     Matrix3Dd m;
+     m.Translate(2, 3, 4);
+     Vector3Dd p(1, 1, 1);
+     Vector3Dd r = p*m;
+     EXPECT_EQ(r.X(), 3.0);
+     EXPECT_EQ(r.Y(), 4.0);
+     EXPECT_EQ(r.Z(), 5.0);
+ }
+
+ TEST(Matrix3DTest, DataViews) {
+     Matrix3Dd m = SampleMatrix<double>(3);
+     const double* view = m.Data();
+     EXPECT_EQ(sizeof(Matrix3Dd), 16*sizeof(double));
+     double rows[16], cols[16];
+     m.CopyData(rows);
+     m.CopyData(cols, ColumnMajor);
+     for(int i=0;i<4;i++) {
+         for(int j=0;j<4;j++) {
+             EXPECT_EQ(view[i*4+j], m(i,j));
+             EXPECT_EQ(rows[i*4+j], m(i,j));
+             EXPECT_EQ(cols[j*4+i], m(i,j));
+         }
+     }
+     ExpectMatrixNear(Matrix3Dd::FromData(cols, ColumnMajor), m, 0.0);
+     ExpectMatrixNear(Matrix3Dd::FromData(rows), m, 0.0);
+     m.Data()[7] = 42;
+     EXPECT_EQ(m(1,3), 42.0);
+ }
+
+ template<class T>
+ void CheckAffine3x4(T tol) {
+     TransformBuilder<T> builder;
+     builder.Scale(T(2), T(0.5), T(3)).RotateX(T(0.3)).RotateZ(T(-1.1)).Translate(T(1), T(-2), T(4));
+     Matrix3D<T> a = builder.Build();
+     a(0,1) += T(0.25); // shear
+     Matrix3D<T> b;
+     b.RotateY(T(0.7));
+     b.Translate(T(-3), T(0.5), T(2));
+     Affine3x4<T> pa(a), pb(b);
+     EXPECT_EQ(sizeof(Affine3x4<T>), 12*sizeof(T));
+     // lossless round trip
+     ExpectMatrixNear(pa.Matrix(), a, T(0));
+     ExpectMatrixNear(Affine3x4<T>(builder.Build()).Matrix(), builder.BuildAffine().Matrix(), T(0));
+     // products, points and inverses agree with Matrix3D
+     ExpectMatrixNear((pa*pb).Matrix(), a*b, tol);
+     Affine3x4<T> pc = pa;
+     pc *= pc;
+     ExpectMatrixNear(pc.Matrix(), a*a, tol);
+     pc = pa;
+     Affine3x4<T>::Multiply(pc, pb, pc);
+     ExpectMatrixNear(pc.Matrix(), a*b, tol);
+     ExpectMatrixNear(pa.Inverse().Matrix(), a.InverseAffine(), tol);
+     EXPECT_NEAR(pa.Det(), a.Det(), tol);
+     ExpectMatrixNear((pa*pa.Inverse()).Matrix(), Matrix3D<T>(), tol);
+     Vector3D<T> p(T(0.5), T(-1.5), T(2)), q = p*pa, r = p*a;
+     EXPECT_NEAR(q.X(), r.X(), tol);
+     EXPECT_NEAR(q.Y(), r.Y(), tol);
+     EXPECT_NEAR(q.Z(), r.Z(), tol);
+     EXPECT_EQ(pa.Translation(), Vector3D<T>(a(3,0), a(3,1), a(3,2)));
+     // singular linear part
+     Affine3x4<T> flat(a);
+     flat(2,0) = flat(2,1) = flat(2,2) = T(0);
+     ExpectMatrixNear(flat.Inverse().Matrix(), Matrix3D<T>(), T(0));
+     // packed data: rows of the 4x3 part, or the 3x4 column-vector matrix
+     T cols[12];
+     pa.CopyData(cols, ColumnMajor);
+     for(int i=0;i<4;i++) {
+         for(int j=0;j<3;j++) {
+             EXPECT_EQ(pa.Data()[i*3+j], a(i,j));
+             EXPECT_EQ(cols[j*4+i], a(i,j));
+         }
+     }
+     // batch transform matches the Matrix3D one
+     std::vector<Vector3D<T> > raw;
+     for(int i=0;i<37;i++)
+         raw.push_back(Vector3D<T>(T(i), T(i%5)-T(2), T(1)/T(i+1)));
+     PointArray3D<T> points(raw), ref, out;
+     Transform(points, ref, a);
+     Transform(points, out, pa);
+     EXPECT_EQ(std::memcmp(ref.X(), out.X(), raw.size()*sizeof(T)), 0);
+     EXPECT_EQ(std::memcmp(ref.Z(), out.Z(), raw.size()*sizeof(T)), 0);
+     Transform(points, pa);
+     EXPECT_EQ(std::memcmp(ref.Y(), points.Y(), raw.size()*sizeof(T)), 0);
+ }
+
+ TEST(Affine3x4Test, MatchesMatrix3D) {
+     CheckAffine3x4<float>(1e-4f);
+     CheckAffine3x4<double>(1e-12);
+ }
+
+ TEST(TransformBuilderTest, MatchesMatrixMethods) {
+     Matrix3Dd ref;
+     ref.Scale(2, 3, 4);
+     ref.RotateX(0.3);
+     ref.Translate(1, 2, 3);
+     ref.RotateY(-0.7);
+     ref.RotateZ(1.1);
+     ref.Translate(-4, 0, 2);
+     TransformBuilderd builder;
+     builder.Scale(2, 3, 4).RotateX(0.3).Translate(1, 2, 3).RotateY(-0.7).RotateZ(1.1).Translate(-4, 0, 2);
+     ExpectMatrixNear(builder.Build(), ref, 1e-12);
+     Matrix3Dd base = SampleMatrix<double>(3);
+     Matrix3Dd applied = base;
+     builder.ApplyTo(applied);
+     ExpectMatrixNear(applied, base*ref, 1e-12);
+     builder.Reset();
+     ExpectIdentity(builder.Build(), 0.0);
+ }
+
+ TEST(QuaternionTest, MatchesMatrixRotations) {
+     Matrix3Dd rx, ry, rz;
+     rx.RotateX(0.4);
+     ry.RotateY(-1.3);
+     rz.RotateZ(2.2);
+     ExpectMatrixNear(Quaterniond::FromAxisAngle(Vector3Dd(1, 0, 0), 0.4).ToMatrix(), rx, 1e-12);
+     ExpectMatrixNear(Quaterniond::FromAxisAngle(Vector3Dd(0, 1, 0), -1.3).ToMatrix(), ry, 1e-12);
+     ExpectMatrixNear(Quaterniond::FromAxisAngle(Vector3Dd(0, 0, 1), 2.2).ToMatrix(), rz, 1e-12);
+ }
+
+ TEST(QuaternionTest, CompositionAndRotate) {
+     Quaterniond a = Quaterniond::FromAxisAngle(Vector3Dd(1, 2, 3), 0.7);
+     Quaterniond b = Quaterniond::FromAxisAngle(Vector3Dd(-1, 0, 2), -1.9);
+     // a followed by b, like Matrix3D products
+     ExpectMatrixNear((a*b).ToMatrix(), a.ToMatrix()*b.ToMatrix(), 1e-12);
+     Vector3Dd v(0.3, -2, 5);
+     Vector3Dd r1 = a.Rotate(v);
+     Vector3Dd r2 = v*a.ToMatrix();
+     EXPECT_NEAR(r1.X(), r2.X(), 1e-12);
+     EXPECT_NEAR(r1.Y(), r2.Y(), 1e-12);
+     EXPECT_NEAR(r1.Z(), r2.Z(), 1e-12);
+     Vector3Dd back = (a*a.Conjugate()).Rotate(v);
+     EXPECT_NEAR(back.X(), v.X(), 1e-12);
+     EXPECT_NEAR(back.Y(), v.Y(), 1e-12);
+     EXPECT_NEAR(back.Z(), v.Z(), 1e-12);
+ }
+
+ TEST(QuaternionTest, FromMatrix) {
+     // includes half turns around each axis, where w is zero
+     Vector3Dd axes[4] = {Vector3Dd(1, 0, 0), Vector3Dd(0, 1, 0), Vector3Dd(0, 0, 1), Vector3Dd(1, -1, 2)};
+     double angles[3] = {0.5, Pi, -2.5};
+     for(int i=0;i<4;i++) {
+         for(int j=0;j<3;j++) {
+             Quaterniond q = Quaterniond::FromAxisAngle(axes[i], angles[j]);
+             Quaterniond r = Quaterniond::FromMatrix(q.ToMatrix());
+             // q and -q are the same rotation
+             EXPECT_NEAR(std::fabs(q.Dot(r)), 1.0, 1e-12);
+         }
+     }
+ }
+
+ TEST(QuaternionTest, Interpolation) {
+     Quaterniond a = Quaterniond::FromAxisAngle(Vector3Dd(0, 0, 1), 0.2);
+     Quaterniond b = Quaterniond::FromAxisAngle(Vector3Dd(0, 0, 1), 1.4);
+     Quaterniond mid = Quaterniond::FromAxisAngle(Vector3Dd(0, 0, 1), 0.8);
+     EXPECT_NEAR(Slerp(a, b, 0.5).Dot(mid), 1.0, 1e-12);
+     EXPECT_NEAR(Slerp(a, b, 0.0).Dot(a), 1.0, 1e-12);
+     EXPECT_NEAR(Slerp(a, b, 1.0).Dot(b), 1.0, 1e-12);
+     // shortest path with the sign-flipped end orientation
+     Quaterniond nb = b;
+     nb *= -1.0;
+     EXPECT_NEAR(std::fabs(Slerp(a, nb, 0.5).Dot(mid)), 1.0, 1e-12);
+     EXPECT_NEAR(Nlerp(a, b, 0.5).Dot(mid), 1.0, 1e-12);
+     std::vector<Quaterniond> ka(5, a), kb(5, b), out;
+     kb[3] = nb;
+     EXPECT_TRUE(Slerp(ka, kb, 0.5, out));
+     ASSERT_EQ(out.size(), 5u);
+     for(int i=0;i<5;i++)
+         EXPECT_NEAR(std::fabs(out[i].Dot(mid)), 1.0, 1e-12);
+     EXPECT_TRUE(Nlerp(ka, kb, 0.25, out));
+     for(int i=0;i<5;i++)
+         EXPECT_NEAR(out[i].LengthSq(), 1.0, 1e-12);
+     // mismatched keyframe counts are rejected without touching out
+     std::vector<Quaterniond> shorter(3, b);
+     EXPECT_FALSE(Slerp(ka, shorter, 0.5, out));
+     EXPECT_FALSE(Nlerp(shorter, kb, 0.5, out));
+     EXPECT_EQ(out.size(), 5u);
+ }
+
+ TEST(SinCosTest, PolynomialAccuracy) {
+     // spans every quadrant, the range limits and a few angles beyond them (libm fallback)
+     std::vector<float> af;
+     std::vector<double> ad;
+     for(int i=-4000;i<=4000;i++) {
+         af.push_back(float(i)*2.0481f);
+         ad.push_back(double(i)*262.1443);
+     }
+     af.push_back(8192.0f); af.push_back(-8192.0f); af.push_back(1e6f);
+     ad.push_back(1048576.0); ad.push_back(-1048576.0); ad.push_back(1e12);
+     std::vector<float> sf(af.size()), cf(af.size());
+     std::vector<double> sd(ad.size()), cd(ad.size());
+     SinCos(&af[0], &sf[0], &cf[0], af.size());
+     SinCos(&ad[0], &sd[0], &cd[0], ad.size());
+     for(std::size_t i=0;i<af.size();i++) {
+         EXPECT_NEAR(sf[i], std::sin(double(af[i])), 1e-7);
+         EXPECT_NEAR(cf[i], std::cos(double(af[i])), 1e-7);
+     }
+     for(std::size_t i=0;i<ad.size();i++) {
+         EXPECT_NEAR(sd[i], std::sin(ad[i]), 4e-16);
+         EXPECT_NEAR(cd[i], std::cos(ad[i]), 4e-16);
+     }
+     // small angles keep full relative precision
+     double tiny = 1e-20, st, ct;
+     SinCos(&tiny, &st, &ct, 1);
+     EXPECT_EQ(st, tiny);
+     EXPECT_EQ(ct, 1.0);
+ }
+
+ TEST(SinCosTest, RotationMatrices) {
+     std::vector<double> angles;
+     for(int i=0;i<37;i++)
+         angles.push_back(-9.0+0.5*i);
+     std::vector<Matrix3Dd> out;
+     RotationAxis axes[3] = {AxisX, AxisY, AxisZ};
+     for(int a=0;a<3;a++) {
+         // the libm path is bit-identical to RotateX/Y/Z
+         RotationMatrices(angles, axes[a], out, SinCosLibm);
+         ASSERT_EQ(out.size(), angles.size());
+         for(std::size_t i=0;i<angles.size();i++) {
+             Matrix3Dd m;
+             if(a==0) m.RotateX(angles[i]);
+             if(a==1) m.RotateY(angles[i]);
+             if(a==2) m.RotateZ(angles[i]);
+             for(int r=0;r<4;r++)
+                 for(int c=0;c<4;c++)
+                     EXPECT_EQ(out[i](r,c), m(r,c));
+         }
+         RotationMatrices(angles, axes[a], out);
+         for(std::size_t i=0;i<angles.size();i++) {
+             Matrix3Dd m;
+             if(a==0) m.RotateX(angles[i]);
+             if(a==1) m.RotateY(angles[i]);
+             if(a==2) m.RotateZ(angles[i]);
+             for(int r=0;r<4;r++)
+                 for(int c=0;c<4;c++)
+                     EXPECT_NEAR(out[i](r,c), m(r,c), 1e-15);
+         }
+     }
+     // arbitrary axis: matches the quaternion rotation and the principal axes
+     Vector3Dd axis(1, -2, 0.5);
+     RotationMatrices(angles, axis, out);
+     for(std::size_t i=0;i<angles.size();i++) {
+         Matrix3Dd q = Quaterniond::FromAxisAngle(axis, angles[i]).ToMatrix();
+         for(int r=0;r<4;r++)
+             for(int c=0;c<4;c++)
+                 EXPECT_NEAR(out[i](r,c), q(r,c), 1e-14);
+     }
+     std::vector<Matrix3Dd> principal;
+     RotationMatrices(angles, Vector3Dd(0, 0, 2), out);
+     RotationMatrices(angles, AxisZ, principal);
+     for(std::size_t i=0;i<angles.size();i++)
+         for(int r=0;r<4;r++)
+             for(int c=0;c<4;c++)
+                 EXPECT_NEAR(out[i](r,c), principal[i](r,c), 1e-15);
+ }
+
+ template<class T>
+ void CheckBoundsReduction() {
+     // odd size so both the vector and the scalar tail are exercised,
+     // extremes placed in different lanes
+     PointArray3D<T> arr;
+     std::vector<Vector3D<T> > pts;
+     for(int i=0;i<1037;i++) {
+         Vector3D<T> p(T((i*37)%101)-T(50), T((i*53)%89)*T(0.5), -T((i*11)%97));
+         arr.PushBack(p);
+         pts.push_back(p);
+     }
+     AABB<T> box = AABB<T>::FromPoints(arr);
+     EXPECT_TRUE(box == AABB<T>::FromPoints(pts));
+     EXPECT_TRUE(box.Min() == Vector3D<T>(-50, 0, -96));
+     EXPECT_TRUE(box.Max() == Vector3D<T>(50, 44, 0));
+     BoundingSphere<T> sphere = BoundingSphere<T>::FromPoints(arr);
+     T r2 = sphere.Radius()*sphere.Radius()*T(1+1e-5);
+     for(std::size_t i=0;i<pts.size();i++)
+         EXPECT_LE(sphere.Center().DistanceSq(pts[i]), r2);
+     // never worse than the sphere around the box
+     EXPECT_LE(sphere.Radius(), BoundingSphere<T>::FromAABB(box).Radius());
+ }
+
+ TEST(AABBTest, FromPointsFloat) {
+     CheckBoundsReduction<float>();
+ }
+
+ TEST(AABBTest, FromPointsDouble) {
+     CheckBoundsReduction<double>();
+ }
+
+ TEST(AABBTest, Queries) {
+     AABBd empty;
+     EXPECT_TRUE(empty.Empty());
+     EXPECT_EQ(empty.Volume(), 0.0);
+     EXPECT_TRUE(AABBd::FromPoints(PointArray3Dd()).Empty());
+     AABBd box(Vector3Dd(0, 0, 0), Vector3Dd(2, 4, 6));
+     EXPECT_EQ(box.Volume(), 48.0);
+     EXPECT_EQ(box.SurfaceArea(), 88.0);
+     EXPECT_TRUE(box.Contains(Vector3Dd(2, 0, 3)));
+     EXPECT_FALSE(box.Contains(Vector3Dd(2.1, 0, 3)));
+     EXPECT_TRUE(box.Intersects(AABBd(Vector3Dd(2, 4, 6), Vector3Dd(3, 5, 7))));
+     EXPECT_FALSE(box.Intersects(AABBd(Vector3Dd(2, 4.5, 6), Vector3Dd(3, 5, 7))));
+     EXPECT_FALSE(box.Intersects(empty));
+     EXPECT_EQ(box.DistanceSq(Vector3Dd(-1, 5, 3)), 2.0);
+     empty.Expand(box);
+     EXPECT_TRUE(empty == box);
+ }
+
+ TEST(AABBTest, TransformArvo) {
+     Matrix3Dd mat;
+     mat.Scale(1, 2, -0.5);
+     mat.RotateX(0.4);
+     mat.RotateY(-1.3);
+     mat.Translate(3, -1, 2);
+     AABBd box(Vector3Dd(-1, 2, 0.5), Vector3Dd(3, 2.5, 4));
+     // box of the 8 transformed corners
+     AABBd ref;
+     for(int i=0;i<8;i++) {
+         Vector3Dd corner((i&1)?box.Max().X():box.Min().X(), (i&2)?box.Max().Y():box.Min().Y(), (i&4)?box.Max().Z():box.Min().Z());
+         ref.Expand(corner*mat);
+     }
+     AABBd t = box.Transform(mat);
+     EXPECT_NEAR(t.Min().X(), ref.Min().X(), 1e-12);
+     EXPECT_NEAR(t.Min().Y(), ref.Min().Y(), 1e-12);
+     EXPECT_NEAR(t.Min().Z(), ref.Min().Z(), 1e-12);
+     EXPECT_NEAR(t.Max().X(), ref.Max().X(), 1e-12);
+     EXPECT_NEAR(t.Max().Y(), ref.Max().Y(), 1e-12);
+     EXPECT_NEAR(t.Max().Z(), ref.Max().Z(), 1e-12);
+     std::vector<AABBd> boxes(3, box);
+     boxes[1] = AABBd();
+     Transform(boxes, mat);
+     EXPECT_TRUE(boxes[0] == t);
+     EXPECT_TRUE(boxes[1].Empty());
+ }
+
+ TEST(BoundingSphereTest, Queries) {
+     BoundingSphered s(Vector3Dd(1, 0, 0), 2);
+     EXPECT_TRUE(s.Contains(Vector3Dd(3, 0, 0)));
+     EXPECT_FALSE(s.Contains(Vector3Dd(3, 0.1, 0)));
+     EXPECT_TRUE(s.Intersects(BoundingSphered(Vector3Dd(4, 0, 0), 1)));
+     EXPECT_TRUE(s.Intersects(AABBd(Vector3Dd(3, -1, -1), Vector3Dd(4, 1, 1))));
+     EXPECT_FALSE(s.Intersects(AABBd(Vector3Dd(3, 2, -1), Vector3Dd(4, 3, 1))));
+     BoundingSphered e;
+     EXPECT_TRUE(e.Empty());
+     e.Expand(Vector3Dd(0, 0, 0));
+     e.Expand(Vector3Dd(2, 0, 0));
+     EXPECT_NEAR(e.Radius(), 1.0, 1e-15);
+     EXPECT_TRUE(e.Center() == Vector3Dd(1, 0, 0));
+     e.Expand(s);
+     EXPECT_TRUE(e.Center() == s.Center());
+     EXPECT_EQ(e.Radius(), s.Radius());
+     // rotation + non-uniform scale: the radius grows by the largest scale
+     Matrix3Dd mat;
+     mat.Scale(2, -3, 0.5);
+     mat.RotateZ(0.9);
+     mat.RotateX(0.3);
+     mat.Translate(1, 2, 3);
+     BoundingSphered t = s.Transform(mat);
+     EXPECT_NEAR(t.Radius(), 6.0, 1e-12);
+     Vector3Dd c = s.Center()*mat;
+     EXPECT_NEAR(t.Center().Distance(c), 0.0, 1e-12);
+ }
+
+ TEST(IntersectionsTest, RayTriangle) {
+     Vector3Dd v0(0, 0, 0), v1(1, 0, 0), v2(0, 1, 0);
+     double t, u, v;
+     EXPECT_TRUE(IntersectRayTriangle(Rayd(Vector3Dd(0.25, 0.5, 2), Vector3Dd(0, 0, -1)), v0, v1, v2, t, u, v));
+     EXPECT_NEAR(t, 2.0, 1e-15);
+     EXPECT_NEAR(u, 0.25, 1e-15);
+     EXPECT_NEAR(v, 0.5, 1e-15);
+     // back side, behind the origin, outside, parallel
+     EXPECT_TRUE(IntersectRayTriangle(Rayd(Vector3Dd(0.25, 0.5, -2), Vector3Dd(0, 0, 1)), v0, v1, v2, t, u, v));
+     EXPECT_FALSE(IntersectRayTriangle(Rayd(Vector3Dd(0.25, 0.5, 2), Vector3Dd(0, 0, 1)), v0, v1, v2, t, u, v));
+     EXPECT_FALSE(IntersectRayTriangle(Rayd(Vector3Dd(0.75, 0.5, 2), Vector3Dd(0, 0, -1)), v0, v1, v2, t, u, v));
+     EXPECT_FALSE(IntersectRayTriangle(Rayd(Vector3Dd(0.25, 0.5, 0), Vector3Dd(1, 0, 0)), v0, v1, v2, t, u, v));
+     double tn, tf;
+     AABBd box(Vector3Dd(-1, -1, -1), Vector3Dd(1, 1, 1));
+     EXPECT_TRUE(IntersectRayAABB(Rayd(Vector3Dd(-3, 0.5, 0), Vector3Dd(1, 0, 0)), box, tn, tf));
+     EXPECT_EQ(tn, 2.0);
+     EXPECT_EQ(tf, 4.0);
+     EXPECT_FALSE(IntersectRayAABB(Rayd(Vector3Dd(-3, 1.5, 0), Vector3Dd(1, 0, 0)), box, tn, tf));
+ }
+
+ template<class T>
+ void CheckBVH(unsigned threads) {
+     // a wavy grid plus some random triangles floating above it
+     std::vector<Vector3D<T> > verts;
+     std::vector<std::uint32_t> indices;
+     const int n = 40;
+     for(int i=0;i<=n;i++)
+         for(int j=0;j<=n;j++)
+             verts.push_back(Vector3D<T>(T(i), T(std::sin(i*0.3)+std::cos(j*0.2)), T(j)));
+     for(int i=0;i<n;i++) {
+         for(int j=0;j<n;j++) {
+             std::uint32_t a = i*(n+1)+j, b = a+1, c = a+n+1, d = c+1;
+             indices.push_back(a); indices.push_back(c); indices.push_back(b);
+             indices.push_back(b); indices.push_back(c); indices.push_back(d);
+         }
+     }
+     srand(3);
+     for(int k=0;k<300;k++) {
+         Vector3D<T> p(T(rand()%400)/T(10), T(2+rand()%50)/T(10), T(rand()%400)/T(10));
+         for(int m=0;m<3;m++) {
+             indices.push_back(std::uint32_t(verts.size()));
+             verts.push_back(p+Vector3D<T>(T(rand()%20)/T(10), T(rand()%20)/T(10), T(rand()%20)/T(10)));
+         }
+     }
+     typename BVH<T>::Settings settings;
+     settings.threads = threads;
+     BVH<T> bvh(verts, indices, settings);
+     std::size_t triCount = indices.size()/3;
+     ASSERT_EQ(bvh.TriangleCount(), triCount);
+     // every triangle is referenced by exactly one leaf
+     std::vector<int> seen(triCount, 0);
+     for(std::size_t i=0;i<bvh.Nodes().size();i++) {
+         const typename BVH<T>::Node& node = bvh.Nodes()[i];
+         for(std::uint32_t k=node.offset;node.count>0 && k<node.offset+node.count;k++)
+             seen[bvh.TriangleIndex(k)]++;
+     }
+     for(std::size_t i=0;i<triCount;i++)
+         EXPECT_EQ(seen[i], 1);
+     // closest and any hit match brute force
+     for(int r=0;r<500;r++) {
+         Vector3D<T> o(T(rand()%400)/T(10), T(8), T(rand()%400)/T(10));
+         Vector3D<T> d(T(rand()%200-100)/T(100), T(-1), T(rand()%200-100)/T(100));
+         if(r%5 == 0)
+             d = Vector3D<T>(T(rand()%200-100)/T(100), T(0), T(1));
+         Ray<T> ray(o, d);
+         RayHit<T> ref;
+         for(std::size_t t=0;t<triCount;t++) {
+             T th, u, v;
+             if(IntersectRayTriangle(ray, verts[indices[3*t]], verts[indices[3*t+1]], verts[indices[3*t+2]], th, u, v) && th < ref.t) {
+                 ref.t = th;
+                 ref.triangle = t;
+             }
+         }
+         RayHit<T> hit;
+         EXPECT_EQ(bvh.Intersect(ray, hit), ref.Hit());
+         EXPECT_EQ(bvh.Occluded(ray), ref.Hit());
+         if(ref.Hit()) {
+             EXPECT_NEAR(hit.t, ref.t, T(1e-4));
+             EXPECT_FALSE(bvh.Occluded(ray, ref.t*T(0.99)));
+         }
+     }
+ }
+
+ TEST(BVHTest, MatchesBruteForce) {
+     CheckBVH<float>(1);
+     CheckBVH<double>(1);
+     CheckBVH<float>(4);
+ }
+
+ TEST(BVHTest, Empty) {
+     BVHd bvh;
+     RayHit<double> hit;
+     EXPECT_TRUE(bvh.Empty());
+     EXPECT_FALSE(bvh.Intersect(Rayd(), hit));
+     EXPECT_FALSE(bvh.Occluded(Rayd()));
+     // a single triangle and many coincident ones
+     std::vector<Vector3Dd> soup(3*600, Vector3Dd(0, 0, 0));
+     for(int i=0;i<600;i++) {
+         soup[3*i+1] = Vector3Dd(1, 0, 0);
+         soup[3*i+2] = Vector3Dd(0, 1, 0);
+     }
+     bvh.Build(soup, std::vector<std::uint32_t>());
+     EXPECT_TRUE(bvh.Intersect(Rayd(Vector3Dd(0.2, 0.2, 1), Vector3Dd(0, 0, -1)), hit));
+     EXPECT_EQ(hit.t, 1.0);     // indices without vertices give an empty hierarchy
+     bvh.Build(std::vector<Vector3Dd>(), std::vector<std::uint32_t>(3, 0));
+     EXPECT_TRUE(bvh.Empty());
+ }
+
+ template<class T>
+ void CheckRayPacket() {
+     // 37 triangles and 45 rays, so the SIMD paths also run their scalar tails
+     srand(11);
+     std::vector<Vector3D<T> > verts;
+     for(int i=0;i<3*37;i++)
+         verts.push_back(Vector3D<T>(T(rand()%100)/T(10), T(rand()%100)/T(10), T(rand()%20)/T(10)));
+     TriangleArray3D<T> tris(verts, std::vector<std::uint32_t>());
+     ASSERT_EQ(tris.Size(), 37u);
+     std::vector<Ray<T> > rays;
+     for(int i=0;i<45;i++)
+         rays.push_back(Ray<T>(Vector3D<T>(T(rand()%100)/T(10), T(rand()%100)/T(10), T(5)),
+                               Vector3D<T>(T(rand()%100-50)/T(100), T(rand()%100-50)/T(100), T(-1))));
+     RayArray3D<T> packet(rays);
+     IntersectRays(packet, tris);
+     int hits = 0;
+     for(std::size_t r=0;r<rays.size();r++) {
+         RayHit<T> ref;
+         for(std::size_t i=0;i<tris.Size();i++) {
+             T t, u, v;
+             if(IntersectRayTriangle(rays[r], verts[3*i], verts[3*i+1], verts[3*i+2], t, u, v) && t < ref.t) {
+                 ref.t = t;
+                 ref.u = u;
+                 ref.v = v;
+                 ref.triangle = i;
+             }
+         }
+         RayHit<T> one;
+         EXPECT_EQ(IntersectRayTriangles(rays[r], tris, one), ref.Hit());
+         RayHit<T> many = packet.GetHit(r);
+         EXPECT_EQ(many.Hit(), ref.Hit());
+         if(ref.Hit()) {
+             hits++;
+             EXPECT_EQ(one.triangle, ref.triangle);
+             EXPECT_EQ(many.triangle, ref.triangle);
+             EXPECT_NEAR(one.t, ref.t, T(1e-4));
+             EXPECT_NEAR(many.t, ref.t, T(1e-4));
+             EXPECT_NEAR(many.u, ref.u, T(1e-4));
+             EXPECT_NEAR(many.v, ref.v, T(1e-4));
+             // nothing closer than the closest hit
+             EXPECT_FALSE(IntersectRayTriangles(rays[r], tris, one, ref.t*T(0.999)));
+         }
+     }
+     EXPECT_GT(hits, 10);
+     packet.ResetHits();
+     EXPECT_FALSE(packet.GetHit(0).Hit());
+ }
+
+ TEST(RayPacketTest, MatchesScalar) {
+     CheckRayPacket<float>();
+     CheckRayPacket<double>();
+ }
+
+ template<class T>
+ void CheckHull(const ConvexHull3D<T>& hull, const std::vector<Vector3D<T> >& points, double tol) {
+     ASSERT_EQ(hull.Dimension(), 3);
+     const std::vector<std::uint32_t>& idx = hull.Indices();
+     // closed 2-manifold: every directed edge appears once and its reverse once
+     std::vector<std::pair<std::uint32_t, std::uint32_t> > edges;
+     for(std::size_t f=0;f<idx.size();f+=3)
+         for(int k=0;k<3;k++)
+             edges.push_back(std::make_pair(idx[f+k], idx[f+(k+1)%3]));
+     std::sort(edges.begin(), edges.end());
+     EXPECT_TRUE(std::adjacent_find(edges.begin(), edges.end()) == edges.end());
+     for(std::size_t e=0;e<edges.size();e++)
+         EXPECT_TRUE(std::binary_search(edges.begin(), edges.end(), std::make_pair(edges[e].second, edges[e].first)));
+     // Euler characteristic of a sphere
+     EXPECT_EQ(int(hull.Vertices().size())-int(edges.size()/2)+int(hull.FaceCount()), 2);
+     // every point is inside or on every face (measured in double)
+     std::vector<Vector3Dd> p;
+     for(std::size_t i=0;i<points.size();i++)
+         p.push_back(Vector3Dd(points[i].X(), points[i].Y(), points[i].Z()));
+     for(std::size_t f=0;f<idx.size();f+=3) {
+         Vector3Dd n = (p[idx[f+1]]-p[idx[f]]).Cross(p[idx[f+2]]-p[idx[f]]);
+         n.Normalize();
+         for(std::size_t i=0;i<p.size();i++)
+             ASSERT_LE(n.Dot(p[i]-p[idx[f]]), tol);
+     }
+ }
+
+ TEST(ConvexHullTest, RandomClouds) {
+     srand(5);
+     std::vector<Vector3Dd> cube, sphere;
+     for(int i=0;i<100000;i++)
+         cube.push_back(Vector3Dd(double(rand())/RAND_MAX, double(rand())/RAND_MAX, double(rand())/RAND_MAX));
+     for(int i=0;i<2000;i++) {
+         Vector3Dd p(double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5, double(rand())/RAND_MAX-0.5);
+         p.Normalize();
+         sphere.push_back(p*3.0);
+     }
+     ConvexHull3Dd::Settings serial, parallel;
+     serial.threads = 1;
+     parallel.threads = 4;
+     ConvexHull3Dd a(cube, serial), b(cube, parallel);
+     CheckHull(a, cube, 1e-12);
+     EXPECT_EQ(a.Vertices(), b.Vertices());
+     EXPECT_EQ(a.FaceCount(), b.FaceCount());
+     // every point of a sphere is a hull vertex
+     ConvexHull3Dd c(sphere);
+     CheckHull(c, sphere, 1e-12);
+     EXPECT_EQ(c.Vertices().size(), sphere.size());
+     // float and SoA input
+     std::vector<Vector3Df> cubef;
+     for(std::size_t i=0;i<cube.size();i++)
+         cubef.push_back(Vector3Df(float(cube[i].X()), float(cube[i].Y()), float(cube[i].Z())));
+     ConvexHull3Df d;
+     d.Build(PointArray3Df(cubef), ConvexHull3Df::Settings());
+     CheckHull(d, cubef, 1e-5f);
+ }
+
+ TEST(ConvexHullTest, Degenerate) {
+     // cube corners plus points on its faces, edges and inside: only the 8 corners are vertices
+     std::vector<Vector3Dd> points;
+     for(int i=0;i<=4;i++)
+         for(int j=0;j<=4;j++)
+             for(int k=0;k<=4;k++)
+                 points.push_back(Vector3Dd(i*0.25, j*0.25, k*0.25));
+     ConvexHull3Dd hull(points);
+     CheckHull(hull, points, 1e-12);
+     EXPECT_EQ(hull.Vertices().size(), 8u);
+     EXPECT_EQ(hull.FaceCount(), 12u);
+     // coplanar: a tilted 5x5 grid gives a two-sided quad
+     std::vector<Vector3Dd> flat;
+     for(int i=0;i<5;i++)
+         for(int j=0;j<5;j++)
+             flat.push_back(Vector3Dd(i, j, 0.5*i+0.25*j));
+     hull.Build(flat);
+     EXPECT_EQ(hull.Dimension(), 2);
+     EXPECT_EQ(hull.Vertices(), std::vector<std::uint32_t>({0, 4, 20, 24}));
+     EXPECT_EQ(hull.FaceCount(), 4u);
+     // collinear, coincident and empty
+     std::vector<Vector3Dd> line;
+     for(int i=0;i<10;i++)
+         line.push_back(Vector3Dd(1, 2, 3)+Vector3Dd(1, -1, 2)*double((i*7)%10));
+     hull.Build(line);
+     EXPECT_EQ(hull.Dimension(), 1);
+     EXPECT_EQ(hull.Vertices(), std::vector<std::uint32_t>({0, 7}));
+     hull.Build(std::vector<Vector3Dd>(5, Vector3Dd(1, 1, 1)));
+     EXPECT_EQ(hull.Dimension(), 0);
+     EXPECT_EQ(hull.Vertices().size(), 1u);
+     hull.Build(std::vector<Vector3Dd>());
+     EXPECT_EQ(hull.Dimension(), -1);
+     EXPECT_EQ(hull.FaceCount(), 0u);
+ }
+
+ template<class T>
+ void StarMesh(std::vector<Vector3D<T> >& soup) {
+     // subdivided octahedron (outward winding) pushed out to a bumpy, non-convex radius
+     std::vector<Vector3Dd> tris;
+     Vector3Dd axis[6] = {Vector3Dd(1, 0, 0), Vector3Dd(0, 1, 0), Vector3Dd(-1, 0, 0), Vector3Dd(0, -1, 0), Vector3Dd(0, 0, 1), Vector3Dd(0, 0, -1)};
+     for(int i=0;i<4;i++) {
+         Vector3Dd a = axis[i], b = axis[(i+1)%4];
+         tris.push_back(a); tris.push_back(b); tris.push_back(axis[4]);
+         tris.push_back(b); tris.push_back(a); tris.push_back(axis[5]);
+     }
+     for(int level=0;level<3;level++) {
+         std::vector<Vector3Dd> finer;
+         for(std::size_t t=0;t<tris.size();t+=3) {
+             Vector3Dd a = tris[t], b = tris[t+1], c = tris[t+2];
+             Vector3Dd ab = a+b, bc = b+c, ca = c+a;
+             ab.Normalize(); bc.Normalize(); ca.Normalize();
+             Vector3Dd sub[12] = {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca};
+             finer.insert(finer.end(), sub, sub+12);
+         }
+         tris.swap(finer);
+     }
+     soup.clear();
+     for(std::size_t i=0;i<tris.size();i++) {
+         Vector3Dd d = tris[i];
+         double r = 1.0+0.4*std::sin(3*std::atan2(d.Y(), d.X()))*d.Z()*d.Z();
+         soup.push_back(Vector3D<T>(T(d.X()*r), T(d.Y()*r), T(d.Z()*r)));
+     }
+ }
+
+ template<class T>
+ void CheckBSP() {
+     std::vector<Vector3D<T> > soup;
+     StarMesh(soup);
+     BSPTree<T> tree(soup, std::vector<std::uint32_t>());
+     EXPECT_GE(tree.PolygonCount(), soup.size()/3);
+     // inside/outside against ray parity (majority of three directions)
+     srand(3);
+     Vector3D<T> dirs[3] = {Vector3D<T>(T(0.31), T(0.52), T(0.79)), Vector3D<T>(T(-0.6), T(0.27), T(0.11)), Vector3D<T>(T(0.05), T(-0.9), T(0.33))};
+     std::vector<Vector3D<T> > probes;
+     int inside = 0;
+     for(int i=0;i<500;i++) {
+         Vector3D<T> p(T(rand()%1000)/T(300)-T(1.66), T(rand()%1000)/T(300)-T(1.66), T(rand()%1000)/T(300)-T(1.66));
+         probes.push_back(p);
+         BSPLocation loc = tree.Classify(p);
+         if(loc == BSPLocation::Boundary)
+             continue;
+         int votes = 0;
+         for(int k=0;k<3;k++) {
+             int crossings = 0;
+             for(std::size_t t=0;t<soup.size();t+=3) {
+                 T h, u, v;
+                 crossings += IntersectRayTriangle(Ray<T>(p, dirs[k]), soup[t], soup[t+1], soup[t+2], h, u, v);
+             }
+             votes += crossings%2;
+         }
+         EXPECT_EQ(loc == BSPLocation::Inside, votes >= 2);
+         inside += (loc == BSPLocation::Inside);
+     }
+     EXPECT_GT(inside, 30);
+     EXPECT_EQ(tree.Classify(soup[0]), BSPLocation::Boundary);
+     // front-to-back: the first fragment a ray from the eye meets is the closest one
+     Vector3D<T> eye(T(2.5), T(-1.5), T(1));
+     std::vector<std::uint32_t> order;
+     tree.TraverseFrontToBack(eye, [&](std::uint32_t f) {order.push_back(f);});
+     ASSERT_EQ(order.size(), tree.PolygonCount());
+     BSPView<T> view = tree.View();
+     for(int r=0;r<40;r++) {
+         Ray<T> ray(eye, Vector3D<T>(T(rand()%100)/T(100)-T(0.5), T(rand()%100)/T(100)-T(0.5), T(rand()%100)/T(100)-T(0.5))-eye);
+         T closest = std::numeric_limits<T>::infinity(), first = closest;
+         for(std::size_t i=0;i<order.size();i++) {
+             typename BSPView<T>::Polygon poly = view.GetPolygon(order[i]);
+             for(std::uint32_t k=1;k+1<poly.vertexCount;k++) {
+                 T h, u, v;
+                 if(IntersectRayTriangle(ray, view.Vertex(poly.firstVertex), view.Vertex(poly.firstVertex+k), view.Vertex(poly.firstVertex+k+1), h, u, v)) {
+                     closest = std::min(closest, h);
+                     if(first == std::numeric_limits<T>::infinity())
+                         first = h;
+                 }
+             }
+         }
+         ASSERT_LT(closest, std::numeric_limits<T>::infinity());
+         EXPECT_NEAR(first, closest, T(1e-4));
+     }
+     // the serialised blob answers the same queries in place
+     std::vector<unsigned char> blob;
+     tree.Serialize(blob);
+     EXPECT_EQ(blob.size(), tree.SerializedSize());
+     BSPView<T> loaded;
+     ASSERT_TRUE(loaded.Load(&blob[0], blob.size()));
+     EXPECT_EQ(loaded.NodeCount(), tree.NodeCount());
+     for(std::size_t i=0;i<probes.size();i++)
+         EXPECT_EQ(loaded.Classify(probes[i]), tree.Classify(probes[i]));
+     std::vector<std::uint32_t> again;
+     loaded.TraverseFrontToBack(eye, [&](std::uint32_t f) {again.push_back(f);});
+     EXPECT_EQ(again, order);
+     // truncated, foreign and corrupt blobs are rejected
+     EXPECT_FALSE(loaded.Load(&blob[0], blob.size()-1));
+     EXPECT_TRUE(loaded.Empty());
+     BSPView<typename std::conditional<std::is_same<T,float>::value, double, float>::type> other;
+     EXPECT_FALSE(other.Load(&blob[0], blob.size()));
+     typename BSPView<T>::Node* root = reinterpret_cast<typename BSPView<T>::Node*>(&blob[sizeof(typename BSPView<T>::Header)]);
+     root->front = 0;
+     EXPECT_FALSE(loaded.Load(&blob[0], blob.size()));
+     // trusted blobs skip the per-node checks, but not the header and size ones
+     EXPECT_TRUE(loaded.Load(&blob[0], blob.size(), false));
+     EXPECT_EQ(loaded.NodeCount(), tree.NodeCount());
+     EXPECT_FALSE(loaded.Load(&blob[0], blob.size()-1, false));
+     EXPECT_FALSE(other.Load(&blob[0], blob.size(), false));
+ }
+
+ TEST(BSPTest, ClassifyTraverseSerialize) {
+     CheckBSP<float>();
+     CheckBSP<double>();
+ }
+
+ TEST(BSPTest, Polygons) {
+     // unit cube from quads: one node per face plane, no splits
+     std::vector<std::vector<Vector3Dd> > quads(6);
+     for(int a=0;a<3;a++) {
+         for(int s=0;s<2;s++) {
+             Vector3Dd n, u, v;
+             double c[3] = {0, 0, 0};
+             c[a] = 1;
+             n = Vector3Dd(c[0], c[1], c[2])*(s?1.0:-1.0);
+             c[a] = 0; c[(a+1)%3] = 1;
+             u = Vector3Dd(c[0], c[1], c[2]);
+             v = n.Cross(u);
+             Vector3Dd center = Vector3Dd(0.5, 0.5, 0.5)+n*0.5;
+             std::vector<Vector3Dd>& q = quads[2*a+s];
+             q.push_back(center-u*0.5-v*0.5);
+             q.push_back(center+u*0.5-v*0.5);
+             q.push_back(center+u*0.5+v*0.5);
+             q.push_back(center-u*0.5+v*0.5);
+         }
+     }
+     BSPTreed tree;
+     tree.Build(quads);
+     EXPECT_EQ(tree.NodeCount(), 6u);
+     EXPECT_EQ(tree.PolygonCount(), 6u);
+     EXPECT_EQ(tree.Classify(Vector3Dd(0.5, 0.5, 0.5)), BSPLocation::Inside);
+     EXPECT_EQ(tree.Classify(Vector3Dd(1.5, 0.5, 0.5)), BSPLocation::Outside);
+     EXPECT_EQ(tree.Classify(Vector3Dd(1, 0.5, 0.5)), BSPLocation::Boundary);
+     EXPECT_EQ(tree.Classify(Vector3Dd(1, 1.5, 0.5)), BSPLocation::Outside);
+     // empty input
+     tree.Build(std::vector<std::vector<Vector3Dd> >());
+     EXPECT_TRUE(tree.Empty());
+     EXPECT_EQ(tree.Classify(Vector3Dd()), BSPLocation::Outside);
+     std::vector<unsigned char> blob;
+     tree.Serialize(blob);
+     BSPViewd view;
+     EXPECT_TRUE(view.Load(&blob[0], blob.size()));
+     EXPECT_TRUE(view.Empty());
+ }
+
+ template<class T>
+ void CheckHalfEdges(const PolyMeshView<T>& mesh) {
+     for(std::uint32_t h=0;h<mesh.HalfEdgeCount();h++) {
+         EXPECT_EQ(mesh.Prev(mesh.Next(h)), h);
+         EXPECT_EQ(mesh.Face(mesh.Next(h)), mesh.Face(h));
+         if(!mesh.IsBoundary(h)) {
+             EXPECT_EQ(mesh.Twin(mesh.Twin(h)), h);
+             EXPECT_EQ(mesh.Origin(mesh.Twin(h)), mesh.Target(h));
+             EXPECT_NE(mesh.Face(mesh.Twin(h)), mesh.Face(h));
+         }
+     }
+ }
+
+ TEST(PolyMeshTest, HalfEdges) {
+     // cube from quads: closed, every vertex has 3 faces
+     std::vector<Vector3Dd> corners;
+     for(int i=0;i<8;i++)
+         corners.push_back(Vector3Dd(i&1, (i>>1)&1, (i>>2)&1));
+     std::vector<std::uint32_t> quads = {0,2,3,1, 4,5,7,6, 0,1,5,4, 2,6,7,3, 0,4,6,2, 1,3,7,5};
+     std::vector<std::uint32_t> offsets = {0, 4, 8, 12, 16, 20, 24};
+     PolyMeshd cube;
+     cube.Build(corners, quads, offsets);
+     PolyMeshViewd view = cube.View();
+     EXPECT_EQ(view.FaceCount(), 6u);
+     EXPECT_EQ(view.HalfEdgeCount(), 24u);
+     EXPECT_EQ(view.NonManifoldCount(), 0u);
+     CheckHalfEdges(view);
+     for(std::uint32_t h=0;h<view.HalfEdgeCount();h++)
+         EXPECT_FALSE(view.IsBoundary(h));
+     for(std::uint32_t v=0;v<8;v++) {
+         int valence = 0;
+         view.ForEachOutgoing(v, [&](std::uint32_t h) {EXPECT_EQ(view.Origin(h), v); valence++;});
+         EXPECT_EQ(valence, 3);
+     }
+     // 3x3 grid of triangle pairs: boundary fans are walked from their boundary edge
+     std::vector<Vector3Df> grid;
+     std::vector<std::uint32_t> tris;
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             grid.push_back(Vector3Df(float(i), float(j), 0));
+     for(std::uint32_t i=0;i<3;i++) {
+         for(std::uint32_t j=0;j<3;j++) {
+             std::uint32_t a = 4*i+j, b = a+4;
+             std::uint32_t tri[6] = {a, b, a+1, a+1, b, b+1};
+             tris.insert(tris.end(), tri, tri+6);
+         }
+     }
+     PolyMeshf sheet(grid, tris);
+     PolyMeshViewf sv = sheet.View();
+     CheckHalfEdges(sv);
+     int boundary = 0;
+     for(std::uint32_t h=0;h<sv.HalfEdgeCount();h++)
+         boundary += sv.IsBoundary(h);
+     EXPECT_EQ(boundary, 12);
+     int fan = 0;
+     sv.ForEachOutgoing(5, [&](std::uint32_t) {fan++;});
+     EXPECT_EQ(fan, 6);
+     fan = 0;
+     sv.ForEachOutgoing(1, [&](std::uint32_t) {fan++;});
+     EXPECT_EQ(fan, 3);
+     // three triangles on one edge are left unpaired
+     std::vector<Vector3Dd> fin = {Vector3Dd(0,0,0), Vector3Dd(1,0,0), Vector3Dd(0,1,0), Vector3Dd(0,-1,0), Vector3Dd(0,0,1)};
+     PolyMeshd book(fin, std::vector<std::uint32_t>({0,1,2, 1,0,3, 0,1,4}));
+     EXPECT_EQ(book.NonManifoldCount(), 3u);
+     CheckHalfEdges(book.View());
+ }
+
+ TEST(PolyMeshTest, HighValenceFan) {
+     // one vertex shared by 200000 triangles: the adjacency stays linear in the corners
+     const std::uint32_t n = 200000;
+     std::vector<Vector3Df> fan(1, Vector3Df(0, 0, 0));
+     std::vector<std::uint32_t> tris;
+     for(std::uint32_t i=0;i<=n;i++) {
+         float angle = 6.2831853f*float(i)/float(n+1);
+         fan.push_back(Vector3Df(std::cos(angle), std::sin(angle), 0));
+     }
+     for(std::uint32_t i=1;i<=n;i++) {
+         std::uint32_t tri[3] = {0, i, i+1};
+         tris.insert(tris.end(), tri, tri+3);
+     }
+     PolyMeshf open(fan, tris);
+     PolyMeshViewf view = open.View();
+     EXPECT_EQ(view.NonManifoldCount(), 0u);
+     CheckHalfEdges(view);
+     std::size_t boundary = 0;
+     for(std::uint32_t h=0;h<view.HalfEdgeCount();h++)
+         boundary += view.IsBoundary(h);
+     EXPECT_EQ(boundary, std::size_t(n+2));
+     std::size_t valence = 0;
+     view.ForEachOutgoing(0, [&](std::uint32_t) {valence++;});
+     EXPECT_EQ(valence, std::size_t(n));
+     // closing the fan leaves only the rim; two doubled spokes are non-manifold (3 half-edges each)
+     std::uint32_t last[3] = {0, n+1, 1};
+     tris.insert(tris.end(), last, last+3);
+     PolyMeshf closed(fan, tris);
+     EXPECT_EQ(closed.NonManifoldCount(), 0u);
+     boundary = 0;
+     for(std::uint32_t h=0;h<closed.View().HalfEdgeCount();h++)
+         boundary += closed.View().IsBoundary(h);
+     EXPECT_EQ(boundary, std::size_t(n+1));
+     std::uint32_t extra[3] = {0, 1, 5};
+     tris.insert(tris.end(), extra, extra+3);
+     PolyMeshf doubled(fan, tris);
+     EXPECT_EQ(doubled.NonManifoldCount(), 6u);
+     CheckHalfEdges(doubled.View());
+ }
+
+ TEST(PolyMeshTest, SerializeAndMap) {
+     std::vector<Vector3Dd> corners;
+     for(int i=0;i<8;i++)
+         corners.push_back(Vector3Dd(i&1, (i>>1)&1, (i>>2)&1));
+     std::vector<std::uint32_t> tris = {0,2,3, 0,3,1, 4,5,7, 4,7,6, 0,1,5, 0,5,4, 2,6,7, 2,7,3, 0,4,6, 0,6,2, 1,3,7, 1,7,5};
+     PolyMeshd mesh(corners, tris);
+     std::vector<unsigned char> blob;
+     mesh.Serialize(blob);
+     EXPECT_EQ(blob.size(), mesh.SerializedSize());
+     PolyMeshViewd view;
+     ASSERT_TRUE(view.Load(&blob[0], blob.size()));
+     EXPECT_EQ(view.VertexCount(), 8u);
+     EXPECT_EQ(view.FaceCount(), 12u);
+     CheckHalfEdges(view);
+     EXPECT_EQ(view.Vertex(7).X(), 1.0);
+     for(std::uint32_t h=0;h<view.HalfEdgeCount();h++)
+         EXPECT_EQ(view.Twin(h), mesh.View().Twin(h));
+     // through a file mapping
+     std::string path = ::testing::TempDir()+"polymesh_test.msh";
+     ASSERT_TRUE(mesh.Save(path));
+     {
+         MappedFile file(path);
+         ASSERT_TRUE(file.IsOpen());
+         EXPECT_EQ(file.Size(), blob.size());
+         PolyMeshViewd mapped;
+         ASSERT_TRUE(mapped.Load(file.Data(), file.Size(), false));
+         EXPECT_EQ(std::memcmp(mapped.Indices(), view.Indices(), 36*sizeof(std::uint32_t)), 0);
+         EXPECT_EQ(mapped.Vertex(3).Y(), 1.0);
+     }
+     std::remove(path.c_str());
+     EXPECT_FALSE(MappedFile(path).IsOpen());
+     // truncated, foreign and corrupt blobs
+     EXPECT_FALSE(view.Load(&blob[0], blob.size()-1));
+     EXPECT_EQ(view.FaceCount(), 0u);
+     PolyMeshViewf other;
+     EXPECT_FALSE(other.Load(&blob[0], blob.size()));
+     std::size_t twinOffset = sizeof(PolyMeshViewd::Header)+8*3*sizeof(double)+(13+36)*sizeof(std::uint32_t);
+     std::uint32_t bad = 35;
+     std::memcpy(&blob[twinOffset], &bad, sizeof(bad));
+     EXPECT_FALSE(view.Load(&blob[0], blob.size()));
+     EXPECT_TRUE(view.Load(&blob[0], blob.size(), false));
+ }
+
+ template<class T>
+ void CheckQuantized(QuantizedFormat format) {
+     // 5000 points in blocks of 512 (the last one partial), spread over
+     // different extents per axis
+     std::vector<Vector3D<T> > raw(5000);
+     srand(11);
+     for(std::size_t i=0;i<raw.size();i++)
+         raw[i] = Vector3D<T>(T(rand()%100000)/T(1000), T(rand()%100000)/T(100000)-T(3), T(rand()%100000)/T(10));
+     PointArray3D<T> points(raw);
+     typename QuantizedPointArray3D<T>::Settings settings;
+     settings.format = format;
+     settings.blockSize = 512;
+     QuantizedPointArray3D<T> q(points, settings);
+     EXPECT_EQ(q.Size(), raw.size());
+     EXPECT_EQ(q.BlockCount(), 10u);
+     EXPECT_LT(q.Bytes(), raw.size()*((format == Quantized16)?7:5));
+     // every decoded point lies within the bound, and the bound is about half a step
+     Vector3D<T> bound = q.MaxError();
+     T levels = (format == Quantized16)?T(65535):T(1023);
+     EXPECT_LE(bound.X(), T(100)/levels/2*T(1.01));
+     EXPECT_LE(bound.Z(), T(10000)/levels/2*T(1.01));
+     T slack = T(64)*std::numeric_limits<T>::epsilon();
+     PointArray3D<T> decoded;
+     q.Decode(decoded);
+     for(std::size_t i=0;i<raw.size();i++) {
+         Vector3D<T> p = q.Get(i);
+         EXPECT_EQ(p, decoded.Get(i));
+         EXPECT_LE(std::abs(p.X()-raw[i].X()), bound.X()+slack*T(100));
+         EXPECT_LE(std::abs(p.Y()-raw[i].Y()), bound.Y()+slack*T(3));
+         EXPECT_LE(std::abs(p.Z()-raw[i].Z()), bound.Z()+slack*T(10000));
+     }
+     // fused decode-and-transform against transforming the input
+     Matrix3D<T> mat;
+     mat.RotateX(T(0.4));
+     mat.RotateZ(T(1.1));
+     mat.Scale(T(2), T(1), T(0.5));
+     mat(3,0) = T(10); mat(3,1) = T(-20); mat(3,2) = T(5);
+     PointArray3D<T> moved, ref;
+     Transform(q, moved, mat);
+     Transform(points, ref, mat);
+     Vector3D<T> moveBound = q.MaxError(mat);
+     T reach = T(4)*T(10000)*slack;
+     for(std::size_t i=0;i<raw.size();i++) {
+         Vector3D<T> a = moved.Get(i), b = ref.Get(i);
+         EXPECT_LE(std::abs(a.X()-b.X()), moveBound.X()+reach);
+         EXPECT_LE(std::abs(a.Y()-b.Y()), moveBound.Y()+reach);
+         EXPECT_LE(std::abs(a.Z()-b.Z()), moveBound.Z()+reach);
+     }
+ }
+
+ TEST(QuantizedTest, ErrorBounds) {
+     CheckQuantized<float>(Quantized16);
+     CheckQuantized<float>(Quantized10);
+     CheckQuantized<double>(Quantized16);
+     CheckQuantized<double>(Quantized10);
+ }
+
+ TEST(QuantizedTest, Degenerate) {
+     QuantizedPointArray3Df q;
+     PointArray3Df out;
+     EXPECT_TRUE(q.Build(std::vector<Vector3Df>()));
+     EXPECT_TRUE(q.Empty());
+     q.Decode(out);
+     EXPECT_TRUE(out.Empty());
+     // flat blocks decode exactly
+     std::vector<Vector3Df> same(37, Vector3Df(1.5f, -2, 7));
+     same[36] = Vector3Df(1.5f, -2, 8);
+     EXPECT_TRUE(q.Build(same));
+     EXPECT_EQ(q.MaxError().X(), 0.0f);
+     q.Decode(out);
+     for(std::size_t i=0;i<same.size();i++)
+         EXPECT_EQ(out.Get(i), same[i]);
+     // non-finite input is rejected
+     same[3] = Vector3Df(std::numeric_limits<float>::quiet_NaN(), 0, 0);
+     EXPECT_FALSE(q.Build(same));
+     EXPECT_TRUE(q.Empty());
+     same[3] = Vector3Df(std::numeric_limits<float>::infinity(), 0, 0);
+     EXPECT_FALSE(q.Build(same));
+ }
+
+ TEST(ParallelTest, WorkStealingExecutor) {
+     WorkStealingExecutor::Settings settings;
+     settings.threads = 4;
+     WorkStealingExecutor executor(settings);
+     EXPECT_EQ(executor.Concurrency(), 4u);
+     // no thread until something is split
+     int single = 0;
+     executor.Run(1, [&](unsigned) {single++;});
+     EXPECT_EQ(single, 1);
+     EXPECT_FALSE(executor.Started());
+     SetDefaultExecutor(&executor);
+     std::vector<int> hits(100003, 0);
+     for(int run=0;run<20;run++)
+         detail::ParallelFor(0, hits.size(), 1000, 0, [&](std::size_t b, std::size_t e) {
+             for(std::size_t i=b;i<e;i++)
+                 hits[i]++;
+         });
+     EXPECT_TRUE(executor.Started());
+     EXPECT_EQ(std::count(hits.begin(), hits.end(), 20), std::ptrdiff_t(hits.size()));
+     // nested runs finish (waiting threads keep executing tasks)
+     std::atomic<int> inner(0);
+     executor.Run(8, [&](unsigned) {
+         executor.Run(8, [&](unsigned) {inner++;});
+     });
+     EXPECT_EQ(inner.load(), 64);
+     SetDefaultExecutor(0);
+     EXPECT_NE(&DefaultExecutor(), static_cast<Executor*>(&executor));
+ }
+
+ TEST(ParallelTest, TaskExceptions) {
+     WorkStealingExecutor::Settings settings;
+     settings.threads = 4;
+     WorkStealingExecutor executor(settings);
+     SetDefaultExecutor(&executor);
+     // one chunk of a ParallelFor throws: the caller gets the exception once every task is done
+     std::vector<int> hits(100000, 0);
+     for(int run=0;run<20;run++) {
+         std::atomic<int> active(0);
+         EXPECT_THROW(detail::ParallelFor(0, hits.size(), 100, 0, [&](std::size_t b, std::size_t e) {
+             active++;
+             if(b <= 50000 && 50000 < e) {
+                 active--;
+                 throw std::runtime_error("chunk");
+             }
+             for(std::size_t i=b;i<e;i++)
+                 hits[i]++;
+             active--;
+         }), std::runtime_error);
+         EXPECT_EQ(active.load(), 0);
+     }
+     // the task run by the caller and a nested task
+     EXPECT_THROW(executor.Run(8, [](unsigned i) {if(i == 0) throw std::runtime_error("first");}), std::runtime_error);
+     EXPECT_THROW(executor.Run(4, [&](unsigned) {
+         executor.Run(4, [](unsigned j) {if(j == 3) throw std::logic_error("nested");});
+     }), std::logic_error);
+     // the executor keeps working
+     std::fill(hits.begin(), hits.end(), 0);
+     detail::ParallelFor(0, hits.size(), 100, 0, [&](std::size_t b, std::size_t e) {
+         for(std::size_t i=b;i<e;i++)
+             hits[i]++;
+     });
+     EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), std::ptrdiff_t(hits.size()));
+     SetDefaultExecutor(0);
+     // background tasks rethrow on Wait
+     detail::AsyncTask async;
+     async.Post([]() {throw std::runtime_error("async");});
+     EXPECT_THROW(async.Wait(), std::runtime_error);
+     int done = 0;
+     async.Post([&]() {done++;});
+     EXPECT_NO_THROW(async.Wait());
+     EXPECT_EQ(done, 1);
+     // and so do the stream callbacks
+     PointCloudStreamf stream;
+     EXPECT_THROW(stream.Transform([](float*, std::size_t, std::size_t&) -> bool {throw std::runtime_error("read");},
+         [](const float*, std::size_t) {return true;}, Matrix3Df()), std::runtime_error);
+ }
+
+ /**
+ * Executor with a tiny grain that counts its Run calls
+ **/
+ class CountingExecutor : public Executor {
+ public:
+     WorkStealingExecutor inner;
+     std::atomic<unsigned> runs;
+     CountingExecutor(const WorkStealingExecutor::Settings& s):inner(s),runs(0) {}
+     unsigned Concurrency()const {return inner.Concurrency();}
+     std::size_t Grain()const {return 100;}
+     void Run(unsigned count, const std::function<void(unsigned)>& task) {
+         runs++;
+         inner.Run(count, task);
+     }
+ };
+
+ template<class T>
+ void CheckParallelBatches() {
+     std::vector<Vector3D<T> > raw(10007);
+     srand(21);
+     for(std::size_t i=0;i<raw.size();i++)
+         raw[i] = Vector3D<T>(T(rand()%2000)/T(1000), T(rand()%2000)/T(1000), T(rand()%2000)/T(1000));
+     raw[5000] = Vector3D<T>(4, 4, 4);
+     raw[777] = Vector3D<T>(-3, 0, 0);
+     PointArray3D<T> points(raw);
+     Matrix3D<T> mat;
+     mat.RotateY(T(0.7));
+     mat(3,0) = T(1); mat(3,2) = T(-2);
+     std::vector<T> angles(3001);
+     for(std::size_t i=0;i<angles.size();i++)
+         angles[i] = T(i)/T(100)-T(15);
+     AABB<T> box(Vector3D<T>(0, 0, 0), Vector3D<T>(1, 1, 1));
+     // serial references
+     WorkStealingExecutor::Settings serialSettings;
+     serialSettings.threads = 1;
+     WorkStealingExecutor serial(serialSettings);
+     SetDefaultExecutor(&serial);
+     PointArray3D<T> moved;
+     Transform(points, moved, mat);
+     AABB<T> bounds = AABB<T>::FromPoints(points);
+     BoundingSphere<T> sphere = BoundingSphere<T>::FromPoints(points);
+     std::vector<T> s(angles.size()), c(angles.size()), d(points.Size());
+     SinCos(&angles[0], &s[0], &c[0], angles.size());
+     EXPECT_EQ(DistanceSqPointsAABB(points, box, &d[0], T(4)), 777u);
+     // the same with chunks of 100 on four threads
+     WorkStealingExecutor::Settings settings;
+     settings.threads = 4;
+     CountingExecutor counting(settings);
+     SetDefaultExecutor(&counting);
+     PointArray3D<T> moved2;
+     Transform(points, moved2, mat);
+     EXPECT_EQ(std::memcmp(moved.X(), moved2.X(), moved.Size()*sizeof(T)), 0);
+     EXPECT_EQ(std::memcmp(moved.Z(), moved2.Z(), moved.Size()*sizeof(T)), 0);
+     AABB<T> bounds2 = AABB<T>::FromPoints(points);
+     EXPECT_EQ(bounds.Min(), bounds2.Min());
+     EXPECT_EQ(bounds.Max(), bounds2.Max());
+     BoundingSphere<T> sphere2 = BoundingSphere<T>::FromPoints(points);
+     EXPECT_EQ(sphere.Center(), sphere2.Center());
+     EXPECT_EQ(sphere.Radius(), sphere2.Radius());
+     std::vector<T> s2(angles.size()), c2(angles.size()), d2(points.Size());
+     SinCos(&angles[0], &s2[0], &c2[0], angles.size());
+     EXPECT_EQ(s, s2);
+     EXPECT_EQ(c, c2);
+     // the first point beyond the bound wins even if a later chunk finds another
+     EXPECT_EQ(DistanceSqPointsAABB(points, box, &d2[0], T(4)), 777u);
+     EXPECT_TRUE(std::equal(d.begin(), d.begin()+778, d2.begin()));
+     EXPECT_EQ(DistanceSqPointsAABB(points, box, &d2[0]), points.Size());
+     EXPECT_GE(counting.runs.load(), 6u);
+     SetDefaultExecutor(0);
+ }
+
+ TEST(ParallelTest, BatchesMatchSerial) {
+     CheckParallelBatches<float>();
+     CheckParallelBatches<double>();
+ }
+
+ template<class T>
+ void CheckParallelStructures() {
+     srand(22);
+     std::vector<Quaternion<T> > qa(5003), qb(5003);
+     for(std::size_t i=0;i<qa.size();i++) {
+         qa[i] = Quaternion<T>::FromAxisAngle(Vector3D<T>(T(1), T(rand()%100)/T(50), T(0.5)), T(rand()%600)/T(100));
+         qb[i] = Quaternion<T>::FromAxisAngle(Vector3D<T>(T(rand()%100)/T(50), T(1), T(-0.5)), T(rand()%600)/T(100));
+     }
+     // small random triangles for the BSP, a triangulated grid for the half-edges
+     std::vector<Vector3D<T> > soup;
+     std::vector<std::uint32_t> soupIndices;
+     for(std::uint32_t i=0;i<1500;i++) {
+         if(i%3 == 0)
+             soup.push_back(Vector3D<T>(T(rand()%1000)/T(100), T(rand()%1000)/T(100), T(rand()%1000)/T(100)));
+         else
+             soup.push_back(soup[i-i%3]+Vector3D<T>(T(rand()%100)/T(200), T(rand()%100)/T(200), T(rand()%100)/T(200)));
+         soupIndices.push_back(i);
+     }
+     std::vector<Vector3D<T> > grid;
+     std::vector<std::uint32_t> tris;
+     for(int i=0;i<60;i++)
+         for(int j=0;j<60;j++)
+             grid.push_back(Vector3D<T>(T(i), T(j), T((i*j)%7)));
+     for(std::uint32_t i=0;i<59;i++) {
+         for(std::uint32_t j=0;j<59;j++) {
+             std::uint32_t a = 60*i+j, b = a+60;
+             std::uint32_t tri[6] = {a, b, a+1, a+1, b, b+1};
+             tris.insert(tris.end(), tri, tri+6);
+         }
+     }
+     // serial references
+     WorkStealingExecutor::Settings serialSettings;
+     serialSettings.threads = 1;
+     WorkStealingExecutor serial(serialSettings);
+     SetDefaultExecutor(&serial);
+     std::vector<Quaternion<T> > n(qa.size()), s(qa.size());
+     ASSERT_TRUE(Nlerp(qa, qb, T(0.3), n));
+     ASSERT_TRUE(Slerp(qa, qb, T(0.3), s));
+     BSPTree<T> tree;
+     tree.Build(soup, soupIndices);
+     std::vector<unsigned char> treeBlob, meshBlob;
+     tree.Serialize(treeBlob);
+     PolyMesh<T> mesh(grid, tris);
+     mesh.Serialize(meshBlob);
+     // the same with chunks of about 100 on four threads
+     WorkStealingExecutor::Settings settings;
+     settings.threads = 4;
+     CountingExecutor counting(settings);
+     SetDefaultExecutor(&counting);
+     std::vector<Quaternion<T> > n2, s2;
+     ASSERT_TRUE(Nlerp(qa, qb, T(0.3), n2));
+     ASSERT_TRUE(Slerp(qa, qb, T(0.3), s2));
+     EXPECT_EQ(n, n2);
+     EXPECT_EQ(s, s2);
+     unsigned runs = counting.runs.load();
+     EXPECT_GE(runs, 2u);
+     BSPTree<T> tree2;
+     tree2.Build(soup, soupIndices);
+     EXPECT_GT(counting.runs.load(), runs);
+     runs = counting.runs.load();
+     EXPECT_EQ(tree2.NodeCount(), tree.NodeCount());
+     EXPECT_EQ(tree2.PolygonCount(), tree.PolygonCount());
+     std::vector<unsigned char> treeBlob2, meshBlob2;
+     tree2.Serialize(treeBlob2);
+     EXPECT_TRUE(treeBlob == treeBlob2);
+     PolyMesh<T> mesh2(grid, tris);
+     EXPECT_GT(counting.runs.load(), runs);
+     EXPECT_EQ(mesh2.NonManifoldCount(), mesh.NonManifoldCount());
+     mesh2.Serialize(meshBlob2);
+     EXPECT_TRUE(meshBlob == meshBlob2);
+     CheckHalfEdges(mesh2.View());
+     SetDefaultExecutor(0);
+ }
+
+ TEST(ParallelTest, StructuresMatchSerial) {
+     CheckParallelStructures<float>();
+     CheckParallelStructures<double>();
+ }
+
+ template<class T>
+ void CheckPointStream() {
+     // 10007 points in chunks of 1000: the last chunk is partial
+     std::vector<Vector3D<T> > points = std::vector<Vector3D<T> >(10007);
+     srand(8);
+     for(std::size_t i=0;i<points.size();i++)
+         points[i] = Vector3D<T>(T(rand()%1000)/T(10), T(rand()%1000)/T(10), T(rand()%1000)/T(10));
+     std::vector<T> input;
+     for(std::size_t i=0;i<points.size();i++) {
+         input.push_back(points[i].X());
+         input.push_back(points[i].Y());
+         input.push_back(points[i].Z());
+     }
+     Matrix3D<T> mat;
+     mat.RotateX(T(0.4));
+     mat.RotateZ(T(-1.3));
+     mat(3,0) = T(5); mat(3,1) = T(-2); mat(3,2) = T(0.25);
+     typename PointCloudStream<T>::Settings settings;
+     settings.chunkPoints = 1000;
+     settings.threads = 3;
+     PointCloudStream<T> stream(settings);
+     std::size_t offset = 0;
+     std::vector<T> output;
+     bool ok = stream.Transform([&](T* buffer, std::size_t maxPoints, std::size_t& n) {
+         n = std::min(maxPoints, points.size()-offset);
+         std::copy(input.begin()+3*offset, input.begin()+3*(offset+n), buffer);
+         offset += n;
+         return true;
+     }, [&](const T* buffer, std::size_t n) {
+         output.insert(output.end(), buffer, buffer+3*n);
+         return true;
+     }, mat);
+     ASSERT_TRUE(ok);
+     EXPECT_EQ(stream.LastStats().points, points.size());
+     EXPECT_EQ(stream.LastStats().bytes, points.size()*3*sizeof(T));
+     ASSERT_EQ(output.size(), input.size());
+     for(std::size_t i=0;i<points.size();i++) {
+         Vector3D<T> ref = points[i]*mat;
+         EXPECT_NEAR(output[3*i], ref.X(), T(1e-4)*T(100));
+         EXPECT_NEAR(output[3*i+1], ref.Y(), T(1e-4)*T(100));
+         EXPECT_NEAR(output[3*i+2], ref.Z(), T(1e-4)*T(100));
+     }
+     // files, and a trailing partial record is an error
+     std::string in = ::testing::TempDir()+"stream_in.xyz", out = ::testing::TempDir()+"stream_out.xyz";
+     std::FILE* f = std::fopen(in.c_str(), "wb");
+     std::fwrite(&input[0], sizeof(T), input.size(), f);
+     std::fclose(f);
+     ASSERT_TRUE(stream.Transform(in, out, mat));
+     std::vector<T> back(input.size()+1);
+     f = std::fopen(out.c_str(), "rb");
+     EXPECT_EQ(std::fread(&back[0], sizeof(T), back.size(), f), input.size());
+     std::fclose(f);
+     back.pop_back();
+     EXPECT_EQ(back, output);
+     f = std::fopen(in.c_str(), "ab");
+     std::fputc(0, f);
+     std::fclose(f);
+     EXPECT_FALSE(stream.Transform(in, out, mat));
+     std::remove(in.c_str());
+     std::remove(out.c_str());
+     EXPECT_FALSE(stream.Transform(in, out, mat));
+     // a failing writer stops the pipeline
+     offset = 0;
+     int writes = 0;
+     EXPECT_FALSE(stream.Transform([&](T* buffer, std::size_t maxPoints, std::size_t& n) {
+         n = std::min(maxPoints, points.size()-offset);
+         std::copy(input.begin()+3*offset, input.begin()+3*(offset+n), buffer);
+         offset += n;
+         return true;
+     }, [&](const T*, std::size_t) {return ++writes < 3;}, mat));
+     EXPECT_EQ(writes, 3);
+ }
+
+ TEST(PointStreamTest, MatchesPerPoint) {
+     CheckPointStream<float>();
+     CheckPointStream<double>();
+ }
+
+ template<class T>
+ std::vector<Neighbor<T> > BruteNeighbors(const std::vector<Vector3D<T> >& points, const Vector3D<T>& q, std::size_t k, T radius) {
+     std::vector<Neighbor<T> > all;
+     for(std::size_t i=0;i<points.size();i++) {
+         Neighbor<T> n = {std::uint32_t(i), q.DistanceSq(points[i])};
+         if(n.distanceSq <= radius*radius)
+             all.push_back(n);
+     }
+     std::sort(all.begin(), all.end());
+     all.resize(std::min(k, all.size()));
+     return all;
+ }
+
+ template<class T, class Index>
+ void CheckNeighbors(const Index& index, const std::vector<Vector3D<T> >& points, const std::vector<Vector3D<T> >& queries) {
+     const T inf = std::numeric_limits<T>::infinity();
+     std::vector<Neighbor<T> > found;
+     NeighborLists<T> lists1, lists4;
+     for(std::size_t k=1;k<=points.size()+1;k=(k < 8)?k+3:k*7) {
+         index.NearestBatch(queries, k, lists1, 1);
+         index.NearestBatch(queries, k, lists4, 4);
+         EXPECT_EQ(lists1.offsets, lists4.offsets);
+         ASSERT_EQ(lists1.Size(), queries.size());
+         for(std::size_t i=0;i<queries.size();i++) {
+             std::vector<Neighbor<T> > ref = BruteNeighbors(points, queries[i], k, inf);
+             index.Nearest(queries[i], k, found);
+             ASSERT_EQ(found.size(), ref.size());
+             ASSERT_EQ(lists1.Count(i), ref.size());
+             for(std::size_t j=0;j<ref.size();j++) {
+                 EXPECT_EQ(found[j].index, ref[j].index);
+                 EXPECT_EQ(found[j].distanceSq, ref[j].distanceSq);
+                 EXPECT_EQ(lists1.Begin(i)[j].index, ref[j].index);
+                 EXPECT_EQ(lists4.Begin(i)[j].index, ref[j].index);
+             }
+         }
+     }
+     for(T radius=T(0);radius<T(40);radius=radius*T(3)+T(1)) {
+         index.RadiusBatch(queries, radius, lists4, 4);
+         ASSERT_EQ(lists4.Size(), queries.size());
+         for(std::size_t i=0;i<queries.size();i++) {
+             std::vector<Neighbor<T> > ref = BruteNeighbors(points, queries[i], points.size(), radius);
+             index.Radius(queries[i], radius, found);
+             std::sort(found.begin(), found.end());
+             std::vector<Neighbor<T> > batch(lists4.Begin(i), lists4.Begin(i)+lists4.Count(i));
+             std::sort(batch.begin(), batch.end());
+             ASSERT_EQ(found.size(), ref.size());
+             ASSERT_EQ(batch.size(), ref.size());
+             for(std::size_t j=0;j<ref.size();j++) {
+                 EXPECT_EQ(found[j].index, ref[j].index);
+                 EXPECT_EQ(batch[j].index, ref[j].index);
+             }
+         }
+     }
+ }
+
+ template<class T>
+ void CheckProximity() {
+     // a grid with many ties, random points and coincident duplicates
+     std::vector<Vector3D<T> > points;
+     for(int i=0;i<5;i++)
+         for(int j=0;j<5;j++)
+             for(int k=0;k<5;k++)
+                 points.push_back(Vector3D<T>(T(2*i), T(2*j), T(2*k)));
+     srand(11);
+     for(int i=0;i<1500;i++)
+         points.push_back(Vector3D<T>(T(rand()%2000)/T(100), T(rand()%2000)/T(100), T(rand()%400)/T(100)));
+     for(int i=0;i<20;i++)
+         points.push_back(points[std::size_t(i*7)]);
+     std::vector<Vector3D<T> > queries;
+     for(int i=0;i<300;i++)
+         queries.push_back(Vector3D<T>(T(rand()%3000)/T(100)-T(5), T(rand()%3000)/T(100)-T(5), T(rand()%1000)/T(100)-T(3)));
+     queries.push_back(points[3]);
+     queries.push_back(Vector3D<T>(T(500), T(-300), T(40)));
+     typename KdTree<T>::Settings settings;
+     settings.threads = 4;
+     settings.leafSize = 4;
+     KdTree<T> tree(points, settings);
+     EXPECT_EQ(tree.Size(), points.size());
+     CheckNeighbors(tree, points, queries);
+     SpatialHash<T> hash(points, T(1.5));
+     EXPECT_EQ(hash.Size(), points.size());
+     CheckNeighbors(hash, points, queries);
+     // the same tree from a point array
+     KdTree<T> fromArray;
+     fromArray.Build(PointArray3D<T>(points));
+     Neighbor<T> nearest;
+     ASSERT_TRUE(fromArray.Nearest(queries[0], nearest));
+     EXPECT_EQ(nearest.index, BruteNeighbors(points, queries[0], 1, std::numeric_limits<T>::infinity())[0].index);
+ }
+
+ TEST(ProximityTest, MatchesBruteForce) {
+     CheckProximity<float>();
+     CheckProximity<double>();
+ }
+
+ TEST(ProximityTest, Degenerate) {
+     std::vector<Neighbor<double> > found(3);
+     Neighbor<double> nearest;
+     KdTreed tree;
+     EXPECT_TRUE(tree.Empty());
+     EXPECT_FALSE(tree.Nearest(Vector3Dd(), nearest));
+     tree.Nearest(Vector3Dd(), 4, found);
+     EXPECT_TRUE(found.empty());
+     SpatialHashd hash;
+     EXPECT_FALSE(hash.Build(std::vector<Vector3Dd>(), 0.0));
+     EXPECT_TRUE(hash.Build(std::vector<Vector3Dd>(), 1.0));
+     hash.Radius(Vector3Dd(), 10.0, found);
+     EXPECT_TRUE(found.empty());
+     NeighborLists<double> lists;
+     hash.NearestBatch(std::vector<Vector3Dd>(3), 2, lists);
+     EXPECT_EQ(lists.Size(), 3u);
+     EXPECT_TRUE(lists.neighbors.empty());
+     // all points coincident: ties resolve by index
+     std::vector<Vector3Dd> same(100, Vector3Dd(1, 2, 3));
+     tree.Build(same);
+     hash.Build(same, 0.5);
+     tree.Nearest(Vector3Dd(0, 0, 0), 3, found);
+     ASSERT_EQ(found.size(), 3u);
+     EXPECT_EQ(found[2].index, 2u);
+     hash.Nearest(Vector3Dd(0, 0, 0), 200, found);
+     ASSERT_EQ(found.size(), 100u);
+     EXPECT_EQ(found[99].index, 99u);
+     tree.Radius(Vector3Dd(1, 2, 3), 0.0, found);
+     EXPECT_EQ(found.size(), 100u);
+ }
+
+ template<class T>
+ void CheckDynamicHash() {
+     // jitter inside cells, jumps across the grid (filling the overflow until
+     // the runs are rebuilt), inserts and removals, checked against brute force
+     srand(5);
+     std::vector<Vector3D<T> > points;
+     for(int i=0;i<2000;i++)
+         points.push_back(Vector3D<T>(T(rand()%2000)/T(100), T(rand()%2000)/T(100), T(rand()%2000)/T(100)));
+     std::vector<bool> alive(points.size(), true);
+     SpatialHash<T> hash(points, T(1.5));
+     std::vector<Neighbor<T> > found;
+     for(int frame=0;frame<6;frame++) {
+         for(int m=0;m<400;m++) {
+             std::uint32_t i = std::uint32_t(rand()%int(points.size()));
+             Vector3D<T> p = (m%2)?points[i]+Vector3D<T>(T(rand()%10)/T(100), T(0), T(0))
+                                  :Vector3D<T>(T(rand()%2500)/T(100), T(rand()%2000)/T(100), T(rand()%2000)/T(100));
+             EXPECT_EQ(hash.Update(i, p), bool(alive[i]));
+             if(alive[i])
+                 points[i] = p;
+         }
+         for(int m=0;m<40;m++) {
+             std::uint32_t i = std::uint32_t(rand()%int(points.size()));
+             EXPECT_EQ(hash.Remove(i), bool(alive[i]));
+             alive[i] = false;
+             EXPECT_FALSE(hash.Contains(i));
+             points.push_back(Vector3D<T>(T(rand()%2000)/T(100), T(rand()%2000)/T(100), T(-frame)));
+             alive.push_back(true);
+             EXPECT_EQ(hash.Insert(points.back()), std::uint32_t(points.size()-1));
+         }
+         // brute force over the live points, in index order so ties match
+         std::vector<Vector3D<T> > current;
+         std::vector<std::uint32_t> ids;
+         for(std::size_t i=0;i<points.size();i++) {
+             if(alive[i]) {
+                 current.push_back(points[i]);
+                 ids.push_back(std::uint32_t(i));
+                 EXPECT_EQ(hash.Point(std::uint32_t(i)), points[i]);
+             }
+         }
+         ASSERT_EQ(hash.Size(), current.size());
+         for(int q=0;q<40;q++) {
+             Vector3D<T> query(T(rand()%2400)/T(100)-T(2), T(rand()%2400)/T(100)-T(2), T(rand()%2400)/T(100)-T(2));
+             std::vector<Neighbor<T> > ref = BruteNeighbors(current, query, 5, std::numeric_limits<T>::infinity());
+             hash.Nearest(query, 5, found);
+             ASSERT_EQ(found.size(), ref.size());
+             for(std::size_t j=0;j<ref.size();j++)
+                 EXPECT_EQ(found[j].index, ids[ref[j].index]);
+             ref = BruteNeighbors(current, query, current.size(), T(2));
+             hash.Radius(query, T(2), found);
+             std::sort(found.begin(), found.end());
+             ASSERT_EQ(found.size(), ref.size());
+             for(std::size_t j=0;j<ref.size();j++)
+                 EXPECT_EQ(found[j].index, ids[ref[j].index]);
+         }
+     }
+ }
+
+ TEST(ProximityTest, DynamicHash) {
+     CheckDynamicHash<float>();
+     CheckDynamicHash<double>();
+     // non-finite queries find nothing (and return)
+     SpatialHashd hash(std::vector<Vector3Dd>(10, Vector3Dd(1, 2, 3)), 1.0);
+     std::vector<Neighbor<double> > found;
+     hash.Nearest(Vector3Dd(std::numeric_limits<double>::quiet_NaN(), 0, 0), 3, found);
+     EXPECT_TRUE(found.empty());
+     hash.Nearest(Vector3Dd(0, std::numeric_limits<double>::infinity(), 0), 3, found);
+     EXPECT_TRUE(found.empty());
+     hash.Radius(Vector3Dd(0, 0, std::numeric_limits<double>::quiet_NaN()), 5.0, found);
+     EXPECT_TRUE(found.empty());
+     // a query far beyond the doubling limit still finds its neighbours
+     hash.Nearest(Vector3Dd(1e300, 0, 0), 3, found);
+     EXPECT_EQ(found.size(), 3u);
+ }
+
+ template<class T>
+ Vector3D<T> DeCasteljau(std::vector<Vector3D<T> > p, T t) {
+     for(std::size_t r=1;r<p.size();r++)
+         for(std::size_t i=0;i+r<p.size();i++)
+             p[i] = p[i]*(T(1)-t)+p[i+1]*t;
+     return p[0];
+ }
+
+ template<class T>
+ Vector3D<T> DeBoor(int degree, const std::vector<Vector3D<T> >& points, const std::vector<T>& knots, const std::vector<T>& weights, T t) {
+     // homogeneous de Boor on the span holding t (clamped to the domain)
+     std::size_t n = points.size();
+     t = std::min(std::max(t, knots[degree]), knots[n]);
+     std::size_t span = degree;
+     while(span+1 < n && knots[span+1] <= t)
+         span++;
+     std::vector<T> d(4*(degree+1));
+     for(int j=0;j<=degree;j++) {
+         T w = weights.empty()?T(1):weights[span-degree+j];
+         const Vector3D<T>& p = points[span-degree+j];
+         d[4*j] = p.X()*w; d[4*j+1] = p.Y()*w; d[4*j+2] = p.Z()*w; d[4*j+3] = w;
+     }
+     for(int r=1;r<=degree;r++)
+         for(int j=degree;j>=r;j--) {
+             std::size_t idx = span-degree+j;
+             T a = (t-knots[idx])/(knots[idx+degree+1-r]-knots[idx]);
+             for(int c=0;c<4;c++)
+                 d[4*j+c] = (T(1)-a)*d[4*(j-1)+c]+a*d[4*j+c];
+         }
+     T* q = &d[4*degree];
+     return Vector3D<T>(q[0]/q[3], q[1]/q[3], q[2]/q[3]);
+ }
+
+ template<class T>
+ void CheckCurves() {
+     const T tol = std::is_same<T, float>::value?T(2e-4):T(1e-10);
+     srand(5);
+     std::vector<Vector3D<T> > points;
+     for(int i=0;i<9;i++)
+         points.push_back(Vector3D<T>(T(rand()%200)/T(100)-T(1), T(rand()%200)/T(100)-T(1), T(rand()%200)/T(100)-T(1)));
+     // sorted parameters, some unsorted ones and some outside the domain
+     std::vector<T> t;
+     for(int i=0;i<=100;i++)
+         t.push_back(T(i)/T(100));
+     T extra[] = {T(0.7), T(0.1), T(0.35), T(-0.5), T(1.5), T(0.3)};
+     t.insert(t.end(), extra, extra+6);
+     PointArray3D<T> out;
+
+     std::vector<Vector3D<T> > bezierPoints(points.begin(), points.begin()+6);
+     BezierCurve<T> bezier(bezierPoints);
+     EXPECT_EQ(bezier.Degree(), 5);
+     bezier.Evaluate(t, out);
+     ASSERT_EQ(out.Size(), t.size());
+     for(std::size_t i=0;i<t.size();i++) {
+         Vector3D<T> ref = DeCasteljau(bezierPoints, std::min(std::max(t[i], T(0)), T(1)));
+         EXPECT_NEAR(out.Get(i).Distance(ref), T(0), tol);
+         EXPECT_NEAR(bezier.Evaluate(t[i]).Distance(ref), T(0), tol);
+     }
+
+     // clamped non-uniform knots with a double knot, with and without weights
+     T knotValues[] = {0, 0, 0, 0, T(0.1), T(0.3), T(0.3), T(0.6), T(0.8), 1, 1, 1, 1};
+     std::vector<T> knots(knotValues, knotValues+13), weights;
+     for(int i=0;i<9;i++)
+         weights.push_back(T(0.5)+T(rand()%150)/T(100));
+     NURBSCurve<T> nurbs(3, points, knots, weights);
+     BSplineCurve<T> bspline(3, points, knots);
+     ASSERT_TRUE(nurbs.IsValid());
+     EXPECT_TRUE(nurbs.IsRational());
+     EXPECT_FALSE(bspline.IsRational());
+     EXPECT_EQ(nurbs.Breaks().size(), 6u);
+     nurbs.Evaluate(t, out);
+     for(std::size_t i=0;i<t.size();i++)
+         EXPECT_NEAR(out.Get(i).Distance(DeBoor(3, points, knots, weights, t[i])), T(0), tol);
+     bspline.Evaluate(t, out);
+     for(std::size_t i=0;i<t.size();i++) {
+         Vector3D<T> ref = DeBoor(3, points, knots, std::vector<T>(), t[i]);
+         EXPECT_NEAR(out.Get(i).Distance(ref), T(0), tol);
+         EXPECT_NEAR(bspline.Evaluate(t[i]).Distance(ref), T(0), tol);
+     }
+     // an unclamped uniform quadratic B-spline on [2,9]
+     std::vector<T> uniform;
+     for(int i=0;i<12;i++)
+         uniform.push_back(T(i));
+     BSplineCurve<T> open(2, points, uniform);
+     EXPECT_EQ(open.DomainStart(), T(2));
+     EXPECT_EQ(open.DomainEnd(), T(9));
+     std::vector<T> ut;
+     for(int i=0;i<=70;i++)
+         ut.push_back(T(2)+T(i)/T(10));
+     open.Evaluate(ut, out);
+     for(std::size_t i=0;i<ut.size();i++)
+         EXPECT_NEAR(out.Get(i).Distance(DeBoor(2, points, uniform, std::vector<T>(), ut[i])), T(0), tol*T(10));
+     // the default knots give a clamped curve through the end points
+     BSplineCurve<T> clamped(3, points);
+     EXPECT_NEAR(clamped.Evaluate(T(0)).Distance(points[0]), T(0), tol);
+     EXPECT_NEAR(clamped.Evaluate(T(1)).Distance(points[8]), T(0), tol);
+
+     // a bicubic x biquadratic patch against nested de Casteljau
+     BezierPatch<T> patch(3, 2, points);
+     EXPECT_EQ(patch.UDegree(), -1);
+     std::vector<Vector3D<T> > net(points);
+     net.insert(net.end(), points.begin(), points.begin()+3);
+     ASSERT_TRUE(patch.Set(3, 2, net));
+     std::vector<T> u(t.begin(), t.begin()+30), v(t.begin()+90, t.end());
+     patch.Evaluate(u, v, out);
+     ASSERT_EQ(out.Size(), u.size()*v.size());
+     for(std::size_t j=0;j<v.size();j++)
+         for(std::size_t i=0;i<u.size();i++) {
+             std::vector<Vector3D<T> > column;
+             for(int r=0;r<4;r++)
+                 column.push_back(DeCasteljau(std::vector<Vector3D<T> >(net.begin()+3*r, net.begin()+3*r+3), std::min(std::max(v[j], T(0)), T(1))));
+             Vector3D<T> ref = DeCasteljau(column, std::min(std::max(u[i], T(0)), T(1)));
+             EXPECT_NEAR(out.Get(j*u.size()+i).Distance(ref), T(0), tol);
+         }
+ }
+
+ TEST(CurvesTest, MatchesReference) {
+     CheckCurves<float>();
+     CheckCurves<double>();
+ }
+
+ TEST(CurvesTest, Invalid) {
+     std::vector<Vector3Dd> points(4, Vector3Dd(1, 2, 3));
+     NURBSCurved nurbs;
+     EXPECT_FALSE(nurbs.IsValid());
+     EXPECT_FALSE(nurbs.Set(4, points));
+     EXPECT_FALSE(nurbs.Set(2, points, std::vector<double>(6, 0.0)));
+     EXPECT_FALSE(nurbs.Set(2, points, std::vector<double>(7, 0.0)));
+     double decreasing[] = {0, 0, 0, 2, 1, 3, 3};
+     EXPECT_FALSE(nurbs.Set(2, points, std::vector<double>(decreasing, decreasing+7)));
+     EXPECT_FALSE(nurbs.Set(2, points, std::vector<double>(), std::vector<double>(4, -1.0)));
+     EXPECT_FALSE(nurbs.IsValid());
+     EXPECT_EQ(nurbs.Evaluate(0.5).X(), 0.0);
+     EXPECT_TRUE(nurbs.Set(0, points));
+     EXPECT_EQ(nurbs.Evaluate(0.5).Y(), 2.0);
+     BezierCurved bezier;
+     EXPECT_EQ(bezier.Degree(), -1);
+     EXPECT_FALSE(bezier.Set(std::vector<Vector3Dd>()));
+ }
+
+ template<class T>
+ void CheckTessellator() {
+     typename Tessellator<T>::Settings settings;
+     settings.tolerance = T(1e-3);
+     Tessellator<T> tessellator(settings);
+     std::vector<Vector3D<T> > points;
+     for(int i=0;i<7;i++)
+         points.push_back(Vector3D<T>(T(i), T((i%2)?1:-1), T(i*i)/T(10)));
+     BSplineCurve<T> curve(3, points);
+     const typename Tessellator<T>::Tessellation& line = tessellator.Tessellate(curve);
+     ASSERT_GT(line.points.Size(), 8u);
+     ASSERT_EQ(line.parameters.size(), line.points.Size());
+     EXPECT_EQ(line.parameters.front(), T(0));
+     EXPECT_EQ(line.parameters.back(), T(1));
+     // the curve between polyline vertices stays close to the chord
+     T worst = T(0);
+     for(std::size_t i=0;i+1<line.parameters.size();i++) {
+         EXPECT_LT(line.parameters[i], line.parameters[i+1]);
+         Vector3D<T> a = line.points.Get(i), b = line.points.Get(i+1);
+         EXPECT_NEAR(a.Distance(curve.Evaluate(line.parameters[i])), T(0), T(1e-4));
+         for(int k=1;k<8;k++) {
+             Vector3D<T> p = curve.Evaluate(line.parameters[i]+(line.parameters[i+1]-line.parameters[i])*T(k)/T(8));
+             T s = std::min(std::max((p-a).Dot(b-a)/(b-a).LengthSq(), T(0)), T(1));
+             worst = std::max(worst, (p-(a+(b-a)*s)).Length());
+         }
+     }
+     EXPECT_LT(worst, T(2)*settings.tolerance);
+     // an unchanged curve comes from the cache, a changed one is rebuilt
+     EXPECT_EQ(tessellator.Misses(), 1u);
+     EXPECT_EQ(&tessellator.Tessellate(curve), &line);
+     EXPECT_EQ(tessellator.Hits(), 1u);
+     points[3] = points[3]+Vector3D<T>(0, 0, T(0.5));
+     BSplineCurve<T> moved(3, points);
+     const typename Tessellator<T>::Tessellation& movedLine = tessellator.Tessellate(moved);
+     EXPECT_EQ(tessellator.Misses(), 2u);
+     EXPECT_EQ(tessellator.CacheSize(), 2u);
+     EXPECT_NE(movedLine.points.Get(movedLine.points.Size()/2).Z(), line.points.Get(line.points.Size()/2).Z());
+     // a straight Bezier needs no refinement
+     std::vector<Vector3D<T> > straight(4);
+     for(int i=0;i<4;i++)
+         straight[i] = Vector3D<T>(T(i), T(2*i), T(0));
+     EXPECT_EQ(tessellator.Tessellate(BezierCurve<T>(straight)).points.Size(), 4u);
+     // a patch gives a grid on the surface
+     std::vector<Vector3D<T> > net;
+     for(int i=0;i<4;i++)
+         for(int j=0;j<4;j++)
+             net.push_back(Vector3D<T>(T(i), T(j), T((i==1 || i==2) && (j==1 || j==2))));
+     BezierPatch<T> patch(3, 3, net);
+     const typename Tessellator<T>::Tessellation& grid = tessellator.Tessellate(patch);
+     EXPECT_GT(grid.uCount, 2u);
+     EXPECT_EQ(grid.uCount, grid.vCount);
+     ASSERT_EQ(grid.points.Size(), grid.uCount*grid.vCount);
+     ASSERT_EQ(grid.parameters.size(), grid.uCount+grid.vCount);
+     for(std::size_t j=0;j<grid.vCount;j++)
+         for(std::size_t i=0;i<grid.uCount;i++)
+             EXPECT_NEAR(grid.points.Get(j*grid.uCount+i).Distance(patch.Evaluate(grid.parameters[i], grid.parameters[grid.uCount+j])), T(0), T(1e-4));
+     // entries unused for more than maxAge frames are dropped
+     tessellator.NextFrame();
+     EXPECT_EQ(tessellator.CacheSize(), 4u);
+     tessellator.Tessellate(curve);
+     tessellator.NextFrame();
+     EXPECT_EQ(tessellator.CacheSize(), 1u);
+     EXPECT_EQ(tessellator.Hits(), 2u);
+     EXPECT_TRUE(tessellator.Tessellate(NURBSCurve<T>()).points.Empty());
+ }
+
+ TEST(TessellatorTest, AdaptiveAndCached) {
+     CheckTessellator<float>();
+     CheckTessellator<double>();
+ }
+
+ template<class T>
+ void CheckDistances() {
+     const T tol = std::is_same<T, float>::value?T(1e-4):T(1e-10);
+     srand(9);
+     PointArray3D<T> points;
+     for(int i=0;i<1003;i++)
+         points.PushBack(Vector3D<T>(T(rand()%400)/T(100)-T(2), T(rand()%400)/T(100)-T(2), T(rand()%400)/T(100)-T(2)));
+     Vector3D<T> a(T(-1), T(-0.5), T(0.2)), b(T(1.2), T(0.1), T(-0.3)), c(T(0.1), T(1.1), T(0.4));
+     AABB<T> box(Vector3D<T>(T(-0.5), T(-1), T(0)), Vector3D<T>(T(1), T(0.5), T(0.75)));
+     std::vector<T> segment(points.Size()), triangle(points.Size()), boxes(points.Size());
+     EXPECT_EQ(DistanceSqPointsSegment(points, a, b, &segment[0]), points.Size());
+     EXPECT_EQ(DistanceSqPointsTriangle(points, a, b, c, &triangle[0]), points.Size());
+     EXPECT_EQ(DistanceSqPointsAABB(points, box, &boxes[0]), points.Size());
+     for(std::size_t i=0;i<points.Size();i++) {
+         Vector3D<T> p = points.Get(i);
+         EXPECT_NEAR(segment[i], DistanceSqPointSegment(p, a, b), tol);
+         EXPECT_NEAR(boxes[i], DistanceSqPointAABB(p, box), tol);
+         EXPECT_NEAR(boxes[i], p.DistanceSq(ClosestPointOnAABB(p, box)), tol);
+         // the closest point is on the triangle and no sampled point of it is closer
+         T u, v;
+         Vector3D<T> q = ClosestPointOnTriangle(p, a, b, c, u, v);
+         EXPECT_GE(u, T(0));
+         EXPECT_GE(v, T(0));
+         EXPECT_LE(u+v, T(1)+tol);
+         EXPECT_NEAR(q.Distance(a+(b-a)*u+(c-a)*v), T(0), tol);
+         EXPECT_NEAR(triangle[i], p.DistanceSq(q), tol);
+         for(int s=0;s<=8;s++)
+             for(int r=0;s+r<=8;r++)
+                 EXPECT_LE(p.DistanceSq(q), p.DistanceSq(a+(b-a)*(T(s)/T(8))+(c-a)*(T(r)/T(8)))+tol);
+     }
+     // the batch stops at the first point beyond the bound
+     std::size_t first = 0;
+     while(segment[first] <= T(1))
+         first++;
+     std::vector<T> partial(points.Size(), T(-1));
+     EXPECT_EQ(DistanceSqPointsSegment(points, a, b, &partial[0], T(1)), first);
+     EXPECT_NEAR(partial[first], segment[first], tol);
+     EXPECT_EQ(DistanceSqPointsAABB(points, box, &partial[0], T(100)), points.Size());
+     EXPECT_EQ(DistanceSqPointsTriangle(points, a, b, c, &partial[0], T(-1)), 0u);
+     // a closed mesh (an octahedron of 8 indexed triangles) and the same as a soup
+     std::vector<Vector3D<T> > vertices;
+     vertices.push_back(Vector3D<T>(T(1.5), T(0), T(0))); vertices.push_back(Vector3D<T>(T(-1.5), T(0), T(0)));
+     vertices.push_back(Vector3D<T>(T(0), T(1.5), T(0))); vertices.push_back(Vector3D<T>(T(0), T(-1.5), T(0)));
+     vertices.push_back(Vector3D<T>(T(0), T(0), T(1.5))); vertices.push_back(Vector3D<T>(T(0.2), T(0), T(-1.5)));
+     std::vector<std::uint32_t> indices;
+     std::vector<Vector3D<T> > soup;
+     for(std::uint32_t i=0;i<2;i++)
+         for(std::uint32_t j=2;j<4;j++)
+             for(std::uint32_t k=4;k<6;k++) {
+                 indices.push_back(i); indices.push_back(j); indices.push_back(k);
+                 soup.push_back(vertices[i]); soup.push_back(vertices[j]); soup.push_back(vertices[k]);
+             }
+     std::vector<T> mesh(points.Size()), meshSoup(points.Size());
+     EXPECT_EQ(DistanceSqPointsMesh(points, vertices, indices, &mesh[0]), points.Size());
+     EXPECT_EQ(DistanceSqPointsMesh(points, soup, std::vector<std::uint32_t>(), &meshSoup[0]), points.Size());
+     first = points.Size();
+     for(std::size_t i=0;i<points.Size();i++) {
+         Vector3D<T> p = points.Get(i);
+         T nearest = std::numeric_limits<T>::infinity();
+         for(std::size_t t=0;t<indices.size();t+=3)
+             nearest = std::min(nearest, DistanceSqPointTriangle(p, vertices[indices[t]], vertices[indices[t+1]], vertices[indices[t+2]]));
+         EXPECT_NEAR(mesh[i], nearest, tol);
+         EXPECT_EQ(meshSoup[i], mesh[i]);
+         if(first == points.Size() && nearest > T(0.5))
+             first = i;
+     }
+     ASSERT_LT(first, points.Size());
+     EXPECT_EQ(DistanceSqPointsMesh(points, vertices, indices, &partial[0], T(0.5)), first);
+     // no triangles: every point is infinitely far
+     EXPECT_EQ(DistanceSqPointsMesh(points, std::vector<Vector3D<T> >(), indices, &partial[0]), points.Size());
+     EXPECT_EQ(partial[7], std::numeric_limits<T>::infinity());
+ }
+
+ TEST(DistancesTest, MatchesScalar) {
+     CheckDistances<float>();
+     CheckDistances<double>();
+ }
+
+ TEST(DistancesTest, Degenerate) {
+     Vector3Dd p(1, 2, 3), a(0, 0, 0), b(2, 0, 0);
+     double t;
+     EXPECT_EQ(ClosestPointOnSegment(p, a, a, t).X(), 0.0);
+     EXPECT_EQ(t, 0.0);
+     EXPECT_DOUBLE_EQ(DistanceSqPointSegment(p, a, b), 13.0);
+     // collinear and point triangles fall back to their edges
+     EXPECT_DOUBLE_EQ(DistanceSqPointTriangle(p, a, b, Vector3Dd(1, 0, 0)), 13.0);
+     EXPECT_DOUBLE_EQ(DistanceSqPointTriangle(p, a, a, a), 14.0);
+     PointArray3Dd points;
+     points.PushBack(p);
+     points.PushBack(Vector3Dd(1, 0, 0));
+     double out[2];
+     DistanceSqPointsTriangle(points, a, b, Vector3Dd(1, 0, 0), out);
+     EXPECT_DOUBLE_EQ(out[0], 13.0);
+     EXPECT_DOUBLE_EQ(out[1], 0.0);
+     EXPECT_EQ(DistanceSqPointsTriangle(PointArray3Dd(), a, b, p, out), 0u);
+     EXPECT_DOUBLE_EQ(DistanceSqPointAABB(p, AABBd(a, b)), 13.0);
+     EXPECT_EQ(DistanceSqPointAABB(Vector3Dd(1, 0, 0), AABBd(a, b)), 0.0);
+ }
+
+ template<class T>
+ void CheckHierarchy(T tol) {
+     // 3000 nodes with random earlier parents, so the insertion order is not
+     // breadth-first; small grain so the wide levels are split
+     typedef TransformHierarchy<T> Hierarchy;
+     typename Hierarchy::Settings settings;
+     settings.threads = 4;
+     settings.grain = 64;
+     Hierarchy h(settings);
+     typedef typename Hierarchy::NodeId NodeId;
+     std::size_t n = 3000;
+     std::vector<NodeId> parents(n);
+     std::vector<Matrix3D<T> > locals(n), worlds(n);
+     srand(23);
+     for(std::size_t i=0;i<n;i++) {
+         parents[i] = (i < 3)?NodeId(Hierarchy::None):NodeId(rand()%i);
+         locals[i].RotateX(T(rand()%100)/T(100));
+         locals[i].RotateZ(T(rand()%100)/T(100));
+         locals[i](3,0) = T(rand()%100)/T(100);
+         locals[i](3,1) = T(rand()%100)/T(100)-T(0.5);
+         EXPECT_EQ(h.AddNode(locals[i], parents[i]), NodeId(i));
+     }
+     EXPECT_EQ(h.Size(), n);
+     EXPECT_EQ(h.Parent(0), NodeId(Hierarchy::None));
+     EXPECT_EQ(h.Parent(3), parents[3]);
+     EXPECT_EQ(h.Depth(3), h.Depth(parents[3])+1);
+     EXPECT_EQ(h.Update(), n);
+     EXPECT_EQ(h.Update(), 0u);
+     for(std::size_t frame=0;frame<3;frame++) {
+         // move about 2% of the nodes; their subtrees must follow
+         std::vector<std::uint8_t> moved(n, 0);
+         for(std::size_t k=0;k<60;k++) {
+             std::size_t i = rand()%n;
+             locals[i].RotateY(T(0.1));
+             h.SetLocal(NodeId(i), locals[i]);
+             moved[i] = 1;
+         }
+         std::size_t expected = 0;
+         for(std::size_t i=0;i<n;i++) {
+             if(parents[i] != Hierarchy::None && moved[parents[i]])
+                 moved[i] = 1;
+             expected += moved[i];
+             worlds[i] = (parents[i] == Hierarchy::None)?locals[i]:locals[i]*worlds[parents[i]];
+         }
+         EXPECT_EQ(h.Update(), expected);
+         EXPECT_LT(expected, n/2);
+         for(std::size_t i=0;i<n;i++) {
+             ExpectMatrixNear(h.World(NodeId(i)), worlds[i], tol);
+             ExpectMatrixNear(h.Local(NodeId(i)), locals[i], T(0));
+         }
+         for(std::size_t i=0;i<n;i+=97)
+             ExpectMatrixNear(h.World(NodeId(i))*h.InverseWorld(NodeId(i)), Matrix3D<T>(), tol);
+     }
+ }
+
+ TEST(HierarchyTest, MatchesFullRecompute) {
+     CheckHierarchy<float>(1e-4f);
+     CheckHierarchy<double>(1e-12);
+ }
+
+ TEST(HierarchyTest, Structure) {
+     TransformHierarchyd h;
+     EXPECT_EQ(h.Update(), 0u);
+     EXPECT_EQ(h.AddNode(Matrix3Dd(), 5), TransformHierarchyd::NodeId(TransformHierarchyd::None));
+     Matrix3Dd shift;
+     shift(3,0) = 1;
+     // a chain, then a second root, then a child under the deepest node
+     TransformHierarchyd::NodeId a = h.AddNode(shift);
+     TransformHierarchyd::NodeId b = h.AddNode(shift, a);
+     TransformHierarchyd::NodeId c = h.AddNode(shift, b);
+     TransformHierarchyd::NodeId root = h.AddNode(Matrix3Dd());
+     EXPECT_EQ(h.Update(), 4u);
+     EXPECT_EQ(h.World(c)(3,0), 3.0);
+     TransformHierarchyd::NodeId d = h.AddNode(shift, c);
+     EXPECT_EQ(h.Update(), 1u);
+     EXPECT_EQ(h.World(d)(3,0), 4.0);
+     EXPECT_EQ(h.InverseWorld(d)(3,0), -4.0);
+     // moving the top of the chain moves everything below it, not the other root
+     shift(3,0) = 10;
+     h.SetLocal(a, shift);
+     EXPECT_EQ(h.Update(), 4u);
+     EXPECT_EQ(h.World(d)(3,0), 13.0);
+     EXPECT_EQ(h.InverseWorld(d)(3,0), -13.0);
+     ExpectMatrixNear(h.World(root), Matrix3Dd(), 0.0);
+     EXPECT_EQ(h.Parent(d), c);
+     EXPECT_EQ(h.Depth(d), 3u);
+     h.Clear();
+     EXPECT_EQ(h.Size(), 0u);
+     EXPECT_EQ(h.Update(), 0u);
+ }
+
+ template<class T>
+ void CheckSkinning(T tol) {
+     // a 53-bone palette and 1003 vertices (odd sizes reach the scalar tails)
+     std::size_t bones = 53, n = 1003;
+     srand(29);
+     MatrixArray3D<T> bind, world;
+     for(std::size_t i=0;i<bones;i++) {
+         TransformBuilder<T> b, w;
+         b.RotateX(T(rand()%100)/T(50)).Translate(T(rand()%100)/T(10), T(-1), T(2));
+         w.Scale(T(1), T(1.5), T(1)).RotateZ(T(rand()%100)/T(50)).Translate(T(3), T(rand()%100)/T(10), T(0));
+         bind.PushBack(b.Build());
+         world.PushBack(w.Build());
+     }
+     MatrixArray3D<T> palette;
+     EXPECT_TRUE(Multiply(bind, world, palette));
+     EXPECT_EQ(palette.Size(), bones);
+     for(std::size_t i=0;i<bones;i++)
+         ExpectMatrixNear(palette.Get(i), bind.Get(i)*world.Get(i), tol);
+     MatrixArray3D<T> inPlace = bind;
+     EXPECT_TRUE(Multiply(inPlace, world, inPlace));
+     for(std::size_t i=0;i<bones;i++)
+         ExpectMatrixNear(inPlace.Get(i), palette.Get(i), T(0));
+     // one to four influences per vertex, weights summing to 1
+     std::vector<Vector3D<T> > raw(n);
+     SkinWeights<T> weights(n);
+     std::vector<Vector3D<T> > ref(n);
+     for(std::size_t i=0;i<n;i++) {
+         raw[i] = Vector3D<T>(T(rand()%200)/T(100), T(rand()%200)/T(100), T(rand()%200)/T(100));
+         unsigned count = unsigned(i%4)+1;
+         std::uint16_t ids[4];
+         T w[4], sum = 0;
+         for(unsigned j=0;j<count;j++) {
+             ids[j] = std::uint16_t(rand()%bones);
+             w[j] = T(rand()%100+1);
+             sum += w[j];
+         }
+         ref[i] = Vector3D<T>(0, 0, 0);
+         for(unsigned j=0;j<count;j++) {
+             w[j] /= sum;
+             ref[i] += (raw[i]*palette.Get(ids[j]))*w[j];
+         }
+         EXPECT_TRUE(weights.Set(i, count, ids, w));
+     }
+     EXPECT_EQ(weights.Influences(), 4u);
+     PointArray3D<T> rest(raw), out;
+     EXPECT_TRUE(Skin(rest, weights, palette, out));
+     EXPECT_EQ(out.Size(), n);
+     for(std::size_t i=0;i<n;i++) {
+         EXPECT_NEAR(out.Get(i).X(), ref[i].X(), tol*T(20));
+         EXPECT_NEAR(out.Get(i).Y(), ref[i].Y(), tol*T(20));
+         EXPECT_NEAR(out.Get(i).Z(), ref[i].Z(), tol*T(20));
+     }
+     EXPECT_TRUE(Skin(rest, weights, palette, rest));
+     for(std::size_t i=0;i<n;i++)
+         EXPECT_EQ(rest.Get(i), out.Get(i));
+ }
+
+ TEST(SkinningTest, MatchesPerVertex) {
+     CheckSkinning<float>(1e-4f);
+     CheckSkinning<double>(1e-12);
+ }
+
+ TEST(SkinningTest, Invalid) {
+     MatrixArray3Df a(3), b(2), out;
+     ExpectMatrixNear(a.Get(2), Matrix3Df(), 0.0f);
+     EXPECT_FALSE(Multiply(a, b, out));
+     b.Resize(3);
+     EXPECT_TRUE(Multiply(a, b, out));
+     ExpectMatrixNear(out.Get(1), Matrix3Df(), 0.0f);
+     // too many influences, bones outside the palette, size mismatches
+     SkinWeightsf weights(2);
+     std::uint16_t ids[5] = {0, 1, 2, 3, 4};
+     float w[5] = {0.2f, 0.2f, 0.2f, 0.2f, 0.2f};
+     EXPECT_FALSE(weights.Set(0, 5, ids, w));
+     EXPECT_EQ(weights.Influences(), 0u);
+     PointArray3Df rest(2), skinned;
+     rest.Set(0, Vector3Df(1, 2, 3));
+     rest.Set(1, Vector3Df(4, 5, 6));
+     EXPECT_TRUE(weights.Set(0, 1, ids+2, w));
+     EXPECT_TRUE(Skin(rest, weights, a, skinned));
+     // 0.2 of the identity; the second vertex has no influences
+     EXPECT_EQ(skinned.Get(0), Vector3Df(0.2f, 0.4f, 0.6f));
+     EXPECT_EQ(skinned.Get(1), Vector3Df(0, 0, 0));
+     EXPECT_TRUE(weights.Set(1, 4, ids, w));
+     EXPECT_EQ(weights.MaxBone(), 3u);
+     EXPECT_FALSE(Skin(rest, weights, a, skinned));
+     // overwriting the influences of the vertex drops its old bones
+     EXPECT_TRUE(weights.Set(1, 2, ids, w));
+     EXPECT_EQ(weights.MaxBone(), 2u);
+     EXPECT_TRUE(Skin(rest, weights, a, skinned));
+     EXPECT_NEAR(skinned.Get(1).X(), 1.6f, 1e-6f);
+     EXPECT_NEAR(skinned.Get(1).Z(), 2.4f, 1e-6f);
+     EXPECT_TRUE(weights.Set(1, 4, ids, w));
+     EXPECT_FALSE(Skin(PointArray3Df(3), weights, b, skinned));
+     EXPECT_TRUE(Skin(PointArray3Df(), SkinWeightsf(), MatrixArray3Df(), skinned));
+     EXPECT_TRUE(skinned.Empty());
+ }
+
+ // Morton code by moving one bit at a time
+ std::uint64_t MortonReference(std::uint64_t x, std::uint64_t y, std::uint64_t z, unsigned bits) {
+     std::uint64_t code = 0;
+     for(unsigned i=0;i<bits;i++)
+         code |= (((x >> i) & 1) << (3*i)) | (((y >> i) & 1) << (3*i+1)) | (((z >> i) & 1) << (3*i+2));
+     return code;
+ }
+
+ TEST(MortonTest, Codes) {
+     srand(31);
+     for(int k=0;k<1000;k++) {
+         std::uint32_t x = rand()%1024, y = rand()%1024, z = rand()%1024;
+         EXPECT_EQ(Morton32(x, y, z), MortonReference(x, y, z, 10));
+         std::uint64_t X = (std::uint64_t(rand()) << 10 ^ rand()) & 0x1FFFFF;
+         std::uint64_t Y = (std::uint64_t(rand()) << 10 ^ rand()) & 0x1FFFFF;
+         std::uint64_t Z = (std::uint64_t(rand()) << 10 ^ rand()) & 0x1FFFFF;
+         EXPECT_EQ(Morton64(X, Y, Z), MortonReference(X, Y, Z, 21));
+     }
+     EXPECT_EQ(Morton32(1023, 1023, 1023), 0x3FFFFFFFu);
+     EXPECT_EQ(Morton64(0x1FFFFF, 0x1FFFFF, 0x1FFFFF), 0x7FFFFFFFFFFFFFFFull);
+     // quantisation in a box: corners, cells, clamping, flat axes and NaN
+     AABBf box(Vector3Df(-1, 0, 2), Vector3Df(1, 4, 2));
+     EXPECT_EQ(MortonCode32(Vector3Df(-1, 0, 2), box), 0u);
+     EXPECT_EQ(MortonCode32(Vector3Df(1, 4, 2), box), Morton32(1023, 1023, 0));
+     EXPECT_EQ(MortonCode32(Vector3Df(0, 1, 2), box), Morton32(512, 256, 0));
+     EXPECT_EQ(MortonCode64(Vector3Df(0, 1, 2), box), Morton64(1 << 20, 1 << 19, 0));
+     EXPECT_EQ(MortonCode32(Vector3Df(-5, 9, 7), box), Morton32(0, 1023, 0));
+     EXPECT_EQ(MortonCode32(Vector3Df(std::numeric_limits<float>::quiet_NaN(), 1, 2), box), Morton32(0, 256, 0));
+     PointArray3Df points;
+     points.PushBack(Vector3Df(0, 1, 2));
+     points.PushBack(Vector3Df(1, 4, 2));
+     std::vector<std::uint64_t> codes;
+     MortonCodes(points, box, codes);
+     EXPECT_EQ(codes.size(), 2u);
+     EXPECT_EQ(codes[0], MortonCode64(points.Get(0), box));
+     EXPECT_EQ(codes[1], MortonCode64(points.Get(1), box));
+ }
+
+ template<class Code>
+ void CheckRadixSort(std::size_t n, Code mask) {
+     std::vector<Code> codes(n);
+     for(std::size_t i=0;i<n;i++)
+         codes[i] = ((Code(rand()) << 31) ^ (Code(rand()) << 15) ^ Code(rand())) & mask;
+     std::vector<std::pair<Code,std::uint32_t> > ref(n);
+     for(std::size_t i=0;i<n;i++)
+         ref[i] = std::make_pair(codes[i], std::uint32_t(i));
+     std::stable_sort(ref.begin(), ref.end(), [](const std::pair<Code,std::uint32_t>& a, const std::pair<Code,std::uint32_t>& b) {return a.first < b.first;});
+     std::vector<std::uint32_t> order;
+     RadixSort(codes, order);
+     ASSERT_EQ(order.size(), n);
+     for(std::size_t i=0;i<n;i++) {
+         EXPECT_EQ(codes[i], ref[i].first);
+         EXPECT_EQ(order[i], ref[i].second);
+     }
+ }
+
+ TEST(MortonTest, SortAndReorder) {
+     srand(37);
+     CheckRadixSort<std::uint32_t>(0, 0x3FFFFFFF);
+     CheckRadixSort<std::uint32_t>(1, 0x3FFFFFFF);
+     CheckRadixSort<std::uint32_t>(5000, 0x3FFFFFFF);
+     CheckRadixSort<std::uint32_t>(5000, 0x00FF00FF); // skipped passes
+     CheckRadixSort<std::uint64_t>(5000, 0x7FFFFFFFFFFFFFFFull);
+     // chunked passes on four threads give the same result
+     WorkStealingExecutor::Settings settings;
+     settings.threads = 4;
+     settings.grain = 256;
+     WorkStealingExecutor executor(settings);
+     SetDefaultExecutor(&executor);
+     CheckRadixSort<std::uint32_t>(10007, 0x3FFFFFFF);
+     CheckRadixSort<std::uint64_t>(10007, 0x000000FFFFFF00FFull);
+     // points and an attribute array follow the codes
+     std::vector<Vector3Df> raw = std::vector<Vector3Df>(3001);
+     std::vector<int> ids(raw.size());
+     for(std::size_t i=0;i<raw.size();i++) {
+         raw[i] = Vector3Df(float(rand()%1000), float(rand()%1000), float(rand()%1000));
+         ids[i] = int(i);
+     }
+     PointArray3Df points(raw);
+     std::vector<std::uint32_t> codes, order;
+     MortonSort(points, codes, order);
+     EXPECT_TRUE(Reorder(order, ids));
+     AABBf box = AABBf::FromPoints(PointArray3Df(raw));
+     for(std::size_t i=0;i<raw.size();i++) {
+         EXPECT_EQ(points.Get(i), raw[ids[i]]);
+         EXPECT_EQ(codes[i], MortonCode32(points.Get(i), box));
+         if(i > 0) {
+             EXPECT_LE(codes[i-1], codes[i]);
+         }
+     }
+     SetDefaultExecutor(0);
+     std::vector<int> shorter(3);
+     EXPECT_FALSE(Reorder(order, shorter));
+     EXPECT_EQ(shorter.size(), 3u);
+     // radix-tree splits: the upper half starts where the highest differing bit is set
+     std::uint32_t split[6] = {1, 2, 3, 8, 9, 12};
+     EXPECT_EQ(MortonSplit(split, 0, 6), 3u);
+     EXPECT_EQ(MortonSplit(split, 3, 6), 5u);
+     EXPECT_EQ(MortonSplit(split, 0, 3), 1u);
+     std::uint32_t same[4] = {7, 7, 7, 7};
+     EXPECT_EQ(MortonSplit(same, 0, 4), 2u);
+ }
+
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
@@ -0,0 +1,114 @@
+#include <3DTools/Helper.hpp>
+#include <3DTools/Vector3D.hpp>
+#include <3DTools/Matrix3D.hpp>
+using namespace Tools3D;
+
+/**
+* Compile-time tests: everything here is checked with static_assert,
+* so building this file is the test
+**/
+
+// Helper
+static_assert(DegreesToRadians(180.0) == Pi, "DegreesToRadians");
+static_assert(RadiansToDegrees(HalfPi) == 90.0, "RadiansToDegrees");
+
+// Vector3D construction and arithmetic
+constexpr Vector3Dd a(1.0, 2.0, 3.0);
+constexpr Vector3Dd b(-2.0, 0.5, 4.0);
+static_assert(a.X() == 1.0 && a.Y() == 2.0 && a.Z() == 3.0, "Vector3D constructor");
+static_assert(Vector3Dd().IsZero(), "Vector3D default constructor");
+static_assert(a+b == Vector3Dd(-1.0, 2.5, 7.0), "Vector3D operator+");
+static_assert(a-b == Vector3Dd(3.0, 1.5, -1.0), "Vector3D operator-");
+static_assert(a*2.0 == Vector3Dd(2.0, 4.0, 6.0), "Vector3D operator*");
+static_assert(a/2.0 == Vector3Dd(0.5, 1.0, 1.5), "Vector3D operator/");
+static_assert(a*b == 11.0, "Vector3D dot product");
+static_assert(a.Cross(b) == Vector3Dd(6.5, -10.0, 4.5), "Vector3D Cross");
+static_assert(a.LengthSq() == 14.0, "Vector3D LengthSq");
+static_assert(a.DistanceSq(b) == 12.25, "Vector3D DistanceSq");
+static_assert(a.Reverse() == Vector3Dd(-1.0, -2.0, -3.0), "Vector3D Reverse");
+
+// Matrix3D construction, Identity, Transpose, Det and products
+constexpr Matrix3Dd I;
+constexpr Matrix3Dd M(1, 2, 0, 0,
+                      0, 1, 0, 0,
+                      3, 0, 2, 0,
+                      4, 5, 6, 1);
+static_assert(I(0,0) == 1.0 && I(0,1) == 0.0 && I(3,3) == 1.0, "Matrix3D default constructor");
+static_assert(M.Transpose()(0,3) == 4.0 && M.Transpose()(3,0) == 0.0, "Matrix3D Transpose");
+static_assert(M.Det() == 2.0, "Matrix3D Det");
+static_assert((M*I)(3,2) == 6.0 && (I*M)(2,0) == 3.0, "Matrix3D product with Identity");
+static_assert((M*M)(0,1) == 4.0 && (M*M)(3,0) == 26.0, "Matrix3D product");
+static_assert((M*2.0)(1,1) == 2.0, "Matrix3D scalar product");
+static_assert(a*M == Vector3Dd(14.0, 9.0, 12.0), "Vector3D * Matrix3D");
+
+constexpr Matrix3Dd Translation(double dx, double dy, double dz)
+{
+    Matrix3Dd m;
+    m.Translate(dx, dy, dz);
+    return m;
+}
+static_assert(Vector3Dd(1, 1, 1)*Translation(1, 2, 3) == Vector3Dd(2, 3, 4), "Matrix3D Translate");
+
+constexpr Matrix3Dd Identity()
+{
+    Matrix3Dd m = M;
+    m.Identity();
+    return m;
+}
+static_assert(Identity()(3,0) == 0.0 && Identity()(2,2) == 1.0, "Matrix3D Identity");
+
+/**
+* Cube-map face orientations (+X, -X, +Y, -Y, +Z, -Z):
+* rows are the face's right, up and forward axes
+**/
+constexpr Matrix3Df CubeFaces[6] = {
+    Matrix3Df( 0, 0,-1,0,  0, 1, 0,0,  1, 0, 0,0, 0,0,0,1),
+    Matrix3Df( 0, 0, 1,0,  0, 1, 0,0, -1, 0, 0,0, 0,0,0,1),
+    Matrix3Df( 1, 0, 0,0,  0, 0,-1,0,  0, 1, 0,0, 0,0,0,1),
+    Matrix3Df( 1, 0, 0,0,  0, 0, 1,0,  0,-1, 0,0, 0,0,0,1),
+    Matrix3Df( 1, 0, 0,0,  0, 1, 0,0,  0, 0, 1,0, 0,0,0,1),
+    Matrix3Df(-1, 0, 0,0,  0, 1, 0,0,  0, 0,-1,0, 0,0,0,1)
+};
+
+constexpr bool CubeFacesAreRotations()
+{
+    for(int f=0;f<6;f++)
+    {
+        if(CubeFaces[f].Det() != 1.0f)
+            return false;
+        Matrix3Df p = CubeFaces[f]*CubeFaces[f].Transpose();
+        for(int i=0;i<4;i++)
+            for(int j=0;j<4;j++)
+                if(p(i,j) != ((i==j)?1.0f:0.0f))
+                    return false;
+    }
+    return true;
+}
+static_assert(CubeFacesAreRotations(), "Cube-map faces are orthonormal rotations");
+static_assert(Vector3Df(0, 0, 1)*CubeFaces[0] == Vector3Df(1, 0, 0), "+X face looks along +X");
+
+/**
+* Table of rotations by multiples of 90 degrees around z-axis, built at compile time
+**/
+struct RotationTable
+{
+    Matrix3Dd m[4];
+    constexpr RotationTable():m()
+    {
+        Matrix3Dd quarter(0, 1, 0, 0,
+                          -1, 0, 0, 0,
+                          0, 0, 1, 0,
+                          0, 0, 0, 1);
+        for(int i=1;i<4;i++)
+            m[i] = m[i-1]*quarter;
+    }
+};
+constexpr RotationTable ZRotations;
+static_assert(Vector3Dd(1, 0, 0)*ZRotations.m[1] == Vector3Dd(0, 1, 0), "90 degrees around z");
+static_assert(Vector3Dd(1, 0, 0)*ZRotations.m[2] == Vector3Dd(-1, 0, 0), "180 degrees around z");
+static_assert((ZRotations.m[3]*ZRotations.m[1])(0,0) == 1.0, "270 + 90 degrees around z");
+
+int main()
+{
+    return 0;
+}